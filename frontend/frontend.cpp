@@ -247,11 +247,48 @@ auto RunTimedPhase(std::string_view phase_name, std::vector<PhaseTiming>* phase_
     phase_timings->push_back(PhaseTiming{
         std::string(phase_name),
         std::chrono::duration<double>(end - start).count(),
+        {},
     });
   }
   return result;
 }
 
+struct LoweredModule {
+  HIRModule hir;
+  internal::HIRMayThrowSummary may_throw;
+};
+
+LoweredModule LowerForLlvm(std::string_view source, std::string_view filename,
+                           ExecutionMode mode, bool strict_mode,
+                           std::vector<PhaseTiming>* phase_timings) {
+  const std::string preprocessed = RunTimedPhase(
+      "preprocess", phase_timings,
+      [&]() { return internal::RunPreprocessor(source, filename, mode); });
+
+  const internal::ParsedNode parsed =
+      RunTimedPhase("parse", phase_timings,
+                    [&]() { return internal::ParseAst(preprocessed, filename); });
+  const TypedNode root =
+      RunTimedPhase("sema", phase_timings, [&]() {
+        return internal::AnalyzeSemantics(parsed, filename, strict_mode);
+      });
+
+  LoweredModule lowered;
+  lowered.hir = RunTimedPhase("hir-lower", phase_timings,
+                              [&]() { return internal::LowerToHir(root, filename); });
+
+  lowered.may_throw = RunTimedPhase("may-throw", phase_timings,
+                                    [&]() { return internal::AnalyzeMayThrow(lowered.hir); });
+  if (phase_timings != nullptr && !phase_timings->empty()) {
+    phase_timings->back().counters = {
+        PhaseCounter{"try-regions", lowered.may_throw.try_regions},
+        PhaseCounter{"try-regions-elided", lowered.may_throw.nothrow_try_region_count},
+        PhaseCounter{"nounwind-functions", lowered.may_throw.nounwind_function_count},
+    };
+  }
+  return lowered;
+}
+
 }  // namespace
 
 ParseResult ParseAndDumpAst(std::string_view source, std::string_view filename,
@@ -343,27 +380,17 @@ ParseResult EmitHir(std::string_view source, std::string_view filename, Executio
 
 ParseResult EmitLlvmIr(std::string_view source, std::string_view filename,
                        ExecutionMode mode, bool strict_mode,
-                       std::vector<PhaseTiming>* phase_timings) {
+                       std::vector<PhaseTiming>* phase_timings,
+                       ExceptionModel exception_model) {
   try {
-    const std::string preprocessed = RunTimedPhase(
-        "preprocess", phase_timings,
-        [&]() { return internal::RunPreprocessor(source, filename, mode); });
-
-    const internal::ParsedNode parsed =
-        RunTimedPhase("parse", phase_timings,
-                      [&]() { return internal::ParseAst(preprocessed, filename); });
-    const TypedNode root =
-        RunTimedPhase("sema", phase_timings, [&]() {
-          return internal::AnalyzeSemantics(parsed, filename, strict_mode);
-        });
-
-    const HIRModule module =
-        RunTimedPhase("hir-lower", phase_timings,
-                      [&]() { return internal::LowerToHir(root, filename); });
-
+    const LoweredModule lowered =
+        LowerForLlvm(source, filename, mode, strict_mode, phase_timings);
     const llvm_backend::Result irbuilder = RunTimedPhase(
         "llvm-emit", phase_timings,
-        [&]() { return llvm_irbuilder_backend::EmitIrFromHir(module, "holyc"); });
+        [&]() {
+          return llvm_irbuilder_backend::EmitIrFromHir(lowered.hir, "holyc", "", exception_model,
+                                                       &lowered.may_throw, mode);
+        });
     if (irbuilder.ok) {
       return ParseResult{true, irbuilder.output};
     }
@@ -373,4 +400,24 @@ ParseResult EmitLlvmIr(std::string_view source, std::string_view filename,
   }
 }
 
+ParseResult EmitLlvmModule(std::string_view source, std::string_view filename,
+                           llvm_backend::IrModulePtr* module_out, ExecutionMode mode,
+                           bool strict_mode, std::vector<PhaseTiming>* phase_timings,
+                           ExceptionModel exception_model) {
+  try {
+    const LoweredModule lowered =
+        LowerForLlvm(source, filename, mode, strict_mode, phase_timings);
+    const llvm_backend::Result irbuilder = RunTimedPhase(
+        "llvm-emit", phase_timings,
+        [&]() {
+          return llvm_irbuilder_backend::EmitModuleFromHir(lowered.hir, module_out, "holyc", "",
+                                                           exception_model, &lowered.may_throw,
+                                                           mode);
+        });
+    return ParseResult{irbuilder.ok, irbuilder.output};
+  } catch (const std::exception& ex) {
+    return ParseResult{false, ex.what()};
+  }
+}
+
 }  // namespace holyc::frontend
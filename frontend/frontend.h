@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "llvm_backend.h"
+
 namespace holyc::frontend {
 
 struct ParseResult {
@@ -11,9 +14,15 @@ struct ParseResult {
   std::string output;
 };
 
+struct PhaseCounter {
+  std::string name;
+  std::int64_t value = 0;
+};
+
 struct PhaseTiming {
   std::string name;
   double seconds = 0.0;
+  std::vector<PhaseCounter> counters;
 };
 
 enum class ExecutionMode {
@@ -21,6 +30,11 @@ enum class ExecutionMode {
   kAot,
 };
 
+enum class ExceptionModel {
+  kTable,
+  kSetjmp,
+};
+
 ParseResult PreprocessSource(std::string_view source, std::string_view filename,
                              ExecutionMode mode = ExecutionMode::kJit,
                              bool strict_mode = true,
@@ -40,6 +54,13 @@ ParseResult EmitHir(std::string_view source, std::string_view filename,
 ParseResult EmitLlvmIr(std::string_view source, std::string_view filename,
                        ExecutionMode mode = ExecutionMode::kAot,
                        bool strict_mode = true,
-                       std::vector<PhaseTiming>* phase_timings = nullptr);
+                       std::vector<PhaseTiming>* phase_timings = nullptr,
+                       ExceptionModel exception_model = ExceptionModel::kTable);
+ParseResult EmitLlvmModule(std::string_view source, std::string_view filename,
+                           llvm_backend::IrModulePtr* module_out,
+                           ExecutionMode mode = ExecutionMode::kAot,
+                           bool strict_mode = true,
+                           std::vector<PhaseTiming>* phase_timings = nullptr,
+                           ExceptionModel exception_model = ExceptionModel::kTable);
 
 }  // namespace holyc::frontend
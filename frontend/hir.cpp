@@ -397,6 +397,162 @@ class HIRLowerer {
       add_builtin_function(std::move(spawn));
     }
 
+    {
+      FunctionSig yield;
+      yield.return_type = "U0";
+      yield.name = "Yield";
+      yield.linkage_kind = "external";
+      add_builtin_function(std::move(yield));
+    }
+
+    {
+      FunctionSig spawn_grp_begin;
+      spawn_grp_begin.return_type = "CSpawnGrp *";
+      spawn_grp_begin.name = "SpawnGrpBegin";
+      spawn_grp_begin.linkage_kind = "external";
+      add_builtin_function(std::move(spawn_grp_begin));
+    }
+
+    {
+      FunctionSig spawn_grp_cnt;
+      spawn_grp_cnt.return_type = "I64";
+      spawn_grp_cnt.name = "SpawnGrpCnt";
+      spawn_grp_cnt.linkage_kind = "external";
+      spawn_grp_cnt.params.push_back(ParamSig{"CSpawnGrp *", "grp", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(spawn_grp_cnt));
+    }
+
+    {
+      FunctionSig proc_spawn;
+      proc_spawn.return_type = "I64";
+      proc_spawn.name = "ProcSpawn";
+      proc_spawn.linkage_kind = "external";
+      proc_spawn.params.push_back(ParamSig{"U8*", "cmd", false, Node{}});
+      proc_spawn.params.push_back(ParamSig{"I64", "flags", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(proc_spawn));
+    }
+
+    {
+      FunctionSig proc_scan;
+      proc_scan.return_type = "Bool";
+      proc_scan.name = "ProcScan";
+      proc_scan.linkage_kind = "external";
+      proc_scan.params.push_back(ParamSig{"I64", "proc", false, Node{}});
+      proc_scan.params.push_back(ParamSig{"I64 *", "_status", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(proc_scan));
+    }
+
+    {
+      FunctionSig proc_out;
+      proc_out.return_type = "U8*";
+      proc_out.name = "ProcOut";
+      proc_out.linkage_kind = "external";
+      proc_out.params.push_back(ParamSig{"I64", "proc", false, Node{}});
+      proc_out.params.push_back(ParamSig{"I64 *", "_len", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(proc_out));
+    }
+
+    {
+      FunctionSig proc_err;
+      proc_err.return_type = "U8*";
+      proc_err.name = "ProcErr";
+      proc_err.linkage_kind = "external";
+      proc_err.params.push_back(ParamSig{"I64", "proc", false, Node{}});
+      proc_err.params.push_back(ParamSig{"I64 *", "_len", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(proc_err));
+    }
+
+    {
+      FunctionSig fifo_i64_new;
+      fifo_i64_new.return_type = "CFifoI64 *";
+      fifo_i64_new.name = "FifoI64New";
+      fifo_i64_new.linkage_kind = "external";
+      fifo_i64_new.params.push_back(ParamSig{"I64", "size", false, Node{}});
+      fifo_i64_new.params.push_back(ParamSig{"CTask *", "mem_task", true, MakeIntLiteralNode("0")});
+      fifo_i64_new.params.push_back(ParamSig{"I64", "flags", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(fifo_i64_new));
+    }
+
+    {
+      FunctionSig fifo_u8_new;
+      fifo_u8_new.return_type = "CFifoU8 *";
+      fifo_u8_new.name = "FifoU8New";
+      fifo_u8_new.linkage_kind = "external";
+      fifo_u8_new.params.push_back(ParamSig{"I64", "size", false, Node{}});
+      fifo_u8_new.params.push_back(ParamSig{"CTask *", "mem_task", true, MakeIntLiteralNode("0")});
+      fifo_u8_new.params.push_back(ParamSig{"I64", "flags", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(fifo_u8_new));
+    }
+
+    {
+      FunctionSig malloc_sig;
+      malloc_sig.return_type = "U8*";
+      malloc_sig.name = "MAlloc";
+      malloc_sig.linkage_kind = "external";
+      malloc_sig.params.push_back(ParamSig{"I64", "size", false, Node{}});
+      malloc_sig.params.push_back(ParamSig{"CTask *", "mem_task", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(malloc_sig));
+    }
+
+    {
+      FunctionSig calloc_sig;
+      calloc_sig.return_type = "U8*";
+      calloc_sig.name = "CAlloc";
+      calloc_sig.linkage_kind = "external";
+      calloc_sig.params.push_back(ParamSig{"I64", "size", false, Node{}});
+      calloc_sig.params.push_back(ParamSig{"CTask *", "mem_task", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(calloc_sig));
+    }
+
+    {
+      FunctionSig job_res_scan;
+      job_res_scan.return_type = "Bool";
+      job_res_scan.name = "JobResScan";
+      job_res_scan.linkage_kind = "external";
+      job_res_scan.params.push_back(ParamSig{"CJob *", "job", false, Node{}});
+      job_res_scan.params.push_back(ParamSig{"I64 *", "_res", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(job_res_scan));
+    }
+
+    {
+      FunctionSig job_res_any;
+      job_res_any.return_type = "I64";
+      job_res_any.name = "JobResAny";
+      job_res_any.linkage_kind = "external";
+      job_res_any.params.push_back(ParamSig{"CJob **", "jobs", false, Node{}});
+      job_res_any.params.push_back(ParamSig{"I64", "cnt", false, Node{}});
+      job_res_any.params.push_back(ParamSig{"I64 *", "_res", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(job_res_any));
+    }
+
+    {
+      FunctionSig job_par_for;
+      job_par_for.return_type = "U0";
+      job_par_for.name = "JobParFor";
+      job_par_for.linkage_kind = "external";
+      job_par_for.params.push_back(ParamSig{"I64", "lo", false, Node{}});
+      job_par_for.params.push_back(ParamSig{"I64", "hi", false, Node{}});
+      job_par_for.params.push_back(ParamSig{"I64", "grain", false, Node{}});
+      job_par_for.params.push_back(ParamSig{"U8*", "fn", false, Node{}});
+      job_par_for.params.push_back(ParamSig{"U8*", "ctx", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(job_par_for));
+    }
+
+    {
+      FunctionSig job_par_reduce;
+      job_par_reduce.return_type = "I64";
+      job_par_reduce.name = "JobParReduce";
+      job_par_reduce.linkage_kind = "external";
+      job_par_reduce.params.push_back(ParamSig{"I64", "lo", false, Node{}});
+      job_par_reduce.params.push_back(ParamSig{"I64", "hi", false, Node{}});
+      job_par_reduce.params.push_back(ParamSig{"I64", "grain", false, Node{}});
+      job_par_reduce.params.push_back(ParamSig{"U8*", "fn", false, Node{}});
+      job_par_reduce.params.push_back(ParamSig{"U8*", "ctx", true, MakeIntLiteralNode("0")});
+      job_par_reduce.params.push_back(ParamSig{"U8*", "combine", true, MakeIntLiteralNode("0")});
+      job_par_reduce.params.push_back(ParamSig{"I64", "identity", true, MakeIntLiteralNode("0")});
+      add_builtin_function(std::move(job_par_reduce));
+    }
+
     for (const Node& child : program.children) {
       if (child.kind != "FunctionDecl") {
         continue;
@@ -1313,6 +1469,197 @@ class HIRLowerer {
   std::vector<int> exception_region_stack_;
 };
 
+// Runtime entry points that return without raising a HolyC exception.
+// Builtins the runtime does not define, and ones that start other work,
+// stay off the list.
+bool IsNoThrowBuiltin(const std::string& name) {
+  static const std::unordered_set<std::string> kNoThrowBuiltins = {
+      "HashFind",    "MemberMetaData", "MemberMetaFind", "MemberFind",  "Yield",
+      "Sleep",       "SpawnGrpBegin",  "SpawnGrpCnt",    "FifoI64New",  "FifoI64Del",
+      "FifoI64Ins",  "FifoI64Rem",     "FifoI64Peek",    "FifoI64Flush", "FifoI64Cnt",
+      "FifoU8New",   "FifoU8Del",      "FifoU8Ins",      "FifoU8Rem",   "FifoU8Peek",
+      "FifoU8Flush", "FifoU8Cnt",      "JobResScan",     "MAlloc",      "CAlloc",
+      "Free",        "TaskCur",
+  };
+  return kNoThrowBuiltins.find(name) != kNoThrowBuiltins.end();
+}
+
+// Runtime queries that read the try regions around the caller. A function
+// that reaches one is treated as throwing past its own regions, so callers
+// keep the invokes and try frames the answer is read from.
+bool IsHandlerQuery(const std::string& name) {
+  return name == "hc_try_depth" || name == "hc_exception_active";
+}
+
+class MayThrowAnalyzer {
+ public:
+  explicit MayThrowAnalyzer(const HIRModule& module) : module_(module) {
+    for (const HIRFunction& fn : module_.functions) {
+      defined_[fn.name] = &fn;
+    }
+  }
+
+  HIRMayThrowSummary Run() {
+    std::unordered_map<std::string, std::vector<const HIRFunction*>> callers;
+    std::vector<const HIRFunction*> worklist;
+    for (const HIRFunction& fn : module_.functions) {
+      std::vector<std::string> callees;
+      callees_ = &callees;
+      MarkIfThrowing(fn, &worklist);
+      callees_ = nullptr;
+      for (const std::string& callee : callees) {
+        if (defined_.find(callee) != defined_.end()) {
+          callers[callee].push_back(&fn);
+        }
+      }
+    }
+
+    while (!worklist.empty()) {
+      const HIRFunction* fn = worklist.back();
+      worklist.pop_back();
+      const auto it = callers.find(fn->name);
+      if (it == callers.end()) {
+        continue;
+      }
+      for (const HIRFunction* caller : it->second) {
+        const bool caller_done = throwing_.find(caller->name) != throwing_.end() &&
+                                 (observing_.find(caller->name) != observing_.end() ||
+                                  observing_.find(fn->name) == observing_.end());
+        if (!caller_done) {
+          MarkIfThrowing(*caller, &worklist);
+        }
+      }
+    }
+
+    HIRMayThrowSummary summary;
+    summary_ = &summary;
+    for (const HIRFunction& fn : module_.functions) {
+      regions_ = &summary.nothrow_try_regions[fn.name];
+      (void)StmtListMayThrow(fn.body);
+      if (regions_->empty()) {
+        summary.nothrow_try_regions.erase(fn.name);
+      }
+      if (throwing_.find(fn.name) == throwing_.end()) {
+        summary.nounwind_functions.insert(fn.name);
+        ++summary.nounwind_function_count;
+      }
+    }
+    regions_ = nullptr;
+    summary_ = nullptr;
+    for (const HIRFunctionDecl& decl : module_.function_decls) {
+      if (defined_.find(decl.name) == defined_.end() && IsNoThrowBuiltin(decl.name)) {
+        summary.nounwind_functions.insert(decl.name);
+      }
+    }
+    return summary;
+  }
+
+ private:
+  void MarkIfThrowing(const HIRFunction& fn, std::vector<const HIRFunction*>* worklist) {
+    observes_ = false;
+    bool added = StmtListMayThrow(fn.body) && throwing_.insert(fn.name).second;
+    if (observes_ && observing_.insert(fn.name).second) {
+      added = true;
+    }
+    if (added) {
+      worklist->push_back(&fn);
+    }
+  }
+
+  bool CallMayThrow(const std::string& name) {
+    if (callees_ != nullptr) {
+      callees_->push_back(name);
+    }
+    if (IsHandlerQuery(name) || observing_.find(name) != observing_.end()) {
+      observes_ = true;
+    }
+    if (defined_.find(name) != defined_.end()) {
+      return throwing_.find(name) != throwing_.end();
+    }
+    return !IsNoThrowBuiltin(name);
+  }
+
+  bool ExprMayThrow(const HIRExpr& expr) {
+    bool may_throw = false;
+    if (expr.kind == HIRExpr::Kind::kCall) {
+      may_throw = expr.text.empty() || CallMayThrow(expr.text);
+    }
+    for (const HIRExpr& child : expr.children) {
+      if (ExprMayThrow(child)) {
+        may_throw = true;
+      }
+    }
+    return may_throw;
+  }
+
+  bool StmtListMayThrow(const std::vector<HIRStmt>& stmts) {
+    bool may_throw = false;
+    for (const HIRStmt& st : stmts) {
+      if (StmtMayThrow(st)) {
+        may_throw = true;
+      }
+    }
+    return may_throw;
+  }
+
+  bool StmtMayThrow(const HIRStmt& st) {
+    if (st.kind == HIRStmt::Kind::kTryCatch) {
+      const bool outer_observes = observes_;
+      observes_ = false;
+      const bool body_may_throw = StmtListMayThrow(st.try_body);
+      const bool body_observes = observes_;
+      const bool handler_may_throw = StmtListMayThrow(st.catch_body);
+      observes_ = observes_ || outer_observes;
+      if (summary_ != nullptr) {
+        ++summary_->try_regions;
+        if (!body_may_throw) {
+          regions_->insert(st.exception_region_id);
+          ++summary_->nothrow_try_region_count;
+        }
+      }
+      return body_may_throw && (handler_may_throw || body_observes);
+    }
+
+    bool may_throw = st.kind == HIRStmt::Kind::kThrow || st.kind == HIRStmt::Kind::kInlineAsm;
+    if (st.kind == HIRStmt::Kind::kNoParenCall && CallMayThrow(st.name)) {
+      may_throw = true;
+    }
+    const HIRExpr* exprs[] = {&st.expr, &st.print_format, &st.switch_cond, &st.flow_cond};
+    for (const HIRExpr* expr : exprs) {
+      if (ExprMayThrow(*expr)) {
+        may_throw = true;
+      }
+    }
+    for (const std::vector<HIRExpr>* list : {&st.print_args, &st.asm_operands}) {
+      for (const HIRExpr& expr : *list) {
+        if (ExprMayThrow(expr)) {
+          may_throw = true;
+        }
+      }
+    }
+    for (const std::vector<HIRStmt>& body : st.switch_case_bodies) {
+      if (StmtListMayThrow(body)) {
+        may_throw = true;
+      }
+    }
+    for (const std::vector<HIRStmt>* list : {&st.switch_default, &st.flow_then, &st.flow_else}) {
+      if (StmtListMayThrow(*list)) {
+        may_throw = true;
+      }
+    }
+    return may_throw;
+  }
+
+  const HIRModule& module_;
+  std::unordered_map<std::string, const HIRFunction*> defined_;
+  std::unordered_set<std::string> throwing_;
+  std::unordered_set<std::string> observing_;
+  bool observes_ = false;
+  std::vector<std::string>* callees_ = nullptr;
+  HIRMayThrowSummary* summary_ = nullptr;
+  std::unordered_set<int>* regions_ = nullptr;
+};
+
 }  // namespace
 
 HIRModule LowerToHir(const TypedNode& program, std::string_view filename) {
@@ -1320,4 +1667,9 @@ HIRModule LowerToHir(const TypedNode& program, std::string_view filename) {
   return lowerer.LowerModule(program);
 }
 
+HIRMayThrowSummary AnalyzeMayThrow(const HIRModule& module) {
+  MayThrowAnalyzer analyzer(module);
+  return analyzer.Run();
+}
+
 }  // namespace holyc::frontend::internal
@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -126,6 +128,15 @@ struct HIRModule {
   HIRReflectionTable reflection;
 };
 
+struct HIRMayThrowSummary {
+  std::unordered_set<std::string> nounwind_functions;
+  std::unordered_map<std::string, std::unordered_set<int>> nothrow_try_regions;
+  std::int64_t try_regions = 0;
+  std::int64_t nothrow_try_region_count = 0;
+  std::int64_t nounwind_function_count = 0;
+};
+
 HIRModule LowerToHir(const TypedNode& program, std::string_view filename);
+HIRMayThrowSummary AnalyzeMayThrow(const HIRModule& module);
 
 }  // namespace holyc::frontend::internal
@@ -806,6 +806,9 @@ class SemanticAnalyzer {
                          {ParamSig{"U8*", "name", false},
                           ParamSig{"U8*", "table", false},
                           ParamSig{"I64", "kind", false}});
+    add_builtin_function("MemberFind", "CMemberLst *",
+                         {ParamSig{"U8*", "needle_str", false},
+                          ParamSig{"CHashClass *", "haystack_class", false}});
     add_builtin_function("MemberMetaData", "I64",
                          {ParamSig{"U8*", "key", false},
                           ParamSig{"CMemberLst *", "ml", false}});
@@ -820,12 +823,95 @@ class SemanticAnalyzer {
                           ParamSig{"CTask *", "parent", true},
                           ParamSig{"I64", "stk_size", true},
                           ParamSig{"I64", "flags", true}});
+    add_builtin_function("Yield", "U0", {});
+    add_builtin_function("Sleep", "U0", {ParamSig{"I64", "ms", false}});
+    add_builtin_function("SpawnGrpBegin", "CSpawnGrp *", {});
+    add_builtin_function("SpawnGrpWait", "U0", {ParamSig{"CSpawnGrp *", "grp", false}});
+    add_builtin_function("SpawnGrpCnt", "I64", {ParamSig{"CSpawnGrp *", "grp", true}});
+    add_builtin_function("ProcSpawn", "I64",
+                         {ParamSig{"U8*", "cmd", false},
+                          ParamSig{"I64", "flags", true}});
+    add_builtin_function("ProcWait", "I64", {ParamSig{"I64", "proc", false}});
+    add_builtin_function("ProcScan", "Bool",
+                         {ParamSig{"I64", "proc", false},
+                          ParamSig{"I64 *", "_status", true}});
+    add_builtin_function("ProcOut", "U8*",
+                         {ParamSig{"I64", "proc", false},
+                          ParamSig{"I64 *", "_len", true}});
+    add_builtin_function("ProcErr", "U8*",
+                         {ParamSig{"I64", "proc", false},
+                          ParamSig{"I64 *", "_len", true}});
+    add_builtin_function("ProcDel", "U0", {ParamSig{"I64", "proc", false}});
+    add_builtin_function("FifoI64New", "CFifoI64 *",
+                         {ParamSig{"I64", "size", false},
+                          ParamSig{"CTask *", "mem_task", true},
+                          ParamSig{"I64", "flags", true}});
+    add_builtin_function("FifoI64Del", "U0", {ParamSig{"CFifoI64 *", "f", false}});
+    add_builtin_function("FifoI64Ins", "Bool",
+                         {ParamSig{"CFifoI64 *", "f", false},
+                          ParamSig{"I64", "q", false}});
+    add_builtin_function("FifoI64Rem", "Bool",
+                         {ParamSig{"CFifoI64 *", "f", false},
+                          ParamSig{"I64 *", "_q", false}});
+    add_builtin_function("FifoI64Peek", "Bool",
+                         {ParamSig{"CFifoI64 *", "f", false},
+                          ParamSig{"I64 *", "_q", false}});
+    add_builtin_function("FifoI64Flush", "U0", {ParamSig{"CFifoI64 *", "f", false}});
+    add_builtin_function("FifoI64Cnt", "I64", {ParamSig{"CFifoI64 *", "f", false}});
+    add_builtin_function("FifoI64InsWait", "U0",
+                         {ParamSig{"CFifoI64 *", "f", false},
+                          ParamSig{"I64", "q", false}});
+    add_builtin_function("FifoI64RemWait", "I64", {ParamSig{"CFifoI64 *", "f", false}});
+    add_builtin_function("FifoU8New", "CFifoU8 *",
+                         {ParamSig{"I64", "size", false},
+                          ParamSig{"CTask *", "mem_task", true},
+                          ParamSig{"I64", "flags", true}});
+    add_builtin_function("FifoU8Del", "U0", {ParamSig{"CFifoU8 *", "f", false}});
+    add_builtin_function("FifoU8Ins", "Bool",
+                         {ParamSig{"CFifoU8 *", "f", false},
+                          ParamSig{"I64", "b", false}});
+    add_builtin_function("FifoU8Rem", "Bool",
+                         {ParamSig{"CFifoU8 *", "f", false},
+                          ParamSig{"U8 *", "_b", false}});
+    add_builtin_function("FifoU8Peek", "Bool",
+                         {ParamSig{"CFifoU8 *", "f", false},
+                          ParamSig{"U8 *", "_b", false}});
+    add_builtin_function("FifoU8Flush", "U0", {ParamSig{"CFifoU8 *", "f", false}});
+    add_builtin_function("FifoU8Cnt", "I64", {ParamSig{"CFifoU8 *", "f", false}});
+    add_builtin_function("FifoU8InsWait", "U0",
+                         {ParamSig{"CFifoU8 *", "f", false},
+                          ParamSig{"I64", "b", false}});
+    add_builtin_function("FifoU8RemWait", "I64", {ParamSig{"CFifoU8 *", "f", false}});
     add_builtin_function("JobQue", "CJob *",
                          {ParamSig{"U8*", "fn", false},
                           ParamSig{"U8*", "arg", false},
                           ParamSig{"I64", "cpu", false},
                           ParamSig{"I64", "flags", false}});
     add_builtin_function("JobResGet", "I64", {ParamSig{"CJob *", "job", false}});
+    add_builtin_function("JobResScan", "Bool",
+                         {ParamSig{"CJob *", "job", false},
+                          ParamSig{"I64 *", "_res", true}});
+    add_builtin_function("JobResAny", "I64",
+                         {ParamSig{"CJob **", "jobs", false},
+                          ParamSig{"I64", "cnt", false},
+                          ParamSig{"I64 *", "_res", true}});
+    add_builtin_function("JobThen", "CJob *",
+                         {ParamSig{"CJob *", "job", false},
+                          ParamSig{"U8*", "fn", false}});
+    add_builtin_function("JobParFor", "U0",
+                         {ParamSig{"I64", "lo", false},
+                          ParamSig{"I64", "hi", false},
+                          ParamSig{"I64", "grain", false},
+                          ParamSig{"U8*", "fn", false},
+                          ParamSig{"U8*", "ctx", true}});
+    add_builtin_function("JobParReduce", "I64",
+                         {ParamSig{"I64", "lo", false},
+                          ParamSig{"I64", "hi", false},
+                          ParamSig{"I64", "grain", false},
+                          ParamSig{"U8*", "fn", false},
+                          ParamSig{"U8*", "ctx", true},
+                          ParamSig{"U8*", "combine", true},
+                          ParamSig{"I64", "identity", true}});
     add_builtin_function("CallStkGrow", "I64",
                          {ParamSig{"I64", "stack_min", false},
                           ParamSig{"I64", "stack_max", false},
@@ -833,6 +919,12 @@ class SemanticAnalyzer {
                           ParamSig{"I64", "a0", true},
                           ParamSig{"I64", "a1", true},
                           ParamSig{"I64", "a2", true}});
+    add_builtin_function("MAlloc", "U8*",
+                         {ParamSig{"I64", "size", false}, ParamSig{"CTask *", "mem_task", true}});
+    add_builtin_function("CAlloc", "U8*",
+                         {ParamSig{"I64", "size", false}, ParamSig{"CTask *", "mem_task", true}});
+    add_builtin_function("Free", "U0", {ParamSig{"U8*", "addr", false}});
+    add_builtin_function("TaskCur", "CTask *", {});
   }
 
   void CollectFunctionSignatures(const Node& program) {
@@ -1,15 +1,24 @@
 #include "llvm_backend.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -31,12 +40,22 @@ extern char** environ;
 #endif
 
 #ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 #include <llvm/ExecutionEngine/Orc/AbsoluteSymbols.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
 #include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
 #include <llvm/ExecutionEngine/Orc/Mangling.h>
 #include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/PassManager.h>
@@ -48,11 +67,18 @@ extern char** environ;
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/InitLLVM.h>
 #include <llvm/Support/Error.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA1.h>
 #include <llvm/Support/SourceMgr.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/TargetParser/Host.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+
+#include "llvm_ir_module.h"
+#include "version.h"
 #endif
 
 namespace holyc::llvm_backend {
@@ -302,12 +328,582 @@ std::string SessionKey(std::string_view session_name) {
   return session_name.empty() ? "__default__" : std::string(session_name);
 }
 
+JitOptions& ActiveJitOptions() {
+  static JitOptions options;
+  return options;
+}
+
+struct JitBackendCounters {
+  std::atomic<std::int64_t> hits{0};
+  std::atomic<std::int64_t> misses{0};
+  std::atomic<std::int64_t> stores{0};
+  std::atomic<std::int64_t> evictions{0};
+  std::atomic<std::int64_t> lazy_partitions{0};
+  std::atomic<std::int64_t> lazy_functions{0};
+  std::atomic<std::int64_t> tier_functions{0};
+  std::atomic<std::int64_t> tier_requests{0};
+  std::atomic<std::int64_t> tier_promotions{0};
+  std::atomic<std::int64_t> tier_failures{0};
+  std::atomic<std::int64_t> partitions{0};
+};
+
+JitBackendCounters& BackendCounters() {
+  static JitBackendCounters counters;
+  return counters;
+}
+
+constexpr std::string_view kCachedModulePrefix = "holyc-jit-cache:";
+
+std::string CachedModuleKey(const llvm::Module* module) {
+  const std::string& id = module->getModuleIdentifier();
+  if (id.rfind(kCachedModulePrefix, 0) != 0) {
+    return "";
+  }
+  return id.substr(kCachedModulePrefix.size());
+}
+
+class JitObjectCache : public llvm::ObjectCache {
+ public:
+  JitObjectCache(std::filesystem::path dir, std::uint64_t max_bytes)
+      : dir_(std::move(dir)), max_bytes_(max_bytes) {}
+
+  bool Preload(const std::string& key) {
+    const std::filesystem::path path = PathFor(key);
+    auto buffer = llvm::MemoryBuffer::getFile(path.string());
+    if (!buffer) {
+      ++BackendCounters().misses;
+      return false;
+    }
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    std::lock_guard<std::mutex> lock(mutex_);
+    preloaded_[key] = std::move(*buffer);
+    ++BackendCounters().hits;
+    return true;
+  }
+
+  void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) override {
+    const std::string key = CachedModuleKey(module);
+    if (key.empty()) {
+      return;
+    }
+    // An object that alone exceeds the cap would only evict everything else
+    // and then itself, so it is not stored.
+    if (max_bytes_ != 0 && object.getBufferSize() > max_bytes_) {
+      return;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) {
+      return;
+    }
+
+    const std::filesystem::path path = PathFor(key);
+    std::filesystem::path temp_path = path;
+    temp_path += ".tmp" + std::to_string(llvm::sys::Process::getProcessId());
+    {
+      std::ofstream out(temp_path, std::ios::binary);
+      out.write(object.getBufferStart(), static_cast<std::streamsize>(object.getBufferSize()));
+      if (!out.good()) {
+        out.close();
+        std::filesystem::remove(temp_path, ec);
+        return;
+      }
+    }
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+      std::filesystem::remove(temp_path, ec);
+      return;
+    }
+    ++BackendCounters().stores;
+    Evict(path);
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override {
+    const std::string key = CachedModuleKey(module);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = preloaded_.find(key);
+    if (it == preloaded_.end()) {
+      return nullptr;
+    }
+    std::unique_ptr<llvm::MemoryBuffer> buffer = std::move(it->second);
+    preloaded_.erase(it);
+    return buffer;
+  }
+
+ private:
+  struct CacheEntry {
+    std::filesystem::path path;
+    std::uint64_t size = 0;
+    std::filesystem::file_time_type last_used;
+  };
+
+  std::filesystem::path PathFor(const std::string& key) const { return dir_ / (key + ".o"); }
+
+  // Removes least recently used objects until the cache fits the cap. The
+  // object just stored is never a candidate.
+  void Evict(const std::filesystem::path& keep) {
+    if (max_bytes_ == 0) {
+      return;
+    }
+    std::error_code ec;
+    std::vector<CacheEntry> entries;
+    std::uint64_t total = 0;
+    for (std::filesystem::directory_iterator it(dir_, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      if (!it->is_regular_file(ec) || it->path().extension() != ".o") {
+        continue;
+      }
+      CacheEntry entry;
+      entry.path = it->path();
+      entry.size = it->file_size(ec);
+      entry.last_used = it->last_write_time(ec);
+      total += entry.size;
+      entries.push_back(std::move(entry));
+    }
+    if (total <= max_bytes_) {
+      return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) {
+      return a.last_used < b.last_used;
+    });
+    for (const CacheEntry& entry : entries) {
+      if (total <= max_bytes_) {
+        break;
+      }
+      if (entry.path == keep) {
+        continue;
+      }
+      if (std::filesystem::remove(entry.path, ec)) {
+        total -= entry.size;
+        ++BackendCounters().evictions;
+      }
+    }
+  }
+
+  std::filesystem::path dir_;
+  std::uint64_t max_bytes_ = 0;
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::unique_ptr<llvm::MemoryBuffer>> preloaded_;
+};
+
+std::string ModuleCacheKey(const llvm::Module& module, OptLevel opt_level,
+                           std::string_view target_id) {
+  llvm::SmallVector<char, 0> bitcode;
+  llvm::raw_svector_ostream os(bitcode);
+  llvm::WriteBitcodeToFile(module, os);
+
+  llvm::SHA1 hasher;
+  hasher.update(llvm::StringRef(bitcode.data(), bitcode.size()));
+  hasher.update(std::to_string(static_cast<int>(opt_level)));
+  hasher.update(target_id);
+  // Objects from another LLVM or holyc build may lower the same bitcode
+  // differently, so both versions are part of the key.
+  hasher.update(LLVM_VERSION_STRING);
+  hasher.update(HOLYC_VERSION);
+  return llvm::toHex(hasher.final(), true);
+}
+
+struct TierLog {
+  std::mutex mutex;
+  std::vector<JitTierTransition> transitions;
+};
+
+TierLog& TierTransitionLog() {
+  static TierLog log;
+  return log;
+}
+
+const char* OptLevelName(OptLevel opt_level) {
+  switch (opt_level) {
+    case OptLevel::kO0:
+      return "O0";
+    case OptLevel::kO1:
+      return "O1";
+    case OptLevel::kO2:
+      return "O2";
+    case OptLevel::kO3:
+      return "O3";
+    case OptLevel::kOs:
+      return "Os";
+    case OptLevel::kOz:
+      return "Oz";
+  }
+  return "O2";
+}
+
+constexpr std::string_view kTierUpSymbol = "__holyc_tier_up";
+constexpr std::string_view kJitEntryPrefix = "__holyc_entry_";
+constexpr std::string_view kJitEntryTargetPrefix = "__holyc_entry_target_";
+
+// The wrapper ExecuteModuleJit puts around each run's entry point is not
+// program code, so per-function counters leave it out.
+bool IsJitEntryWrapper(const llvm::Function& fn) {
+  const llvm::StringRef name = fn.getName();
+  return name.starts_with(kJitEntryPrefix) && !name.starts_with(kJitEntryTargetPrefix);
+}
+
+constexpr std::string_view kTierOneSuffix = ".tier1";
+
+// Tier-0 code only runs until its function gets hot, so tiered sessions
+// compile it without backend optimization. Promoted bodies are compiled in
+// modules named after them and keep the host's default codegen level.
+class TieredIRCompiler : public llvm::orc::IRCompileLayer::IRCompiler {
+ public:
+  explicit TieredIRCompiler(llvm::orc::JITTargetMachineBuilder jtmb)
+      : IRCompiler(llvm::orc::irManglingOptionsFromTargetOptions(jtmb.getOptions())),
+        tier_one_(jtmb),
+        tier_zero_(std::move(jtmb.setCodeGenOptLevel(llvm::CodeGenOptLevel::None))) {}
+
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> operator()(llvm::Module& module) override {
+    if (llvm::StringRef(module.getModuleIdentifier()).ends_with(kTierOneSuffix)) {
+      return tier_one_(module);
+    }
+    return tier_zero_(module);
+  }
+
+ private:
+  llvm::orc::ConcurrentIRCompiler tier_one_;
+  llvm::orc::ConcurrentIRCompiler tier_zero_;
+};
+
+class TierManager;
+
+struct TieredFunction {
+  std::atomic<std::uint64_t> calls{0};
+  TierManager* manager = nullptr;
+  llvm::orc::JITDylib* dylib = nullptr;
+  llvm::orc::IndirectStubsManager* stubs = nullptr;
+  std::shared_ptr<const llvm::SmallVector<char, 0>> bitcode;
+  std::string name;
+  OptLevel opt_level = OptLevel::kO2;
+};
+
+class TierManager {
+ public:
+  TierManager(llvm::orc::LLJIT* jit, std::uint64_t threshold)
+      : jit_(jit),
+        threshold_(std::max<std::uint64_t>(threshold, 1)),
+        stubs_builder_(llvm::orc::createLocalIndirectStubsManagerBuilder(jit->getTargetTriple())) {}
+
+  TierManager(const TierManager&) = delete;
+  TierManager& operator=(const TierManager&) = delete;
+
+  // Promotions already requested are finished before the worker exits, so
+  // the tier-up counters are final once the session is gone.
+  ~TierManager() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+  // Routes every defined function through an indirection stub whose initial
+  // target is the instrumented O0 body. The uninstrumented module is kept as
+  // bitcode so hot functions can be recompiled without the counters.
+  Result Instrument(llvm::orc::JITDylib& jd, llvm::Module& module, OptLevel opt_level,
+                    std::vector<TieredFunction*>* tiered_out) {
+    llvm::orc::SymbolLinkagePromoter promote;
+    promote(module);
+
+    std::vector<llvm::Function*> candidates;
+    for (llvm::Function& fn : module) {
+      if (fn.isDeclaration() || fn.getName().starts_with("__holyc_")) {
+        continue;
+      }
+      const bool has_block_address = std::any_of(
+          fn.user_begin(), fn.user_end(),
+          [](const llvm::User* user) { return llvm::isa<llvm::BlockAddress>(user); });
+      if (!has_block_address) {
+        candidates.push_back(&fn);
+      }
+    }
+    if (candidates.empty()) {
+      return Result{true, ""};
+    }
+
+    auto bitcode = std::make_shared<llvm::SmallVector<char, 0>>();
+    {
+      llvm::raw_svector_ostream os(*bitcode);
+      llvm::WriteBitcodeToFile(module, os);
+    }
+
+    std::unique_ptr<llvm::orc::IndirectStubsManager> stubs = stubs_builder_();
+    llvm::orc::IndirectStubsManager::StubInitsMap inits;
+    for (llvm::Function* fn : candidates) {
+      inits[fn->getName()] = {llvm::orc::ExecutorAddr(),
+                              llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable};
+    }
+    if (auto err = stubs->createStubs(inits)) {
+      return Result{false, llvm::toString(std::move(err))};
+    }
+
+    llvm::orc::MangleAndInterner mangle(jit_->getExecutionSession(), jit_->getDataLayout());
+    llvm::orc::SymbolMap stub_symbols;
+    for (llvm::Function* fn : candidates) {
+      stub_symbols[mangle(fn->getName())] = stubs->findStub(fn->getName(), false);
+    }
+    if (auto err = jd.define(llvm::orc::absoluteSymbols(std::move(stub_symbols)))) {
+      return Result{false, llvm::toString(std::move(err))};
+    }
+
+    llvm::LLVMContext& context = module.getContext();
+    llvm::FunctionCallee tier_up = module.getOrInsertFunction(
+        kTierUpSymbol, llvm::FunctionType::get(llvm::Type::getVoidTy(context),
+                                               {llvm::Type::getInt64Ty(context)}, false));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (llvm::Function* fn : candidates) {
+      auto record = std::make_unique<TieredFunction>();
+      record->manager = this;
+      record->dylib = &jd;
+      record->stubs = stubs.get();
+      record->bitcode = bitcode;
+      record->name = fn->getName().str();
+      record->opt_level = opt_level;
+
+      fn->setName(record->name + ".tier0");
+      fn->setLinkage(llvm::GlobalValue::ExternalLinkage);
+      fn->setVisibility(llvm::GlobalValue::DefaultVisibility);
+      llvm::Function* stub_decl = llvm::Function::Create(
+          fn->getFunctionType(), llvm::Function::ExternalLinkage, record->name, module);
+      stub_decl->setCallingConv(fn->getCallingConv());
+      stub_decl->setAttributes(fn->getAttributes());
+      fn->replaceAllUsesWith(stub_decl);
+      InsertEntryCounter(fn, record.get(), tier_up);
+
+      tiered_out->push_back(record.get());
+      functions_.push_back(std::move(record));
+    }
+    stubs_.push_back(std::move(stubs));
+    BackendCounters().tier_functions += static_cast<std::int64_t>(candidates.size());
+    return Result{true, ""};
+  }
+
+  Result InstallStubs(const std::vector<TieredFunction*>& tiered) {
+    for (TieredFunction* fn : tiered) {
+      auto body = jit_->lookup(*fn->dylib, fn->name + ".tier0");
+      if (!body) {
+        return Result{false, llvm::toString(body.takeError())};
+      }
+      if (auto err = fn->stubs->updatePointer(fn->name, *body)) {
+        return Result{false, llvm::toString(std::move(err))};
+      }
+    }
+    return Result{true, ""};
+  }
+
+  void Request(TieredFunction* fn) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_) {
+        return;
+      }
+      queue_.push_back(fn);
+      if (!worker_.joinable()) {
+        worker_ = std::thread([this]() { Run(); });
+      }
+    }
+    ++BackendCounters().tier_requests;
+    wake_.notify_one();
+  }
+
+ private:
+  void InsertEntryCounter(llvm::Function* fn, TieredFunction* record,
+                          llvm::FunctionCallee tier_up) {
+    llvm::LLVMContext& context = fn->getContext();
+    llvm::Type* i64_ty = llvm::Type::getInt64Ty(context);
+    llvm::Type* ptr_ty = llvm::PointerType::get(context, 0);
+
+    llvm::BasicBlock& entry = fn->getEntryBlock();
+    auto split = entry.begin();
+    while (llvm::isa<llvm::AllocaInst>(*split)) {
+      ++split;
+    }
+    llvm::BasicBlock* body = entry.splitBasicBlock(split, "tier.body");
+    llvm::BasicBlock* promote = llvm::BasicBlock::Create(context, "tier.promote", fn, body);
+    entry.getTerminator()->eraseFromParent();
+
+    llvm::IRBuilder<> builder(&entry);
+    llvm::Value* counter = builder.CreateIntToPtr(
+        llvm::ConstantInt::get(i64_ty, reinterpret_cast<std::uintptr_t>(&record->calls)), ptr_ty);
+    llvm::Value* previous = builder.CreateAtomicRMW(
+        llvm::AtomicRMWInst::Add, counter, llvm::ConstantInt::get(i64_ty, 1), llvm::MaybeAlign(8),
+        llvm::AtomicOrdering::Monotonic);
+    llvm::Value* hot = builder.CreateICmpEQ(previous, llvm::ConstantInt::get(i64_ty, threshold_ - 1));
+    builder.CreateCondBr(hot, promote, body);
+
+    builder.SetInsertPoint(promote);
+    builder.CreateCall(tier_up,
+                       {llvm::ConstantInt::get(i64_ty, reinterpret_cast<std::uintptr_t>(record))});
+    builder.CreateBr(body);
+  }
+
+  void Run() {
+    for (;;) {
+      TieredFunction* fn = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        fn = queue_.front();
+        queue_.pop_front();
+      }
+
+      JitTierTransition transition;
+      transition.function = fn->name;
+      transition.from = "O0";
+      transition.to = OptLevelName(fn->opt_level);
+      transition.calls = fn->calls.load(std::memory_order_relaxed);
+      const auto start = std::chrono::steady_clock::now();
+      const Result promoted = Promote(fn);
+      transition.compile_ms =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+              .count();
+      transition.ok = promoted.ok;
+      transition.error = promoted.output;
+      ++(promoted.ok ? BackendCounters().tier_promotions : BackendCounters().tier_failures);
+
+      TierLog& log = TierTransitionLog();
+      std::lock_guard<std::mutex> lock(log.mutex);
+      log.transitions.push_back(std::move(transition));
+    }
+  }
+
+  // Recompiles one function at its tier-up level. Only the target and its
+  // direct callees are read from the snapshot; the callees become
+  // available_externally so they can be inlined while the emitted object
+  // still defines only the promoted body, and everything else is cloned as
+  // a declaration.
+  Result Promote(TieredFunction* fn) {
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto snapshot_or_err = llvm::getLazyBitcodeModule(
+        llvm::MemoryBufferRef(llvm::StringRef(fn->bitcode->data(), fn->bitcode->size()),
+                              "holyc-tier"),
+        *context);
+    if (!snapshot_or_err) {
+      return Result{false, llvm::toString(snapshot_or_err.takeError())};
+    }
+    std::unique_ptr<llvm::Module> snapshot = std::move(*snapshot_or_err);
+
+    llvm::Function* source = snapshot->getFunction(fn->name);
+    if (source == nullptr || source->isDeclaration()) {
+      return Result{false, "tier: missing body for " + fn->name};
+    }
+    if (auto err = source->materialize()) {
+      return Result{false, llvm::toString(std::move(err))};
+    }
+    std::unordered_set<const llvm::GlobalValue*> bodies{source};
+    for (llvm::Instruction& inst : llvm::instructions(*source)) {
+      const auto* call = llvm::dyn_cast<llvm::CallBase>(&inst);
+      llvm::Function* callee = call != nullptr ? call->getCalledFunction() : nullptr;
+      if (callee == nullptr || callee->isDeclaration() || !bodies.insert(callee).second) {
+        continue;
+      }
+      if (auto err = callee->materialize()) {
+        return Result{false, llvm::toString(std::move(err))};
+      }
+    }
+
+    llvm::ValueToValueMapTy clone_map;
+    std::unique_ptr<llvm::Module> module =
+        llvm::CloneModule(*snapshot, clone_map, [&bodies](const llvm::GlobalValue* value) {
+          if (const auto* global = llvm::dyn_cast<llvm::GlobalVariable>(value)) {
+            return global->isConstant() && !global->getName().starts_with("llvm.");
+          }
+          return bodies.contains(value);
+        });
+    // The value map and the snapshot live in the context handed to the JIT
+    // below, so both go before the module leaves this thread.
+    clone_map.clear();
+    snapshot.reset();
+    llvm::Function* target = module->getFunction(fn->name);
+
+    std::vector<llvm::GlobalVariable*> special;
+    for (llvm::GlobalVariable& global : module->globals()) {
+      if (global.getName().starts_with("llvm.")) {
+        special.push_back(&global);
+        continue;
+      }
+      global.setComdat(nullptr);
+      global.setVisibility(llvm::GlobalValue::DefaultVisibility);
+      if (!global.isDeclaration()) {
+        global.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+      }
+    }
+    for (llvm::GlobalVariable* global : special) {
+      global->eraseFromParent();
+    }
+    for (llvm::Function& other : *module) {
+      if (&other == target || other.isDeclaration()) {
+        continue;
+      }
+      other.setComdat(nullptr);
+      other.setVisibility(llvm::GlobalValue::DefaultVisibility);
+      other.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+    }
+
+    const std::string body_name = fn->name + std::string(kTierOneSuffix);
+    target->setName(body_name);
+    module->setModuleIdentifier(body_name);
+    target->setLinkage(llvm::GlobalValue::ExternalLinkage);
+    target->setVisibility(llvm::GlobalValue::DefaultVisibility);
+
+    module->setDataLayout(jit_->getDataLayout());
+    const Result optimized = OptimizeModule(*module, fn->opt_level);
+    if (!optimized.ok) {
+      return optimized;
+    }
+
+    if (auto err = jit_->addIRModule(
+            *fn->dylib, llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+      return Result{false, llvm::toString(std::move(err))};
+    }
+    auto body = jit_->lookup(*fn->dylib, body_name);
+    if (!body) {
+      return Result{false, llvm::toString(body.takeError())};
+    }
+    if (auto err = fn->stubs->updatePointer(fn->name, *body)) {
+      return Result{false, llvm::toString(std::move(err))};
+    }
+    return Result{true, ""};
+  }
+
+  llvm::orc::LLJIT* jit_ = nullptr;
+  std::uint64_t threshold_ = 1;
+  std::function<std::unique_ptr<llvm::orc::IndirectStubsManager>()> stubs_builder_;
+  std::vector<std::unique_ptr<llvm::orc::IndirectStubsManager>> stubs_;
+  std::vector<std::unique_ptr<TieredFunction>> functions_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<TieredFunction*> queue_;
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+void TierUpEntry(std::uint64_t record) {
+  auto* fn = reinterpret_cast<TieredFunction*>(static_cast<std::uintptr_t>(record));
+  fn->manager->Request(fn);
+}
+
 struct JitSessionState {
+  std::shared_ptr<JitObjectCache> object_cache;
+  std::string cache_target_id;
   std::unique_ptr<llvm::orc::LLJIT> jit;
+  llvm::orc::LLLazyJIT* lazy_jit = nullptr;
   llvm::orc::JITDylib* runtime_dylib = nullptr;
+  unsigned compile_threads = 0;
   std::vector<llvm::orc::JITDylib*> module_dylibs;
   std::uint64_t next_module_id = 0;
   std::uint64_t next_entry_id = 0;
+  std::unique_ptr<TierManager> tiering;
 };
 
 std::unordered_map<std::string, JitSessionState>& JitSessions() {
@@ -338,8 +934,24 @@ llvm_backend::Result RegisterRuntimeSymbols(llvm::orc::LLJIT& jit, llvm::orc::JI
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_put_char, exported);
   symbols[mangle("hc_print_fmt")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_print_fmt, exported);
+  symbols[mangle("hc_output_flush")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_output_flush, exported);
+  symbols[mangle("hc_fmt_write")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_fmt_write, exported);
+  symbols[mangle("hc_fmt_i64_dec")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_fmt_i64_dec, exported);
+  symbols[mangle("hc_fmt_u64")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_fmt_u64, exported);
+  symbols[mangle("hc_fmt_char")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_fmt_char, exported);
+  symbols[mangle("hc_fmt_str")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_fmt_str, exported);
+  symbols[mangle("hc_fmt_f64")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_fmt_f64, exported);
   symbols[mangle("hc_try_push")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_try_push, exported);
+  symbols[mangle("hc_try_push_cleanup")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_try_push_cleanup, exported);
   symbols[mangle("hc_try_pop")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_try_pop, exported);
   symbols[mangle("hc_throw_i64")] =
@@ -350,6 +962,8 @@ llvm_backend::Result RegisterRuntimeSymbols(llvm::orc::LLJIT& jit, llvm::orc::JI
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_exception_active, exported);
   symbols[mangle("hc_try_depth")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_try_depth, exported);
+  symbols[mangle("hc_personality_v0")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_personality_v0, exported);
   symbols[mangle("hc_register_reflection_table")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_register_reflection_table, exported);
   symbols[mangle("hc_reflection_field_count")] =
@@ -364,16 +978,102 @@ llvm_backend::Result RegisterRuntimeSymbols(llvm::orc::LLJIT& jit, llvm::orc::JI
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_memcpy, exported);
   symbols[mangle("hc_memset")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&hc_memset, exported);
+  symbols[mangle("hc_lock_acquire")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_lock_acquire, exported);
+  symbols[mangle("hc_lock_release")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_lock_release, exported);
+  symbols[mangle("hc_lock_acquire_n")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_lock_acquire_n, exported);
+  symbols[mangle("hc_lock_release_n")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&hc_lock_release_n, exported);
   symbols[mangle("CallStkGrow")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&CallStkGrow, exported);
   symbols[mangle("Spawn")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&Spawn, exported);
+  symbols[mangle("Yield")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&Yield, exported);
+  symbols[mangle("Sleep")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&Sleep, exported);
+  symbols[mangle("SpawnGrpBegin")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&SpawnGrpBegin, exported);
+  symbols[mangle("SpawnGrpWait")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&SpawnGrpWait, exported);
+  symbols[mangle("SpawnGrpCnt")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&SpawnGrpCnt, exported);
+  symbols[mangle("ProcSpawn")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&ProcSpawn, exported);
+  symbols[mangle("ProcWait")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&ProcWait, exported);
+  symbols[mangle("ProcScan")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&ProcScan, exported);
+  symbols[mangle("ProcOut")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&ProcOut, exported);
+  symbols[mangle("ProcErr")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&ProcErr, exported);
+  symbols[mangle("ProcDel")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&ProcDel, exported);
+  symbols[mangle("FifoI64New")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64New, exported);
+  symbols[mangle("FifoI64Del")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64Del, exported);
+  symbols[mangle("FifoI64Ins")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64Ins, exported);
+  symbols[mangle("FifoI64Rem")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64Rem, exported);
+  symbols[mangle("FifoI64Peek")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64Peek, exported);
+  symbols[mangle("FifoI64Flush")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64Flush, exported);
+  symbols[mangle("FifoI64Cnt")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64Cnt, exported);
+  symbols[mangle("FifoI64InsWait")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64InsWait, exported);
+  symbols[mangle("FifoI64RemWait")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoI64RemWait, exported);
+  symbols[mangle("FifoU8New")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8New, exported);
+  symbols[mangle("FifoU8Del")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8Del, exported);
+  symbols[mangle("FifoU8Ins")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8Ins, exported);
+  symbols[mangle("FifoU8Rem")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8Rem, exported);
+  symbols[mangle("FifoU8Peek")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8Peek, exported);
+  symbols[mangle("FifoU8Flush")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8Flush, exported);
+  symbols[mangle("FifoU8Cnt")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8Cnt, exported);
+  symbols[mangle("FifoU8InsWait")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8InsWait, exported);
+  symbols[mangle("FifoU8RemWait")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&FifoU8RemWait, exported);
+  symbols[mangle("MAlloc")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&MAlloc, exported);
+  symbols[mangle("CAlloc")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&CAlloc, exported);
+  symbols[mangle("Free")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&Free, exported);
+  symbols[mangle("TaskCur")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&TaskCur, exported);
   symbols[mangle("JobQue")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&JobQue, exported);
   symbols[mangle("JobResGet")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&JobResGet, exported);
+  symbols[mangle("JobResScan")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&JobResScan, exported);
+  symbols[mangle("JobResAny")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&JobResAny, exported);
+  symbols[mangle("JobThen")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&JobThen, exported);
+  symbols[mangle("JobParFor")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&JobParFor, exported);
+  symbols[mangle("JobParReduce")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&JobParReduce, exported);
   symbols[mangle("HashFind")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&HashFind, exported);
+  symbols[mangle("MemberFind")] =
+      llvm::orc::ExecutorSymbolDef::fromPtr(&MemberFind, exported);
   symbols[mangle("MemberMetaData")] =
       llvm::orc::ExecutorSymbolDef::fromPtr(&MemberMetaData, exported);
   symbols[mangle("MemberMetaFind")] =
@@ -418,12 +1118,78 @@ llvm_backend::Result AttachHostSymbolResolver(llvm::orc::LLJIT& jit,
   return {true, ""};
 }
 
-llvm_backend::Result InitializeJitSessionState(JitSessionState* state) {
-  auto jit_or_err = llvm::orc::LLJITBuilder().create();
+template <typename Builder>
+llvm_backend::Result ConfigureJitBuilder(const JitOptions& options, Builder* builder,
+                                         JitSessionState* state) {
+  if (options.compile_threads > 0) {
+    builder->setNumCompileThreads(options.compile_threads);
+  }
+
+  if (options.tiered) {
+    auto jtmb_or_err = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb_or_err) {
+      return {false, llvm::toString(jtmb_or_err.takeError())};
+    }
+    builder->setJITTargetMachineBuilder(std::move(*jtmb_or_err));
+    builder->setCompileFunctionCreator(
+        [](llvm::orc::JITTargetMachineBuilder jtmb)
+            -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+          return std::make_unique<TieredIRCompiler>(std::move(jtmb));
+        });
+    // Tier-0 code embeds the addresses of this process's call counters, so
+    // tiered sessions never share objects through the cache.
+    return {true, ""};
+  }
+  if (options.cache_dir.empty() || options.lazy) {
+    return {true, ""};
+  }
+
+  auto jtmb_or_err = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!jtmb_or_err) {
+    return {false, llvm::toString(jtmb_or_err.takeError())};
+  }
+  state->cache_target_id = jtmb_or_err->getTargetTriple().str() + "|" +
+                           jtmb_or_err->getCPU() + "|" +
+                           jtmb_or_err->getFeatures().getString();
+  auto cache = std::make_shared<JitObjectCache>(options.cache_dir, options.cache_max_bytes);
+  state->object_cache = cache;
+  builder->setJITTargetMachineBuilder(std::move(*jtmb_or_err));
+  builder->setCompileFunctionCreator(
+      [cache](llvm::orc::JITTargetMachineBuilder jtmb)
+          -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+        return std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(jtmb), cache.get());
+      });
+  return {true, ""};
+}
+
+template <typename Builder>
+llvm_backend::Result CreateJit(const JitOptions& options, JitSessionState* state) {
+  Builder builder;
+  const llvm_backend::Result configured = ConfigureJitBuilder(options, &builder, state);
+  if (!configured.ok) {
+    return configured;
+  }
+
+  auto jit_or_err = builder.create();
   if (!jit_or_err) {
     return {false, llvm::toString(jit_or_err.takeError())};
   }
+  if constexpr (std::is_same_v<Builder, llvm::orc::LLLazyJITBuilder>) {
+    state->lazy_jit = jit_or_err->get();
+  }
   state->jit = std::move(*jit_or_err);
+  return {true, ""};
+}
+
+llvm_backend::Result InitializeJitSessionState(JitSessionState* state) {
+  const JitOptions& options = ActiveJitOptions();
+  const llvm_backend::Result created =
+      options.lazy && !options.tiered ? CreateJit<llvm::orc::LLLazyJITBuilder>(options, state)
+                                      : CreateJit<llvm::orc::LLJITBuilder>(options, state);
+  if (!created.ok) {
+    return created;
+  }
+  state->compile_threads = options.compile_threads;
 
   auto runtime_jd_or_err = state->jit->createJITDylib("__holyc_runtime");
   if (!runtime_jd_or_err) {
@@ -443,6 +1209,19 @@ llvm_backend::Result InitializeJitSessionState(JitSessionState* state) {
     return resolver;
   }
 
+  if (options.tiered) {
+    llvm::orc::MangleAndInterner mangle(state->jit->getExecutionSession(),
+                                        state->jit->getDataLayout());
+    llvm::orc::SymbolMap tier_symbols;
+    tier_symbols[mangle(kTierUpSymbol)] = llvm::orc::ExecutorSymbolDef::fromPtr(
+        &TierUpEntry, llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    if (auto err =
+            state->runtime_dylib->define(llvm::orc::absoluteSymbols(std::move(tier_symbols)))) {
+      return {false, llvm::toString(std::move(err))};
+    }
+    state->tiering = std::make_unique<TierManager>(state->jit.get(), options.tier_threshold);
+  }
+
   return {true, ""};
 }
 
@@ -474,8 +1253,7 @@ Result GetOrCreateJitSession(std::string_view session_key,
   return Result{true, ""};
 }
 
-Result ParseAndVerifyIrModule(std::string_view ir_text, std::unique_ptr<llvm::LLVMContext>* context_out,
-                              std::unique_ptr<llvm::Module>* module_out) {
+Result ParseAndVerifyIrModule(std::string_view ir_text, IrModulePtr* module_out) {
   auto context = std::make_unique<llvm::LLVMContext>();
   llvm::SMDiagnostic diag;
   std::unique_ptr<llvm::Module> module = ParseModule(ir_text, *context, &diag);
@@ -488,13 +1266,142 @@ Result ParseAndVerifyIrModule(std::string_view ir_text, std::unique_ptr<llvm::LL
     return verified;
   }
 
-  *context_out = std::move(context);
-  *module_out = std::move(module);
+  module_out->reset(new IrModule{llvm::orc::ThreadSafeModule(std::move(module), std::move(context))});
+  return Result{true, ""};
+}
+
+bool UseCachedObject(JitSessionState* state, llvm::Module* module, OptLevel opt_level) {
+  if (!state->object_cache) {
+    return false;
+  }
+  const std::string key = ModuleCacheKey(*module, opt_level, state->cache_target_id);
+  module->setModuleIdentifier(std::string(kCachedModulePrefix) + key);
+  return state->object_cache->Preload(key);
+}
+
+// Calls between partitions cannot be inlined, so a module gets at most one
+// partition per compile thread and each partition keeps a few dozen
+// functions together. Modules too small to fill two partitions stay whole.
+constexpr std::size_t kMinFunctionsPerPartition = 32;
+
+// Eager sessions with several compile threads split each module so its
+// functions are optimized and compiled concurrently. Lazy sessions already
+// partition per function; tiered and cached sessions keep whole modules.
+bool PartitionsModules(const JitSessionState& state) {
+  return state.compile_threads > 1 && state.lazy_jit == nullptr && state.tiering == nullptr &&
+         !state.object_cache;
+}
+
+// Each partition is round-tripped through bitcode into its own context so
+// the compile threads never serialize on a shared context lock.
+Result PartitionModule(llvm::orc::ThreadSafeModule tsm, unsigned partition_count,
+                       std::vector<llvm::orc::ThreadSafeModule>* partitions_out) {
+  Result result{true, ""};
+  tsm.withModuleDo([&](llvm::Module& module) {
+    llvm::SplitModule(module, partition_count, [&](std::unique_ptr<llvm::Module> part) {
+      const bool has_definitions =
+          std::any_of(part->global_values().begin(), part->global_values().end(),
+                      [](const llvm::GlobalValue& value) { return !value.isDeclaration(); });
+      if (!result.ok || !has_definitions) {
+        return;
+      }
+      llvm::SmallVector<char, 0> bitcode;
+      {
+        llvm::raw_svector_ostream os(bitcode);
+        llvm::WriteBitcodeToFile(*part, os);
+      }
+      auto context = std::make_unique<llvm::LLVMContext>();
+      auto parsed = llvm::parseBitcodeFile(
+          llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()), "holyc-partition"),
+          *context);
+      if (!parsed) {
+        result = Result{false, llvm::toString(parsed.takeError())};
+        return;
+      }
+      partitions_out->emplace_back(std::move(*parsed), std::move(context));
+    });
+  });
+  return result;
+}
+
+Result AddPartitionedModule(JitSessionState* state, llvm::orc::JITDylib& module_jd,
+                            llvm::orc::ThreadSafeModule tsm, OptLevel opt_level) {
+  llvm::orc::LLJIT* jit = state->jit.get();
+
+  std::size_t function_count = 0;
+  tsm.withModuleDo([&](llvm::Module& module) {
+    for (const llvm::Function& fn : module) {
+      function_count += fn.isDeclaration() ? 0 : 1;
+    }
+  });
+  const unsigned partition_count = static_cast<unsigned>(std::clamp<std::size_t>(
+      function_count / kMinFunctionsPerPartition, 1, std::size_t{state->compile_threads}));
+
+  std::vector<llvm::orc::ThreadSafeModule> partitions;
+  if (partition_count == 1) {
+    partitions.push_back(std::move(tsm));
+  } else {
+    const Result split = PartitionModule(std::move(tsm), partition_count, &partitions);
+    if (!split.ok) {
+      return split;
+    }
+  }
+
+  jit->getIRTransformLayer().setTransform(
+      [opt_level](llvm::orc::ThreadSafeModule partition, llvm::orc::MaterializationResponsibility&)
+          -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+        Result optimized{true, ""};
+        partition.withModuleDo([opt_level, &optimized](llvm::Module& module) {
+          optimized = OptimizeModule(module, opt_level);
+        });
+        if (!optimized.ok) {
+          return llvm::make_error<llvm::StringError>(optimized.output,
+                                                     llvm::inconvertibleErrorCode());
+        }
+        return partition;
+      });
+
+  llvm::orc::MangleAndInterner mangle(jit->getExecutionSession(), jit->getDataLayout());
+  llvm::orc::SymbolLookupSet symbols;
+  for (llvm::orc::ThreadSafeModule& partition : partitions) {
+    partition.withModuleDo([&](llvm::Module& module) {
+      for (const llvm::GlobalValue& value : module.global_values()) {
+        if (!value.isDeclaration() && !value.hasLocalLinkage() &&
+            !value.hasAvailableExternallyLinkage()) {
+          symbols.add(mangle(value.getName()));
+        }
+      }
+    });
+    if (auto err = jit->addIRModule(module_jd, std::move(partition))) {
+      return Result{false, llvm::toString(std::move(err))};
+    }
+  }
+  BackendCounters().partitions += static_cast<std::int64_t>(partitions.size());
+
+  // One lookup over every partition's definitions hands all of them to the
+  // compile threads at once instead of discovering them call by call.
+  auto materialized = jit->getExecutionSession().lookup(
+      {{&module_jd, llvm::orc::JITDylibLookupFlags::MatchAllSymbols}}, std::move(symbols));
+  if (!materialized) {
+    return Result{false, llvm::toString(materialized.takeError())};
+  }
   return Result{true, ""};
 }
 
-Result AddModuleToJitSession(JitSessionState* state, std::unique_ptr<llvm::LLVMContext> context,
-                             std::unique_ptr<llvm::Module> module,
+Result PrepareModuleForSession(JitSessionState* state, llvm::Module* module,
+                               OptLevel opt_level) {
+  // Lazy and partitioned sessions optimize each partition when it is
+  // materialized; tiered sessions start every function at O0 and promote
+  // hot ones later.
+  if (state->lazy_jit != nullptr || state->tiering != nullptr || PartitionsModules(*state) ||
+      UseCachedObject(state, module, opt_level)) {
+    return Result{true, ""};
+  }
+  return OptimizeModule(*module, opt_level);
+}
+
+Result AddModuleToJitSession(JitSessionState* state, llvm::orc::ThreadSafeModule tsm,
+                             OptLevel opt_level,
                              llvm::orc::JITDylib** module_jd_out = nullptr) {
   llvm::orc::LLJIT* jit = state->jit.get();
 
@@ -507,11 +1414,56 @@ Result AddModuleToJitSession(JitSessionState* state, std::unique_ptr<llvm::LLVMC
   llvm::orc::JITDylib* module_jd = &*module_jd_or_err;
   module_jd->setLinkOrder(BuildModuleLinkOrder(*state));
 
-  llvm::orc::ThreadSafeModule tsm(std::move(module), std::move(context));
-  if (auto err = jit->addIRModule(*module_jd, std::move(tsm))) {
+  std::vector<TieredFunction*> tiered;
+  if (state->tiering != nullptr) {
+    Result instrumented{true, ""};
+    tsm.withModuleDo([&](llvm::Module& module) {
+      instrumented = state->tiering->Instrument(*module_jd, module, opt_level, &tiered);
+    });
+    if (!instrumented.ok) {
+      return instrumented;
+    }
+  }
+
+  if (state->lazy_jit != nullptr) {
+    jit->getIRTransformLayer().setTransform(
+        [opt_level](llvm::orc::ThreadSafeModule partition,
+                    llvm::orc::MaterializationResponsibility&)
+            -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+          Result optimized{true, ""};
+          partition.withModuleDo([opt_level, &optimized](llvm::Module& module) {
+            BackendCounters().lazy_functions +=
+                std::count_if(module.begin(), module.end(), [](const llvm::Function& fn) {
+                  return !fn.isDeclaration() && !IsJitEntryWrapper(fn);
+                });
+            optimized = OptimizeModule(module, opt_level);
+          });
+          if (!optimized.ok) {
+            return llvm::make_error<llvm::StringError>(optimized.output,
+                                                       llvm::inconvertibleErrorCode());
+          }
+          ++BackendCounters().lazy_partitions;
+          return partition;
+        });
+    if (auto err = state->lazy_jit->addLazyIRModule(*module_jd, std::move(tsm))) {
+      return Result{false, llvm::toString(std::move(err))};
+    }
+  } else if (PartitionsModules(*state)) {
+    const Result added = AddPartitionedModule(state, *module_jd, std::move(tsm), opt_level);
+    if (!added.ok) {
+      return added;
+    }
+  } else if (auto err = jit->addIRModule(*module_jd, std::move(tsm))) {
     return Result{false, llvm::toString(std::move(err))};
   }
 
+  if (!tiered.empty()) {
+    const Result installed = state->tiering->InstallStubs(tiered);
+    if (!installed.ok) {
+      return installed;
+    }
+  }
+
   state->module_dylibs.push_back(module_jd);
   if (module_jd_out != nullptr) {
     *module_jd_out = module_jd;
@@ -602,23 +1554,60 @@ Result NormalizeIr(std::string_view ir_text) {
 #endif
 }
 
+void IrModuleDeleter::operator()(IrModule* module) const {
+#ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+  delete module;
+#else
+  (void)module;
+#endif
+}
+
+Result PrintIrModule(const IrModule& module) {
+#ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  module.tsm.withModuleDo([&os](const llvm::Module& m) { m.print(os, nullptr); });
+  os.flush();
+  return Result{true, out};
+#else
+  (void)module;
+  return Result{false, "LLVM backend not enabled at build time"};
+#endif
+}
+
 Result BuildExecutableFromIr(std::string_view ir_text, std::string_view output_path,
                              std::string_view artifact_dir,
                              std::string_view target_triple, OptLevel opt_level) {
 #ifdef HOLYC_LLVM_HEADERS_AVAILABLE
   EnsureLlvmInitialized();
 
-  llvm::LLVMContext context;
-  llvm::SMDiagnostic diag;
-  std::unique_ptr<llvm::Module> module = ParseModule(ir_text, context, &diag);
-  if (!module) {
-    return ErrorFromDiagnostic(diag);
+  IrModulePtr module;
+  const Result parsed = ParseAndVerifyIrModule(ir_text, &module);
+  if (!parsed.ok) {
+    return parsed;
   }
+  return BuildExecutableFromModule(std::move(module), output_path, artifact_dir, target_triple,
+                                   opt_level);
+#else
+  (void)ir_text;
+  (void)output_path;
+  (void)artifact_dir;
+  (void)target_triple;
+  (void)opt_level;
+  return Result{false, "LLVM backend not enabled at build time"};
+#endif
+}
 
-  Result verified = VerifyModule(*module);
-  if (!verified.ok) {
-    return verified;
+Result BuildExecutableFromModule(IrModulePtr ir_module, std::string_view output_path,
+                                 std::string_view artifact_dir,
+                                 std::string_view target_triple, OptLevel opt_level) {
+#ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+  EnsureLlvmInitialized();
+
+  if (!ir_module) {
+    return Result{false, "build: missing module"};
   }
+  llvm::Module* module = ir_module->tsm.getModuleUnlocked();
 
   llvm::Triple triple(target_triple.empty() ? llvm::sys::getDefaultTargetTriple()
                                             : std::string(target_triple));
@@ -675,6 +1664,9 @@ Result BuildExecutableFromIr(std::string_view ir_text, std::string_view output_p
   link_args.emplace_back("-std=c++17");
 #if defined(__linux__)
   link_args.emplace_back("-Wl,--build-id=none");
+#endif
+#if defined(HC_RUNTIME_ALLOCATOR)
+  link_args.emplace_back("-DHC_RUNTIME_ALLOCATOR=" + std::to_string(HC_RUNTIME_ALLOCATOR));
 #endif
   const std::string runtime_cpp = std::string(HOLYC_SOURCE_DIR) + "/runtime/hc_runtime.cpp";
   link_args.emplace_back(obj_path);
@@ -688,7 +1680,7 @@ Result BuildExecutableFromIr(std::string_view ir_text, std::string_view output_p
 
   return Result{true, ""};
 #else
-  (void)ir_text;
+  (void)ir_module;
   (void)output_path;
   (void)artifact_dir;
   (void)target_triple;
@@ -701,6 +1693,28 @@ Result LoadIrJit(std::string_view ir_text, std::string_view session_name, OptLev
 #ifdef HOLYC_LLVM_HEADERS_AVAILABLE
   EnsureLlvmInitialized();
 
+  IrModulePtr module;
+  const Result parsed = ParseAndVerifyIrModule(ir_text, &module);
+  if (!parsed.ok) {
+    return parsed;
+  }
+  return LoadModuleJit(std::move(module), session_name, opt_level);
+#else
+  (void)ir_text;
+  (void)session_name;
+  (void)opt_level;
+  return Result{false, "LLVM backend not enabled at build time"};
+#endif
+}
+
+Result LoadModuleJit(IrModulePtr ir_module, std::string_view session_name, OptLevel opt_level) {
+#ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+  EnsureLlvmInitialized();
+
+  if (!ir_module) {
+    return Result{false, "jit: missing module"};
+  }
+
   const std::string key = SessionKey(session_name);
   auto& sessions = JitSessions();
   JitSessionState* state = nullptr;
@@ -709,22 +1723,16 @@ Result LoadIrJit(std::string_view ir_text, std::string_view session_name, OptLev
     return session;
   }
 
-  std::unique_ptr<llvm::LLVMContext> context;
-  std::unique_ptr<llvm::Module> module;
-  const Result parsed = ParseAndVerifyIrModule(ir_text, &context, &module);
-  if (!parsed.ok) {
-    return parsed;
-  }
-
+  llvm::Module* module = ir_module->tsm.getModuleUnlocked();
   module->setDataLayout(state->jit->getDataLayout());
-  const Result optimized = OptimizeModule(*module, opt_level);
-  if (!optimized.ok) {
-    return optimized;
+  const Result prepared = PrepareModuleForSession(state, module, opt_level);
+  if (!prepared.ok) {
+    return prepared;
   }
 
-  return AddModuleToJitSession(state, std::move(context), std::move(module));
+  return AddModuleToJitSession(state, std::move(ir_module->tsm), opt_level);
 #else
-  (void)ir_text;
+  (void)ir_module;
   (void)session_name;
   (void)opt_level;
   return Result{false, "LLVM backend not enabled at build time"};
@@ -736,11 +1744,40 @@ Result ExecuteIrJit(std::string_view ir_text, std::string_view session_name,
 #ifdef HOLYC_LLVM_HEADERS_AVAILABLE
   EnsureLlvmInitialized();
 
+  IrModulePtr module;
+  const Result parsed = ParseAndVerifyIrModule(ir_text, &module);
+  if (!parsed.ok) {
+    if (reset_after_run) {
+      JitSessions().erase(SessionKey(session_name));
+    }
+    return parsed;
+  }
+  return ExecuteModuleJit(std::move(module), session_name, reset_after_run, entry_symbol_name,
+                          opt_level);
+#else
+  (void)ir_text;
+  (void)session_name;
+  (void)reset_after_run;
+  (void)entry_symbol_name;
+  (void)opt_level;
+  return Result{false, "LLVM backend not enabled at build time"};
+#endif
+}
+
+Result ExecuteModuleJit(IrModulePtr ir_module, std::string_view session_name,
+                        bool reset_after_run, std::string_view entry_symbol_name,
+                        OptLevel opt_level) {
+#ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+  EnsureLlvmInitialized();
+
   const std::string key = SessionKey(session_name);
   auto& sessions = JitSessions();
   if (reset_after_run) {
     sessions.erase(key);
   }
+  if (!ir_module) {
+    return Result{false, "jit: missing module"};
+  }
 
   JitSessionState* state = nullptr;
   const Result session = GetOrCreateJitSession(key, &sessions, &state);
@@ -748,24 +1785,8 @@ Result ExecuteIrJit(std::string_view ir_text, std::string_view session_name,
     return session;
   }
 
-  std::unique_ptr<llvm::LLVMContext> context;
-  std::unique_ptr<llvm::Module> module;
-  const Result parsed = ParseAndVerifyIrModule(ir_text, &context, &module);
-  if (!parsed.ok) {
-    if (reset_after_run) {
-      sessions.erase(key);
-    }
-    return parsed;
-  }
-
+  llvm::Module* module = ir_module->tsm.getModuleUnlocked();
   module->setDataLayout(state->jit->getDataLayout());
-  const Result optimized = OptimizeModule(*module, opt_level);
-  if (!optimized.ok) {
-    if (reset_after_run) {
-      sessions.erase(key);
-    }
-    return optimized;
-  }
 
   if (entry_symbol_name.empty()) {
     if (reset_after_run) {
@@ -781,9 +1802,10 @@ Result ExecuteIrJit(std::string_view ir_text, std::string_view session_name,
     }
     return Result{false, "jit: missing entry symbol '" + std::string(entry_symbol_name) + "'"};
   }
-  const std::string entry_symbol = "__holyc_entry_" + std::to_string(++state->next_entry_id);
+  const std::string entry_symbol =
+      std::string(kJitEntryPrefix) + std::to_string(++state->next_entry_id);
   const std::string entry_target_symbol =
-      "__holyc_entry_target_" + std::to_string(state->next_entry_id);
+      std::string(kJitEntryTargetPrefix) + std::to_string(state->next_entry_id);
   entry_fn->setName(entry_target_symbol);
   const Result wrapper_result = BuildJitEntrypointWrapper(*module, entry_fn, entry_symbol);
   if (!wrapper_result.ok) {
@@ -793,9 +1815,17 @@ Result ExecuteIrJit(std::string_view ir_text, std::string_view session_name,
     return wrapper_result;
   }
 
+  const Result prepared = PrepareModuleForSession(state, module, opt_level);
+  if (!prepared.ok) {
+    if (reset_after_run) {
+      sessions.erase(key);
+    }
+    return prepared;
+  }
+
   llvm::orc::JITDylib* module_jd = nullptr;
-  const Result add_module = AddModuleToJitSession(state, std::move(context), std::move(module),
-                                                   &module_jd);
+  const Result add_module =
+      AddModuleToJitSession(state, std::move(ir_module->tsm), opt_level, &module_jd);
   if (!add_module.ok) {
     if (reset_after_run) {
       sessions.erase(key);
@@ -819,10 +1849,11 @@ Result ExecuteIrJit(std::string_view ir_text, std::string_view session_name,
   hc_spawn_wait_all();
   if (reset_after_run) {
     sessions.erase(key);
+    hc_reflection_reset();
   }
   return Result{true, std::to_string(rc) + "\n"};
 #else
-  (void)ir_text;
+  (void)ir_module;
   (void)session_name;
   (void)reset_after_run;
   (void)entry_symbol_name;
@@ -835,6 +1866,9 @@ Result ResetJitSession(std::string_view session_name) {
 #ifdef HOLYC_LLVM_HEADERS_AVAILABLE
   hc_spawn_wait_all();
   JitSessions().erase(SessionKey(session_name));
+  // The registered table and every index built from it point into the
+  // session's unloaded code, so this is the quiescent point to free them.
+  hc_reflection_reset();
   return Result{true, ""};
 #else
   (void)session_name;
@@ -842,4 +1876,48 @@ Result ResetJitSession(std::string_view session_name) {
 #endif
 }
 
+void SetJitOptions(const JitOptions& options) {
+#ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+  ActiveJitOptions() = options;
+#else
+  (void)options;
+#endif
+}
+
+std::vector<JitCounter> JitCounters() {
+  std::vector<JitCounter> out;
+#ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+  const JitBackendCounters& counters = BackendCounters();
+  if (ActiveJitOptions().tiered) {
+    out.push_back(JitCounter{"tier-functions", counters.tier_functions.load()});
+    out.push_back(JitCounter{"tier-up-requests", counters.tier_requests.load()});
+    out.push_back(JitCounter{"tier-ups", counters.tier_promotions.load()});
+    out.push_back(JitCounter{"tier-up-failures", counters.tier_failures.load()});
+  } else if (ActiveJitOptions().lazy) {
+    out.push_back(JitCounter{"lazy-partitions", counters.lazy_partitions.load()});
+    out.push_back(JitCounter{"lazy-functions", counters.lazy_functions.load()});
+  } else if (!ActiveJitOptions().cache_dir.empty()) {
+    out.push_back(JitCounter{"cache-hits", counters.hits.load()});
+    out.push_back(JitCounter{"cache-misses", counters.misses.load()});
+    out.push_back(JitCounter{"cache-stores", counters.stores.load()});
+    out.push_back(JitCounter{"cache-evictions", counters.evictions.load()});
+  }
+  if (ActiveJitOptions().compile_threads > 0) {
+    out.push_back(JitCounter{"compile-threads", ActiveJitOptions().compile_threads});
+    out.push_back(JitCounter{"jit-partitions", counters.partitions.load()});
+  }
+#endif
+  return out;
+}
+
+std::vector<JitTierTransition> JitTierTransitions() {
+#ifdef HOLYC_LLVM_HEADERS_AVAILABLE
+  TierLog& log = TierTransitionLog();
+  std::lock_guard<std::mutex> lock(log.mutex);
+  return log.transitions;
+#else
+  return {};
+#endif
+}
+
 }  // namespace holyc::llvm_backend
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace holyc::llvm_backend {
 
@@ -19,7 +22,40 @@ enum class OptLevel {
   kOz,
 };
 
+struct JitOptions {
+  std::string cache_dir;
+  std::uint64_t cache_max_bytes = 256ull << 20;
+  bool lazy = false;
+  bool tiered = false;
+  std::uint64_t tier_threshold = 1000;
+  unsigned compile_threads = 0;
+};
+
+struct JitCounter {
+  std::string name;
+  std::int64_t value = 0;
+};
+
+struct JitTierTransition {
+  std::string function;
+  std::string from;
+  std::string to;
+  std::uint64_t calls = 0;
+  double compile_ms = 0.0;
+  bool ok = false;
+  std::string error;
+};
+
+struct IrModule;
+
+struct IrModuleDeleter {
+  void operator()(IrModule* module) const;
+};
+
+using IrModulePtr = std::unique_ptr<IrModule, IrModuleDeleter>;
+
 Result NormalizeIr(std::string_view ir_text);
+Result PrintIrModule(const IrModule& module);
 Result BuildExecutableFromIr(std::string_view ir_text, std::string_view output_path,
                              std::string_view artifact_dir = "",
                              std::string_view target_triple = "",
@@ -30,6 +66,19 @@ Result ExecuteIrJit(std::string_view ir_text, std::string_view session_name = ""
                     bool reset_after_run = true,
                     std::string_view entry_symbol_name = "main",
                     OptLevel opt_level = OptLevel::kO2);
+Result BuildExecutableFromModule(IrModulePtr module, std::string_view output_path,
+                                 std::string_view artifact_dir = "",
+                                 std::string_view target_triple = "",
+                                 OptLevel opt_level = OptLevel::kO2);
+Result LoadModuleJit(IrModulePtr module, std::string_view session_name = "",
+                     OptLevel opt_level = OptLevel::kO2);
+Result ExecuteModuleJit(IrModulePtr module, std::string_view session_name = "",
+                        bool reset_after_run = true,
+                        std::string_view entry_symbol_name = "main",
+                        OptLevel opt_level = OptLevel::kO2);
 Result ResetJitSession(std::string_view session_name = "");
+void SetJitOptions(const JitOptions& options);
+std::vector<JitCounter> JitCounters();
+std::vector<JitTierTransition> JitTierTransitions();
 
 }  // namespace holyc::llvm_backend
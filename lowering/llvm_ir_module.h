@@ -0,0 +1,13 @@
+#pragma once
+
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+
+#include "llvm_backend.h"
+
+namespace holyc::llvm_backend {
+
+struct IrModule {
+  llvm::orc::ThreadSafeModule tsm;
+};
+
+}  // namespace holyc::llvm_backend
@@ -7,9 +7,11 @@
 #include <cstdint>
 #include <cctype>
 #include <cstdlib>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <regex>
+#include <set>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -32,6 +34,9 @@
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/TargetParser/Host.h>
+#include <llvm/Transforms/Utils/Local.h>
+
+#include "llvm_ir_module.h"
 #endif
 
 namespace holyc::llvm_irbuilder_backend {
@@ -43,6 +48,7 @@ namespace {
 using frontend::internal::HIRExpr;
 using frontend::internal::HIRFunction;
 using frontend::internal::HIRFunctionDecl;
+using frontend::internal::HIRMayThrowSummary;
 using frontend::internal::HIRModule;
 using frontend::internal::HIRReflectionField;
 using frontend::internal::HIRReflectionTable;
@@ -124,6 +130,35 @@ std::string JoinTokens(const std::vector<std::string>& tokens, std::string_view
   return out;
 }
 
+std::vector<std::string> SplitMetaTokens(const std::string& text) {
+  std::vector<std::string> tokens;
+  std::size_t i = 0;
+  while (i < text.size()) {
+    while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i])) != 0) {
+      ++i;
+    }
+    if (i >= text.size()) {
+      break;
+    }
+    const std::size_t start = i;
+    if (text[i] == '"') {
+      ++i;
+      while (i < text.size() && !(text[i] == '"' && text[i - 1] != '\\')) {
+        ++i;
+      }
+      if (i < text.size()) {
+        ++i;
+      }
+    } else {
+      while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i])) == 0) {
+        ++i;
+      }
+    }
+    tokens.push_back(text.substr(start, i - start));
+  }
+  return tokens;
+}
+
 bool ParseIntegerLiteralText(std::string_view text, std::int64_t* value_out) {
   if (value_out == nullptr) {
     return false;
@@ -236,16 +271,47 @@ bool HasExpr(const HIRExpr& expr) {
 
 class IrBuilderEmitter {
  public:
-  IrBuilderEmitter(std::string_view module_name, std::string_view target_triple)
+  IrBuilderEmitter(std::string_view module_name, std::string_view target_triple,
+                   frontend::ExceptionModel exception_model,
+                   const HIRMayThrowSummary* may_throw, frontend::ExecutionMode mode)
       : context_(std::make_unique<llvm::LLVMContext>()),
         module_(std::make_unique<llvm::Module>(std::string(module_name), *context_)),
-        builder_(*context_) {
+        builder_(*context_),
+        exception_model_(exception_model),
+        may_throw_(may_throw),
+        mode_(mode) {
     const std::string triple = target_triple.empty() ? llvm::sys::getDefaultTargetTriple()
                                                      : std::string(target_triple);
     module_->setTargetTriple(llvm::Triple(triple));
   }
 
   llvm_backend::Result Emit(const HIRModule& hir_module) {
+    const llvm_backend::Result built = Build(hir_module);
+    if (!built.ok) {
+      return built;
+    }
+
+    std::string out;
+    llvm::raw_string_ostream os(out);
+    module_->print(os, nullptr);
+    os.flush();
+    return {true, out};
+  }
+
+  llvm_backend::Result EmitModule(const HIRModule& hir_module,
+                                  llvm_backend::IrModulePtr* module_out) {
+    const llvm_backend::Result built = Build(hir_module);
+    if (!built.ok) {
+      return built;
+    }
+
+    module_out->reset(new llvm_backend::IrModule{
+        llvm::orc::ThreadSafeModule(std::move(module_), std::move(context_))});
+    return {true, ""};
+  }
+
+ private:
+  llvm_backend::Result Build(const HIRModule& hir_module) {
     const llvm_backend::Result layouts_result = BuildAggregateLayouts(hir_module);
     if (!layouts_result.ok) {
       return layouts_result;
@@ -256,10 +322,7 @@ class IrBuilderEmitter {
       return globals_result;
     }
 
-    const llvm_backend::Result reflection_result = EmitReflectionTable(hir_module.reflection);
-    if (!reflection_result.ok) {
-      return reflection_result;
-    }
+    CollectStripedLocks(hir_module);
 
     for (const HIRFunctionDecl& fn : hir_module.function_decls) {
       if (!DeclareFunction(fn.name, fn.return_type, fn.params, fn.linkage_kind)) {
@@ -267,6 +330,15 @@ class IrBuilderEmitter {
       }
     }
 
+    if (may_throw_ != nullptr) {
+      for (const std::string& name : may_throw_->nounwind_functions) {
+        const auto it = functions_.find(name);
+        if (it != functions_.end()) {
+          it->second->addFnAttr(llvm::Attribute::NoUnwind);
+        }
+      }
+    }
+
     for (const HIRFunction& fn : hir_module.functions) {
       const auto it = functions_.find(fn.name);
       if (it == functions_.end()) {
@@ -279,6 +351,13 @@ class IrBuilderEmitter {
       }
     }
 
+    if (mode_ == frontend::ExecutionMode::kJit || ReflectionBuiltinsReferenced()) {
+      const llvm_backend::Result reflection_result = EmitReflectionTable(hir_module.reflection);
+      if (!reflection_result.ok) {
+        return reflection_result;
+      }
+    }
+
     const llvm_backend::Result wrapper = EmitHostMainWrapper();
     if (!wrapper.ok) {
       return wrapper;
@@ -290,20 +369,42 @@ class IrBuilderEmitter {
       verify_os.flush();
       return {false, verify_err};
     }
-
-    std::string out;
-    llvm::raw_string_ostream os(out);
-    module_->print(os, nullptr);
-    os.flush();
-    return {true, out};
+    return {true, ""};
   }
 
- private:
+  // keys is the single stripe address when key_count is 1, otherwise an
+  // array of key_count addresses; a count of 0 holds every stripe.
+  struct HeldLock {
+    llvm::Value* keys = nullptr;
+    std::int64_t key_count = 0;
+    llvm::Value* try_frame = nullptr;
+    std::size_t break_depth = 0;
+  };
+
+  // What a striped lock block may touch: the variables it names, directly
+  // or in the module functions it calls, whether it reaches memory through
+  // a pointer, and whether it runs code (calls, prints, asm) whose effects
+  // cannot be keyed on a variable.
+  struct LockFootprint {
+    std::set<std::string> vars;
+    bool indirect = false;
+    bool opaque = false;
+  };
+
   struct FunctionFrame {
     llvm::Function* function = nullptr;
     std::unordered_map<std::string, llvm::AllocaInst*> locals;
     std::unordered_map<std::string, llvm::BasicBlock*> label_blocks;
     std::vector<llvm::BasicBlock*> break_targets;
+    std::vector<HeldLock> held_locks;
+    const std::unordered_set<int>* nothrow_try_regions = nullptr;
+    std::int64_t table_try_depth = 0;
+  };
+
+  struct LockedRmw {
+    HIRExpr target;
+    std::string assign_op;
+    const HIRExpr* rhs = nullptr;
   };
 
   struct ExprResult {
@@ -358,6 +459,12 @@ class IrBuilderEmitter {
     char conv = '\0';
     bool width_from_arg = false;
     bool precision_from_arg = false;
+    std::int64_t flags = 0;
+    std::int64_t width = 0;
+    std::int64_t precision = -1;
+    unsigned int_bits = 32;
+    std::size_t begin = 0;
+    std::size_t end = 0;
   };
 
   static constexpr std::size_t kTryFrameStorageSize = sizeof(hc_try_frame);
@@ -488,9 +595,32 @@ class IrBuilderEmitter {
       layout.type->setBody(llvm_fields, false);
     }
 
+    AddRuntimeAggregateLayout("CHashClass", {{"member_lst_and_root", TypePtr()}});
+    AddRuntimeAggregateLayout("CMemberLst",
+                              {{"str", TypePtr()}, {"offset", TypeI64()}, {"next", TypePtr()}});
     return {true, ""};
   }
 
+  // Leading members of runtime-owned classes (see hc_runtime.cpp) so
+  // reflection walks like ml->offset and ml->next address real fields.
+  void AddRuntimeAggregateLayout(const std::string& name,
+                                 const std::vector<std::pair<std::string, llvm::Type*>>& members) {
+    if (aggregate_layouts_.find(name) != aggregate_layouts_.end()) {
+      return;
+    }
+    AggregateLayout layout;
+    layout.type = llvm::StructType::create(*context_, "hc." + name);
+    std::vector<llvm::Type*> body;
+    body.reserve(members.size());
+    for (std::size_t i = 0; i < members.size(); ++i) {
+      body.push_back(members[i].second);
+      layout.members[members[i].first] =
+          AggregateMemberLayout{static_cast<unsigned>(i), members[i].second};
+    }
+    layout.type->setBody(body, false);
+    aggregate_layouts_[name] = std::move(layout);
+  }
+
   llvm_backend::Result EmitGlobalVariable(const HIRStmt& st) {
     llvm::Type* ty = ToLlvmType(st.type);
     if (!ty->isIntegerTy() && !ty->isPointerTy() && !ty->isStructTy() &&
@@ -564,6 +694,197 @@ class IrBuilderEmitter {
     return {true, ""};
   }
 
+  struct MetaOperand {
+    bool is_int = true;
+    std::int64_t value = 0;
+    llvm::Constant* address = nullptr;
+  };
+
+  static int MetaBinaryPrecedence(const std::string& op) {
+    if (op == "*" || op == "/" || op == "%") {
+      return 5;
+    }
+    if (op == "+" || op == "-") {
+      return 4;
+    }
+    if (op == "<<" || op == ">>") {
+      return 3;
+    }
+    if (op == "&") {
+      return 2;
+    }
+    if (op == "^") {
+      return 1;
+    }
+    if (op == "|") {
+      return 0;
+    }
+    return -1;
+  }
+
+  llvm::Constant* ResolveMetaSymbol(const std::string& name) {
+    if (const auto it = functions_.find(name); it != functions_.end()) {
+      return it->second;
+    }
+    if (const auto it = globals_.find(name); it != globals_.end()) {
+      return it->second;
+    }
+    if (llvm::GlobalValue* existing = module_->getNamedValue(name)) {
+      return existing;
+    }
+    return llvm::Function::Create(llvm::FunctionType::get(llvm::Type::getVoidTy(*context_), false),
+                                  llvm::GlobalValue::ExternalWeakLinkage, name, module_.get());
+  }
+
+  MetaOperand EvalMetaPrimary(const std::vector<std::string>& tokens, std::size_t* pos) {
+    const std::string& tok = tokens[(*pos)++];
+    MetaOperand out;
+    if (tok == "(") {
+      out = EvalMetaExpr(tokens, pos, 0);
+      if (*pos < tokens.size() && tokens[*pos] == ")") {
+        ++*pos;
+      }
+      return out;
+    }
+    if ((tok == "-" || tok == "+" || tok == "~") && *pos < tokens.size()) {
+      out = EvalMetaPrimary(tokens, pos);
+      if (out.is_int) {
+        out.value = tok == "-" ? static_cast<std::int64_t>(0ULL - static_cast<std::uint64_t>(out.value))
+                    : tok == "~" ? ~out.value
+                                 : out.value;
+      }
+      return out;
+    }
+    if (tok == "&" && *pos < tokens.size()) {
+      out.is_int = false;
+      out.address = ResolveMetaSymbol(tokens[(*pos)++]);
+      return out;
+    }
+    if (!tok.empty() && tok.front() == '&') {
+      out.is_int = false;
+      out.address = ResolveMetaSymbol(tok.substr(1));
+      return out;
+    }
+    if (!tok.empty() && tok.front() == '"') {
+      out.is_int = false;
+      out.address = llvm::cast<llvm::Constant>(GetOrCreateStringLiteral(tok));
+      return out;
+    }
+    if (!tok.empty() && tok.front() == '\'') {
+      out.value = ParseCharLiteral(tok);
+      return out;
+    }
+    if (ParseIntegerLiteralText(tok, &out.value)) {
+      return out;
+    }
+    if (tok == "TRUE" || tok == "RED") {
+      out.value = 1;
+      return out;
+    }
+    if (tok == "FALSE" || tok == "NULL") {
+      return out;
+    }
+    if (const auto it = global_constants_.find(tok); it != global_constants_.end()) {
+      if (const auto* constant = llvm::dyn_cast<llvm::ConstantInt>(it->second)) {
+        out.value = constant->getSExtValue();
+      }
+      return out;
+    }
+    char* end = nullptr;
+    const double as_double = std::strtod(tok.c_str(), &end);
+    if (end != tok.c_str() && *end == '\0') {
+      out.value = static_cast<std::int64_t>(as_double);
+    }
+    return out;
+  }
+
+  MetaOperand EvalMetaExpr(const std::vector<std::string>& tokens, std::size_t* pos,
+                           int min_precedence) {
+    MetaOperand lhs = EvalMetaPrimary(tokens, pos);
+    while (*pos + 1 < tokens.size()) {
+      const std::string op = tokens[*pos];
+      const int precedence = MetaBinaryPrecedence(op);
+      if (precedence < min_precedence) {
+        break;
+      }
+      ++*pos;
+      const MetaOperand rhs = EvalMetaExpr(tokens, pos, precedence + 1);
+      if (!lhs.is_int || !rhs.is_int) {
+        lhs = MetaOperand{};
+        continue;
+      }
+      const auto a = static_cast<std::uint64_t>(lhs.value);
+      const auto b = static_cast<std::uint64_t>(rhs.value);
+      if (op == "*") {
+        lhs.value = static_cast<std::int64_t>(a * b);
+      } else if (op == "/") {
+        lhs.value = rhs.value == 0 ? 0 : lhs.value / rhs.value;
+      } else if (op == "%") {
+        lhs.value = rhs.value == 0 ? 0 : lhs.value % rhs.value;
+      } else if (op == "+") {
+        lhs.value = static_cast<std::int64_t>(a + b);
+      } else if (op == "-") {
+        lhs.value = static_cast<std::int64_t>(a - b);
+      } else if (op == "<<") {
+        lhs.value = static_cast<std::int64_t>(a << (b & 63));
+      } else if (op == ">>") {
+        lhs.value = lhs.value >> (b & 63);
+      } else if (op == "&") {
+        lhs.value = static_cast<std::int64_t>(a & b);
+      } else if (op == "^") {
+        lhs.value = static_cast<std::int64_t>(a ^ b);
+      } else {
+        lhs.value = static_cast<std::int64_t>(a | b);
+      }
+    }
+    return lhs;
+  }
+
+  llvm::Constant* MetaOperandConstant(const MetaOperand& operand) {
+    if (operand.is_int) {
+      return llvm::ConstantInt::get(TypeI64(), static_cast<std::uint64_t>(operand.value), true);
+    }
+    return llvm::ConstantExpr::getPtrToInt(operand.address, TypeI64());
+  }
+
+  llvm::Constant* ConstantOffsetOf(llvm::StructType* aggregate, unsigned index) {
+    llvm::Constant* indices[] = {
+        llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), 0),
+        llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), index)};
+    llvm::Constant* null_ptr =
+        llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(TypePtr()));
+    return llvm::ConstantExpr::getPtrToInt(
+        llvm::ConstantExpr::getGetElementPtr(aggregate, null_ptr, indices), TypeI64());
+  }
+
+  llvm::Constant* ConstantSizeOf(llvm::Type* ty) {
+    llvm::Constant* one = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), 1);
+    llvm::Constant* null_ptr =
+        llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(TypePtr()));
+    return llvm::ConstantExpr::getPtrToInt(llvm::ConstantExpr::getGetElementPtr(ty, null_ptr, one),
+                                           TypeI64());
+  }
+
+  // An AOT program only gets the table and its registration when something
+  // can read them; the runtime builds its index on the first lookup. JIT
+  // modules always register, since a later cell in the same session may
+  // look up classes declared here.
+  bool ReflectionBuiltinsReferenced() const {
+    static constexpr std::string_view kReflectionBuiltins[] = {
+        "HashFind",       "MemberFind",                "MemberMetaData",
+        "MemberMetaFind", "hc_reflection_field_count", "hc_reflection_fields"};
+    for (const std::string_view name : kReflectionBuiltins) {
+      const llvm::Function* fn = module_->getFunction(name);
+      if (fn != nullptr && !fn->use_empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Rows carry layout and metadata fully resolved, so the runtime only
+  // indexes them: offsets/sizes are DataLayout constant expressions and
+  // meta values are folded here (symbols become relocations).
   llvm_backend::Result EmitReflectionTable(const HIRReflectionTable& table) {
     reflection_table_ptr_ = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(TypePtr()));
     reflection_table_count_ = 0;
@@ -572,12 +893,42 @@ class IrBuilderEmitter {
       return {true, ""};
     }
 
-    llvm::StructType* field_ty =
-        llvm::StructType::get(TypePtr(), TypePtr(), TypePtr(), TypePtr());
+    llvm::StructType* meta_ty = llvm::StructType::get(TypePtr(), TypeI64());
+    llvm::StructType* field_ty = llvm::StructType::get(TypePtr(), TypePtr(), TypePtr(), TypePtr(),
+                                                       TypeI64(), TypeI64(), TypePtr(), TypeI64());
+    std::vector<llvm::Constant*> metas;
+    std::vector<std::pair<std::size_t, std::size_t>> meta_ranges;
+    meta_ranges.reserve(table.fields.size());
+    for (const HIRReflectionField& field : table.fields) {
+      const std::vector<std::string> tokens = SplitMetaTokens(JoinTokens(field.annotations, " "));
+      const std::size_t start = metas.size();
+      std::size_t pos = 0;
+      while (pos < tokens.size()) {
+        llvm::Constant* key = llvm::cast<llvm::Constant>(GetOrCreateStringData(tokens[pos++]));
+        llvm::Constant* value = llvm::ConstantInt::get(TypeI64(), 1);
+        if (pos < tokens.size()) {
+          value = MetaOperandConstant(EvalMetaExpr(tokens, &pos, 0));
+        }
+        metas.push_back(llvm::ConstantStruct::get(meta_ty, {key, value}));
+      }
+      meta_ranges.emplace_back(start, metas.size() - start);
+    }
+
+    llvm::GlobalVariable* meta_global = nullptr;
+    llvm::ArrayType* meta_table_ty = llvm::ArrayType::get(meta_ty, metas.size());
+    if (!metas.empty()) {
+      meta_global = new llvm::GlobalVariable(*module_, meta_table_ty, true,
+                                             llvm::GlobalValue::PrivateLinkage,
+                                             llvm::ConstantArray::get(meta_table_ty, metas),
+                                             ".hc.reflection.meta");
+      meta_global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    }
+
     std::vector<llvm::Constant*> rows;
     rows.reserve(table.fields.size());
-
-    for (const HIRReflectionField& field : table.fields) {
+    llvm::Constant* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), 0);
+    for (std::size_t i = 0; i < table.fields.size(); ++i) {
+      const HIRReflectionField& field = table.fields[i];
       llvm::Constant* aggregate_name =
           llvm::cast<llvm::Constant>(GetOrCreateStringLiteral(field.aggregate_name));
       llvm::Constant* field_name =
@@ -586,8 +937,33 @@ class IrBuilderEmitter {
           llvm::cast<llvm::Constant>(GetOrCreateStringLiteral(field.field_type));
       llvm::Constant* annotations =
           llvm::cast<llvm::Constant>(GetOrCreateStringLiteral(JoinTokens(field.annotations, " ")));
-      rows.push_back(
-          llvm::ConstantStruct::get(field_ty, {aggregate_name, field_name, field_type, annotations}));
+
+      llvm::Type* member_ty = ToLlvmType(field.field_type);
+      llvm::Constant* offset = llvm::ConstantInt::get(TypeI64(), 0);
+      const auto layout_it = aggregate_layouts_.find(field.aggregate_name);
+      if (layout_it != aggregate_layouts_.end() && layout_it->second.type != nullptr) {
+        const AggregateLayout& layout = layout_it->second;
+        const auto member_it = layout.members.find(field.field_name);
+        if (member_it != layout.members.end()) {
+          member_ty = member_it->second.type;
+          if (!layout.is_union) {
+            offset = ConstantOffsetOf(layout.type, member_it->second.index);
+          }
+        }
+      }
+
+      const auto [meta_start, meta_count] = meta_ranges[i];
+      llvm::Constant* meta = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(TypePtr()));
+      if (meta_count > 0) {
+        llvm::Constant* indices[] = {
+            zero, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), meta_start)};
+        meta = llvm::ConstantExpr::getGetElementPtr(meta_table_ty, meta_global, indices);
+      }
+
+      rows.push_back(llvm::ConstantStruct::get(
+          field_ty, {aggregate_name, field_name, field_type, annotations, offset,
+                     ConstantSizeOf(member_ty), meta,
+                     llvm::ConstantInt::get(TypeI64(), meta_count)}));
     }
 
     llvm::ArrayType* table_ty = llvm::ArrayType::get(field_ty, rows.size());
@@ -596,7 +972,6 @@ class IrBuilderEmitter {
         *module_, table_ty, true, llvm::GlobalValue::PrivateLinkage, table_init, ".hc.reflection");
     table_global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
 
-    llvm::Constant* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), 0);
     llvm::Constant* indices[] = {zero, zero};
     reflection_table_ptr_ =
         llvm::ConstantExpr::getGetElementPtr(table_ty, table_global, indices);
@@ -663,6 +1038,12 @@ class IrBuilderEmitter {
 
     FunctionFrame frame;
     frame.function = fn_value;
+    if (may_throw_ != nullptr) {
+      const auto regions = may_throw_->nothrow_try_regions.find(fn.name);
+      if (regions != may_throw_->nothrow_try_regions.end()) {
+        frame.nothrow_try_regions = &regions->second;
+      }
+    }
 
     for (llvm::Argument& arg : fn_value->args()) {
       llvm::AllocaInst* slot =
@@ -814,6 +1195,11 @@ class IrBuilderEmitter {
         if (frame->break_targets.empty()) {
           return {false, "irbuilder emit: break used outside switch/loop"};
         }
+        for (auto it = frame->held_locks.rbegin();
+             it != frame->held_locks.rend() && it->break_depth == frame->break_targets.size();
+             ++it) {
+          EmitLockRelease(*it);
+        }
         builder_.CreateBr(frame->break_targets.back());
         return {true, ""};
       }
@@ -821,6 +1207,7 @@ class IrBuilderEmitter {
       case HIRStmt::Kind::kReturn: {
         llvm::Type* ret_ty = frame->function->getReturnType();
         if (ret_ty->isVoidTy()) {
+          EmitLockReleaseAll(frame);
           builder_.CreateRetVoid();
           return {true, ""};
         }
@@ -841,6 +1228,7 @@ class IrBuilderEmitter {
         if (casted == nullptr) {
           return {false, "irbuilder emit: return type mismatch"};
         }
+        EmitLockReleaseAll(frame);
         builder_.CreateRet(casted);
         return {true, ""};
       }
@@ -1110,6 +1498,9 @@ class IrBuilderEmitter {
     if (st.label_name.empty()) {
       return {false, "irbuilder emit: invalid empty label"};
     }
+    if (!frame->held_locks.empty()) {
+      return {false, "irbuilder emit: label inside lock block is not supported"};
+    }
     llvm::BasicBlock* label_bb = GetOrCreateLabelBlock(frame, st.label_name);
     if (builder_.GetInsertBlock()->getTerminator() == nullptr) {
       builder_.CreateBr(label_bb);
@@ -1122,6 +1513,9 @@ class IrBuilderEmitter {
     if (st.goto_target.empty()) {
       return {false, "irbuilder emit: invalid goto target"};
     }
+    if (!frame->held_locks.empty()) {
+      return {false, "irbuilder emit: goto inside lock block is not supported"};
+    }
     llvm::BasicBlock* target_bb = GetOrCreateLabelBlock(frame, st.goto_target);
     builder_.CreateBr(target_bb);
     return {true, ""};
@@ -1140,16 +1534,152 @@ class IrBuilderEmitter {
       return {false, "irbuilder emit: throw payload must be integer-convertible"};
     }
 
-    llvm::FunctionCallee throw_fn =
-        module_->getOrInsertFunction("hc_throw_i64",
-                                     llvm::FunctionType::get(
-                                         llvm::Type::getVoidTy(*context_), {TypeI64()}, false));
-    builder_.CreateCall(throw_fn, {payload});
+    // Held locks are released by the enclosing lock block's cleanup.
+    builder_.CreateCall(ThrowFn(), {payload});
     builder_.CreateUnreachable();
     return {true, ""};
   }
 
+  // Runtime entry points that never raise; calls to them stay plain calls
+  // inside try and lock regions.
+  llvm::FunctionCallee NoUnwindRuntimeFn(llvm::StringRef name, llvm::FunctionType* type) {
+    llvm::FunctionCallee callee = module_->getOrInsertFunction(name, type);
+    if (auto* fn = llvm::dyn_cast<llvm::Function>(callee.getCallee())) {
+      fn->addFnAttr(llvm::Attribute::NoUnwind);
+    }
+    return callee;
+  }
+
+  llvm::FunctionCallee ThrowFn() {
+    return module_->getOrInsertFunction(
+        "hc_throw_i64",
+        llvm::FunctionType::get(llvm::Type::getVoidTy(*context_), {TypeI64()}, false));
+  }
+
+  // Re-raises the exception currently being handled after a cleanup ran.
+  void EmitRethrow() {
+    llvm::FunctionCallee payload_fn =
+        NoUnwindRuntimeFn("hc_exception_payload", llvm::FunctionType::get(TypeI64(), false));
+    builder_.CreateCall(ThrowFn(), {builder_.CreateCall(payload_fn)});
+    builder_.CreateUnreachable();
+  }
+
+  static bool TryRegionCannotThrow(const HIRStmt& st, const FunctionFrame& frame) {
+    return frame.nothrow_try_regions != nullptr &&
+           frame.nothrow_try_regions->count(st.exception_region_id) != 0;
+  }
+
   llvm_backend::Result EmitTryCatchStmt(const HIRStmt& st, FunctionFrame* frame) {
+    if (exception_model_ == frontend::ExceptionModel::kSetjmp &&
+        !TryRegionCannotThrow(st, *frame)) {
+      return EmitSetjmpTryCatchStmt(st, frame);
+    }
+
+    llvm::Function* fn = frame->function;
+    llvm::BasicBlock* try_bb = llvm::BasicBlock::Create(*context_, "try.body", fn);
+    llvm::BasicBlock* catch_bb = llvm::BasicBlock::Create(*context_, "catch.body", fn);
+    llvm::BasicBlock* end_bb = llvm::BasicBlock::Create(*context_, "try.end", fn);
+    builder_.CreateBr(try_bb);
+
+    // The try body can fill blocks created before it (e.g. a label that an
+    // earlier goto jumped forward to), so the protected calls are the ones
+    // inserted while the body is emitted, wherever their blocks sit.
+    const std::unordered_set<const llvm::Instruction*> calls_before = SnapshotCalls(*fn);
+
+    const bool region_can_throw = !TryRegionCannotThrow(st, *frame);
+    frame->table_try_depth += region_can_throw ? 1 : 0;
+    builder_.SetInsertPoint(try_bb);
+    const llvm_backend::Result try_result = EmitStmtList(st.try_body, frame);
+    const std::int64_t try_depth = frame->table_try_depth;
+    frame->table_try_depth -= region_can_throw ? 1 : 0;
+    if (!try_result.ok) {
+      return try_result;
+    }
+    if (builder_.GetInsertBlock()->getTerminator() == nullptr) {
+      builder_.CreateBr(end_bb);
+    }
+
+    std::vector<llvm::CallInst*> throwing_calls;
+    for (llvm::BasicBlock& block : *fn) {
+      CollectThrowingCalls(block, calls_before, &throwing_calls);
+    }
+    if (!throwing_calls.empty() && region_can_throw) {
+      llvm::BasicBlock* lpad_bb = llvm::BasicBlock::Create(*context_, "try.lpad", fn);
+      builder_.SetInsertPoint(lpad_bb);
+      llvm::LandingPadInst* pad = builder_.CreateLandingPad(
+          llvm::StructType::get(*context_, {TypePtr(), llvm::Type::getInt32Ty(*context_)}), 1);
+      pad->addClause(TryDepthMarker(*fn, try_depth));
+      builder_.CreateBr(catch_bb);
+
+      SetPersonality(fn);
+      for (llvm::CallInst* call : throwing_calls) {
+        llvm::changeToInvokeAndSplitBasicBlock(call, lpad_bb);
+      }
+    }
+
+    builder_.SetInsertPoint(catch_bb);
+    const llvm_backend::Result catch_result = EmitStmtList(st.catch_body, frame);
+    if (!catch_result.ok) {
+      return catch_result;
+    }
+    if (builder_.GetInsertBlock()->getTerminator() == nullptr) {
+      builder_.CreateBr(end_bb);
+    }
+
+    builder_.SetInsertPoint(end_bb);
+    return {true, ""};
+  }
+
+  // The catch clause of a table-mode pad: a constant hc_try_depth reads back
+  // to learn how many try regions of this function enclose the call. Each
+  // function gets its own markers, so when inlining appends a caller's
+  // clauses to a pad the runtime still sees one marker per original frame.
+  llvm::Constant* TryDepthMarker(const llvm::Function& fn, std::int64_t depth) {
+    const std::string name = "hc.try." + fn.getName().str() + "." + std::to_string(depth);
+    if (llvm::GlobalVariable* existing = module_->getNamedGlobal(name)) {
+      return existing;
+    }
+    llvm::StructType* marker_ty = llvm::StructType::get(*context_, {TypeI64(), TypeI64()});
+    llvm::Constant* init = llvm::ConstantStruct::get(
+        marker_ty, {llvm::ConstantInt::get(TypeI64(), HC_TRY_DEPTH_MAGIC),
+                    llvm::ConstantInt::get(TypeI64(), static_cast<std::uint64_t>(depth))});
+    return new llvm::GlobalVariable(*module_, marker_ty, true, llvm::GlobalValue::PrivateLinkage,
+                                    init, name);
+  }
+
+  static std::unordered_set<const llvm::Instruction*> SnapshotCalls(llvm::Function& fn) {
+    std::unordered_set<const llvm::Instruction*> calls;
+    for (llvm::BasicBlock& block : fn) {
+      for (llvm::Instruction& inst : block) {
+        if (llvm::isa<llvm::CallInst>(inst)) {
+          calls.insert(&inst);
+        }
+      }
+    }
+    return calls;
+  }
+
+  void SetPersonality(llvm::Function* fn) {
+    fn->setPersonalityFn(llvm::cast<llvm::Constant>(
+        module_
+            ->getOrInsertFunction("hc_personality_v0",
+                                  llvm::FunctionType::get(llvm::Type::getInt32Ty(*context_), true))
+            .getCallee()));
+  }
+
+  static void CollectThrowingCalls(llvm::BasicBlock& block,
+                                   const std::unordered_set<const llvm::Instruction*>& skip,
+                                   std::vector<llvm::CallInst*>* calls) {
+    for (llvm::Instruction& inst : block) {
+      auto* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+      if (call != nullptr && !call->doesNotThrow() && !call->isInlineAsm() &&
+          !skip.contains(call)) {
+        calls->push_back(call);
+      }
+    }
+  }
+
+  llvm_backend::Result EmitSetjmpTryCatchStmt(const HIRStmt& st, FunctionFrame* frame) {
     llvm::ArrayType* storage_ty =
         llvm::ArrayType::get(llvm::Type::getInt8Ty(*context_), kTryFrameStorageSize);
     llvm::AllocaInst* storage = CreateEntryAlloca(frame->function, "hc.try.frame", storage_ty);
@@ -2132,57 +2662,498 @@ class IrBuilderEmitter {
     return {true, ""};
   }
 
-  llvm_backend::Result EmitLockStmt(const HIRStmt& st, FunctionFrame* frame) {
-    for (const HIRStmt& nested : st.flow_then) {
-      if (nested.kind == HIRStmt::Kind::kAssign) {
-        HIRExpr lhs;
-        lhs.kind = HIRExpr::Kind::kVar;
-        lhs.text = nested.name;
-        lhs.type = nested.type.empty() ? "I64" : nested.type;
-        const llvm_backend::Result result =
-            EmitAtomicAssignExpr(lhs, nested.assign_op, nested.expr, frame);
-        if (!result.ok) {
-          return result;
-        }
-        continue;
+  static bool MatchLockedRmw(const HIRStmt& st, LockedRmw* out) {
+    if (st.kind == HIRStmt::Kind::kAssign) {
+      out->target.kind = HIRExpr::Kind::kVar;
+      out->target.text = st.name;
+      out->target.type = st.type.empty() ? "I64" : st.type;
+      out->assign_op = st.assign_op;
+      out->rhs = &st.expr;
+      return true;
+    }
+    if (st.kind != HIRStmt::Kind::kExpr) {
+      return false;
+    }
+    if (st.expr.kind == HIRExpr::Kind::kAssign && st.expr.children.size() == 2) {
+      out->target = st.expr.children[0];
+      out->assign_op = st.expr.text;
+      out->rhs = &st.expr.children[1];
+      return true;
+    }
+    if ((st.expr.kind == HIRExpr::Kind::kPostfix || st.expr.kind == HIRExpr::Kind::kUnary) &&
+        st.expr.children.size() == 1 && (st.expr.text == "++" || st.expr.text == "--")) {
+      out->target = st.expr.children[0];
+      out->assign_op = st.expr.text == "++" ? "+=" : "-=";
+      out->rhs = nullptr;
+      return true;
+    }
+    return false;
+  }
+
+  static bool IsAtomicRmwAssignOp(const std::string& assign_op) {
+    return assign_op == "=" || assign_op == "+=" || assign_op == "-=" || assign_op == "&=" ||
+           assign_op == "|=" || assign_op == "^=";
+  }
+
+  llvm_backend::Result EmitCmpxchgAssignExpr(const HIRExpr& lhs_expr, const std::string& assign_op,
+                                             const HIRExpr* rhs_expr, FunctionFrame* frame) {
+    const LValueResult lhs = EmitLValue(lhs_expr, frame);
+    if (!lhs.ok) {
+      return {false, lhs.message};
+    }
+    llvm::Type* value_ty = lhs.pointee_type;
+    if (value_ty == nullptr || !value_ty->isIntegerTy()) {
+      return {false, "irbuilder emit: lock requires integer lvalue target"};
+    }
+
+    llvm::Value* operand = llvm::ConstantInt::get(TypeI64(), 1, true);
+    if (rhs_expr != nullptr) {
+      const ExprResult rhs = EmitExpr(*rhs_expr, frame);
+      if (!rhs.ok) {
+        return {false, rhs.message};
       }
+      operand = rhs.value;
+    }
+    operand = CastIfNeeded(operand, value_ty);
+    if (operand == nullptr) {
+      return {false, "irbuilder emit: lock assignment rhs type mismatch"};
+    }
 
-      if (nested.kind == HIRStmt::Kind::kExpr && nested.expr.kind == HIRExpr::Kind::kAssign &&
-          nested.expr.children.size() == 2) {
-        const llvm_backend::Result result = EmitAtomicAssignExpr(
-            nested.expr.children[0], nested.expr.text, nested.expr.children[1], frame);
-        if (!result.ok) {
-          return result;
+    llvm::LoadInst* initial = builder_.CreateAlignedLoad(
+        value_ty, lhs.ptr,
+        llvm::Align(module_->getDataLayout().getTypeStoreSize(value_ty).getFixedValue()));
+    initial->setAtomic(llvm::AtomicOrdering::Monotonic);
+    llvm::BasicBlock* entry_bb = builder_.GetInsertBlock();
+    llvm::BasicBlock* loop_bb = llvm::BasicBlock::Create(*context_, "lock.cas", frame->function);
+    llvm::BasicBlock* done_bb =
+        llvm::BasicBlock::Create(*context_, "lock.cas.done", frame->function);
+    builder_.CreateBr(loop_bb);
+
+    builder_.SetInsertPoint(loop_bb);
+    llvm::PHINode* current = builder_.CreatePHI(value_ty, 2, "lock.cas.old");
+    current->addIncoming(initial, entry_bb);
+    llvm::Value* updated = operand;
+    if (assign_op != "=") {
+      const BinaryResult combined =
+          EmitBinaryOp(AssignOpToBinary(assign_op), current, operand);
+      if (!combined.ok) {
+        return {false, combined.message};
+      }
+      updated = CastIfNeeded(combined.value, value_ty);
+      if (updated == nullptr) {
+        return {false, "irbuilder emit: lock assignment type mismatch"};
+      }
+    }
+
+    llvm::AtomicCmpXchgInst* cas = builder_.CreateAtomicCmpXchg(
+        lhs.ptr, current, updated, llvm::MaybeAlign(),
+        llvm::AtomicOrdering::SequentiallyConsistent, llvm::AtomicOrdering::SequentiallyConsistent);
+    llvm::Value* seen = builder_.CreateExtractValue(cas, 0);
+    llvm::Value* swapped = builder_.CreateExtractValue(cas, 1);
+    current->addIncoming(seen, builder_.GetInsertBlock());
+    builder_.CreateCondBr(swapped, done_bb, loop_bb);
+
+    builder_.SetInsertPoint(done_bb);
+    return {true, ""};
+  }
+
+  void EmitStripeCall(const char* single_name, const char* set_name, const HeldLock& lock) {
+    if (lock.key_count == 1) {
+      llvm::FunctionCallee fn = NoUnwindRuntimeFn(
+          single_name,
+          llvm::FunctionType::get(llvm::Type::getVoidTy(*context_), {TypePtr()}, false));
+      builder_.CreateCall(fn, {lock.keys});
+      return;
+    }
+    llvm::FunctionCallee fn = NoUnwindRuntimeFn(
+        set_name, llvm::FunctionType::get(llvm::Type::getVoidTy(*context_),
+                                          {TypePtr(), TypeI64()}, false));
+    builder_.CreateCall(fn, {lock.keys, llvm::ConstantInt::get(TypeI64(), lock.key_count)});
+  }
+
+  void EmitStripeRelease(const HeldLock& lock) {
+    EmitStripeCall("hc_lock_release", "hc_lock_release_n", lock);
+  }
+
+  void EmitLockRelease(const HeldLock& lock) {
+    if (lock.try_frame != nullptr) {
+      llvm::FunctionCallee pop_fn = NoUnwindRuntimeFn(
+          "hc_try_pop",
+          llvm::FunctionType::get(llvm::Type::getVoidTy(*context_), {TypePtr()}, false));
+      builder_.CreateCall(pop_fn, {lock.try_frame});
+    }
+    EmitStripeRelease(lock);
+  }
+
+  void EmitLockReleaseAll(FunctionFrame* frame) {
+    for (auto it = frame->held_locks.rbegin(); it != frame->held_locks.rend(); ++it) {
+      EmitLockRelease(*it);
+    }
+  }
+
+  // In setjmp mode a lock block is its own cleanup try frame: an exception
+  // that reaches it releases the stripe and is raised again to the next frame.
+  llvm::Value* EmitLockTryFrame(FunctionFrame* frame, const HeldLock& lock) {
+    llvm::ArrayType* storage_ty =
+        llvm::ArrayType::get(llvm::Type::getInt8Ty(*context_), kTryFrameStorageSize);
+    llvm::AllocaInst* storage = CreateEntryAlloca(frame->function, "hc.lock.frame", storage_ty);
+    storage->setAlignment(llvm::Align(kTryFrameStorageAlignment));
+    llvm::Value* frame_ptr = builder_.CreateBitCast(storage, TypePtr());
+
+    llvm::FunctionCallee push_fn = module_->getOrInsertFunction(
+        "hc_try_push_cleanup",
+        llvm::FunctionType::get(llvm::Type::getVoidTy(*context_), {TypePtr()}, false));
+    llvm::FunctionCallee setjmp_fn = module_->getOrInsertFunction(
+        "_setjmp",
+        llvm::FunctionType::get(llvm::Type::getInt32Ty(*context_), {TypePtr()}, false));
+    builder_.CreateCall(push_fn, {frame_ptr});
+    llvm::Value* sj_value = builder_.CreateCall(setjmp_fn, {frame_ptr});
+    llvm::Value* run_body = builder_.CreateICmpEQ(
+        sj_value, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), 0));
+
+    llvm::BasicBlock* body_bb = llvm::BasicBlock::Create(*context_, "lock.body", frame->function);
+    llvm::BasicBlock* unwind_bb =
+        llvm::BasicBlock::Create(*context_, "lock.unwind", frame->function);
+    builder_.CreateCondBr(run_body, body_bb, unwind_bb);
+
+    builder_.SetInsertPoint(unwind_bb);
+    EmitStripeRelease(lock);
+    EmitRethrow();
+    builder_.SetInsertPoint(body_bb);
+    return frame_ptr;
+  }
+
+  // In table mode every call in the block that may throw unwinds to a pad
+  // that releases the stripe and raises the exception again; an enclosing
+  // try in the same function then picks up that re-raise like any other call.
+  // Inside a try the pad also carries that try's depth marker.
+  void EmitLockCleanupPad(llvm::Function* fn, const HeldLock& lock, std::int64_t try_depth,
+                          const std::unordered_set<const llvm::Instruction*>& calls_before) {
+    std::vector<llvm::CallInst*> throwing_calls;
+    for (llvm::BasicBlock& block : *fn) {
+      CollectThrowingCalls(block, calls_before, &throwing_calls);
+    }
+    if (throwing_calls.empty()) {
+      return;
+    }
+    llvm::BasicBlock* lpad_bb = llvm::BasicBlock::Create(*context_, "lock.lpad", fn);
+    builder_.SetInsertPoint(lpad_bb);
+    llvm::LandingPadInst* pad = builder_.CreateLandingPad(
+        llvm::StructType::get(*context_, {TypePtr(), llvm::Type::getInt32Ty(*context_)}),
+        try_depth > 0 ? 1 : 0);
+    pad->setCleanup(true);
+    if (try_depth > 0) {
+      pad->addClause(TryDepthMarker(*fn, try_depth));
+    }
+    EmitStripeRelease(lock);
+    EmitRethrow();
+
+    SetPersonality(fn);
+    for (llvm::CallInst* call : throwing_calls) {
+      llvm::changeToInvokeAndSplitBasicBlock(call, lpad_bb);
+    }
+  }
+
+  // A block takes the stripe of every variable it names, so blocks that
+  // share a variable exclude each other whatever order they touch it in.
+  // A block that reaches memory through a pointer or runs opaque code takes
+  // every stripe.
+  HeldLock LockKeysFor(const HIRStmt& st, FunctionFrame* frame) {
+    LockFootprint footprint;
+    AddFootprint(st.flow_then, &footprint);
+    std::vector<llvm::Value*> keys;
+    if (!footprint.indirect && !footprint.opaque) {
+      for (const std::string& name : footprint.vars) {
+        if (const auto local_it = frame->locals.find(name); local_it != frame->locals.end()) {
+          keys.push_back(local_it->second);
+        } else if (const auto global_it = globals_.find(name); global_it != globals_.end()) {
+          keys.push_back(global_it->second);
         }
-        continue;
       }
+    }
+    HeldLock lock;
+    lock.break_depth = frame->break_targets.size();
+    if (keys.empty()) {
+      lock.keys = llvm::Constant::getNullValue(TypePtr());
+      return lock;
+    }
+    if (keys.size() == 1) {
+      lock.keys = keys.front();
+      lock.key_count = 1;
+      return lock;
+    }
+    llvm::ArrayType* keys_ty = llvm::ArrayType::get(TypePtr(), keys.size());
+    llvm::AllocaInst* array = CreateEntryAlloca(frame->function, "hc.lock.keys", keys_ty);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      builder_.CreateStore(keys[i], builder_.CreateConstInBoundsGEP2_64(keys_ty, array, 0, i));
+    }
+    lock.keys = array;
+    lock.key_count = static_cast<std::int64_t>(keys.size());
+    return lock;
+  }
+
+  llvm_backend::Result EmitStripedLockStmt(const HIRStmt& st, FunctionFrame* frame) {
+    HeldLock lock = LockKeysFor(st, frame);
+    EmitStripeCall("hc_lock_acquire", "hc_lock_acquire_n", lock);
+
+    llvm::Function* fn = frame->function;
+    if (exception_model_ == frontend::ExceptionModel::kSetjmp) {
+      lock.try_frame = EmitLockTryFrame(frame, lock);
+    }
+    const std::unordered_set<const llvm::Instruction*> calls_before = SnapshotCalls(*fn);
+
+    frame->held_locks.push_back(lock);
+    const llvm_backend::Result body = EmitStmtList(st.flow_then, frame);
+    frame->held_locks.pop_back();
+    if (!body.ok) {
+      return body;
+    }
+    llvm::BasicBlock* end_bb = llvm::BasicBlock::Create(*context_, "lock.end", fn);
+    if (builder_.GetInsertBlock()->getTerminator() == nullptr) {
+      EmitLockRelease(lock);
+      builder_.CreateBr(end_bb);
+    }
+    if (lock.try_frame == nullptr) {
+      EmitLockCleanupPad(fn, lock, frame->table_try_depth, calls_before);
+    }
+    builder_.SetInsertPoint(end_bb);
+    return {true, ""};
+  }
+
+  static std::string RootVarName(const HIRExpr& expr) {
+    if (expr.kind == HIRExpr::Kind::kVar) {
+      return expr.text;
+    }
+    if (expr.kind == HIRExpr::Kind::kMember && expr.children.size() == 1 &&
+        expr.children[0].type.find('*') == std::string::npos) {
+      return RootVarName(expr.children[0]);
+    }
+    return "";
+  }
+
+  static void ForEachStmt(const std::vector<HIRStmt>& stmts,
+                          const std::function<void(const HIRStmt&)>& visit) {
+    for (const HIRStmt& st : stmts) {
+      visit(st);
+      ForEachStmt(st.try_body, visit);
+      ForEachStmt(st.catch_body, visit);
+      for (const std::vector<HIRStmt>& body : st.switch_case_bodies) {
+        ForEachStmt(body, visit);
+      }
+      ForEachStmt(st.switch_default, visit);
+      ForEachStmt(st.flow_then, visit);
+      ForEachStmt(st.flow_else, visit);
+    }
+  }
 
-      if (nested.kind == HIRStmt::Kind::kExpr && nested.expr.kind == HIRExpr::Kind::kPostfix &&
-          nested.expr.children.size() == 1 &&
-          (nested.expr.text == "++" || nested.expr.text == "--")) {
-        const llvm_backend::Result result =
-            EmitAtomicIncDec(nested.expr.children[0], nested.expr.text == "++", frame);
-        if (!result.ok) {
-          return result;
+  static void ForEachExpr(const HIRStmt& st, const std::function<void(const HIRExpr&)>& visit) {
+    const std::function<void(const HIRExpr&)> walk = [&](const HIRExpr& expr) {
+      visit(expr);
+      for (const HIRExpr& child : expr.children) {
+        walk(child);
+      }
+    };
+    walk(st.expr);
+    walk(st.print_format);
+    walk(st.switch_cond);
+    walk(st.flow_cond);
+    for (const HIRExpr& arg : st.print_args) {
+      walk(arg);
+    }
+    for (const HIRExpr& operand : st.asm_operands) {
+      walk(operand);
+    }
+  }
+
+  void AddCallFootprint(const std::string& callee, LockFootprint* footprint) const {
+    footprint->opaque = true;
+    if (const auto it = function_footprints_.find(callee); it != function_footprints_.end()) {
+      footprint->vars.insert(it->second.vars.begin(), it->second.vars.end());
+      footprint->indirect = footprint->indirect || it->second.indirect;
+    } else if (bodiless_functions_.contains(callee)) {
+      footprint->indirect = true;
+    }
+  }
+
+  void AddFootprint(const std::vector<HIRStmt>& stmts, LockFootprint* footprint) const {
+    ForEachStmt(stmts, [&](const HIRStmt& st) {
+      switch (st.kind) {
+        case HIRStmt::Kind::kAssign:
+          footprint->vars.insert(st.name);
+          break;
+        case HIRStmt::Kind::kNoParenCall:
+          AddCallFootprint(st.name, footprint);
+          break;
+        case HIRStmt::Kind::kPrint:
+          footprint->opaque = true;
+          break;
+        case HIRStmt::Kind::kInlineAsm:
+          footprint->opaque = true;
+          footprint->indirect = true;
+          break;
+        default:
+          break;
+      }
+      ForEachExpr(st, [&](const HIRExpr& expr) {
+        switch (expr.kind) {
+          case HIRExpr::Kind::kVar:
+            footprint->vars.insert(expr.text);
+            break;
+          case HIRExpr::Kind::kUnary:
+            footprint->indirect = footprint->indirect || expr.text == "*";
+            break;
+          case HIRExpr::Kind::kIndex:
+            footprint->indirect = true;
+            break;
+          case HIRExpr::Kind::kMember:
+            footprint->indirect =
+                footprint->indirect || (!expr.children.empty() &&
+                                        expr.children[0].type.find('*') != std::string::npos);
+            break;
+          case HIRExpr::Kind::kCall:
+            if (expr.text.empty()) {
+              footprint->opaque = true;
+              footprint->indirect = true;
+            } else {
+              AddCallFootprint(expr.text, footprint);
+            }
+            break;
+          default:
+            break;
         }
+      });
+    });
+  }
+
+  // A local that never has its address taken is only ever seen by the
+  // thread running its frame, so no tier choice can race on it.
+  bool IsPrivateVar(const std::string& name) const {
+    return local_vars_.contains(name) && !globals_.contains(name) &&
+           !address_taken_vars_.contains(name);
+  }
+
+  // A single-RMW lock may use atomicrmw or cmpxchg only if no striped
+  // block in the module can touch its target; otherwise the striped body's
+  // plain loads and stores would race with it. A target reached through a
+  // pointer may alias any shared variable a striped body touches.
+  bool SharesStripedLockTarget(const HIRExpr& target) const {
+    if (!has_striped_locks_) {
+      return false;
+    }
+    const std::string root = RootVarName(target);
+    if (root.empty()) {
+      return striped_footprint_.indirect ||
+             std::any_of(striped_footprint_.vars.begin(), striped_footprint_.vars.end(),
+                         [this](const std::string& name) { return !IsPrivateVar(name); });
+    }
+    if (IsPrivateVar(root)) {
+      return false;
+    }
+    return striped_footprint_.vars.contains(root) ||
+           (striped_footprint_.indirect && address_taken_vars_.contains(root));
+  }
+
+  bool IsAtomicLockStmt(const HIRStmt& st, LockedRmw* rmw) {
+    if (st.flow_then.size() != 1 || !MatchLockedRmw(st.flow_then.front(), rmw) ||
+        SharesStripedLockTarget(rmw->target)) {
+      return false;
+    }
+    return ToLlvmType(rmw->target.type.empty() ? "I64" : rmw->target.type)->isIntegerTy();
+  }
+
+  void CollectStripedLocks(const std::vector<HIRStmt>& stmts) {
+    for (const HIRStmt& st : stmts) {
+      LockedRmw rmw;
+      if (st.kind == HIRStmt::Kind::kLock && !IsAtomicLockStmt(st, &rmw)) {
+        has_striped_locks_ = true;
+        AddFootprint(st.flow_then, &striped_footprint_);
         continue;
       }
+      CollectStripedLocks(st.try_body);
+      CollectStripedLocks(st.catch_body);
+      for (const std::vector<HIRStmt>& body : st.switch_case_bodies) {
+        CollectStripedLocks(body);
+      }
+      CollectStripedLocks(st.switch_default);
+      CollectStripedLocks(st.flow_then);
+      CollectStripedLocks(st.flow_else);
+    }
+  }
 
-      if (nested.kind == HIRStmt::Kind::kExpr && nested.expr.kind == HIRExpr::Kind::kUnary &&
-          nested.expr.children.size() == 1 &&
-          (nested.expr.text == "++" || nested.expr.text == "--")) {
-        const llvm_backend::Result result =
-            EmitAtomicIncDec(nested.expr.children[0], nested.expr.text == "++", frame);
-        if (!result.ok) {
-          return result;
+  // Function footprints and the striped-lock footprint only grow, and
+  // demoting a lock to the stripes can expose more variables, so both run
+  // until nothing changes.
+  void CollectStripedLocks(const HIRModule& hir_module) {
+    for (const HIRFunctionDecl& decl : hir_module.function_decls) {
+      bodiless_functions_.insert(decl.name);
+    }
+    for (const HIRFunction& fn : hir_module.functions) {
+      bodiless_functions_.erase(fn.name);
+      for (const auto& param : fn.params) {
+        local_vars_.insert(param.second);
+      }
+    }
+    const auto note_vars = [this](const HIRStmt& st) {
+      if (st.kind == HIRStmt::Kind::kVarDecl && !st.decl_is_global) {
+        local_vars_.insert(st.name);
+      }
+      ForEachExpr(st, [this](const HIRExpr& expr) {
+        if (expr.kind == HIRExpr::Kind::kUnary && expr.text == "&" && !expr.children.empty()) {
+          const std::string root = RootVarName(expr.children[0]);
+          if (!root.empty()) {
+            address_taken_vars_.insert(root);
+          }
+        }
+      });
+    };
+    ForEachStmt(hir_module.top_level_items, note_vars);
+    for (const HIRFunction& fn : hir_module.functions) {
+      ForEachStmt(fn.body, note_vars);
+    }
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (const HIRFunction& fn : hir_module.functions) {
+        LockFootprint footprint;
+        AddFootprint(fn.body, &footprint);
+        LockFootprint& summary = function_footprints_[fn.name];
+        if (footprint.vars.size() != summary.vars.size() ||
+            footprint.indirect != summary.indirect || footprint.opaque != summary.opaque) {
+          summary = std::move(footprint);
+          changed = true;
         }
-        continue;
       }
+    }
 
-      return {false, "irbuilder emit: unsupported statement inside lock block: " +
-                         StmtKindName(nested.kind)};
+    std::size_t previous_vars = 0;
+    bool previous_indirect = false;
+    bool previous_striped = false;
+    do {
+      previous_vars = striped_footprint_.vars.size();
+      previous_indirect = striped_footprint_.indirect;
+      previous_striped = has_striped_locks_;
+      CollectStripedLocks(hir_module.top_level_items);
+      for (const HIRFunction& fn : hir_module.functions) {
+        CollectStripedLocks(fn.body);
+      }
+    } while (striped_footprint_.vars.size() != previous_vars ||
+             striped_footprint_.indirect != previous_indirect ||
+             has_striped_locks_ != previous_striped);
+  }
+
+  llvm_backend::Result EmitLockStmt(const HIRStmt& st, FunctionFrame* frame) {
+    LockedRmw rmw;
+    if (IsAtomicLockStmt(st, &rmw)) {
+      if (IsAtomicRmwAssignOp(rmw.assign_op)) {
+        if (rmw.rhs == nullptr) {
+          return EmitAtomicIncDec(rmw.target, rmw.assign_op == "+=", frame);
+        }
+        return EmitAtomicAssignExpr(rmw.target, rmw.assign_op, *rmw.rhs, frame);
+      }
+      return EmitCmpxchgAssignExpr(rmw.target, rmw.assign_op, rmw.rhs, frame);
     }
-    return {true, ""};
+    return EmitStripedLockStmt(st, frame);
   }
 
   static bool IsFloatPrintConversion(char conv) {
@@ -2206,34 +3177,50 @@ class IrBuilderEmitter {
         return {};
       }
 
-      ++i;
+      PrintFormatSpec spec;
+      spec.begin = i++;
       if (format[i] == '%') {
         ++i;
         continue;
       }
 
-      while (i < format.size() &&
-             (format[i] == '-' || format[i] == '+' || format[i] == ' ' || format[i] == '#' ||
-              format[i] == '0' || format[i] == '\'')) {
-        ++i;
+      for (; i < format.size(); ++i) {
+        if (format[i] == '-') {
+          spec.flags |= HC_FMT_LEFT;
+        } else if (format[i] == '+') {
+          spec.flags |= HC_FMT_PLUS;
+        } else if (format[i] == ' ') {
+          spec.flags |= HC_FMT_SPACE;
+        } else if (format[i] == '#') {
+          spec.flags |= HC_FMT_ALT;
+        } else if (format[i] == '0') {
+          spec.flags |= HC_FMT_ZERO;
+        } else if (format[i] != '\'') {
+          break;
+        }
       }
 
-      PrintFormatSpec spec;
       if (i < format.size() && format[i] == '*') {
         spec.width_from_arg = true;
         ++i;
       }
       while (i < format.size() && std::isdigit(static_cast<unsigned char>(format[i])) != 0) {
+        spec.width = std::min<std::int64_t>(spec.width * 10 + (format[i] - '0'),
+                                            std::numeric_limits<std::int32_t>::max());
         ++i;
       }
 
       if (i < format.size() && format[i] == '.') {
         ++i;
+        spec.precision = 0;
         if (i < format.size() && format[i] == '*') {
           spec.precision_from_arg = true;
           ++i;
         }
         while (i < format.size() && std::isdigit(static_cast<unsigned char>(format[i])) != 0) {
+          spec.precision =
+              std::min<std::int64_t>(spec.precision * 10 + (format[i] - '0'),
+                                     std::numeric_limits<std::int32_t>::max());
           ++i;
         }
       }
@@ -2242,6 +3229,10 @@ class IrBuilderEmitter {
         const char lm = format[i];
         if (lm == 'h' || lm == 'l' || lm == 'j' || lm == 't' || lm == 'L' || lm == 'q') {
           ++i;
+          spec.int_bits = 64;
+          if (lm == 'h') {
+            spec.int_bits = i < format.size() && format[i] == 'h' ? 8 : 16;
+          }
           if ((lm == 'h' || lm == 'l') && i < format.size() && format[i] == lm) {
             ++i;
           }
@@ -2258,6 +3249,7 @@ class IrBuilderEmitter {
       }
 
       const char conv = format[i++];
+      spec.end = i;
       switch (conv) {
         case 'd':
         case 'i':
@@ -2309,6 +3301,134 @@ class IrBuilderEmitter {
     return mask;
   }
 
+  static bool CanSpecializePrint(const std::string& format,
+                                 const std::vector<PrintFormatSpec>& specs) {
+    if (format.find('\0') != std::string::npos) {
+      return false;
+    }
+    for (const PrintFormatSpec& spec : specs) {
+      if (spec.width_from_arg || spec.precision_from_arg) {
+        return false;
+      }
+      switch (spec.conv) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+          if (spec.precision >= 0) {
+            return false;
+          }
+          break;
+        case 'b':
+        case 'c':
+        case 's':
+          break;
+        case 'f':
+          if (spec.flags != 0 || spec.width != 0) {
+            return false;
+          }
+          break;
+        default:
+          return false;
+      }
+    }
+    return true;
+  }
+
+  void EmitSpecializedPrint(const std::string& format, const std::vector<PrintFormatSpec>& specs,
+                            const std::vector<llvm::Value*>& args) {
+    llvm::Type* void_ty = llvm::Type::getVoidTy(*context_);
+    auto i64 = [&](std::int64_t value) {
+      return llvm::ConstantInt::get(TypeI64(), static_cast<std::uint64_t>(value), true);
+    };
+    auto call = [&](const char* name, llvm::ArrayRef<llvm::Type*> params,
+                    llvm::ArrayRef<llvm::Value*> operands) {
+      llvm::FunctionCallee callee =
+          module_->getOrInsertFunction(name, llvm::FunctionType::get(void_ty, params, false));
+      builder_.CreateCall(callee, operands);
+    };
+
+    std::string pending;
+    auto append_literal = [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        pending.push_back(format[i]);
+        if (format[i] == '%') {
+          ++i;
+        }
+      }
+    };
+    auto flush_literal = [&]() {
+      if (pending.empty()) {
+        return;
+      }
+      call("hc_fmt_write", {TypePtr(), TypeI64()},
+           {GetOrCreateStringData(pending), i64(static_cast<std::int64_t>(pending.size()))});
+      pending.clear();
+    };
+
+    std::size_t cursor = 0;
+    for (std::size_t i = 0; i < specs.size(); ++i) {
+      const PrintFormatSpec& spec = specs[i];
+      append_literal(cursor, spec.begin);
+      cursor = spec.end;
+      flush_literal();
+
+      llvm::Value* value = args[i];
+      const bool is_signed = spec.conv == 'd' || spec.conv == 'i';
+      if ((is_signed || spec.conv == 'u' || spec.conv == 'x' || spec.conv == 'X' ||
+           spec.conv == 'o') &&
+          spec.int_bits < 64) {
+        llvm::Value* narrow = builder_.CreateTrunc(
+            value, llvm::IntegerType::get(*context_, spec.int_bits), "print.narrow");
+        value = is_signed ? builder_.CreateSExt(narrow, TypeI64())
+                          : builder_.CreateZExt(narrow, TypeI64());
+      }
+      switch (spec.conv) {
+        case 'd':
+        case 'i':
+          call("hc_fmt_i64_dec", {TypeI64(), TypeI64(), TypeI64()},
+               {i64(spec.width), i64(spec.flags), value});
+          break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'b': {
+          std::int64_t radix = spec.conv == 'u' ? 10 : spec.conv == 'o' ? 8 : 16;
+          std::int64_t flags = spec.flags & ~(HC_FMT_PLUS | HC_FMT_SPACE);
+          std::int64_t width = spec.width;
+          if (spec.conv == 'X') {
+            flags |= HC_FMT_UPPER;
+          } else if (spec.conv == 'b') {
+            radix = 2;
+            flags = 0;
+            width = 0;
+          }
+          call("hc_fmt_u64", {TypeI64(), TypeI64(), TypeI64(), TypeI64()},
+               {i64(radix), i64(width), i64(flags), value});
+          break;
+        }
+        case 'c':
+          call("hc_fmt_char", {TypeI64(), TypeI64(), TypeI64()},
+               {i64(spec.width), i64(spec.flags), value});
+          break;
+        case 's':
+          call("hc_fmt_str", {TypeI64(), TypeI64(), TypeI64(), TypePtr()},
+               {i64(spec.width), i64(spec.flags), i64(spec.precision),
+                builder_.CreateIntToPtr(value, TypePtr())});
+          break;
+        default:
+          call("hc_fmt_f64", {TypeI64(), TypeI64()},
+               {i64(spec.precision < 0 ? 6 : spec.precision), value});
+          break;
+      }
+    }
+    append_literal(cursor, format.size());
+    flush_literal();
+  }
+
   llvm_backend::Result EmitPrint(const HIRStmt& st, FunctionFrame* frame) {
     const std::string literal = !st.name.empty() ? st.name : st.print_format.text;
     if (!literal.empty() && literal.front() == '\'') {
@@ -2322,26 +3442,26 @@ class IrBuilderEmitter {
       return {true, ""};
     }
 
+    const bool literal_format = !literal.empty() && literal.front() == '"';
     llvm::Value* format_ptr = nullptr;
-    if (!literal.empty() && literal.front() == '"') {
-      format_ptr = GetOrCreateStringLiteral(literal);
-    } else {
+    if (!literal_format) {
       const ExprResult fmt_expr = EmitExpr(st.print_format, frame);
       if (!fmt_expr.ok) {
         return {false, fmt_expr.message};
       }
       format_ptr = CastIfNeeded(fmt_expr.value, TypePtr());
-    }
-
-    if (format_ptr == nullptr) {
-      return {false, "irbuilder emit: print format must be pointer-like"};
+      if (format_ptr == nullptr) {
+        return {false, "irbuilder emit: print format must be pointer-like"};
+      }
     }
 
     std::vector<bool> float_arg_mask(st.print_args.size(), false);
-    if (!literal.empty() && literal.front() == '"') {
+    std::string format_text;
+    std::vector<PrintFormatSpec> specs;
+    if (literal_format) {
       std::string format_error;
-      const std::vector<PrintFormatSpec> specs =
-          ParsePrintFormatSpecifiers(DecodeQuotedString(literal), &format_error);
+      format_text = DecodeQuotedString(literal);
+      specs = ParsePrintFormatSpecifiers(format_text, &format_error);
       if (!format_error.empty()) {
         return {false, "irbuilder emit: " + format_error};
       }
@@ -2369,6 +3489,14 @@ class IrBuilderEmitter {
       coerced_args.push_back(as_i64);
     }
 
+    if (literal_format) {
+      if (CanSpecializePrint(format_text, specs)) {
+        EmitSpecializedPrint(format_text, specs, coerced_args);
+        return {true, ""};
+      }
+      format_ptr = GetOrCreateStringLiteral(literal);
+    }
+
     llvm::Value* args_ptr = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(TypePtr()));
     if (!coerced_args.empty()) {
       llvm::ArrayType* arg_array_ty = llvm::ArrayType::get(TypeI64(), coerced_args.size());
@@ -3054,7 +4182,16 @@ class IrBuilderEmitter {
       return it->second;
     }
 
-    const std::string decoded = DecodeQuotedString(quoted);
+    llvm::Constant* ptr = GetOrCreateStringData(DecodeQuotedString(quoted));
+    string_literals_[quoted] = ptr;
+    return ptr;
+  }
+
+  llvm::Constant* GetOrCreateStringData(const std::string& decoded) {
+    const auto it = string_data_.find(decoded);
+    if (it != string_data_.end()) {
+      return it->second;
+    }
 
     llvm::Constant* data = llvm::ConstantDataArray::getString(*context_, decoded, true);
     auto* gv = new llvm::GlobalVariable(*module_, data->getType(), true,
@@ -3065,7 +4202,7 @@ class IrBuilderEmitter {
     llvm::Constant* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), 0);
     llvm::Constant* indices[] = {zero, zero};
     llvm::Constant* ptr = llvm::ConstantExpr::getGetElementPtr(data->getType(), gv, indices);
-    string_literals_[quoted] = ptr;
+    string_data_[decoded] = ptr;
     return ptr;
   }
 
@@ -3099,13 +4236,23 @@ class IrBuilderEmitter {
   std::unique_ptr<llvm::LLVMContext> context_;
   std::unique_ptr<llvm::Module> module_;
   llvm::IRBuilder<> builder_;
+  frontend::ExceptionModel exception_model_;
+  const HIRMayThrowSummary* may_throw_ = nullptr;
+  frontend::ExecutionMode mode_ = frontend::ExecutionMode::kAot;
   std::unordered_map<std::string, llvm::Function*> functions_;
   std::unordered_map<std::string, llvm::GlobalVariable*> globals_;
   std::unordered_map<std::string, llvm::Constant*> global_constants_;
   std::unordered_map<std::string, AggregateLayout> aggregate_layouts_;
   std::unordered_map<std::string, llvm::Constant*> string_literals_;
+  std::unordered_map<std::string, llvm::Constant*> string_data_;
   llvm::Constant* reflection_table_ptr_ = nullptr;
   std::uint64_t reflection_table_count_ = 0;
+  std::unordered_map<std::string, LockFootprint> function_footprints_;
+  std::unordered_set<std::string> bodiless_functions_;
+  std::unordered_set<std::string> local_vars_;
+  std::unordered_set<std::string> address_taken_vars_;
+  LockFootprint striped_footprint_;
+  bool has_striped_locks_ = false;
   int next_string_id_ = 0;
 };
 
@@ -3115,14 +4262,42 @@ class IrBuilderEmitter {
 
 llvm_backend::Result EmitIrFromHir(const frontend::internal::HIRModule& module,
                                    std::string_view module_name,
-                                   std::string_view target_triple) {
+                                   std::string_view target_triple,
+                                   frontend::ExceptionModel exception_model,
+                                   const frontend::internal::HIRMayThrowSummary* may_throw,
+                                   frontend::ExecutionMode mode) {
 #ifdef HOLYC_LLVM_IRBUILDER_HEADERS_AVAILABLE
-  IrBuilderEmitter emitter(module_name, target_triple);
+  IrBuilderEmitter emitter(module_name, target_triple, exception_model, may_throw, mode);
   return emitter.Emit(module);
 #else
   (void)module;
   (void)module_name;
   (void)target_triple;
+  (void)exception_model;
+  (void)may_throw;
+  (void)mode;
+  return {false, "LLVM IRBuilder backend not enabled at build time"};
+#endif
+}
+
+llvm_backend::Result EmitModuleFromHir(const frontend::internal::HIRModule& module,
+                                       llvm_backend::IrModulePtr* module_out,
+                                       std::string_view module_name,
+                                       std::string_view target_triple,
+                                       frontend::ExceptionModel exception_model,
+                                       const frontend::internal::HIRMayThrowSummary* may_throw,
+                                       frontend::ExecutionMode mode) {
+#ifdef HOLYC_LLVM_IRBUILDER_HEADERS_AVAILABLE
+  IrBuilderEmitter emitter(module_name, target_triple, exception_model, may_throw, mode);
+  return emitter.EmitModule(module, module_out);
+#else
+  (void)module;
+  (void)module_out;
+  (void)module_name;
+  (void)target_triple;
+  (void)exception_model;
+  (void)may_throw;
+  (void)mode;
   return {false, "LLVM IRBuilder backend not enabled at build time"};
 #endif
 }
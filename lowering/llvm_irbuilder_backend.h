@@ -2,6 +2,7 @@
 
 #include <string_view>
 
+#include "frontend.h"
 #include "hir.h"
 #include "llvm_backend.h"
 
@@ -9,6 +10,21 @@ namespace holyc::llvm_irbuilder_backend {
 
 llvm_backend::Result EmitIrFromHir(const frontend::internal::HIRModule& module,
                                    std::string_view module_name = "holyc",
-                                   std::string_view target_triple = "");
+                                   std::string_view target_triple = "",
+                                   frontend::ExceptionModel exception_model =
+                                       frontend::ExceptionModel::kTable,
+                                   const frontend::internal::HIRMayThrowSummary* may_throw =
+                                       nullptr,
+                                   frontend::ExecutionMode mode = frontend::ExecutionMode::kAot);
+llvm_backend::Result EmitModuleFromHir(const frontend::internal::HIRModule& module,
+                                       llvm_backend::IrModulePtr* module_out,
+                                       std::string_view module_name = "holyc",
+                                       std::string_view target_triple = "",
+                                       frontend::ExceptionModel exception_model =
+                                           frontend::ExceptionModel::kTable,
+                                       const frontend::internal::HIRMayThrowSummary* may_throw =
+                                           nullptr,
+                                       frontend::ExecutionMode mode =
+                                           frontend::ExecutionMode::kAot);
 
 }  // namespace holyc::llvm_irbuilder_backend
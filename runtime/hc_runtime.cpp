@@ -1,26 +1,202 @@
 #include "hc_runtime.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cctype>
 #include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
 #if defined(__unix__) || defined(__APPLE__)
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #endif
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <malloc.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#define HC_RUNTIME_FIBERS 1
+#else
+#define HC_RUNTIME_FIBERS 0
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define HC_RUNTIME_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define HC_RUNTIME_ASAN 1
+#endif
+#endif
+
+#if !defined(HC_RUNTIME_ALLOCATOR)
+#if defined(HC_RUNTIME_ASAN) || !(defined(__unix__) || defined(__APPLE__))
+#define HC_RUNTIME_ALLOCATOR 0
+#else
+#define HC_RUNTIME_ALLOCATOR 1
+#endif
+#endif
+
+// Without the span allocator, Free() can only tell task-arena blocks apart
+// through a global registry. It costs a mutex per scoped allocation, so it
+// is a debug aid that ASan builds turn on by default.
+#if !defined(HC_RUNTIME_ARENA_FREE_CHECK)
+#if defined(HC_RUNTIME_ASAN)
+#define HC_RUNTIME_ARENA_FREE_CHECK 1
+#else
+#define HC_RUNTIME_ARENA_FREE_CHECK 0
+#endif
+#endif
+
+#if HC_RUNTIME_FIBERS
+#if defined(__APPLE__)
+#define HC_ASM_SYMBOL(name) "_" name
+#define HC_ASM_PROLOGUE(symbol) ".private_extern " symbol "\n"
+#elif defined(__x86_64__)
+#define HC_ASM_SYMBOL(name) name
+#define HC_ASM_PROLOGUE(symbol) ".hidden " symbol "\n.type " symbol ", @function\n"
+#else
+#define HC_ASM_SYMBOL(name) name
+#define HC_ASM_PROLOGUE(symbol) ".hidden " symbol "\n.type " symbol ", %function\n"
+#endif
+#define HC_FIBER_SWITCH_SYMBOL HC_ASM_SYMBOL("hc_fiber_switch_context")
+#define HC_FIBER_SWITCH_PROLOGUE HC_ASM_PROLOGUE(HC_FIBER_SWITCH_SYMBOL)
+#define HC_STACK_CALL_SYMBOL HC_ASM_SYMBOL("hc_stack_call")
+#define HC_STACK_CALL_PROLOGUE HC_ASM_PROLOGUE(HC_STACK_CALL_SYMBOL)
+
+#if defined(__x86_64__)
+asm(".text\n"
+    ".globl " HC_FIBER_SWITCH_SYMBOL "\n"
+    HC_FIBER_SWITCH_PROLOGUE
+    ".p2align 4\n"
+    HC_FIBER_SWITCH_SYMBOL ":\n"
+    "  pushq %rbp\n"
+    "  pushq %rbx\n"
+    "  pushq %r12\n"
+    "  pushq %r13\n"
+    "  pushq %r14\n"
+    "  pushq %r15\n"
+    "  subq $8, %rsp\n"
+    "  stmxcsr (%rsp)\n"
+    "  fnstcw 4(%rsp)\n"
+    "  movq %rsp, (%rdi)\n"
+    "  movq %rsi, %rsp\n"
+    "  ldmxcsr (%rsp)\n"
+    "  fldcw 4(%rsp)\n"
+    "  addq $8, %rsp\n"
+    "  popq %r15\n"
+    "  popq %r14\n"
+    "  popq %r13\n"
+    "  popq %r12\n"
+    "  popq %rbx\n"
+    "  popq %rbp\n"
+    "  ret\n");
+
+asm(".text\n"
+    ".globl " HC_STACK_CALL_SYMBOL "\n"
+    HC_STACK_CALL_PROLOGUE
+    ".p2align 4\n"
+    HC_STACK_CALL_SYMBOL ":\n"
+    "  .cfi_startproc\n"
+    "  pushq %rbp\n"
+    "  .cfi_def_cfa_offset 16\n"
+    "  .cfi_offset %rbp, -16\n"
+    "  movq %rsp, %rbp\n"
+    "  .cfi_def_cfa_register %rbp\n"
+    "  movq %rdx, %rsp\n"
+    "  callq *%rsi\n"
+    "  movq %rbp, %rsp\n"
+    "  popq %rbp\n"
+    "  .cfi_def_cfa %rsp, 8\n"
+    "  ret\n"
+    "  .cfi_endproc\n");
+#else
+asm(".text\n"
+    ".globl " HC_FIBER_SWITCH_SYMBOL "\n"
+    HC_FIBER_SWITCH_PROLOGUE
+    ".p2align 2\n"
+    HC_FIBER_SWITCH_SYMBOL ":\n"
+    "  sub sp, sp, #160\n"
+    "  stp x19, x20, [sp, #0]\n"
+    "  stp x21, x22, [sp, #16]\n"
+    "  stp x23, x24, [sp, #32]\n"
+    "  stp x25, x26, [sp, #48]\n"
+    "  stp x27, x28, [sp, #64]\n"
+    "  stp x29, x30, [sp, #80]\n"
+    "  stp d8, d9, [sp, #96]\n"
+    "  stp d10, d11, [sp, #112]\n"
+    "  stp d12, d13, [sp, #128]\n"
+    "  stp d14, d15, [sp, #144]\n"
+    "  mov x9, sp\n"
+    "  str x9, [x0]\n"
+    "  mov sp, x1\n"
+    "  ldp x19, x20, [sp, #0]\n"
+    "  ldp x21, x22, [sp, #16]\n"
+    "  ldp x23, x24, [sp, #32]\n"
+    "  ldp x25, x26, [sp, #48]\n"
+    "  ldp x27, x28, [sp, #64]\n"
+    "  ldp x29, x30, [sp, #80]\n"
+    "  ldp d8, d9, [sp, #96]\n"
+    "  ldp d10, d11, [sp, #112]\n"
+    "  ldp d12, d13, [sp, #128]\n"
+    "  ldp d14, d15, [sp, #144]\n"
+    "  add sp, sp, #160\n"
+    "  ret\n");
+
+asm(".text\n"
+    ".globl " HC_STACK_CALL_SYMBOL "\n"
+    HC_STACK_CALL_PROLOGUE
+    ".p2align 2\n"
+    HC_STACK_CALL_SYMBOL ":\n"
+    "  .cfi_startproc\n"
+    "  stp x29, x30, [sp, #-16]!\n"
+    "  .cfi_def_cfa_offset 16\n"
+    "  .cfi_offset x30, -8\n"
+    "  .cfi_offset x29, -16\n"
+    "  mov x29, sp\n"
+    "  .cfi_def_cfa_register x29\n"
+    "  mov sp, x2\n"
+    "  blr x1\n"
+    "  mov sp, x29\n"
+    "  .cfi_def_cfa_register sp\n"
+    "  ldp x29, x30, [sp], #16\n"
+    "  .cfi_def_cfa_offset 0\n"
+    "  .cfi_restore x30\n"
+    "  .cfi_restore x29\n"
+    "  ret\n"
+    "  .cfi_endproc\n");
+#endif
+#endif
+
+
 extern "C" {
 
 struct HcMemberMeta {
   char* key;
   std::int64_t value;
   HcMemberMeta* next;
+  std::uint64_t hash;
 };
 
 struct CMemberLst {
@@ -28,6 +204,7 @@ struct CMemberLst {
   std::int64_t offset;
   CMemberLst* next;
   HcMemberMeta* meta;
+  std::uint64_t hash;
 };
 
 struct CHashClass {
@@ -36,49 +213,584 @@ struct CHashClass {
   CHashClass* next;
   CMemberLst* tail;
   std::int64_t next_offset;
+  std::uint64_t hash;
+  CMemberLst** member_slots;
+  std::uint64_t member_mask;
+};
+
+struct HcReflectionIndex {
+  const hc_reflection_field* fields;
+  std::size_t field_count;
+  CHashClass* classes;
+  CHashClass** slots;
+  std::uint64_t mask;
+  CMemberLst* members;
+  std::size_t member_count;
+  HcMemberMeta* metas;
+  std::size_t meta_capacity;
+  HcReflectionIndex* retired;
+};
+
+struct HcArenaBump {
+  char* bump;
+  char* limit;
+  void* chunks;
+};
+
+struct HcArenaScope {
+  HcArenaBump local;
+  HcArenaBump shared;
+  std::atomic<bool> lock;
 };
 
 struct CJob {
-  pthread_t thread;
+  HcArenaScope arena;
   const char* fn;
   std::int64_t arg;
   std::int64_t result;
-  int joined;
+  int flags;
+  std::atomic<int> done;
+  std::atomic<CJob*> then;
+  CJob* prev;
+  CJob* next;
+};
+
+struct HcWaitGroup {
+  std::atomic<std::int64_t> count;
+  std::atomic<std::uint32_t> seq;
+  std::atomic<std::int32_t> waiters;
+};
+
+struct CSpawnGrp {
+  HcWaitGroup wait;
+  CSpawnGrp* outer;
+  CSpawnGrp* next_free;
+};
+
+struct HcFifoCell {
+  std::atomic<std::uint64_t> seq;
+  std::atomic<std::int64_t> value;
+};
+
+struct alignas(64) CFifoI64 {
+  HcFifoCell* cells;
+  std::uint64_t mask;
+  std::int64_t flags;
+  alignas(64) std::atomic<std::uint64_t> in;
+  std::uint64_t out_cache;
+  alignas(64) std::atomic<std::uint64_t> out;
+  std::uint64_t in_cache;
+  alignas(64) std::atomic<std::uint32_t> event;
+  std::atomic<std::uint32_t> sleeping;
+};
+
+struct CFifoU8 {
+  CFifoI64 ring;
 };
 
 struct HcSpawnRequest {
+  HcArenaScope arena;
+  std::int64_t id;
+  const char* fn;
+  const char* data;
+  CSpawnGrp* group;
+};
+
+struct CTask {
+  HcArenaScope arena;
+  void* sp;
+  void* return_sp;
+  char* stack_lo;
+  std::size_t stack_size;
+  bool stack_pooled;
+  int state;
   const char* fn;
   const char* data;
+  std::int64_t id;
+  std::int64_t target_cpu;
+  std::int64_t wake_ns;
+  hc_try_frame* try_stack;
+  std::int64_t exception_payload;
+  char* stack_limit;
+  void* stack_call;
+  CSpawnGrp* spawn_group;
+  CSpawnGrp* spawn_scope;
+  const void* asan_stack_bottom;
+  std::size_t asan_stack_size;
+  void* asan_fake_stack;
+  const void* asan_return_bottom;
+  std::size_t asan_return_size;
+  CTask* next;
+  char name[32];
 };
 
+#if HC_RUNTIME_FIBERS
+void hc_fiber_switch_context(void** save_sp, void* load_sp);
+void hc_stack_call(void* ctx, void (*entry)(void*), void* stack_top);
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+extern char** environ;
+#endif
+
+#if defined(__APPLE__)
+int __ulock_wait(std::uint32_t operation, void* addr, std::uint64_t value, std::uint32_t timeout);
+int __ulock_wake(std::uint32_t operation, void* addr, std::uint64_t wake_value);
+#endif
+
+#if defined(HC_RUNTIME_ASAN)
+void __sanitizer_start_switch_fiber(void** fake_stack_save, const void* bottom, std::size_t size);
+void __sanitizer_finish_switch_fiber(void* fake_stack_save, const void** bottom_old,
+                                     std::size_t* size_old);
+#endif
+
 namespace {
 
 thread_local hc_try_frame* g_try_stack = nullptr;
 thread_local std::int64_t g_exception_payload = 0;
-thread_local const hc_reflection_field* g_reflection_fields = nullptr;
-thread_local std::size_t g_reflection_field_count = 0;
-thread_local CHashClass* g_hash_classes = nullptr;
-thread_local bool g_reflection_cache_ready = false;
+thread_local char* g_stack_limit = nullptr;
+pthread_mutex_t g_reflection_mutex = PTHREAD_MUTEX_INITIALIZER;
+const hc_reflection_field* g_reflection_fields = nullptr;
+std::size_t g_reflection_field_count = 0;
+std::atomic<HcReflectionIndex*> g_reflection_index{nullptr};
+HcReflectionIndex* g_reflection_retired = nullptr;
 std::atomic<std::int64_t> g_next_task_id{1};
-pthread_mutex_t g_spawn_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t g_spawn_cond = PTHREAD_COND_INITIALIZER;
-std::int64_t g_spawn_inflight = 0;
+// Spawn returns an opaque id instead of its task: a finished fiber's CTask
+// goes back to the pool and a spawned thread frees its request on exit, so
+// a kept pointer would dangle. Task pointers are aligned, so the low bit
+// marks such ids and MAlloc resolves them through g_spawn_arenas instead.
+constexpr std::uintptr_t kSpawnHandleTag = 1;
+// Arenas of spawned tasks that are still running, by task id. Ids are never
+// reused, so a handle outliving its task misses here rather than reaching a
+// recycled arena. A task leaves the registry before its arena is released.
+pthread_mutex_t g_spawn_arenas_mutex = PTHREAD_MUTEX_INITIALIZER;
+std::unordered_map<std::int64_t, HcArenaScope*> g_spawn_arenas;
+HcWaitGroup g_spawn_all{};
+thread_local CSpawnGrp* g_spawn_scope = nullptr;
+pthread_mutex_t g_spawn_grp_mutex = PTHREAD_MUTEX_INITIALIZER;
+CSpawnGrp* g_spawn_grp_free = nullptr;
+
+enum HcStatField : std::size_t {
+  kStatAllocs,
+  kStatFrees,
+  kStatBytesAllocated,
+  kStatBytesFreed,
+  kStatArenaAllocs,
+  kStatArenaBytes,
+  kStatJobsRun,
+  kStatTasksSpawned,
+  kStatExceptionsThrown,
+  kStatBytesPrinted,
+  kStatSizeBuckets,
+  kStatFieldCount = kStatSizeBuckets + HC_RUNTIME_STATS_SIZE_BUCKETS,
+};
+
+// Only the owning thread writes values. hc_runtime_stats_enable snapshots
+// them into baseline instead of zeroing counters other threads update.
+struct HcStatsThread {
+  std::atomic<std::int64_t> values[kStatFieldCount];
+  std::atomic<std::int64_t> baseline[kStatFieldCount];
+  std::int64_t index;
+  HcStatsThread* next;
+};
+
+std::atomic<bool> g_stats_enabled{false};
+std::atomic<HcStatsThread*> g_stats_threads{nullptr};
+std::atomic<std::int64_t> g_stats_thread_count{0};
+std::atomic<std::int64_t> g_stats_live_bytes{0};
+std::atomic<std::int64_t> g_stats_peak_bytes{0};
+thread_local HcStatsThread* g_stats_thread = nullptr;
+
+bool StatsEnabled() {
+  return g_stats_enabled.load(std::memory_order_relaxed);
+}
+
+__attribute__((noinline)) HcStatsThread* StatsAttach() {
+  HcStatsThread* stats = static_cast<HcStatsThread*>(std::calloc(1, sizeof(HcStatsThread)));
+  if (stats == nullptr) {
+    return nullptr;
+  }
+  stats->index = g_stats_thread_count.fetch_add(1, std::memory_order_relaxed);
+  HcStatsThread* head = g_stats_threads.load(std::memory_order_relaxed);
+  do {
+    stats->next = head;
+  } while (!g_stats_threads.compare_exchange_weak(head, stats, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+  g_stats_thread = stats;
+  return stats;
+}
+
+void StatsAdd(std::size_t field, std::int64_t amount) {
+  HcStatsThread* stats = g_stats_thread != nullptr ? g_stats_thread : StatsAttach();
+  if (stats != nullptr) {
+    std::atomic<std::int64_t>& value = stats->values[field];
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+}
+
+std::int64_t StatsValue(const HcStatsThread* stats, std::size_t field) {
+  return stats->values[field].load(std::memory_order_relaxed) -
+         stats->baseline[field].load(std::memory_order_relaxed);
+}
+
+void StatsCount(std::size_t field, std::int64_t amount) {
+  if (StatsEnabled()) {
+    StatsAdd(field, amount);
+  }
+}
+
+std::size_t StatsSizeBucket(std::size_t size) {
+  if (size <= 16) {
+    return kStatSizeBuckets;
+  }
+  const std::size_t bucket = static_cast<std::size_t>(64 - __builtin_clzll(size - 1)) - 4;
+  return kStatSizeBuckets + std::min<std::size_t>(bucket, HC_RUNTIME_STATS_SIZE_BUCKETS - 1);
+}
+
+// Blocks allocated before stats were enabled are freed untracked, so the
+// live count is clamped at zero rather than going negative.
+void StatsLiveBytes(std::int64_t delta) {
+  std::int64_t live = g_stats_live_bytes.load(std::memory_order_relaxed);
+  std::int64_t next = 0;
+  do {
+    next = std::max<std::int64_t>(live + delta, 0);
+  } while (!g_stats_live_bytes.compare_exchange_weak(live, next, std::memory_order_relaxed));
+  live = next;
+  std::int64_t peak = g_stats_peak_bytes.load(std::memory_order_relaxed);
+  while (live > peak &&
+         !g_stats_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+#if defined(__APPLE__)
+constexpr std::uint32_t kUlockCompareAndWait = 1;
+constexpr std::uint32_t kUlockWakeAll = 0x00000100;
+constexpr std::uint32_t kUlockNoErrno = 0x01000000;
+#endif
+
+void FutexWait(std::atomic<std::uint32_t>* word, std::uint32_t expected,
+               std::int64_t timeout_ns = 0) {
+#if defined(__linux__)
+  timespec timeout{};
+  timeout.tv_sec = static_cast<time_t>(timeout_ns / 1000000000);
+  timeout.tv_nsec = static_cast<long>(timeout_ns % 1000000000);
+  (void)::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected,
+                  timeout_ns > 0 ? &timeout : nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+  const std::int64_t timeout_us = timeout_ns > 0 ? std::max<std::int64_t>(timeout_ns / 1000, 1) : 0;
+  (void)__ulock_wait(kUlockCompareAndWait | kUlockNoErrno, word, expected,
+                     static_cast<std::uint32_t>(std::min<std::int64_t>(timeout_us, UINT32_MAX)));
+#else
+  if (timeout_ns > 0) {
+    sched_yield();
+    return;
+  }
+  while (word->load(std::memory_order_acquire) == expected) {
+    sched_yield();
+  }
+#endif
+}
+
+void FutexWakeAll(std::atomic<std::uint32_t>* word) {
+#if defined(__linux__)
+  (void)::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT_MAX,
+                  nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+  (void)__ulock_wake(kUlockCompareAndWait | kUlockWakeAll | kUlockNoErrno, word, 0);
+#else
+  (void)word;
+#endif
+}
+
+void WaitGroupAdd(HcWaitGroup* group) {
+  group->count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WaitGroupLeave(HcWaitGroup* group) {
+  if (group->count.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+      group->waiters.load(std::memory_order_seq_cst) > 0) {
+    group->seq.fetch_add(1, std::memory_order_release);
+    FutexWakeAll(&group->seq);
+  }
+}
+
+bool WaitGroupDrained(const void* opaque) {
+  const HcWaitGroup* group = static_cast<const HcWaitGroup*>(opaque);
+  return group->count.load(std::memory_order_acquire) <= 0;
+}
+
+void WaitGroupBlock(HcWaitGroup* group) {
+  while (!WaitGroupDrained(group)) {
+    const std::uint32_t seq = group->seq.load(std::memory_order_acquire);
+    group->waiters.fetch_add(1, std::memory_order_seq_cst);
+    if (group->count.load(std::memory_order_seq_cst) > 0) {
+      FutexWait(&group->seq, seq);
+    }
+    group->waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void MarkSpawnStart(CSpawnGrp* group) {
+  WaitGroupAdd(&g_spawn_all);
+  if (group != nullptr) {
+    WaitGroupAdd(&group->wait);
+  }
+}
+
+void MarkSpawnDone(CSpawnGrp* group) {
+  if (group != nullptr) {
+    WaitGroupLeave(&group->wait);
+  }
+  WaitGroupLeave(&g_spawn_all);
+}
+
+void SpawnArenaRegister(std::int64_t id, HcArenaScope* scope) {
+  pthread_mutex_lock(&g_spawn_arenas_mutex);
+  g_spawn_arenas[id] = scope;
+  pthread_mutex_unlock(&g_spawn_arenas_mutex);
+}
+
+void SpawnArenaUnregister(std::int64_t id) {
+  pthread_mutex_lock(&g_spawn_arenas_mutex);
+  g_spawn_arenas.erase(id);
+  pthread_mutex_unlock(&g_spawn_arenas_mutex);
+}
+
+constexpr std::size_t kOutputBufferSize = 8192;
+constexpr int kFmtLeft = HC_FMT_LEFT;
+constexpr int kFmtPlus = HC_FMT_PLUS;
+constexpr int kFmtSpace = HC_FMT_SPACE;
+constexpr int kFmtAlt = HC_FMT_ALT;
+constexpr int kFmtZero = HC_FMT_ZERO;
+constexpr int kFmtUpper = HC_FMT_UPPER;
+constexpr char kDigitPairs[] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+struct HcOutputBuffer {
+  std::size_t len;
+  bool registered;
+  bool closed;
+  char data[kOutputBufferSize];
+};
+
+struct HcOutputExit {
+  ~HcOutputExit();
+};
+
+thread_local HcOutputBuffer g_output;
+thread_local HcOutputExit g_output_exit;
+std::atomic<int> g_output_line_mode{-1};
+
+void OutputEmit(const char* text, std::size_t len) {
+  std::fwrite(text, 1, len, stdout);
+  StatsCount(kStatBytesPrinted, static_cast<std::int64_t>(len));
+}
+
+void OutputFlush(HcOutputBuffer* out) {
+  if (out->len != 0) {
+    OutputEmit(out->data, out->len);
+    out->len = 0;
+  }
+}
+
+HcOutputExit::~HcOutputExit() {
+  OutputFlush(&g_output);
+  g_output.closed = true;
+}
 
-void MarkSpawnStart() {
-  pthread_mutex_lock(&g_spawn_mutex);
-  ++g_spawn_inflight;
-  pthread_mutex_unlock(&g_spawn_mutex);
+bool OutputLineBuffered() {
+  int mode = g_output_line_mode.load(std::memory_order_relaxed);
+  if (mode < 0) {
+    const char* text = std::getenv("HOLYC_OUTPUT_LINEBUF");
+    mode = text != nullptr && text[0] != '\0' && std::strcmp(text, "0") != 0 ? 1 : 0;
+    g_output_line_mode.store(mode, std::memory_order_relaxed);
+  }
+  return mode != 0;
+}
+
+__attribute__((noinline)) void OutputFlushThread() {
+  OutputFlush(&g_output);
+}
+
+void OutputCommit(HcOutputBuffer* out) {
+  if (!out->registered) {
+    out->registered = true;
+    static_cast<void>(&g_output_exit);
+  }
+  if (out->len != 0 && OutputLineBuffered() &&
+      std::memchr(out->data, '\n', out->len) != nullptr) {
+    OutputFlush(out);
+    std::fflush(stdout);
+  }
+}
+
+void OutputWrite(HcOutputBuffer* out, const char* text, std::size_t len) {
+  if (out->closed) {
+    OutputEmit(text, len);
+    return;
+  }
+  if (len > kOutputBufferSize - out->len) {
+    OutputFlush(out);
+    if (len >= kOutputBufferSize) {
+      OutputEmit(text, len);
+      return;
+    }
+  }
+  std::memcpy(out->data + out->len, text, len);
+  out->len += len;
+}
+
+void OutputPut(HcOutputBuffer* out, char ch) {
+  if (out->len < kOutputBufferSize && !out->closed) {
+    out->data[out->len++] = ch;
+    return;
+  }
+  OutputWrite(out, &ch, 1);
+}
+
+void OutputPad(HcOutputBuffer* out, char ch, std::int64_t count) {
+  if (count <= 0) {
+    return;
+  }
+  char chunk[64];
+  std::memset(chunk, ch, sizeof(chunk));
+  while (count > 0) {
+    const std::size_t step = std::min<std::size_t>(static_cast<std::size_t>(count), sizeof(chunk));
+    OutputWrite(out, chunk, step);
+    count -= static_cast<std::int64_t>(step);
+  }
+}
+
+void OutputText(HcOutputBuffer* out, const char* text, std::size_t len, int flags,
+                std::int64_t width) {
+  const std::int64_t pad = width - static_cast<std::int64_t>(len);
+  if ((flags & kFmtLeft) == 0) {
+    OutputPad(out, ' ', pad);
+  }
+  OutputWrite(out, text, len);
+  if ((flags & kFmtLeft) != 0) {
+    OutputPad(out, ' ', pad);
+  }
+}
+
+void OutputInteger(HcOutputBuffer* out, std::uint64_t magnitude, bool negative, unsigned base,
+                   bool upper, int flags, std::int64_t width, std::int64_t precision) {
+  char digits[72];
+  char* end = digits + sizeof(digits);
+  char* cur = end;
+  const bool is_zero = magnitude == 0;
+  if (!(is_zero && precision == 0)) {
+    if (base == 10) {
+      while (magnitude >= 100) {
+        const std::size_t pair = static_cast<std::size_t>(magnitude % 100) * 2;
+        magnitude /= 100;
+        *--cur = kDigitPairs[pair + 1];
+        *--cur = kDigitPairs[pair];
+      }
+      if (magnitude >= 10) {
+        const std::size_t pair = static_cast<std::size_t>(magnitude) * 2;
+        *--cur = kDigitPairs[pair + 1];
+        *--cur = kDigitPairs[pair];
+      } else {
+        *--cur = static_cast<char>('0' + magnitude);
+      }
+    } else {
+      const char* alphabet = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+      const unsigned shift = base == 16 ? 4U : base == 8 ? 3U : 1U;
+      const std::uint64_t mask = base - 1U;
+      do {
+        *--cur = alphabet[magnitude & mask];
+        magnitude >>= shift;
+      } while (magnitude != 0);
+    }
+  }
+  const std::int64_t count = end - cur;
+
+  char prefix[2];
+  std::int64_t prefix_len = 0;
+  if (negative) {
+    prefix[prefix_len++] = '-';
+  } else if ((flags & kFmtPlus) != 0) {
+    prefix[prefix_len++] = '+';
+  } else if ((flags & kFmtSpace) != 0) {
+    prefix[prefix_len++] = ' ';
+  }
+  if ((flags & kFmtAlt) != 0 && base == 16 && !is_zero) {
+    prefix[prefix_len++] = '0';
+    prefix[prefix_len++] = upper ? 'X' : 'x';
+  }
+
+  std::int64_t zeros = precision > count ? precision - count : 0;
+  if ((flags & kFmtAlt) != 0 && base == 8 && zeros == 0 && (count == 0 || *cur != '0')) {
+    zeros = 1;
+  }
+  const std::int64_t pad = width - (prefix_len + zeros + count);
+  const bool zero_fill = (flags & (kFmtZero | kFmtLeft)) == kFmtZero && precision < 0;
+  if ((flags & kFmtLeft) == 0 && !zero_fill) {
+    OutputPad(out, ' ', pad);
+  }
+  OutputWrite(out, prefix, static_cast<std::size_t>(prefix_len));
+  if (zero_fill) {
+    OutputPad(out, '0', pad);
+  }
+  OutputPad(out, '0', zeros);
+  OutputWrite(out, cur, static_cast<std::size_t>(count));
+  if ((flags & kFmtLeft) != 0) {
+    OutputPad(out, ' ', pad);
+  }
+}
+
+void OutputSigned(HcOutputBuffer* out, std::int64_t value, int flags, std::int64_t width,
+                  std::int64_t precision) {
+  const std::uint64_t magnitude = value < 0 ? 0ULL - static_cast<std::uint64_t>(value)
+                                            : static_cast<std::uint64_t>(value);
+  OutputInteger(out, magnitude, value < 0, 10, false, flags, width, precision);
 }
 
-void MarkSpawnDone() {
-  pthread_mutex_lock(&g_spawn_mutex);
-  if (g_spawn_inflight > 0) {
-    --g_spawn_inflight;
+void OutputDouble(HcOutputBuffer* out, char conv, int flags, std::int64_t width,
+                  std::int64_t precision, double value) {
+  char spec[16];
+  std::size_t spec_len = 0;
+  spec[spec_len++] = '%';
+  if ((flags & kFmtLeft) != 0) {
+    spec[spec_len++] = '-';
+  }
+  if ((flags & kFmtPlus) != 0) {
+    spec[spec_len++] = '+';
+  }
+  if ((flags & kFmtSpace) != 0) {
+    spec[spec_len++] = ' ';
+  }
+  if ((flags & kFmtAlt) != 0) {
+    spec[spec_len++] = '#';
   }
-  if (g_spawn_inflight == 0) {
-    pthread_cond_broadcast(&g_spawn_cond);
+  if ((flags & kFmtZero) != 0) {
+    spec[spec_len++] = '0';
   }
-  pthread_mutex_unlock(&g_spawn_mutex);
+  spec[spec_len++] = '*';
+  spec[spec_len++] = '.';
+  spec[spec_len++] = '*';
+  spec[spec_len++] = conv;
+  spec[spec_len] = '\0';
+  const int width_arg = static_cast<int>(std::min<std::int64_t>(width, INT_MAX));
+  const int precision_arg = static_cast<int>(std::min<std::int64_t>(precision, INT_MAX));
+  char text[128];
+  const int len = std::snprintf(text, sizeof(text), spec, width_arg, precision_arg, value);
+  if (len < 0) {
+    return;
+  }
+  if (static_cast<std::size_t>(len) < sizeof(text)) {
+    OutputWrite(out, text, static_cast<std::size_t>(len));
+    return;
+  }
+  char* heap = static_cast<char*>(std::malloc(static_cast<std::size_t>(len) + 1));
+  if (heap == nullptr) {
+    return;
+  }
+  std::snprintf(heap, static_cast<std::size_t>(len) + 1, spec, width_arg, precision_arg, value);
+  OutputWrite(out, heap, static_cast<std::size_t>(len));
+  std::free(heap);
 }
 
 const char* LookupZString(const char* table, std::int64_t index) {
@@ -95,21 +807,6 @@ const char* LookupZString(const char* table, std::int64_t index) {
   return cur;
 }
 
-void PrintBinary(std::uint64_t value) {
-  bool started = false;
-  for (int bit = 63; bit >= 0; --bit) {
-    const bool one = ((value >> bit) & 1ULL) != 0;
-    if (one) {
-      started = true;
-    }
-    if (started) {
-      std::fputc(one ? '1' : '0', stdout);
-    }
-  }
-  if (!started) {
-    std::fputc('0', stdout);
-  }
-}
 
 char* CopyCString(const char* text) {
   if (text == nullptr) {
@@ -124,33 +821,20 @@ char* CopyCString(const char* text) {
   return out;
 }
 
-void FreeMetaList(HcMemberMeta* meta) {
-  while (meta != nullptr) {
-    HcMemberMeta* next = meta->next;
-    std::free(meta->key);
-    std::free(meta);
-    meta = next;
+std::uint64_t ReflectionHash(const char* text) {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const unsigned char* cur = reinterpret_cast<const unsigned char*>(text); *cur != 0; ++cur) {
+    hash = (hash ^ *cur) * 0x100000001b3ULL;
   }
+  return hash;
 }
 
-void ClearReflectionCache() {
-  CHashClass* klass = g_hash_classes;
-  while (klass != nullptr) {
-    CHashClass* next_class = klass->next;
-    CMemberLst* member = klass->member_lst_and_root;
-    while (member != nullptr) {
-      CMemberLst* next_member = member->next;
-      std::free(const_cast<char*>(member->str));
-      FreeMetaList(member->meta);
-      std::free(member);
-      member = next_member;
-    }
-    std::free(const_cast<char*>(klass->class_name));
-    std::free(klass);
-    klass = next_class;
+std::uint64_t ReflectionSlotCount(std::size_t entries) {
+  std::uint64_t slots = 8;
+  while (slots < static_cast<std::uint64_t>(entries) * 2) {
+    slots <<= 1;
   }
-  g_hash_classes = nullptr;
-  g_reflection_cache_ready = false;
+  return slots;
 }
 
 std::size_t EstimateTypeSize(const char* type_name) {
@@ -367,6 +1051,7 @@ void AddMetaEntry(CMemberLst* member, const char* key, std::int64_t value) {
   meta->key = CopyCString(key);
   meta->value = value;
   meta->next = nullptr;
+  meta->hash = ReflectionHash(key);
 
   if (member->meta == nullptr) {
     member->meta = meta;
@@ -441,625 +1126,4196 @@ void PopulateMemberMeta(CMemberLst* member, const char* annotations) {
   std::free(copy);
 }
 
-CHashClass* FindClassByName(const char* class_name) {
-  for (CHashClass* klass = g_hash_classes; klass != nullptr; klass = klass->next) {
-    if (klass->class_name != nullptr && class_name != nullptr &&
-        std::strcmp(klass->class_name, class_name) == 0) {
+CHashClass* FindClass(const HcReflectionIndex* index, const char* class_name) {
+  if (index == nullptr || index->slots == nullptr || class_name == nullptr) {
+    return nullptr;
+  }
+  const std::uint64_t hash = ReflectionHash(class_name);
+  for (std::uint64_t slot = hash & index->mask;; slot = (slot + 1) & index->mask) {
+    CHashClass* klass = index->slots[slot];
+    if (klass == nullptr) {
+      return nullptr;
+    }
+    if (klass->hash == hash && std::strcmp(klass->class_name, class_name) == 0) {
       return klass;
     }
   }
-  return nullptr;
 }
 
-CHashClass* FindOrCreateClass(const char* class_name) {
-  CHashClass* existing = FindClassByName(class_name);
-  if (existing != nullptr) {
-    return existing;
-  }
-
-  CHashClass* klass = static_cast<CHashClass*>(std::calloc(1, sizeof(CHashClass)));
-  if (klass == nullptr) {
+const HcMemberMeta* FindMemberMeta(const char* key, const CMemberLst* member) {
+  if (key == nullptr || member == nullptr) {
     return nullptr;
   }
-  klass->class_name = CopyCString(class_name);
-  klass->member_lst_and_root = nullptr;
-  klass->tail = nullptr;
-  klass->next_offset = 0;
-  klass->next = g_hash_classes;
-  g_hash_classes = klass;
-  return klass;
+  const std::uint64_t hash = ReflectionHash(key);
+  for (const HcMemberMeta* meta = member->meta; meta != nullptr; meta = meta->next) {
+    if (meta->hash == hash && meta->key != nullptr && std::strcmp(meta->key, key) == 0) {
+      return meta;
+    }
+  }
+  return nullptr;
 }
 
-void AppendMemberField(CHashClass* klass, const hc_reflection_field& field) {
-  if (klass == nullptr || field.field_name == nullptr) {
-    return;
+CHashClass* InsertClass(HcReflectionIndex* index, std::size_t* class_count, const char* class_name) {
+  const std::uint64_t hash = ReflectionHash(class_name);
+  std::uint64_t slot = hash & index->mask;
+  for (;; slot = (slot + 1) & index->mask) {
+    CHashClass* klass = index->slots[slot];
+    if (klass == nullptr) {
+      break;
+    }
+    if (klass->hash == hash && std::strcmp(klass->class_name, class_name) == 0) {
+      return klass;
+    }
   }
+  CHashClass* klass = &index->classes[(*class_count)++];
+  klass->class_name = class_name;
+  klass->hash = hash;
+  index->slots[slot] = klass;
+  return klass;
+}
 
-  CMemberLst* member = static_cast<CMemberLst*>(std::calloc(1, sizeof(CMemberLst)));
-  if (member == nullptr) {
-    return;
+void AppendResolvedMeta(CMemberLst* member, const hc_reflection_field& field, HcMemberMeta* metas) {
+  HcMemberMeta* tail = nullptr;
+  for (std::int64_t i = 0; field.meta != nullptr && i < field.meta_count; ++i) {
+    HcMemberMeta* meta = &metas[i];
+    meta->key = const_cast<char*>(field.meta[i].key);
+    meta->value = field.meta[i].value;
+    meta->hash = ReflectionHash(field.meta[i].key);
+    if (tail == nullptr) {
+      member->meta = meta;
+    } else {
+      tail->next = meta;
+    }
+    tail = meta;
   }
+}
 
-  member->str = CopyCString(field.field_name);
-  member->offset = klass->next_offset;
+void AppendMemberField(CHashClass* klass, CMemberLst* member, const hc_reflection_field& field,
+                       HcMemberMeta* metas) {
+  member->str = field.field_name;
+  member->hash = ReflectionHash(field.field_name);
   member->next = nullptr;
   member->meta = nullptr;
-  klass->next_offset += static_cast<std::int64_t>(EstimateTypeSize(field.field_type));
+  if (field.size > 0) {
+    member->offset = field.offset;
+    klass->next_offset = field.offset + field.size;
+  } else {
+    member->offset = klass->next_offset;
+    klass->next_offset += static_cast<std::int64_t>(EstimateTypeSize(field.field_type));
+  }
 
   if (klass->member_lst_and_root == nullptr) {
     klass->member_lst_and_root = member;
-    klass->tail = member;
   } else {
     klass->tail->next = member;
-    klass->tail = member;
   }
+  klass->tail = member;
 
-  PopulateMemberMeta(member, field.annotations);
+  if (field.size > 0) {
+    AppendResolvedMeta(member, field, metas);
+  } else {
+    PopulateMemberMeta(member, field.annotations);
+  }
 }
 
-void EnsureReflectionCache() {
-  if (g_reflection_cache_ready) {
-    return;
+void IndexClassMembers(CHashClass* klass) {
+  std::size_t count = 0;
+  for (CMemberLst* member = klass->member_lst_and_root; member != nullptr; member = member->next) {
+    ++count;
   }
-  ClearReflectionCache();
-
-  if (g_reflection_fields == nullptr || g_reflection_field_count == 0) {
-    g_reflection_cache_ready = true;
+  const std::uint64_t slots = ReflectionSlotCount(count);
+  klass->member_slots = static_cast<CMemberLst**>(std::calloc(slots, sizeof(CMemberLst*)));
+  if (klass->member_slots == nullptr) {
     return;
   }
-
-  for (std::size_t i = 0; i < g_reflection_field_count; ++i) {
-    const hc_reflection_field& field = g_reflection_fields[i];
-    if (field.aggregate_name == nullptr || field.field_name == nullptr) {
-      continue;
+  klass->member_mask = slots - 1;
+  for (CMemberLst* member = klass->member_lst_and_root; member != nullptr; member = member->next) {
+    std::uint64_t slot = member->hash & klass->member_mask;
+    bool duplicate = false;
+    for (; klass->member_slots[slot] != nullptr; slot = (slot + 1) & klass->member_mask) {
+      const CMemberLst* other = klass->member_slots[slot];
+      if (other->hash == member->hash && std::strcmp(other->str, member->str) == 0) {
+        duplicate = true;
+        break;
+      }
     }
-    CHashClass* klass = FindOrCreateClass(field.aggregate_name);
-    if (klass == nullptr) {
-      continue;
+    if (!duplicate) {
+      klass->member_slots[slot] = member;
     }
-    AppendMemberField(klass, field);
   }
-
-  g_reflection_cache_ready = true;
 }
 
-void* JobThreadMain(void* opaque) {
-  CJob* job = static_cast<CJob*>(opaque);
-  if (job == nullptr || job->fn == nullptr) {
+HcReflectionIndex* BuildReflectionIndex(const hc_reflection_field* fields, std::size_t field_count) {
+  HcReflectionIndex* index =
+      static_cast<HcReflectionIndex*>(std::calloc(1, sizeof(HcReflectionIndex)));
+  if (index == nullptr) {
     return nullptr;
   }
+  index->fields = fields;
+  index->field_count = field_count;
+  if (fields == nullptr || field_count == 0) {
+    return index;
+  }
 
-  using JobFn = void (*)(std::int64_t);
-  JobFn fn = reinterpret_cast<JobFn>(reinterpret_cast<std::uintptr_t>(job->fn));
-  fn(job->arg);
-  job->result = 0;
-  return nullptr;
-}
-
-void* SpawnThreadMain(void* opaque) {
-  HcSpawnRequest* req = static_cast<HcSpawnRequest*>(opaque);
-  if (req == nullptr) {
-    MarkSpawnDone();
-    return nullptr;
+  const std::uint64_t slots = ReflectionSlotCount(field_count);
+  index->slots = static_cast<CHashClass**>(std::calloc(slots, sizeof(CHashClass*)));
+  index->classes = static_cast<CHashClass*>(std::calloc(field_count, sizeof(CHashClass)));
+  index->members = static_cast<CMemberLst*>(std::calloc(field_count, sizeof(CMemberLst)));
+  std::size_t meta_total = 0;
+  for (std::size_t i = 0; i < field_count; ++i) {
+    if (fields[i].size > 0 && fields[i].meta != nullptr && fields[i].meta_count > 0) {
+      meta_total += static_cast<std::size_t>(fields[i].meta_count);
+    }
   }
-  if (req->fn != nullptr) {
-    using SpawnFn = void (*)(const char*);
-    SpawnFn fn = reinterpret_cast<SpawnFn>(reinterpret_cast<std::uintptr_t>(req->fn));
-    fn(req->data);
+  index->metas = static_cast<HcMemberMeta*>(std::calloc(meta_total + 1, sizeof(HcMemberMeta)));
+  if (index->slots == nullptr || index->classes == nullptr || index->members == nullptr ||
+      index->metas == nullptr) {
+    std::free(index->slots);
+    std::free(index->classes);
+    std::free(index->members);
+    std::free(index->metas);
+    index->slots = nullptr;
+    index->classes = nullptr;
+    index->members = nullptr;
+    index->metas = nullptr;
+    return index;
   }
-  std::free(req);
-  MarkSpawnDone();
-  return nullptr;
-}
+  index->mask = slots - 1;
+  index->meta_capacity = meta_total + 1;
 
-void TaskSpawnCommandEntry(const char* command_data) {
-  char* command = const_cast<char*>(command_data);
-  if (command != nullptr && command[0] != '\0') {
-    const int system_rc = std::system(command);
-    if (system_rc == -1) {
-      std::fprintf(stderr, "warning: Spawn command launch failed: %s\n", command);
+  std::size_t class_count = 0;
+  std::size_t member_count = 0;
+  std::size_t meta_used = 0;
+  CHashClass* head = nullptr;
+  for (std::size_t i = 0; i < field_count; ++i) {
+    const hc_reflection_field& field = fields[i];
+    if (field.aggregate_name == nullptr || field.field_name == nullptr) {
+      continue;
     }
+    const std::size_t before = class_count;
+    CHashClass* klass = InsertClass(index, &class_count, field.aggregate_name);
+    if (class_count != before) {
+      klass->next = head;
+      head = klass;
+    }
+    HcMemberMeta* metas = &index->metas[meta_used];
+    if (field.size > 0 && field.meta != nullptr && field.meta_count > 0) {
+      meta_used += static_cast<std::size_t>(field.meta_count);
+    }
+    AppendMemberField(klass, &index->members[member_count++], field, metas);
   }
-  std::free(command);
+  index->member_count = member_count;
+  for (std::size_t i = 0; i < class_count; ++i) {
+    IndexClassMembers(&index->classes[i]);
+  }
+  return index;
 }
 
-std::size_t NormalizeStackSize(std::int64_t requested_size) {
-  if (requested_size <= 0) {
-    return 0;
+void FreeReflectionIndex(HcReflectionIndex* index) {
+  if (index == nullptr) {
+    return;
   }
-  std::size_t stack_size = static_cast<std::size_t>(requested_size);
-  if (stack_size < static_cast<std::size_t>(PTHREAD_STACK_MIN)) {
-    stack_size = static_cast<std::size_t>(PTHREAD_STACK_MIN);
+  const HcMemberMeta* resolved_begin = index->metas;
+  const HcMemberMeta* resolved_end = index->metas + index->meta_capacity;
+  for (std::size_t i = 0; i < index->member_count; ++i) {
+    HcMemberMeta* meta = index->members[i].meta;
+    if (meta >= resolved_begin && meta < resolved_end) {
+      continue;
+    }
+    while (meta != nullptr) {
+      HcMemberMeta* next = meta->next;
+      std::free(meta->key);
+      std::free(meta);
+      meta = next;
+    }
   }
-#if defined(_SC_PAGESIZE)
-  const long page_size = ::sysconf(_SC_PAGESIZE);
-  if (page_size > 0) {
-    const std::size_t page = static_cast<std::size_t>(page_size);
-    const std::size_t rem = stack_size % page;
-    if (rem != 0) {
-      stack_size += page - rem;
+  if (index->classes != nullptr) {
+    for (std::size_t i = 0; i < index->field_count; ++i) {
+      std::free(index->classes[i].member_slots);
     }
   }
-#endif
-  return stack_size;
+  std::free(index->slots);
+  std::free(index->classes);
+  std::free(index->members);
+  std::free(index->metas);
+  std::free(index);
 }
 
-}  // namespace
+HcReflectionIndex* EnsureReflectionIndex() {
+  HcReflectionIndex* index = g_reflection_index.load(std::memory_order_acquire);
+  if (index != nullptr) {
+    return index;
+  }
+  pthread_mutex_lock(&g_reflection_mutex);
+  index = g_reflection_index.load(std::memory_order_relaxed);
+  if (index == nullptr) {
+    index = BuildReflectionIndex(g_reflection_fields, g_reflection_field_count);
+    g_reflection_index.store(index, std::memory_order_release);
+  }
+  pthread_mutex_unlock(&g_reflection_mutex);
+  return index;
+}
 
-std::int64_t hc_runtime_abi_version() {
-  return (static_cast<std::int64_t>(HC_RUNTIME_ABI_VERSION_MAJOR) << 32) |
-         static_cast<std::int64_t>(HC_RUNTIME_ABI_VERSION_MINOR);
+constexpr std::size_t kJobWorkerMax = 64;
+constexpr std::size_t kJobCacheMax = 64;
+constexpr int kJobFreeOnComplete = 1;
+constexpr int kJobRequeue = 2;
+
+struct HcJobDeque {
+  pthread_mutex_t lock;
+  CJob* top;
+  CJob* bottom;
+  std::atomic<std::int64_t> depth;
+};
+
+struct HcJobWorker {
+  pthread_t thread;
+  std::size_t index;
+  std::int64_t cpu;
+  HcJobDeque deque;
+  HcJobDeque pinned;
+  pthread_cond_t wake;
+  std::atomic<int> sleeping;
+  std::atomic<std::int64_t> executed;
+  std::atomic<std::int64_t> migrations;
+};
+
+HcJobWorker g_job_workers[kJobWorkerMax];
+std::atomic<std::size_t> g_job_worker_count{0};
+pthread_once_t g_job_pool_once = PTHREAD_ONCE_INIT;
+pthread_mutex_t g_job_idle_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t g_job_done_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_job_done_cond = PTHREAD_COND_INITIALIZER;
+std::atomic<std::int64_t> g_job_queued{0};
+std::atomic<std::int64_t> g_job_inflight{0};
+std::atomic<std::int64_t> g_job_idle_workers{0};
+std::atomic<std::int64_t> g_job_done_waiters{0};
+std::atomic<std::size_t> g_job_next_worker{0};
+thread_local HcJobWorker* g_job_worker_self = nullptr;
+thread_local CJob* g_job_cache = nullptr;
+thread_local std::size_t g_job_cache_count = 0;
+thread_local HcArenaScope* g_arena_current = nullptr;
+
+void ArenaRelease(HcArenaScope* scope);
+
+CJob* AllocJob() {
+  CJob* job = g_job_cache;
+  if (job != nullptr) {
+    g_job_cache = job->next;
+    --g_job_cache_count;
+  } else {
+    job = static_cast<CJob*>(std::calloc(1, sizeof(CJob)));
+    if (job == nullptr) {
+      return nullptr;
+    }
+  }
+  job->fn = nullptr;
+  job->arg = 0;
+  job->result = 0;
+  job->flags = 0;
+  job->done.store(0, std::memory_order_relaxed);
+  job->then.store(nullptr, std::memory_order_relaxed);
+  job->prev = nullptr;
+  job->next = nullptr;
+  return job;
 }
 
-void hc_print_str(const char* text) {
-  if (text == nullptr) {
+void ReleaseJob(CJob* job) {
+  ArenaRelease(&job->arena);
+  if (g_job_cache_count >= kJobCacheMax) {
+    std::free(job);
     return;
   }
-  std::fputs(text, stdout);
+  job->next = g_job_cache;
+  g_job_cache = job;
+  ++g_job_cache_count;
 }
 
-void hc_put_char(std::int64_t ch) {
-  const int value = static_cast<int>(ch & 0xff);
-  std::fputc(value, stdout);
+void PushJobBottom(HcJobDeque* deque, CJob* job) {
+  pthread_mutex_lock(&deque->lock);
+  job->next = nullptr;
+  job->prev = deque->bottom;
+  if (deque->bottom != nullptr) {
+    deque->bottom->next = job;
+  } else {
+    deque->top = job;
+  }
+  deque->bottom = job;
+  deque->depth.fetch_add(1, std::memory_order_seq_cst);
+  pthread_mutex_unlock(&deque->lock);
 }
 
-void hc_print_fmt(const char* format, const std::int64_t* args, std::size_t arg_count) {
-  if (format == nullptr) {
-    return;
+void PushJobTop(HcJobDeque* deque, CJob* job) {
+  pthread_mutex_lock(&deque->lock);
+  job->prev = nullptr;
+  job->next = deque->top;
+  if (deque->top != nullptr) {
+    deque->top->prev = job;
+  } else {
+    deque->bottom = job;
   }
+  deque->top = job;
+  deque->depth.fetch_add(1, std::memory_order_seq_cst);
+  pthread_mutex_unlock(&deque->lock);
+}
 
-  std::size_t arg_index = 0;
-  auto next_arg = [&](std::int64_t fallback = 0) -> std::int64_t {
-    if (args == nullptr || arg_index >= arg_count) {
-      return fallback;
-    }
-    return args[arg_index++];
-  };
+void PushJob(HcJobDeque* deque, CJob* job) {
+  if ((job->flags & kJobRequeue) != 0) {
+    PushJobTop(deque, job);
+  } else {
+    PushJobBottom(deque, job);
+  }
+}
 
-  std::size_t i = 0;
-  while (format[i] != '\0') {
-    if (format[i] != '%') {
-      std::fputc(format[i], stdout);
-      ++i;
-      continue;
+CJob* PopJobBottom(HcJobDeque* deque) {
+  if (deque->depth.load(std::memory_order_acquire) <= 0) {
+    return nullptr;
+  }
+  pthread_mutex_lock(&deque->lock);
+  CJob* job = deque->bottom;
+  if (job != nullptr) {
+    deque->bottom = job->prev;
+    if (deque->bottom != nullptr) {
+      deque->bottom->next = nullptr;
+    } else {
+      deque->top = nullptr;
     }
+    deque->depth.fetch_sub(1, std::memory_order_relaxed);
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return job;
+}
 
-    const std::size_t spec_begin = i++;
-    if (format[i] == '%') {
-      std::fputc('%', stdout);
-      ++i;
-      continue;
+CJob* StealJobTop(HcJobDeque* deque) {
+  if (deque->depth.load(std::memory_order_acquire) <= 0 ||
+      pthread_mutex_trylock(&deque->lock) != 0) {
+    return nullptr;
+  }
+  CJob* job = deque->top;
+  if (job != nullptr) {
+    deque->top = job->next;
+    if (deque->top != nullptr) {
+      deque->top->prev = nullptr;
+    } else {
+      deque->bottom = nullptr;
     }
+    deque->depth.fetch_sub(1, std::memory_order_relaxed);
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return job;
+}
 
-    while (format[i] == '-' || format[i] == '+' || format[i] == ' ' || format[i] == '#' ||
-           format[i] == '0' || format[i] == '\'') {
-      ++i;
+CJob* TakeJob(HcJobWorker* self) {
+  std::size_t start = 0;
+  if (self != nullptr) {
+    if (CJob* pinned = PopJobBottom(&self->pinned)) {
+      return pinned;
     }
-    bool width_from_arg = false;
-    bool precision_from_arg = false;
-    if (format[i] == '*') {
-      width_from_arg = true;
-      ++i;
-    } else {
-      while (format[i] >= '0' && format[i] <= '9') {
-        ++i;
+    start = self->index + 1;
+  }
+  if (g_job_queued.load(std::memory_order_acquire) <= 0) {
+    return nullptr;
+  }
+  CJob* job = self != nullptr ? PopJobBottom(&self->deque) : nullptr;
+  const std::size_t worker_count = g_job_worker_count.load(std::memory_order_acquire);
+  for (std::size_t i = 0; job == nullptr && i < worker_count; ++i) {
+    HcJobWorker* victim = &g_job_workers[(start + i) % worker_count];
+    if (victim != self) {
+      job = StealJobTop(&victim->deque);
+      if (job != nullptr) {
+        victim->migrations.fetch_add(1, std::memory_order_relaxed);
       }
     }
-    if (format[i] == '.') {
-      ++i;
-      if (format[i] == '*') {
-        precision_from_arg = true;
-        ++i;
-      } else {
-        while (format[i] >= '0' && format[i] <= '9') {
-          ++i;
-        }
+  }
+  if (job != nullptr) {
+    g_job_queued.fetch_sub(1, std::memory_order_acq_rel);
+  }
+  return job;
+}
+
+void WakeJobWaiters() {
+  if (g_job_done_waiters.load(std::memory_order_seq_cst) > 0) {
+    pthread_mutex_lock(&g_job_done_mutex);
+    pthread_cond_broadcast(&g_job_done_cond);
+    pthread_mutex_unlock(&g_job_done_mutex);
+  }
+}
+
+CJob* const kJobThenSealed = reinterpret_cast<CJob*>(static_cast<std::uintptr_t>(1));
+
+void DispatchJob(CJob* job, std::int64_t cpu);
+
+void RunJob(CJob* job) {
+  std::int64_t result = 0;
+  if (job->fn != nullptr) {
+    using JobFn = std::int64_t (*)(std::int64_t);
+    JobFn fn = reinterpret_cast<JobFn>(reinterpret_cast<std::uintptr_t>(job->fn));
+    HcArenaScope* const outer_arena = g_arena_current;
+    // A SpawnGrp opened by a job and never waited on must not capture the
+    // spawns of whatever runs next on this thread, nor may a job join a
+    // group opened by the thread that helps run it.
+    CSpawnGrp* const outer_scope = g_spawn_scope;
+    g_arena_current = &job->arena;
+    g_spawn_scope = nullptr;
+    result = fn(job->arg);
+    g_spawn_scope = outer_scope;
+    g_arena_current = outer_arena;
+    OutputFlushThread();
+    ArenaRelease(&job->arena);
+  }
+  job->result = result;
+  if ((job->flags & kJobFreeOnComplete) == 0) {
+    StatsCount(kStatJobsRun, 1);
+  }
+  if (g_job_worker_self != nullptr) {
+    g_job_worker_self->executed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  CJob* continuation = job->then.exchange(kJobThenSealed, std::memory_order_acq_rel);
+  if (continuation != nullptr) {
+    continuation->arg = result;
+    DispatchJob(continuation, -1);
+    ReleaseJob(job);
+  } else if ((job->flags & kJobFreeOnComplete) != 0) {
+    ReleaseJob(job);
+  } else {
+    job->done.store(1, std::memory_order_seq_cst);
+  }
+  g_job_inflight.fetch_sub(1, std::memory_order_seq_cst);
+  WakeJobWaiters();
+}
+
+bool WorkerHasWork(const HcJobWorker* self) {
+  return g_job_queued.load(std::memory_order_seq_cst) > 0 ||
+         self->pinned.depth.load(std::memory_order_seq_cst) > 0;
+}
+
+void* JobWorkerMain(void* opaque) {
+  HcJobWorker* self = static_cast<HcJobWorker*>(opaque);
+  g_job_worker_self = self;
+#if defined(__linux__)
+  if (self->cpu >= 0 && self->cpu < CPU_SETSIZE) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<std::size_t>(self->cpu), &set);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+  for (;;) {
+    CJob* job = TakeJob(self);
+    if (job != nullptr) {
+      RunJob(job);
+      continue;
+    }
+    pthread_mutex_lock(&g_job_idle_mutex);
+    g_job_idle_workers.fetch_add(1, std::memory_order_seq_cst);
+    for (;;) {
+      self->sleeping.store(1, std::memory_order_seq_cst);
+      if (WorkerHasWork(self)) {
+        break;
       }
+      pthread_cond_wait(&self->wake, &g_job_idle_mutex);
     }
-    while (format[i] == 'h' || format[i] == 'l' || format[i] == 'j' || format[i] == 't' ||
-           format[i] == 'L' || format[i] == 'q') {
-      const char lm = format[i++];
-      if ((lm == 'h' || lm == 'l') && format[i] == lm) {
-        ++i;
+    g_job_idle_workers.fetch_sub(1, std::memory_order_seq_cst);
+    self->sleeping.store(0, std::memory_order_seq_cst);
+    pthread_mutex_unlock(&g_job_idle_mutex);
+  }
+  return nullptr;
+}
+
+std::size_t CollectJobCpus(std::int64_t* cpus, std::size_t capacity) {
+  std::size_t count = 0;
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < capacity; ++cpu) {
+      if (CPU_ISSET(static_cast<std::size_t>(cpu), &set)) {
+        cpus[count++] = cpu;
       }
     }
+  }
+#endif
+  if (count == 0) {
+    long online = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    online = ::sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    const std::int64_t available = online > 0 ? online : 1;
+    for (std::int64_t cpu = 0; cpu < available && count < capacity; ++cpu) {
+      cpus[count++] = -1;
+    }
+  }
+  return count;
+}
 
-    const char conv = format[i];
-    if (conv == '\0') {
+std::size_t ApplyJobWorkerOverride(std::int64_t* cpus, std::size_t count) {
+  const char* text = std::getenv("HOLYC_JOB_WORKERS");
+  std::int64_t requested = 0;
+  if (text == nullptr || !ParseIntLiteral(text, &requested) || requested <= 0 || count == 0) {
+    return count;
+  }
+  std::size_t limit = static_cast<std::size_t>(requested);
+  if (limit > kJobWorkerMax) {
+    limit = kJobWorkerMax;
+  }
+  for (std::size_t i = count; i < limit; ++i) {
+    cpus[i] = cpus[i % count];
+  }
+  return limit;
+}
+
+void StartJobPool() {
+  std::int64_t cpus[kJobWorkerMax];
+  const std::size_t count = ApplyJobWorkerOverride(cpus, CollectJobCpus(cpus, kJobWorkerMax));
+
+  for (std::size_t i = 0; i < count; ++i) {
+    HcJobWorker* worker = &g_job_workers[i];
+    worker->index = i;
+    worker->cpu = cpus[i];
+    pthread_mutex_init(&worker->deque.lock, nullptr);
+    pthread_mutex_init(&worker->pinned.lock, nullptr);
+    pthread_cond_init(&worker->wake, nullptr);
+  }
+
+  g_job_worker_count.store(count, std::memory_order_release);
+  std::size_t started = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    HcJobWorker* worker = &g_job_workers[i];
+    if (pthread_create(&worker->thread, nullptr, JobWorkerMain, worker) != 0) {
       break;
     }
-    ++i;
-    const int width_arg = width_from_arg ? static_cast<int>(next_arg()) : 0;
-    const int precision_arg = precision_from_arg ? static_cast<int>(next_arg()) : 0;
-
-    auto print_signed = [&](const char* spec, long long value) {
-      if (width_from_arg && precision_from_arg) {
-        std::fprintf(stdout, spec, width_arg, precision_arg, value);
-      } else if (width_from_arg) {
-        std::fprintf(stdout, spec, width_arg, value);
-      } else if (precision_from_arg) {
-        std::fprintf(stdout, spec, precision_arg, value);
-      } else {
-        std::fprintf(stdout, spec, value);
-      }
-    };
-    auto print_unsigned = [&](const char* spec, unsigned long long value) {
-      if (width_from_arg && precision_from_arg) {
-        std::fprintf(stdout, spec, width_arg, precision_arg, value);
-      } else if (width_from_arg) {
-        std::fprintf(stdout, spec, width_arg, value);
-      } else if (precision_from_arg) {
-        std::fprintf(stdout, spec, precision_arg, value);
-      } else {
-        std::fprintf(stdout, spec, value);
-      }
-    };
-    auto print_int = [&](const char* spec, int value) {
-      if (width_from_arg && precision_from_arg) {
-        std::fprintf(stdout, spec, width_arg, precision_arg, value);
-      } else if (width_from_arg) {
-        std::fprintf(stdout, spec, width_arg, value);
-      } else if (precision_from_arg) {
-        std::fprintf(stdout, spec, precision_arg, value);
-      } else {
-        std::fprintf(stdout, spec, value);
-      }
-    };
-    auto print_pointer = [&](const char* spec, const void* ptr) {
-      if (width_from_arg && precision_from_arg) {
-        std::fprintf(stdout, spec, width_arg, precision_arg, ptr);
-      } else if (width_from_arg) {
-        std::fprintf(stdout, spec, width_arg, ptr);
-      } else if (precision_from_arg) {
-        std::fprintf(stdout, spec, precision_arg, ptr);
-      } else {
-        std::fprintf(stdout, spec, ptr);
-      }
-    };
-    auto print_cstr = [&](const char* spec, const char* text) {
-      if (width_from_arg && precision_from_arg) {
-        std::fprintf(stdout, spec, width_arg, precision_arg, text);
-      } else if (width_from_arg) {
-        std::fprintf(stdout, spec, width_arg, text);
-      } else if (precision_from_arg) {
-        std::fprintf(stdout, spec, precision_arg, text);
-      } else {
-        std::fprintf(stdout, spec, text);
-      }
-    };
-    auto print_double = [&](const char* spec, double value) {
-      if (width_from_arg && precision_from_arg) {
-        std::fprintf(stdout, spec, width_arg, precision_arg, value);
-      } else if (width_from_arg) {
-        std::fprintf(stdout, spec, width_arg, value);
-      } else if (precision_from_arg) {
-        std::fprintf(stdout, spec, precision_arg, value);
-      } else {
-        std::fprintf(stdout, spec, value);
-      }
-    };
-    auto unpack_double = [](std::int64_t raw) {
-      const std::uint64_t bits = static_cast<std::uint64_t>(raw);
-      double value = 0.0;
-      static_assert(sizeof(value) == sizeof(bits), "double payload size mismatch");
-      std::memcpy(&value, &bits, sizeof(value));
-      return value;
-    };
-
-    if (conv == 'z') {
-      const std::int64_t idx = next_arg();
-      const char* table =
-          reinterpret_cast<const char*>(static_cast<std::uintptr_t>(next_arg()));
-      std::fputs(LookupZString(table, idx), stdout);
-      continue;
+    pthread_detach(worker->thread);
+    ++started;
+  }
+  if (started == 0) {
+    std::fprintf(stderr, "warning: JobQue worker pool failed to start; running jobs inline\n");
+  }
+  g_job_worker_count.store(started, std::memory_order_release);
+}
+
+HcJobWorker* FindJobWorkerForCpu(std::int64_t cpu) {
+  const std::size_t worker_count = g_job_worker_count.load(std::memory_order_acquire);
+  for (std::size_t i = 0; i < worker_count; ++i) {
+    if (g_job_workers[i].cpu == cpu) {
+      return &g_job_workers[i];
+    }
+  }
+  return &g_job_workers[static_cast<std::size_t>(cpu) % worker_count];
+}
+
+HcJobWorker* PickLeastLoadedJobWorker() {
+  const std::size_t slot = g_job_next_worker.fetch_add(1, std::memory_order_relaxed);
+  const std::size_t worker_count = g_job_worker_count.load(std::memory_order_acquire);
+  HcJobWorker* first = &g_job_workers[slot % worker_count];
+  HcJobWorker* second = &g_job_workers[(slot * 7 + 3) % worker_count];
+  const std::int64_t first_depth = first->deque.depth.load(std::memory_order_relaxed) +
+                                   first->pinned.depth.load(std::memory_order_relaxed);
+  const std::int64_t second_depth = second->deque.depth.load(std::memory_order_relaxed) +
+                                    second->pinned.depth.load(std::memory_order_relaxed);
+  return second_depth < first_depth ? second : first;
+}
+
+void WakeJobWorker(HcJobWorker* worker) {
+  pthread_mutex_lock(&g_job_idle_mutex);
+  worker->sleeping.store(0, std::memory_order_relaxed);
+  pthread_cond_signal(&worker->wake);
+  pthread_mutex_unlock(&g_job_idle_mutex);
+}
+
+void WakeAnyJobWorker(HcJobWorker* preferred) {
+  if (g_job_idle_workers.load(std::memory_order_seq_cst) <= 0) {
+    return;
+  }
+  pthread_mutex_lock(&g_job_idle_mutex);
+  HcJobWorker* target = nullptr;
+  if (preferred != nullptr && preferred->sleeping.load(std::memory_order_relaxed) != 0) {
+    target = preferred;
+  }
+  const std::size_t worker_count = g_job_worker_count.load(std::memory_order_acquire);
+  for (std::size_t i = 0; target == nullptr && i < worker_count; ++i) {
+    if (g_job_workers[i].sleeping.load(std::memory_order_relaxed) != 0) {
+      target = &g_job_workers[i];
+    }
+  }
+  if (target != nullptr) {
+    target->sleeping.store(0, std::memory_order_relaxed);
+    pthread_cond_signal(&target->wake);
+  }
+  pthread_mutex_unlock(&g_job_idle_mutex);
+}
+
+void SubmitJob(CJob* job, std::int64_t cpu) {
+  g_job_inflight.fetch_add(1, std::memory_order_seq_cst);
+  if (cpu >= 0) {
+    HcJobWorker* target = FindJobWorkerForCpu(cpu);
+    PushJob(&target->pinned, job);
+    if (target->sleeping.load(std::memory_order_seq_cst) != 0) {
+      WakeJobWorker(target);
+    }
+    WakeJobWaiters();
+    return;
+  }
+
+  HcJobWorker* target = g_job_worker_self;
+  if (target == nullptr) {
+    target = PickLeastLoadedJobWorker();
+  }
+  PushJob(&target->deque, job);
+  g_job_queued.fetch_add(1, std::memory_order_seq_cst);
+  WakeAnyJobWorker(target);
+  WakeJobWaiters();
+}
+
+void DispatchJob(CJob* job, std::int64_t cpu) {
+  OutputFlushThread();
+  if (g_job_worker_count.load(std::memory_order_acquire) == 0) {
+    g_job_inflight.fetch_add(1, std::memory_order_seq_cst);
+    RunJob(job);
+    return;
+  }
+  SubmitJob(job, cpu);
+}
+
+bool JobIsDone(const void* opaque) {
+  const CJob* job = static_cast<const CJob*>(opaque);
+  return job->done.load(std::memory_order_seq_cst) != 0;
+}
+
+struct HcJobAnyWait {
+  CJob** jobs;
+  std::size_t count;
+};
+
+bool AnyJobDone(const void* opaque) {
+  const HcJobAnyWait* wait = static_cast<const HcJobAnyWait*>(opaque);
+  for (std::size_t i = 0; i < wait->count; ++i) {
+    if (wait->jobs[i] != nullptr && JobIsDone(wait->jobs[i])) {
+      return true;
     }
-    if (conv == 'b') {
-      PrintBinary(static_cast<std::uint64_t>(next_arg()));
+  }
+  return false;
+}
+
+bool JobsDrained(const void*) {
+  return g_job_inflight.load(std::memory_order_seq_cst) <= 0;
+}
+
+__attribute__((noinline)) CSpawnGrp* SwapSpawnScope(CSpawnGrp* scope) {
+  CSpawnGrp* const previous = g_spawn_scope;
+  g_spawn_scope = scope;
+  return previous;
+}
+
+__attribute__((noinline)) void EndSpawnScope(CSpawnGrp* group) {
+  CSpawnGrp** link = &g_spawn_scope;
+  while (*link != nullptr && *link != group) {
+    link = &(*link)->outer;
+  }
+  if (*link == group) {
+    *link = group->outer;
+  }
+}
+
+void HelpJobsUntil(bool (*done)(const void*), const void* ctx) {
+  OutputFlushThread();
+  HcJobWorker* self = g_job_worker_self;
+  while (!done(ctx)) {
+    CJob* other = TakeJob(self);
+    if (other != nullptr) {
+      RunJob(other);
       continue;
     }
+    pthread_mutex_lock(&g_job_done_mutex);
+    g_job_done_waiters.fetch_add(1, std::memory_order_seq_cst);
+    while (!done(ctx) && g_job_queued.load(std::memory_order_seq_cst) <= 0 &&
+           (self == nullptr || self->pinned.depth.load(std::memory_order_seq_cst) <= 0)) {
+      pthread_cond_wait(&g_job_done_cond, &g_job_done_mutex);
+    }
+    g_job_done_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    pthread_mutex_unlock(&g_job_done_mutex);
+  }
+}
+
+constexpr std::size_t kParSlotCount = kJobWorkerMax + 1;
+
+struct alignas(64) HcParSlot {
+  std::int64_t value;
+  int used;
+};
+
+struct HcParState {
+  const char* body;
+  const char* ctx;
+  const char* combine;
+  std::int64_t grain;
+  std::int64_t split_limit;
+  bool reduce;
+  std::atomic<std::int64_t> pending;
+  pthread_mutex_t external_lock;
+  HcParSlot slots[kParSlotCount];
+};
+
+struct HcParChunk {
+  HcParState* state;
+  std::int64_t lo;
+  std::int64_t hi;
+};
+
+std::int64_t CombinePartial(const HcParState* state, std::int64_t lhs, std::int64_t rhs) {
+  if (state->combine == nullptr) {
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(lhs) +
+                                     static_cast<std::uint64_t>(rhs));
+  }
+  using CombineFn = std::int64_t (*)(std::int64_t, std::int64_t);
+  CombineFn fn = reinterpret_cast<CombineFn>(reinterpret_cast<std::uintptr_t>(state->combine));
+  return fn(lhs, rhs);
+}
+
+void MergePartial(HcParState* state, HcParSlot* slot, std::int64_t partial) {
+  if (slot->used != 0) {
+    slot->value = CombinePartial(state, slot->value, partial);
+  } else {
+    slot->value = partial;
+    slot->used = 1;
+  }
+}
+
+void RunParRange(HcParState* state, std::int64_t lo, std::int64_t hi) {
+  if (!state->reduce) {
+    using BodyFn = void (*)(std::int64_t, std::int64_t, const char*);
+    BodyFn fn = reinterpret_cast<BodyFn>(reinterpret_cast<std::uintptr_t>(state->body));
+    fn(lo, hi, state->ctx);
+    return;
+  }
 
-    char spec[64];
-    std::size_t spec_len = i - spec_begin;
-    if (spec_len >= sizeof(spec)) {
-      spec_len = sizeof(spec) - 1;
+  using ReduceFn = std::int64_t (*)(std::int64_t, std::int64_t, const char*);
+  ReduceFn fn = reinterpret_cast<ReduceFn>(reinterpret_cast<std::uintptr_t>(state->body));
+  const std::int64_t partial = fn(lo, hi, state->ctx);
+  HcJobWorker* self = g_job_worker_self;
+  if (self != nullptr) {
+    MergePartial(state, &state->slots[self->index], partial);
+    return;
+  }
+  pthread_mutex_lock(&state->external_lock);
+  MergePartial(state, &state->slots[kJobWorkerMax], partial);
+  pthread_mutex_unlock(&state->external_lock);
+}
+
+std::int64_t ParChunkMain(std::int64_t arg);
+
+void SplitAndRunPar(HcParState* state, std::int64_t lo, std::int64_t hi) {
+  while (hi - lo > state->grain &&
+         g_job_queued.load(std::memory_order_relaxed) < state->split_limit) {
+    const std::int64_t mid = lo + (hi - lo) / 2;
+    HcParChunk* chunk = static_cast<HcParChunk*>(std::malloc(sizeof(HcParChunk)));
+    if (chunk == nullptr) {
+      break;
     }
-    std::memcpy(spec, format + spec_begin, spec_len);
-    spec[spec_len] = '\0';
-    switch (conv) {
-      case 'd':
-      case 'i':
-        print_signed(spec, static_cast<long long>(next_arg()));
-        break;
-      case 'u':
-      case 'x':
-      case 'X':
-      case 'o':
-        print_unsigned(spec, static_cast<unsigned long long>(next_arg()));
-        break;
-      case 'p': {
-        char pointer_spec[64];
-        std::memcpy(pointer_spec, spec, spec_len + 1);
-        pointer_spec[spec_len - 1] = 'p';
-        void* ptr = reinterpret_cast<void*>(static_cast<std::uintptr_t>(next_arg()));
-        print_pointer(pointer_spec, ptr);
-        break;
-      }
-      case 'P': {
-        const std::uintptr_t raw = static_cast<std::uintptr_t>(next_arg());
-        if (raw == 0) {
-          std::fputs("0x0", stdout);
-          break;
-        }
-        char pointer_spec[64];
-        std::memcpy(pointer_spec, spec, spec_len + 1);
-        pointer_spec[spec_len - 1] = 'p';
-        void* ptr = reinterpret_cast<void*>(raw);
-        print_pointer(pointer_spec, ptr);
-        break;
-      }
-      case 'c':
-        print_int(spec, static_cast<int>(next_arg() & 0xff));
-        break;
-      case 's': {
-        const char* text =
+    CJob* job = AllocJob();
+    if (job == nullptr) {
+      std::free(chunk);
+      break;
+    }
+    chunk->state = state;
+    chunk->lo = mid;
+    chunk->hi = hi;
+    job->fn = reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&ParChunkMain));
+    job->arg = static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(chunk));
+    job->flags = kJobFreeOnComplete;
+    state->pending.fetch_add(1, std::memory_order_relaxed);
+    SubmitJob(job, -1);
+    hi = mid;
+  }
+  RunParRange(state, lo, hi);
+}
+
+std::int64_t ParChunkMain(std::int64_t arg) {
+  HcParChunk* chunk = reinterpret_cast<HcParChunk*>(static_cast<std::uintptr_t>(arg));
+  HcParState* state = chunk->state;
+  const std::int64_t lo = chunk->lo;
+  const std::int64_t hi = chunk->hi;
+  std::free(chunk);
+  SplitAndRunPar(state, lo, hi);
+  state->pending.fetch_sub(1, std::memory_order_seq_cst);
+  return 0;
+}
+
+bool ParDone(const void* opaque) {
+  const HcParState* state = static_cast<const HcParState*>(opaque);
+  return state->pending.load(std::memory_order_seq_cst) == 0;
+}
+
+void RunParallel(HcParState* state, std::int64_t lo, std::int64_t hi, std::int64_t grain) {
+  pthread_once(&g_job_pool_once, StartJobPool);
+  const std::int64_t workers =
+      static_cast<std::int64_t>(g_job_worker_count.load(std::memory_order_acquire));
+  state->grain = grain;
+  if (state->grain <= 0) {
+    const std::int64_t target_chunks = (workers > 0 ? workers : 1) * 8;
+    state->grain = (hi - lo) / target_chunks;
+  }
+  if (state->grain < 1) {
+    state->grain = 1;
+  }
+  state->split_limit = workers * 2;
+  state->pending.store(0, std::memory_order_relaxed);
+  pthread_mutex_init(&state->external_lock, nullptr);
+  for (HcParSlot& slot : state->slots) {
+    slot.value = 0;
+    slot.used = 0;
+  }
+
+  if (workers == 0 || hi - lo <= state->grain) {
+    RunParRange(state, lo, hi);
+  } else {
+    SplitAndRunPar(state, lo, hi);
+    HelpJobsUntil(ParDone, state);
+  }
+  pthread_mutex_destroy(&state->external_lock);
+}
+
+#if HC_RUNTIME_FIBERS
+
+struct HcStackCall;
+
+thread_local HcStackCall* g_stack_call = nullptr;
+
+constexpr std::size_t kFiberDefaultStackSize = 64 * 1024;
+constexpr std::size_t kFiberSlabStacks = 64;
+constexpr std::size_t kFiberStackPoolRetain = 256;
+constexpr std::size_t kFiberTaskPoolMax = 1024;
+constexpr std::uint64_t kFiberStackCanary = 0x484354534B535443ULL;
+constexpr std::size_t kFiberStackLimitPad = 256;
+constexpr std::size_t kStackSegmentMin = 64 * 1024;
+constexpr std::size_t kStackSegmentReserve = 4 * 1024;
+constexpr std::size_t kStackSegmentCacheMax = 8;
+constexpr std::size_t kStackSegmentCacheBytes = 64 * 1024 * 1024;
+
+enum HcTaskState : int {
+  kTaskRunnable = 0,
+  kTaskYielded = 1,
+  kTaskSleeping = 2,
+  kTaskDone = 3,
+};
+
+struct HcFreeStack {
+  HcFreeStack* next;
+};
+
+pthread_mutex_t g_fiber_stack_mutex = PTHREAD_MUTEX_INITIALIZER;
+HcFreeStack* g_fiber_free_stacks = nullptr;
+std::size_t g_fiber_free_stack_count = 0;
+char* g_fiber_slab_cursor = nullptr;
+std::size_t g_fiber_slab_remaining = 0;
+pthread_mutex_t g_fiber_task_mutex = PTHREAD_MUTEX_INITIALIZER;
+CTask* g_fiber_free_tasks = nullptr;
+std::size_t g_fiber_free_task_count = 0;
+thread_local CTask* g_fiber_current = nullptr;
+
+pthread_once_t g_sleep_once = PTHREAD_ONCE_INIT;
+pthread_mutex_t g_sleep_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_sleep_cond = PTHREAD_COND_INITIALIZER;
+std::vector<CTask*> g_sleep_heap;
+
+std::size_t PageSize() {
+  static const std::size_t page = [] {
+    const long value = ::sysconf(_SC_PAGESIZE);
+    return value > 0 ? static_cast<std::size_t>(value) : static_cast<std::size_t>(4096);
+  }();
+  return page;
+}
+
+std::size_t RoundUpToPage(std::size_t size) {
+  const std::size_t page = PageSize();
+  return (size + page - 1) / page * page;
+}
+
+void* MapAnonymous(std::size_t size) {
+  int map_flags = MAP_PRIVATE | MAP_ANON;
+#if defined(MAP_NORESERVE)
+  map_flags |= MAP_NORESERVE;
+#endif
+  void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+  return base == MAP_FAILED ? nullptr : base;
+}
+
+bool AllocFiberStack(CTask* task, std::size_t size) {
+  if (size == kFiberDefaultStackSize) {
+    pthread_mutex_lock(&g_fiber_stack_mutex);
+    char* stack = nullptr;
+    if (g_fiber_free_stacks != nullptr) {
+      stack = reinterpret_cast<char*>(g_fiber_free_stacks);
+      g_fiber_free_stacks = g_fiber_free_stacks->next;
+      --g_fiber_free_stack_count;
+    } else {
+      // A guard page per stack would split the slab into one mapping per
+      // slot and run into vm.max_map_count long before memory runs out. The
+      // slab gets a single PROT_NONE page below its lowest stack; overflow
+      // between neighbours is caught by the canary CheckFiberStack reads at
+      // each switch.
+      if (g_fiber_slab_remaining == 0) {
+        const std::size_t guard = PageSize();
+        char* slab =
+            static_cast<char*>(MapAnonymous(guard + kFiberDefaultStackSize * kFiberSlabStacks));
+        if (slab != nullptr) {
+          (void)::mprotect(slab, guard, PROT_NONE);
+          g_fiber_slab_cursor = slab + guard;
+          g_fiber_slab_remaining = kFiberSlabStacks;
+        }
+      }
+      if (g_fiber_slab_remaining > 0) {
+        stack = g_fiber_slab_cursor;
+        g_fiber_slab_cursor += kFiberDefaultStackSize;
+        --g_fiber_slab_remaining;
+      }
+    }
+    pthread_mutex_unlock(&g_fiber_stack_mutex);
+    if (stack == nullptr) {
+      return false;
+    }
+    task->stack_lo = stack;
+    task->stack_size = kFiberDefaultStackSize;
+    task->stack_pooled = true;
+    return true;
+  }
+
+  const std::size_t guard = PageSize();
+  char* base = static_cast<char*>(MapAnonymous(size + guard));
+  if (base == nullptr) {
+    return false;
+  }
+  (void)::mprotect(base, guard, PROT_NONE);
+  task->stack_lo = base + guard;
+  task->stack_size = size;
+  task->stack_pooled = false;
+  return true;
+}
+
+void ReleaseFiberStack(CTask* task) {
+  if (!task->stack_pooled) {
+    const std::size_t guard = PageSize();
+    ::munmap(task->stack_lo - guard, task->stack_size + guard);
+    return;
+  }
+  pthread_mutex_lock(&g_fiber_stack_mutex);
+  if (g_fiber_free_stack_count >= kFiberStackPoolRetain) {
+#if defined(MADV_DONTNEED)
+    (void)::madvise(task->stack_lo, task->stack_size, MADV_DONTNEED);
+#endif
+  }
+  HcFreeStack* node = reinterpret_cast<HcFreeStack*>(task->stack_lo);
+  node->next = g_fiber_free_stacks;
+  g_fiber_free_stacks = node;
+  ++g_fiber_free_stack_count;
+  pthread_mutex_unlock(&g_fiber_stack_mutex);
+}
+
+CTask* AllocTask() {
+  pthread_mutex_lock(&g_fiber_task_mutex);
+  CTask* task = g_fiber_free_tasks;
+  if (task != nullptr) {
+    g_fiber_free_tasks = task->next;
+    --g_fiber_free_task_count;
+  }
+  pthread_mutex_unlock(&g_fiber_task_mutex);
+  if (task == nullptr) {
+    task = static_cast<CTask*>(std::malloc(sizeof(CTask)));
+  }
+  if (task != nullptr) {
+    std::memset(static_cast<void*>(task), 0, sizeof(CTask));
+  }
+  return task;
+}
+
+void ReleaseTask(CTask* task) {
+  SpawnArenaUnregister(task->id);
+  ArenaRelease(&task->arena);
+  ReleaseFiberStack(task);
+  pthread_mutex_lock(&g_fiber_task_mutex);
+  if (g_fiber_free_task_count < kFiberTaskPoolMax) {
+    task->next = g_fiber_free_tasks;
+    g_fiber_free_tasks = task;
+    ++g_fiber_free_task_count;
+    task = nullptr;
+  }
+  pthread_mutex_unlock(&g_fiber_task_mutex);
+  std::free(task);
+}
+
+void AsanStartSwitch(void** fake_stack_save, const void* bottom, std::size_t size) {
+#if defined(HC_RUNTIME_ASAN)
+  __sanitizer_start_switch_fiber(fake_stack_save, bottom, size);
+#else
+  (void)fake_stack_save;
+  (void)bottom;
+  (void)size;
+#endif
+}
+
+void AsanFinishSwitch(void* fake_stack_save, const void** bottom_old, std::size_t* size_old) {
+#if defined(HC_RUNTIME_ASAN)
+  __sanitizer_finish_switch_fiber(fake_stack_save, bottom_old, size_old);
+#else
+  (void)fake_stack_save;
+  (void)bottom_old;
+  (void)size_old;
+#endif
+}
+
+void CheckFiberStack(const CTask* task) {
+  std::uint64_t canary = 0;
+  std::memcpy(&canary, task->stack_lo, sizeof(canary));
+  if (canary != kFiberStackCanary) {
+    std::fprintf(stderr, "fatal runtime error: stack overflow in spawned task '%s'\n", task->name);
+    std::abort();
+  }
+}
+
+void SwitchToScheduler(CTask* self) {
+  AsanStartSwitch(self->state == kTaskDone ? nullptr : &self->asan_fake_stack,
+                  self->asan_return_bottom, self->asan_return_size);
+  hc_fiber_switch_context(&self->sp, self->return_sp);
+  AsanFinishSwitch(self->asan_fake_stack, &self->asan_return_bottom, &self->asan_return_size);
+}
+
+void FiberEntry() {
+  CTask* self = g_fiber_current;
+  AsanFinishSwitch(nullptr, &self->asan_return_bottom, &self->asan_return_size);
+  using SpawnFn = void (*)(const char*);
+  SpawnFn fn = reinterpret_cast<SpawnFn>(reinterpret_cast<std::uintptr_t>(self->fn));
+  fn(self->data);
+  self->state = kTaskDone;
+  SwitchToScheduler(self);
+  std::abort();
+}
+
+void PrepareFiberContext(CTask* task) {
+  std::memcpy(task->stack_lo, &kFiberStackCanary, sizeof(kFiberStackCanary));
+  task->stack_limit = task->stack_lo + kFiberStackLimitPad;
+  task->asan_stack_bottom = task->stack_lo;
+  task->asan_stack_size = task->stack_size;
+  std::uintptr_t top = reinterpret_cast<std::uintptr_t>(task->stack_lo + task->stack_size);
+  top &= ~static_cast<std::uintptr_t>(15);
+  const std::uintptr_t entry = reinterpret_cast<std::uintptr_t>(&FiberEntry);
+#if defined(__x86_64__)
+  std::uint64_t* frame = reinterpret_cast<std::uint64_t*>(top) - 9;
+  frame[0] = 0x0000037F00001F80ULL;
+  frame[1] = 0;
+  frame[2] = 0;
+  frame[3] = 0;
+  frame[4] = 0;
+  frame[5] = 0;
+  frame[6] = 0;
+  frame[7] = entry;
+  frame[8] = 0;
+#else
+  std::uint64_t* frame = reinterpret_cast<std::uint64_t*>(top) - 20;
+  for (std::size_t i = 0; i < 20; ++i) {
+    frame[i] = 0;
+  }
+  frame[11] = entry;
+#endif
+  task->sp = frame;
+}
+
+std::int64_t MonotonicNowNs() {
+  timespec now{};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<std::int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+bool SleepHeapLater(const CTask* lhs, const CTask* rhs) {
+  return lhs->wake_ns > rhs->wake_ns;
+}
+
+bool DispatchTask(CTask* task, int flags);
+void RequeueTask(CTask* task, int flags);
+
+void* SleepTimerMain(void*) {
+  pthread_mutex_lock(&g_sleep_mutex);
+  for (;;) {
+    if (g_sleep_heap.empty()) {
+      pthread_cond_wait(&g_sleep_cond, &g_sleep_mutex);
+      continue;
+    }
+    const std::int64_t now = MonotonicNowNs();
+    CTask* earliest = g_sleep_heap.front();
+    if (earliest->wake_ns <= now) {
+      std::pop_heap(g_sleep_heap.begin(), g_sleep_heap.end(), SleepHeapLater);
+      g_sleep_heap.pop_back();
+      pthread_mutex_unlock(&g_sleep_mutex);
+      earliest->state = kTaskRunnable;
+      RequeueTask(earliest, 0);
+      pthread_mutex_lock(&g_sleep_mutex);
+      continue;
+    }
+    const std::int64_t delta = earliest->wake_ns - now;
+    timespec deadline{};
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    const std::int64_t deadline_ns =
+        static_cast<std::int64_t>(deadline.tv_sec) * 1000000000LL + deadline.tv_nsec + delta;
+    deadline.tv_sec = static_cast<time_t>(deadline_ns / 1000000000LL);
+    deadline.tv_nsec = static_cast<long>(deadline_ns % 1000000000LL);
+    pthread_cond_timedwait(&g_sleep_cond, &g_sleep_mutex, &deadline);
+  }
+  return nullptr;
+}
+
+void StartSleepTimer() {
+  pthread_t thread{};
+  if (pthread_create(&thread, nullptr, SleepTimerMain, nullptr) != 0) {
+    std::fprintf(stderr, "fatal runtime error: Sleep timer thread failed to start\n");
+    std::abort();
+  }
+  pthread_detach(thread);
+}
+
+void ScheduleSleepingTask(CTask* task) {
+  pthread_once(&g_sleep_once, StartSleepTimer);
+  pthread_mutex_lock(&g_sleep_mutex);
+  g_sleep_heap.push_back(task);
+  std::push_heap(g_sleep_heap.begin(), g_sleep_heap.end(), SleepHeapLater);
+  if (g_sleep_heap.front() == task) {
+    pthread_cond_signal(&g_sleep_cond);
+  }
+  pthread_mutex_unlock(&g_sleep_mutex);
+}
+
+std::int64_t FiberResumeMain(std::int64_t arg) {
+  CTask* task = reinterpret_cast<CTask*>(static_cast<std::uintptr_t>(arg));
+  CTask* const prev = g_fiber_current;
+  hc_try_frame* const thread_try_stack = g_try_stack;
+  const std::int64_t thread_payload = g_exception_payload;
+  char* const thread_stack_limit = g_stack_limit;
+  HcStackCall* const thread_stack_call = g_stack_call;
+  CSpawnGrp* const thread_spawn_scope = g_spawn_scope;
+  HcArenaScope* const thread_arena = g_arena_current;
+  g_try_stack = task->try_stack;
+  g_exception_payload = task->exception_payload;
+  g_stack_limit = task->stack_limit;
+  g_stack_call = static_cast<HcStackCall*>(task->stack_call);
+  g_spawn_scope = task->spawn_scope;
+  g_arena_current = &task->arena;
+  g_fiber_current = task;
+
+  void* thread_fake_stack = nullptr;
+  AsanStartSwitch(&thread_fake_stack, task->asan_stack_bottom, task->asan_stack_size);
+  hc_fiber_switch_context(&task->return_sp, task->sp);
+  AsanFinishSwitch(thread_fake_stack, nullptr, nullptr);
+  OutputFlushThread();
+
+  g_fiber_current = prev;
+  task->try_stack = g_try_stack;
+  task->exception_payload = g_exception_payload;
+  task->stack_limit = g_stack_limit;
+  task->stack_call = g_stack_call;
+  task->spawn_scope = g_spawn_scope;
+  g_try_stack = thread_try_stack;
+  g_exception_payload = thread_payload;
+  g_stack_limit = thread_stack_limit;
+  g_stack_call = thread_stack_call;
+  g_spawn_scope = thread_spawn_scope;
+  g_arena_current = thread_arena;
+  CheckFiberStack(task);
+
+  switch (task->state) {
+    case kTaskDone: {
+      CSpawnGrp* const group = task->spawn_group;
+      ReleaseTask(task);
+      MarkSpawnDone(group);
+      break;
+    }
+    case kTaskSleeping:
+      ScheduleSleepingTask(task);
+      break;
+    default:
+      task->state = kTaskRunnable;
+      RequeueTask(task, kJobRequeue);
+      break;
+  }
+  return 0;
+}
+
+bool DispatchTask(CTask* task, int flags) {
+  pthread_once(&g_job_pool_once, StartJobPool);
+  CJob* job = AllocJob();
+  if (job == nullptr) {
+    return false;
+  }
+  job->fn = reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&FiberResumeMain));
+  job->arg = static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(task));
+  job->flags = kJobFreeOnComplete | flags;
+  DispatchJob(job, task->target_cpu);
+  return true;
+}
+
+// A task that has started can neither be dropped nor finished early, so
+// running out of memory while putting it back on a queue is fatal.
+void RequeueTask(CTask* task, int flags) {
+  if (!DispatchTask(task, flags)) {
+    std::fprintf(stderr, "fatal runtime error: out of memory resuming task '%s'\n", task->name);
+    std::abort();
+  }
+}
+
+std::int64_t SpawnFiber(const char* fn, const char* data, const char* task_name,
+                        std::int64_t target_cpu, std::int64_t stk_size) {
+  CTask* task = AllocTask();
+  if (task == nullptr) {
+    return 0;
+  }
+  std::size_t stack_size = kFiberDefaultStackSize;
+  if (stk_size > 0) {
+    stack_size = RoundUpToPage(static_cast<std::size_t>(stk_size));
+  }
+  if (!AllocFiberStack(task, stack_size)) {
+    std::free(task);
+    return 0;
+  }
+  task->fn = fn;
+  task->data = data;
+  task->target_cpu = target_cpu < 0 ? -1 : target_cpu;
+  task->id = g_next_task_id.fetch_add(1, std::memory_order_relaxed);
+  task->state = kTaskRunnable;
+  if (task_name != nullptr) {
+    std::strncpy(task->name, task_name, sizeof(task->name) - 1);
+  }
+  PrepareFiberContext(task);
+  task->spawn_group = g_spawn_scope;
+  task->spawn_scope = g_spawn_scope;
+  const std::int64_t id = task->id;
+  SpawnArenaRegister(id, &task->arena);
+
+  MarkSpawnStart(task->spawn_group);
+  if (!DispatchTask(task, 0)) {
+    CSpawnGrp* const group = task->spawn_group;
+    ReleaseTask(task);
+    MarkSpawnDone(group);
+    return 0;
+  }
+  StatsCount(kStatTasksSpawned, 1);
+  return id;
+}
+
+struct HcStackSegment {
+  char* base;
+  std::size_t map_size;
+  char* lo;
+  HcStackSegment* next;
+};
+
+struct HcStackCall {
+  const char* fn;
+  std::int64_t a0;
+  std::int64_t a1;
+  std::int64_t a2;
+  std::int64_t result;
+  std::int64_t payload;
+  bool thrown;
+  const void* asan_bottom;
+  std::size_t asan_size;
+  const char* stack_lo;
+  const char* stack_hi;
+  HcStackCall* outer;
+  jmp_buf unwind_env;
+};
+
+thread_local HcStackSegment* g_stack_segment_cache = nullptr;
+thread_local std::size_t g_stack_segment_cache_count = 0;
+thread_local std::size_t g_stack_segment_cache_bytes = 0;
+
+char* ThreadStackLimit() {
+#if defined(__APPLE__)
+  pthread_t self = pthread_self();
+  char* hi = static_cast<char*>(pthread_get_stackaddr_np(self));
+  return hi - pthread_get_stacksize_np(self);
+#elif defined(__linux__)
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+    return nullptr;
+  }
+  void* lo = nullptr;
+  std::size_t size = 0;
+  const int rc = pthread_attr_getstack(&attr, &lo, &size);
+  pthread_attr_destroy(&attr);
+  return rc == 0 ? static_cast<char*>(lo) : nullptr;
+#else
+  return nullptr;
+#endif
+}
+
+std::size_t StackSegmentSize(const HcStackSegment* segment) {
+  return static_cast<std::size_t>(reinterpret_cast<const char*>(segment) - segment->lo);
+}
+
+void* StackSegmentTop(HcStackSegment* segment) {
+  std::uintptr_t top = reinterpret_cast<std::uintptr_t>(segment);
+  top &= ~static_cast<std::uintptr_t>(15);
+  return reinterpret_cast<void*>(top);
+}
+
+HcStackSegment* AcquireStackSegment(std::size_t size) {
+  HcStackSegment** link = &g_stack_segment_cache;
+  while (*link != nullptr) {
+    HcStackSegment* segment = *link;
+    if (StackSegmentSize(segment) >= size) {
+      *link = segment->next;
+      --g_stack_segment_cache_count;
+      g_stack_segment_cache_bytes -= segment->map_size;
+      return segment;
+    }
+    link = &segment->next;
+  }
+
+  const std::size_t guard = PageSize();
+  const std::size_t map_size = RoundUpToPage(size + sizeof(HcStackSegment)) + guard;
+  char* base = static_cast<char*>(MapAnonymous(map_size));
+  if (base == nullptr) {
+    return nullptr;
+  }
+  (void)::mprotect(base, guard, PROT_NONE);
+  HcStackSegment* segment =
+      reinterpret_cast<HcStackSegment*>(base + map_size - sizeof(HcStackSegment));
+  segment->base = base;
+  segment->map_size = map_size;
+  segment->lo = base + guard;
+  segment->next = nullptr;
+  return segment;
+}
+
+void ReleaseStackSegment(HcStackSegment* segment) {
+  if (g_stack_segment_cache_count >= kStackSegmentCacheMax ||
+      g_stack_segment_cache_bytes + segment->map_size > kStackSegmentCacheBytes) {
+    ::munmap(segment->base, segment->map_size);
+    return;
+  }
+  segment->next = g_stack_segment_cache;
+  g_stack_segment_cache = segment;
+  ++g_stack_segment_cache_count;
+  g_stack_segment_cache_bytes += segment->map_size;
+}
+
+std::int64_t CallStkGrowFn(const char* fn, std::int64_t a0, std::int64_t a1, std::int64_t a2) {
+  using StkGrowFn = std::int64_t (*)(std::int64_t, std::int64_t, std::int64_t);
+  StkGrowFn callee = reinterpret_cast<StkGrowFn>(reinterpret_cast<std::uintptr_t>(fn));
+  return callee(a0, a1, a2);
+}
+
+void StackSegmentEntry(void* opaque) {
+  HcStackCall* call = static_cast<HcStackCall*>(opaque);
+  AsanFinishSwitch(nullptr, &call->asan_bottom, &call->asan_size);
+  if (g_try_stack == nullptr) {
+    call->outer = g_stack_call;
+    g_stack_call = call;
+    if (setjmp(call->unwind_env) == 0) {
+      call->result = CallStkGrowFn(call->fn, call->a0, call->a1, call->a2);
+    } else {
+      call->thrown = true;
+      call->payload = g_exception_payload;
+    }
+    g_stack_call = call->outer;
+  } else {
+    hc_try_frame frame;
+    hc_try_push_cleanup(&frame);
+    if (setjmp(frame.env) == 0) {
+      call->result = CallStkGrowFn(call->fn, call->a0, call->a1, call->a2);
+      hc_try_end(&frame);
+    } else {
+      call->thrown = true;
+      call->payload = g_exception_payload;
+    }
+  }
+  AsanStartSwitch(nullptr, call->asan_bottom, call->asan_size);
+}
+
+struct HcStackBounds {
+  char* limit;
+  const void* bottom;
+  std::size_t size;
+};
+
+__attribute__((noinline)) HcStackBounds SwapStackBounds(HcStackBounds next) {
+  HcStackBounds previous{g_stack_limit, nullptr, 0};
+  g_stack_limit = next.limit;
+  if (CTask* fiber = g_fiber_current) {
+    previous.bottom = fiber->asan_stack_bottom;
+    previous.size = fiber->asan_stack_size;
+    fiber->asan_stack_bottom = next.bottom;
+    fiber->asan_stack_size = next.size;
+  }
+  return previous;
+}
+
+__attribute__((noinline)) bool StackHasRoom(std::size_t needed) {
+  if (g_stack_limit == nullptr) {
+    g_stack_limit = ThreadStackLimit();
+  }
+  const char* sp = static_cast<const char*>(__builtin_frame_address(0));
+  return g_stack_limit != nullptr && sp > g_stack_limit &&
+         static_cast<std::size_t>(sp - g_stack_limit) >= needed;
+}
+
+[[noreturn]] void ThrowPayload(std::int64_t payload);
+
+std::int64_t CallOnStackSegment(std::size_t size, const char* fn, std::int64_t a0,
+                                std::int64_t a1, std::int64_t a2) {
+  HcStackSegment* segment = AcquireStackSegment(size);
+  if (segment == nullptr) {
+    std::fprintf(stderr, "fatal runtime error: CallStkGrow could not map a %zu byte stack\n",
+                 size);
+    std::abort();
+  }
+  HcStackCall call{};
+  call.fn = fn;
+  call.a0 = a0;
+  call.a1 = a1;
+  call.a2 = a2;
+  call.stack_lo = segment->lo;
+  call.stack_hi = static_cast<const char*>(StackSegmentTop(segment));
+
+  const HcStackBounds outer =
+      SwapStackBounds(HcStackBounds{segment->lo, segment->lo, StackSegmentSize(segment)});
+  void* fake_stack = nullptr;
+  AsanStartSwitch(&fake_stack, segment->lo, StackSegmentSize(segment));
+  hc_stack_call(&call, &StackSegmentEntry, StackSegmentTop(segment));
+  AsanFinishSwitch(fake_stack, nullptr, nullptr);
+  (void)SwapStackBounds(outer);
+  ReleaseStackSegment(segment);
+
+  if (call.thrown) {
+    ThrowPayload(call.payload);
+  }
+  return call.result;
+}
+
+bool StackCallOwnsFrame(_Unwind_Context* context) {
+  const HcStackCall* call = g_stack_call;
+  if (call == nullptr) {
+    return true;
+  }
+  const std::uintptr_t cfa = _Unwind_GetCFA(context);
+  return cfa > reinterpret_cast<std::uintptr_t>(call->stack_lo) &&
+         cfa <= reinterpret_cast<std::uintptr_t>(call->stack_hi);
+}
+
+void ResumeStackCallAfterThrow() {
+  if (HcStackCall* call = g_stack_call) {
+    longjmp(call->unwind_env, 1);
+  }
+}
+
+#else
+
+bool StackCallOwnsFrame(_Unwind_Context*) {
+  return true;
+}
+
+void ResumeStackCallAfterThrow() {}
+
+#endif
+
+constexpr _Unwind_Exception_Class kHcExceptionClass = 0x484F4C5943000000ULL;
+constexpr std::uint8_t kDwEhPeOmit = 0xff;
+constexpr std::uint8_t kDwEhPePcrel = 0x10;
+constexpr std::uint8_t kDwEhPeIndirect = 0x80;
+
+thread_local _Unwind_Exception g_unwind_exception;
+
+std::uintptr_t ReadUleb128(const std::uint8_t** data) {
+  std::uintptr_t result = 0;
+  unsigned shift = 0;
+  std::uint8_t byte = 0;
+  do {
+    byte = *(*data)++;
+    result |= static_cast<std::uintptr_t>(byte & 0x7f) << shift;
+    shift += 7;
+  } while ((byte & 0x80) != 0);
+  return result;
+}
+
+std::uintptr_t ReadSleb128(const std::uint8_t** data) {
+  std::uintptr_t result = 0;
+  unsigned shift = 0;
+  std::uint8_t byte = 0;
+  do {
+    byte = *(*data)++;
+    result |= static_cast<std::uintptr_t>(byte & 0x7f) << shift;
+    shift += 7;
+  } while ((byte & 0x80) != 0);
+  if (shift < sizeof(result) * 8 && (byte & 0x40) != 0) {
+    result |= ~static_cast<std::uintptr_t>(0) << shift;
+  }
+  return result;
+}
+
+std::uintptr_t ReadEncodedPointer(const std::uint8_t** data, std::uint8_t encoding) {
+  const std::uint8_t* const start = *data;
+  std::uintptr_t result = 0;
+  switch (encoding & 0x0f) {
+    case 0x00: {
+      std::uintptr_t value;
+      std::memcpy(&value, *data, sizeof(value));
+      *data += sizeof(value);
+      result = static_cast<std::uintptr_t>(value);
+      break;
+    }
+    case 0x01:
+      result = ReadUleb128(data);
+      break;
+    case 0x02: {
+      std::uint16_t value;
+      std::memcpy(&value, *data, sizeof(value));
+      *data += sizeof(value);
+      result = static_cast<std::uintptr_t>(value);
+      break;
+    }
+    case 0x03: {
+      std::uint32_t value;
+      std::memcpy(&value, *data, sizeof(value));
+      *data += sizeof(value);
+      result = static_cast<std::uintptr_t>(value);
+      break;
+    }
+    case 0x04: {
+      std::uint64_t value;
+      std::memcpy(&value, *data, sizeof(value));
+      *data += sizeof(value);
+      result = static_cast<std::uintptr_t>(value);
+      break;
+    }
+    case 0x09:
+      result = ReadSleb128(data);
+      break;
+    case 0x0a: {
+      std::int16_t value;
+      std::memcpy(&value, *data, sizeof(value));
+      *data += sizeof(value);
+      result = static_cast<std::uintptr_t>(value);
+      break;
+    }
+    case 0x0b: {
+      std::int32_t value;
+      std::memcpy(&value, *data, sizeof(value));
+      *data += sizeof(value);
+      result = static_cast<std::uintptr_t>(value);
+      break;
+    }
+    case 0x0c: {
+      std::int64_t value;
+      std::memcpy(&value, *data, sizeof(value));
+      *data += sizeof(value);
+      result = static_cast<std::uintptr_t>(value);
+      break;
+    }
+    default:
+      std::abort();
+  }
+  if (result != 0 && (encoding & 0x70) == kDwEhPePcrel) {
+    result += reinterpret_cast<std::uintptr_t>(start);
+  }
+  if (result != 0 && (encoding & kDwEhPeIndirect) != 0) {
+    std::memcpy(&result, reinterpret_cast<const void*>(result), sizeof(result));
+  }
+  return result;
+}
+
+struct HcCallSite {
+  std::uintptr_t landing_pad;
+  const std::uint8_t* action;
+  const std::uint8_t* ttype_base;
+  std::uint8_t ttype_encoding;
+};
+
+// Looks up the LSDA call-site entry covering the frame's IP. action is the
+// first action record, or null for a cleanup-only pad.
+bool FindCallSite(_Unwind_Context* context, HcCallSite* out) {
+  const std::uint8_t* lsda =
+      static_cast<const std::uint8_t*>(_Unwind_GetLanguageSpecificData(context));
+  if (lsda == nullptr) {
+    return false;
+  }
+  int ip_before = 0;
+  std::uintptr_t ip = _Unwind_GetIPInfo(context, &ip_before);
+  if (ip_before == 0) {
+    --ip;
+  }
+  const std::uintptr_t func_start = _Unwind_GetRegionStart(context);
+  std::uintptr_t lp_start = func_start;
+  const std::uint8_t lp_start_encoding = *lsda++;
+  if (lp_start_encoding != kDwEhPeOmit) {
+    lp_start = ReadEncodedPointer(&lsda, lp_start_encoding);
+  }
+  out->ttype_encoding = *lsda++;
+  out->ttype_base = nullptr;
+  if (out->ttype_encoding != kDwEhPeOmit) {
+    const std::uintptr_t ttype_offset = ReadUleb128(&lsda);
+    out->ttype_base = lsda + ttype_offset;
+  }
+  const std::uint8_t call_site_encoding = *lsda++;
+  const std::uintptr_t call_site_bytes = ReadUleb128(&lsda);
+  const std::uint8_t* const call_site_end = lsda + call_site_bytes;
+  while (lsda < call_site_end) {
+    const std::uintptr_t start = func_start + ReadEncodedPointer(&lsda, call_site_encoding);
+    const std::uintptr_t length = ReadEncodedPointer(&lsda, call_site_encoding);
+    const std::uintptr_t landing_pad = ReadEncodedPointer(&lsda, call_site_encoding);
+    const std::uintptr_t action = ReadUleb128(&lsda);
+    if (ip < start) {
+      break;
+    }
+    if (ip < start + length) {
+      out->landing_pad = landing_pad == 0 ? 0 : lp_start + landing_pad;
+      out->action = action == 0 ? nullptr : call_site_end + action - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::uintptr_t FindLandingPad(_Unwind_Context* context) {
+  HcCallSite site{};
+  return FindCallSite(context, &site) ? site.landing_pad : 0;
+}
+
+std::size_t EncodedPointerSize(std::uint8_t encoding) {
+  switch (encoding & 0x07) {
+    case 0x02:
+      return 2;
+    case 0x03:
+      return 4;
+    case 0x04:
+      return 8;
+    default:
+      return sizeof(std::uintptr_t);
+  }
+}
+
+// The try nesting a table-mode landing pad records in its catch clauses, or
+// 0 for cleanup pads and frames compiled by anything else. A pad inlining
+// merged holds one marker per original function, so the markers add up.
+std::int64_t LandingPadTryDepth(_Unwind_Context* context) {
+  HcCallSite site{};
+  if (!FindCallSite(context, &site) || site.landing_pad == 0 || site.action == nullptr ||
+      site.ttype_base == nullptr) {
+    return 0;
+  }
+  std::int64_t depth = 0;
+  const std::uint8_t* action = site.action;
+  for (;;) {
+    const std::intptr_t filter = static_cast<std::intptr_t>(ReadSleb128(&action));
+    const std::uint8_t* const next = action;
+    const std::intptr_t displacement = static_cast<std::intptr_t>(ReadSleb128(&action));
+    if (filter > 0) {
+      const std::uint8_t* entry =
+          site.ttype_base - static_cast<std::size_t>(filter) * EncodedPointerSize(site.ttype_encoding);
+      const std::uintptr_t clause = ReadEncodedPointer(&entry, site.ttype_encoding);
+      if (clause != 0) {
+        const auto* marker = reinterpret_cast<const hc_try_depth_marker*>(clause);
+        if (marker->magic == HC_TRY_DEPTH_MAGIC) {
+          depth += marker->depth;
+        }
+      }
+    }
+    if (displacement == 0) {
+      return depth;
+    }
+    action = next + displacement;
+  }
+}
+
+_Unwind_Reason_Code CountTryDepth(_Unwind_Context* context, void* opaque) {
+  *static_cast<std::int64_t*>(opaque) += LandingPadTryDepth(context);
+  return _URC_NO_REASON;
+}
+
+void DiscardUnwindException(_Unwind_Reason_Code, _Unwind_Exception*) {}
+
+void RaiseUnwindException() {
+  _Unwind_Exception* exception = &g_unwind_exception;
+  std::memset(static_cast<void*>(exception), 0, sizeof(*exception));
+  exception->exception_class = kHcExceptionClass;
+  exception->exception_cleanup = &DiscardUnwindException;
+  (void)_Unwind_RaiseException(exception);
+}
+
+constexpr std::size_t kProcSlotMax = 256;
+constexpr std::size_t kProcCaptureMax = 64 * 1024 * 1024;
+constexpr std::int64_t kProcCaptureOut = 1;
+constexpr std::int64_t kProcCaptureErr = 2;
+constexpr std::int64_t kProcLaunchFailed = 127;
+
+struct HcProcBuffer {
+  char* data;
+  std::size_t len;
+  std::size_t cap;
+};
+
+struct HcProc {
+  char* command;
+  std::int64_t flags;
+  std::int64_t status;
+  CSpawnGrp* group;
+  HcWaitGroup done;
+  HcProcBuffer out;
+  HcProcBuffer err;
+  HcProc* next;
+};
+
+pthread_mutex_t g_proc_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_proc_cond = PTHREAD_COND_INITIALIZER;
+HcProc* g_proc_head = nullptr;
+HcProc* g_proc_tail = nullptr;
+HcProc* g_proc_free = nullptr;
+std::size_t g_proc_queued = 0;
+std::size_t g_proc_slots = 0;
+std::size_t g_proc_idle_slots = 0;
+std::size_t g_proc_slot_limit = 0;
+
+std::size_t ProcSlotLimit() {
+  if (g_proc_slot_limit != 0) {
+    return g_proc_slot_limit;
+  }
+  std::int64_t limit = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+  const long online = ::sysconf(_SC_NPROCESSORS_ONLN);
+  limit = online > 0 ? online : 1;
+#endif
+  const char* text = std::getenv("HOLYC_TASK_PROCS");
+  std::int64_t requested = 0;
+  if (text != nullptr && ParseIntLiteral(text, &requested) && requested > 0) {
+    limit = requested;
+  }
+  g_proc_slot_limit = std::min(static_cast<std::size_t>(limit), kProcSlotMax);
+  return g_proc_slot_limit;
+}
+
+bool HasShellMeta(const char* command) {
+  for (const char* cur = command; *cur != '\0'; ++cur) {
+    if (std::strchr("|&;<>()$`\\\"'*?[]#~{}!\n", *cur) != nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Builtins and leading NAME=value assignments have no executable to spawn,
+// so commands starting with one still go through the shell.
+bool IsShellBuiltin(const char* word) {
+  static constexpr const char* kBuiltins[] = {
+      ":", ".", "alias", "bg", "break", "cd", "command", "continue", "eval", "exec",
+      "exit", "export", "fg", "getopts", "hash", "jobs", "read", "readonly", "return",
+      "set", "shift", "times", "trap", "type", "ulimit", "umask", "unalias", "unset", "wait"};
+  for (const char* builtin : kBuiltins) {
+    if (std::strcmp(word, builtin) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AppendProcOutput(HcProcBuffer* buffer, const char* data, std::size_t len) {
+  if (buffer->len >= kProcCaptureMax) {
+    return;
+  }
+  len = std::min(len, kProcCaptureMax - buffer->len);
+  if (buffer->len + len + 1 > buffer->cap) {
+    std::size_t cap = buffer->cap == 0 ? 4096 : buffer->cap;
+    while (cap < buffer->len + len + 1) {
+      cap *= 2;
+    }
+    char* grown = static_cast<char*>(std::realloc(buffer->data, cap));
+    if (grown == nullptr) {
+      return;
+    }
+    buffer->data = grown;
+    buffer->cap = cap;
+  }
+  std::memcpy(buffer->data + buffer->len, data, len);
+  buffer->len += len;
+  buffer->data[buffer->len] = '\0';
+}
+
+void ReleaseProcBuffer(HcProcBuffer* buffer) {
+  std::free(buffer->data);
+  buffer->data = nullptr;
+  buffer->len = 0;
+  buffer->cap = 0;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+bool OpenCapturePipe(int fds[2]) {
+#if defined(__linux__)
+  return ::pipe2(fds, O_CLOEXEC) == 0;
+#else
+  if (::pipe(fds) != 0) {
+    return false;
+  }
+  (void)::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  (void)::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return true;
+#endif
+}
+
+void CloseFd(int* fd) {
+  if (*fd >= 0) {
+    ::close(*fd);
+    *fd = -1;
+  }
+}
+
+pid_t LaunchProc(HcProc* proc, int* out_fd, int* err_fd) {
+  int out_pipe[2] = {-1, -1};
+  int err_pipe[2] = {-1, -1};
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  if ((proc->flags & kProcCaptureOut) != 0 && OpenCapturePipe(out_pipe)) {
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+  }
+  if ((proc->flags & kProcCaptureErr) != 0 && OpenCapturePipe(err_pipe)) {
+    posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO);
+  }
+
+  std::vector<char*> argv;
+  char* words = nullptr;
+  if (!HasShellMeta(proc->command)) {
+    words = CopyCString(proc->command);
+    for (char* cur = words; cur != nullptr && *cur != '\0';) {
+      while (*cur == ' ' || *cur == '\t') {
+        *cur++ = '\0';
+      }
+      if (*cur != '\0') {
+        argv.push_back(cur);
+      }
+      while (*cur != '\0' && *cur != ' ' && *cur != '\t') {
+        ++cur;
+      }
+    }
+  }
+
+  if (!argv.empty() && (IsShellBuiltin(argv[0]) || std::strchr(argv[0], '=') != nullptr)) {
+    argv.clear();
+  }
+
+  // A direct launch that fails (e.g. ENOENT) is reported, not retried
+  // through the shell, which would run the command a second way.
+  pid_t pid = -1;
+  int rc = 0;
+  if (!argv.empty()) {
+    argv.push_back(nullptr);
+    rc = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+  } else {
+    char* shell_argv[] = {const_cast<char*>("/bin/sh"), const_cast<char*>("-c"), proc->command,
+                          nullptr};
+    rc = posix_spawn(&pid, "/bin/sh", &actions, nullptr, shell_argv, environ);
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  std::free(words);
+  CloseFd(&out_pipe[1]);
+  CloseFd(&err_pipe[1]);
+  if (rc != 0) {
+    CloseFd(&out_pipe[0]);
+    CloseFd(&err_pipe[0]);
+    errno = rc;
+    return -1;
+  }
+  *out_fd = out_pipe[0];
+  *err_fd = err_pipe[0];
+  return pid;
+}
+
+void DrainProcPipes(HcProc* proc, int out_fd, int err_fd) {
+  int fds[2] = {out_fd, err_fd};
+  HcProcBuffer* buffers[2] = {&proc->out, &proc->err};
+  char chunk[16384];
+  while (fds[0] >= 0 || fds[1] >= 0) {
+    pollfd polled[2];
+    int slots[2];
+    nfds_t count = 0;
+    for (int i = 0; i < 2; ++i) {
+      if (fds[i] >= 0) {
+        polled[count].fd = fds[i];
+        polled[count].events = POLLIN;
+        polled[count].revents = 0;
+        slots[count++] = i;
+      }
+    }
+    if (::poll(polled, count, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    for (nfds_t i = 0; i < count; ++i) {
+      if (polled[i].revents == 0) {
+        continue;
+      }
+      const int slot = slots[i];
+      const ssize_t got = ::read(fds[slot], chunk, sizeof(chunk));
+      if (got > 0) {
+        AppendProcOutput(buffers[slot], chunk, static_cast<std::size_t>(got));
+      } else if (got == 0 || errno != EINTR) {
+        CloseFd(&fds[slot]);
+      }
+    }
+  }
+  CloseFd(&fds[0]);
+  CloseFd(&fds[1]);
+}
+
+std::int64_t ReapProc(pid_t pid) {
+  int wait_status = 0;
+  while (::waitpid(pid, &wait_status, 0) < 0) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  if (WIFEXITED(wait_status)) {
+    return WEXITSTATUS(wait_status);
+  }
+  if (WIFSIGNALED(wait_status)) {
+    return 128 + WTERMSIG(wait_status);
+  }
+  return -1;
+}
+#endif
+
+void RunProc(HcProc* proc) {
+#if defined(__unix__) || defined(__APPLE__)
+  int out_fd = -1;
+  int err_fd = -1;
+  const pid_t pid = LaunchProc(proc, &out_fd, &err_fd);
+  if (pid < 0) {
+    std::fprintf(stderr, "warning: Spawn command launch failed: %s: %s\n", proc->command,
+                 std::strerror(errno));
+    proc->status = kProcLaunchFailed;
+  } else {
+    DrainProcPipes(proc, out_fd, err_fd);
+    proc->status = ReapProc(pid);
+  }
+#else
+  proc->status = std::system(proc->command);
+#endif
+  if ((proc->flags & kProcCaptureOut) != 0) {
+    AppendProcOutput(&proc->out, "", 0);
+  }
+  if ((proc->flags & kProcCaptureErr) != 0) {
+    AppendProcOutput(&proc->err, "", 0);
+  }
+  CSpawnGrp* const group = proc->group;
+  WaitGroupLeave(&proc->done);
+  WakeJobWaiters();
+  MarkSpawnDone(group);
+}
+
+void* ProcSlotMain(void*) {
+  pthread_mutex_lock(&g_proc_mutex);
+  for (;;) {
+    while (g_proc_head == nullptr) {
+      ++g_proc_idle_slots;
+      pthread_cond_wait(&g_proc_cond, &g_proc_mutex);
+      --g_proc_idle_slots;
+    }
+    HcProc* proc = g_proc_head;
+    g_proc_head = proc->next;
+    if (g_proc_head == nullptr) {
+      g_proc_tail = nullptr;
+    }
+    --g_proc_queued;
+    pthread_mutex_unlock(&g_proc_mutex);
+    RunProc(proc);
+    pthread_mutex_lock(&g_proc_mutex);
+  }
+  return nullptr;
+}
+
+void SubmitProc(HcProc* proc) {
+  pthread_mutex_lock(&g_proc_mutex);
+  proc->next = nullptr;
+  if (g_proc_tail != nullptr) {
+    g_proc_tail->next = proc;
+  } else {
+    g_proc_head = proc;
+  }
+  g_proc_tail = proc;
+  ++g_proc_queued;
+  if (g_proc_queued > g_proc_idle_slots && g_proc_slots < ProcSlotLimit()) {
+    pthread_t thread{};
+    if (pthread_create(&thread, nullptr, ProcSlotMain, nullptr) == 0) {
+      pthread_detach(thread);
+      ++g_proc_slots;
+    }
+  }
+  pthread_cond_signal(&g_proc_cond);
+  const bool stranded = g_proc_slots == 0;
+  if (stranded) {
+    g_proc_head = nullptr;
+    g_proc_tail = nullptr;
+    g_proc_queued = 0;
+  }
+  pthread_mutex_unlock(&g_proc_mutex);
+  if (stranded) {
+    RunProc(proc);
+  }
+}
+
+HcProc* AllocProc() {
+  pthread_mutex_lock(&g_proc_mutex);
+  HcProc* proc = g_proc_free;
+  if (proc != nullptr) {
+    g_proc_free = proc->next;
+  }
+  pthread_mutex_unlock(&g_proc_mutex);
+  if (proc == nullptr) {
+    proc = static_cast<HcProc*>(std::calloc(1, sizeof(HcProc)));
+  }
+  return proc;
+}
+
+HcProc* ProcFromHandle(std::int64_t handle) {
+  return handle > 0 ? reinterpret_cast<HcProc*>(static_cast<std::uintptr_t>(handle)) : nullptr;
+}
+
+#if !HC_RUNTIME_FIBERS
+void* SpawnThreadMain(void* opaque) {
+  HcSpawnRequest* req = static_cast<HcSpawnRequest*>(opaque);
+  if (req == nullptr) {
+    MarkSpawnDone(nullptr);
+    return nullptr;
+  }
+  CSpawnGrp* const group = req->group;
+  g_spawn_scope = group;
+  g_arena_current = &req->arena;
+  if (req->fn != nullptr) {
+    using SpawnFn = void (*)(const char*);
+    SpawnFn fn = reinterpret_cast<SpawnFn>(reinterpret_cast<std::uintptr_t>(req->fn));
+    fn(req->data);
+  }
+  g_arena_current = nullptr;
+  SpawnArenaUnregister(req->id);
+  ArenaRelease(&req->arena);
+  std::free(req);
+  OutputFlushThread();
+  MarkSpawnDone(group);
+  return nullptr;
+}
+
+std::size_t NormalizeStackSize(std::int64_t requested_size) {
+  if (requested_size <= 0) {
+    return 0;
+  }
+  std::size_t stack_size = static_cast<std::size_t>(requested_size);
+  if (stack_size < static_cast<std::size_t>(PTHREAD_STACK_MIN)) {
+    stack_size = static_cast<std::size_t>(PTHREAD_STACK_MIN);
+  }
+#if defined(_SC_PAGESIZE)
+  const long page_size = ::sysconf(_SC_PAGESIZE);
+  if (page_size > 0) {
+    const std::size_t page = static_cast<std::size_t>(page_size);
+    const std::size_t rem = stack_size % page;
+    if (rem != 0) {
+      stack_size += page - rem;
+    }
+  }
+#endif
+  return stack_size;
+}
+#endif
+
+void JoinWaitGroup(HcWaitGroup* group) {
+#if HC_RUNTIME_FIBERS
+  if (g_fiber_current != nullptr) {
+    while (!WaitGroupDrained(group)) {
+      Yield();
+    }
+    return;
+  }
+#endif
+  if (g_job_worker_self != nullptr) {
+    HelpJobsUntil(WaitGroupDrained, group);
+    return;
+  }
+  WaitGroupBlock(group);
+}
+
+constexpr std::int64_t kFifoSpsc = 1;
+constexpr std::uint64_t kFifoCapacityMax = std::uint64_t{1} << 30;
+constexpr std::int64_t kFifoHelpWaitNs = 200000;
+constexpr int kFifoSpinRounds = 16;
+
+bool FifoSpsc(const CFifoI64* fifo) {
+  return (fifo->flags & kFifoSpsc) != 0;
+}
+
+void FifoNotify(CFifoI64* fifo) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (fifo->sleeping.load(std::memory_order_relaxed) != 0 &&
+      fifo->sleeping.exchange(0, std::memory_order_acq_rel) != 0) {
+    fifo->event.fetch_add(1, std::memory_order_release);
+    FutexWakeAll(&fifo->event);
+  }
+}
+
+bool FifoTryIns(CFifoI64* fifo, std::int64_t value) {
+  if (FifoSpsc(fifo)) {
+    const std::uint64_t pos = fifo->in.load(std::memory_order_relaxed);
+    if (pos - fifo->out_cache > fifo->mask) {
+      fifo->out_cache = fifo->out.load(std::memory_order_acquire);
+      if (pos - fifo->out_cache > fifo->mask) {
+        return false;
+      }
+    }
+    fifo->cells[pos & fifo->mask].value.store(value, std::memory_order_relaxed);
+    fifo->in.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+  std::uint64_t pos = fifo->in.load(std::memory_order_relaxed);
+  for (;;) {
+    HcFifoCell* cell = &fifo->cells[pos & fifo->mask];
+    const std::uint64_t seq = cell->seq.load(std::memory_order_acquire);
+    const std::int64_t dif = static_cast<std::int64_t>(seq - pos);
+    if (dif == 0) {
+      if (fifo->in.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        cell->value.store(value, std::memory_order_relaxed);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (dif < 0) {
+      return false;
+    } else {
+      pos = fifo->in.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool FifoTryRem(CFifoI64* fifo, std::int64_t* value) {
+  if (FifoSpsc(fifo)) {
+    const std::uint64_t pos = fifo->out.load(std::memory_order_relaxed);
+    if (pos == fifo->in_cache) {
+      fifo->in_cache = fifo->in.load(std::memory_order_acquire);
+      if (pos == fifo->in_cache) {
+        return false;
+      }
+    }
+    *value = fifo->cells[pos & fifo->mask].value.load(std::memory_order_relaxed);
+    fifo->out.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+  std::uint64_t pos = fifo->out.load(std::memory_order_relaxed);
+  for (;;) {
+    HcFifoCell* cell = &fifo->cells[pos & fifo->mask];
+    const std::uint64_t seq = cell->seq.load(std::memory_order_acquire);
+    const std::int64_t dif = static_cast<std::int64_t>(seq - (pos + 1));
+    if (dif == 0) {
+      if (fifo->out.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        *value = cell->value.load(std::memory_order_relaxed);
+        cell->seq.store(pos + fifo->mask + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (dif < 0) {
+      return false;
+    } else {
+      pos = fifo->out.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool FifoTryPeek(CFifoI64* fifo, std::int64_t* value) {
+  if (FifoSpsc(fifo)) {
+    const std::uint64_t pos = fifo->out.load(std::memory_order_relaxed);
+    if (pos == fifo->in.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *value = fifo->cells[pos & fifo->mask].value.load(std::memory_order_relaxed);
+    return true;
+  }
+  for (;;) {
+    const std::uint64_t pos = fifo->out.load(std::memory_order_acquire);
+    HcFifoCell* cell = &fifo->cells[pos & fifo->mask];
+    if (cell->seq.load(std::memory_order_acquire) != pos + 1) {
+      if (fifo->out.load(std::memory_order_acquire) == pos) {
+        return false;
+      }
+      continue;
+    }
+    const std::int64_t peeked = cell->value.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (cell->seq.load(std::memory_order_relaxed) == pos + 1 &&
+        fifo->out.load(std::memory_order_relaxed) == pos) {
+      *value = peeked;
+      return true;
+    }
+  }
+}
+
+bool FifoReadable(const void* opaque) {
+  const CFifoI64* fifo = static_cast<const CFifoI64*>(opaque);
+  const std::uint64_t pos = fifo->out.load(std::memory_order_seq_cst);
+  if (FifoSpsc(fifo)) {
+    return fifo->in.load(std::memory_order_seq_cst) != pos;
+  }
+  return fifo->cells[pos & fifo->mask].seq.load(std::memory_order_seq_cst) == pos + 1;
+}
+
+bool FifoWritable(const void* opaque) {
+  const CFifoI64* fifo = static_cast<const CFifoI64*>(opaque);
+  const std::uint64_t pos = fifo->in.load(std::memory_order_seq_cst);
+  if (FifoSpsc(fifo)) {
+    return pos - fifo->out.load(std::memory_order_seq_cst) <= fifo->mask;
+  }
+  return fifo->cells[pos & fifo->mask].seq.load(std::memory_order_seq_cst) == pos;
+}
+
+constexpr unsigned kLockStripeBits = 8;
+constexpr std::size_t kLockStripeCount = std::size_t{1} << kLockStripeBits;
+constexpr int kLockSpinLimit = 64;
+
+struct alignas(64) HcLockStripe {
+  std::atomic<std::uintptr_t> owner;
+  std::uint32_t depth;
+};
+
+HcLockStripe g_lock_stripes[kLockStripeCount];
+thread_local char g_lock_thread_token = 0;
+
+HcLockStripe* LockStripeFor(const void* addr) {
+  const std::uint64_t bits =
+      static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(addr) >> 3);
+  return &g_lock_stripes[(bits * 0x9E3779B97F4A7C15ULL) >> (64 - kLockStripeBits)];
+}
+
+__attribute__((noinline)) std::uintptr_t LockOwnerToken() {
+#if HC_RUNTIME_FIBERS
+  if (g_fiber_current != nullptr) {
+    return reinterpret_cast<std::uintptr_t>(g_fiber_current);
+  }
+#endif
+  return reinterpret_cast<std::uintptr_t>(&g_lock_thread_token);
+}
+
+void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+void LockStripeAcquire(HcLockStripe* stripe) {
+  const std::uintptr_t self = LockOwnerToken();
+  if (stripe->owner.load(std::memory_order_relaxed) == self) {
+    ++stripe->depth;
+    return;
+  }
+  int backoff = 1;
+  for (;;) {
+    std::uintptr_t expected = 0;
+    if (stripe->owner.load(std::memory_order_relaxed) == 0 &&
+        stripe->owner.compare_exchange_weak(expected, self, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+      stripe->depth = 1;
+      return;
+    }
+    if (backoff <= kLockSpinLimit) {
+      for (int i = 0; i < backoff; ++i) {
+        CpuRelax();
+      }
+      backoff <<= 1;
+    } else {
+      Yield();
+    }
+  }
+}
+
+void LockStripeRelease(HcLockStripe* stripe) {
+  if (--stripe->depth == 0) {
+    stripe->owner.store(0, std::memory_order_release);
+  }
+}
+
+constexpr std::size_t kLockMaskWords = kLockStripeCount / 64;
+
+void LockStripeMask(const void* const* addrs, std::int64_t count, std::uint64_t* mask) {
+  for (std::size_t i = 0; i < kLockMaskWords; ++i) {
+    mask[i] = count > 0 ? 0 : ~std::uint64_t{0};
+  }
+  for (std::int64_t i = 0; i < count; ++i) {
+    const std::size_t index = static_cast<std::size_t>(LockStripeFor(addrs[i]) - g_lock_stripes);
+    mask[index / 64] |= std::uint64_t{1} << (index % 64);
+  }
+}
+
+void FifoBlock(CFifoI64* fifo, bool (*ready)(const void*)) {
+  OutputFlushThread();
+#if HC_RUNTIME_FIBERS
+  if (g_fiber_current != nullptr) {
+    Yield();
+    return;
+  }
+#endif
+  HcJobWorker* self = g_job_worker_self;
+  CJob* job = TakeJob(self);
+  if (job != nullptr) {
+    RunJob(job);
+    return;
+  }
+  for (int spin = 0; spin < kFifoSpinRounds; ++spin) {
+    if (ready(fifo)) {
+      return;
+    }
+    sched_yield();
+  }
+  const std::uint32_t seq = fifo->event.load(std::memory_order_acquire);
+  fifo->sleeping.store(1, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!ready(fifo)) {
+    FutexWait(&fifo->event, seq, self != nullptr ? kFifoHelpWaitNs : 0);
+  }
+}
+
+void ArenaLock(HcArenaScope* scope) {
+  while (scope->lock.exchange(true, std::memory_order_acquire)) {
+    sched_yield();
+  }
+}
+
+void ArenaUnlock(HcArenaScope* scope) {
+  scope->lock.store(false, std::memory_order_release);
+}
+
+#if HC_RUNTIME_ALLOCATOR
+constexpr std::size_t kHeapSpanShift = 20;
+constexpr std::size_t kHeapSpanSize = std::size_t{1} << kHeapSpanShift;
+constexpr std::size_t kHeapSpanHeader = 128;
+constexpr std::size_t kHeapSmallMax = 128 * 1024;
+constexpr std::uint32_t kHeapClassCount = 48;
+constexpr std::uint32_t kHeapLargeClass = 0xffffffffu;
+constexpr std::uint32_t kHeapArenaClass = 0xfffffffeu;
+constexpr std::size_t kHeapSpanCacheMax = 4;
+constexpr std::size_t kHeapLargeGranule = 64 * 1024;
+constexpr std::size_t kHeapHugePageSize = 2 * 1024 * 1024;
+
+struct HcHeapBlock {
+  HcHeapBlock* next;
+};
+
+struct HcHeap;
+
+struct alignas(64) HcHeapSpan {
+  HcHeap* owner;
+  HcHeapBlock* local_free;
+  HcHeapSpan* next;
+  HcHeapSpan* prev;
+  char* bump;
+  char* limit;
+  std::size_t block_size;
+  std::size_t map_size;
+  std::uint32_t size_class;
+  std::uint32_t used;
+  bool partial;
+};
+
+static_assert(sizeof(HcHeapSpan) <= kHeapSpanHeader, "span header must fit its reserved bytes");
+
+struct HcHeapClass {
+  HcHeapSpan* current;
+  HcHeapSpan* partial;
+};
+
+struct HcHeap {
+  std::atomic<HcHeapBlock*> remote_free;
+  HcHeapClass classes[kHeapClassCount];
+  HcHeapSpan* cache;
+  std::size_t cache_count;
+  HcHeap* next_orphan;
+};
+
+pthread_once_t g_heap_key_once = PTHREAD_ONCE_INIT;
+pthread_key_t g_heap_key;
+pthread_mutex_t g_heap_mutex = PTHREAD_MUTEX_INITIALIZER;
+HcHeap* g_heap_orphans = nullptr;
+thread_local HcHeap* g_heap = nullptr;
+std::atomic<int> g_heap_huge_pages{-1};
+
+std::uint32_t HeapSizeClass(std::size_t size) {
+  if (size <= 128) {
+    return size == 0 ? 0 : static_cast<std::uint32_t>((size - 1) >> 4);
+  }
+  const unsigned k = 63u - static_cast<unsigned>(__builtin_clzll(size - 1));
+  return static_cast<std::uint32_t>(8 + (k - 7) * 4 + (((size - 1) - (std::size_t{1} << k)) >> (k - 2)));
+}
+
+std::size_t HeapClassSize(std::uint32_t size_class) {
+  if (size_class < 8) {
+    return (static_cast<std::size_t>(size_class) + 1) << 4;
+  }
+  const std::uint32_t group = (size_class - 8) / 4;
+  const std::uint32_t step = (size_class - 8) % 4;
+  const unsigned k = 7 + group;
+  return (std::size_t{1} << k) + ((static_cast<std::size_t>(step) + 1) << (k - 2));
+}
+
+HcHeapSpan* HeapSpanOf(const void* ptr) {
+  return reinterpret_cast<HcHeapSpan*>(reinterpret_cast<std::uintptr_t>(ptr) &
+                                       ~static_cast<std::uintptr_t>(kHeapSpanSize - 1));
+}
+
+bool HeapHugePages() {
+  int mode = g_heap_huge_pages.load(std::memory_order_relaxed);
+  if (mode < 0) {
+    const char* text = std::getenv("HOLYC_MALLOC_THP");
+    mode = text != nullptr && text[0] != '\0' && std::strcmp(text, "0") != 0 ? 1 : 0;
+    g_heap_huge_pages.store(mode, std::memory_order_relaxed);
+  }
+  return mode != 0;
+}
+
+void* HeapMapAligned(std::size_t size, std::size_t align) {
+  int map_flags = MAP_PRIVATE | MAP_ANON;
+#if defined(MAP_NORESERVE)
+  map_flags |= MAP_NORESERVE;
+#endif
+  const std::size_t reserve = size + align;
+  void* raw = ::mmap(nullptr, reserve, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+  if (raw == MAP_FAILED) {
+    return nullptr;
+  }
+  const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(raw);
+  const std::uintptr_t start = (base + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+  const std::size_t head = static_cast<std::size_t>(start - base);
+  const std::size_t tail = reserve - head - size;
+  if (head != 0) {
+    (void)::munmap(raw, head);
+  }
+  if (tail != 0) {
+    (void)::munmap(reinterpret_cast<void*>(start + size), tail);
+  }
+  return reinterpret_cast<void*>(start);
+}
+
+void HeapReleaseKey(void* opaque) {
+  HcHeap* heap = static_cast<HcHeap*>(opaque);
+  g_heap = nullptr;
+  pthread_mutex_lock(&g_heap_mutex);
+  heap->next_orphan = g_heap_orphans;
+  g_heap_orphans = heap;
+  pthread_mutex_unlock(&g_heap_mutex);
+}
+
+void HeapCreateKey() {
+  (void)pthread_key_create(&g_heap_key, HeapReleaseKey);
+}
+
+__attribute__((noinline)) HcHeap* HeapAttach() {
+  pthread_once(&g_heap_key_once, HeapCreateKey);
+  pthread_mutex_lock(&g_heap_mutex);
+  HcHeap* heap = g_heap_orphans;
+  if (heap != nullptr) {
+    g_heap_orphans = heap->next_orphan;
+    heap->next_orphan = nullptr;
+  }
+  pthread_mutex_unlock(&g_heap_mutex);
+  if (heap == nullptr) {
+    heap = static_cast<HcHeap*>(std::calloc(1, sizeof(HcHeap)));
+    if (heap == nullptr) {
+      return nullptr;
+    }
+  }
+  g_heap = heap;
+  (void)pthread_setspecific(g_heap_key, heap);
+  return heap;
+}
+
+void HeapUnlinkPartial(HcHeapClass* cls, HcHeapSpan* span) {
+  if (span->prev != nullptr) {
+    span->prev->next = span->next;
+  } else {
+    cls->partial = span->next;
+  }
+  if (span->next != nullptr) {
+    span->next->prev = span->prev;
+  }
+  span->next = nullptr;
+  span->prev = nullptr;
+  span->partial = false;
+}
+
+void HeapLinkPartial(HcHeapClass* cls, HcHeapSpan* span) {
+  span->prev = nullptr;
+  span->next = cls->partial;
+  if (cls->partial != nullptr) {
+    cls->partial->prev = span;
+  }
+  cls->partial = span;
+  span->partial = true;
+}
+
+void HeapReleaseSpan(HcHeap* heap, HcHeapSpan* span) {
+  if (heap->cache_count < kHeapSpanCacheMax) {
+    span->next = heap->cache;
+    heap->cache = span;
+    ++heap->cache_count;
+    return;
+  }
+  (void)::munmap(span, kHeapSpanSize);
+}
+
+void HeapFreeLocal(HcHeap* heap, HcHeapSpan* span, HcHeapBlock* block) {
+  block->next = span->local_free;
+  span->local_free = block;
+  --span->used;
+  HcHeapClass* cls = &heap->classes[span->size_class];
+  if (span == cls->current) {
+    return;
+  }
+  if (span->used == 0) {
+    if (span->partial) {
+      HeapUnlinkPartial(cls, span);
+    }
+    HeapReleaseSpan(heap, span);
+    return;
+  }
+  if (!span->partial) {
+    HeapLinkPartial(cls, span);
+  }
+}
+
+void HeapDrainRemote(HcHeap* heap) {
+  HcHeapBlock* block = heap->remote_free.exchange(nullptr, std::memory_order_acquire);
+  while (block != nullptr) {
+    HcHeapBlock* next = block->next;
+    HeapFreeLocal(heap, HeapSpanOf(block), block);
+    block = next;
+  }
+}
+
+HcHeapSpan* HeapAcquireSpan(HcHeap* heap, std::uint32_t size_class) {
+  HcHeapSpan* span = heap->cache;
+  if (span != nullptr) {
+    heap->cache = span->next;
+    --heap->cache_count;
+  } else {
+    span = static_cast<HcHeapSpan*>(HeapMapAligned(kHeapSpanSize, kHeapSpanSize));
+    if (span == nullptr) {
+      return nullptr;
+    }
+  }
+  span->owner = heap;
+  span->local_free = nullptr;
+  span->next = nullptr;
+  span->prev = nullptr;
+  span->bump = reinterpret_cast<char*>(span) + kHeapSpanHeader;
+  span->limit = reinterpret_cast<char*>(span) + kHeapSpanSize;
+  span->block_size = HeapClassSize(size_class);
+  span->map_size = kHeapSpanSize;
+  span->size_class = size_class;
+  span->used = 0;
+  span->partial = false;
+  return span;
+}
+
+void* HeapSpanPop(HcHeapSpan* span) {
+  HcHeapBlock* block = span->local_free;
+  if (block != nullptr) {
+    span->local_free = block->next;
+    ++span->used;
+    return block;
+  }
+  if (static_cast<std::size_t>(span->limit - span->bump) >= span->block_size) {
+    void* out = span->bump;
+    span->bump += span->block_size;
+    ++span->used;
+    return out;
+  }
+  return nullptr;
+}
+
+__attribute__((noinline)) void* HeapAllocSlow(HcHeap* heap, std::uint32_t size_class) {
+  HeapDrainRemote(heap);
+  HcHeapClass* cls = &heap->classes[size_class];
+  if (cls->current != nullptr) {
+    void* out = HeapSpanPop(cls->current);
+    if (out != nullptr) {
+      return out;
+    }
+  }
+  HcHeapSpan* span = cls->partial;
+  if (span != nullptr) {
+    HeapUnlinkPartial(cls, span);
+  } else {
+    span = HeapAcquireSpan(heap, size_class);
+    if (span == nullptr) {
+      return nullptr;
+    }
+  }
+  cls->current = span;
+  return HeapSpanPop(span);
+}
+
+void* HeapAllocLarge(std::size_t size) {
+  if (size > SIZE_MAX - kHeapSpanHeader - kHeapHugePageSize) {
+    return nullptr;
+  }
+  const bool huge = size >= kHeapHugePageSize && HeapHugePages();
+  const std::size_t granule = huge ? kHeapHugePageSize : kHeapLargeGranule;
+  const std::size_t map_size = (kHeapSpanHeader + size + granule - 1) / granule * granule;
+  HcHeapSpan* span = static_cast<HcHeapSpan*>(
+      HeapMapAligned(map_size, huge ? kHeapHugePageSize : kHeapSpanSize));
+  if (span == nullptr) {
+    return nullptr;
+  }
+#if defined(MADV_HUGEPAGE)
+  if (huge) {
+    (void)::madvise(span, map_size, MADV_HUGEPAGE);
+  }
+#endif
+  span->owner = nullptr;
+  span->block_size = map_size - kHeapSpanHeader;
+  span->map_size = map_size;
+  span->size_class = kHeapLargeClass;
+  return reinterpret_cast<char*>(span) + kHeapSpanHeader;
+}
+
+void* HeapAlloc(std::size_t size) {
+  if (size > kHeapSmallMax) {
+    return HeapAllocLarge(size);
+  }
+  HcHeap* heap = g_heap;
+  if (heap == nullptr) {
+    heap = HeapAttach();
+    if (heap == nullptr) {
+      return nullptr;
+    }
+  }
+  const std::uint32_t size_class = HeapSizeClass(size);
+  HcHeapSpan* span = heap->classes[size_class].current;
+  if (span != nullptr) {
+    void* out = HeapSpanPop(span);
+    if (out != nullptr) {
+      return out;
+    }
+  }
+  return HeapAllocSlow(heap, size_class);
+}
+
+void HeapFree(void* ptr) {
+  HcHeapSpan* span = HeapSpanOf(ptr);
+  if (span->size_class >= kHeapArenaClass) {
+    if (span->size_class == kHeapLargeClass) {
+      (void)::munmap(span, span->map_size);
+    }
+    return;
+  }
+  HcHeapBlock* block = static_cast<HcHeapBlock*>(ptr);
+  HcHeap* owner = span->owner;
+  if (owner == g_heap) {
+    HeapFreeLocal(owner, span, block);
+    return;
+  }
+  HcHeapBlock* head = owner->remote_free.load(std::memory_order_relaxed);
+  do {
+    block->next = head;
+  } while (!owner->remote_free.compare_exchange_weak(head, block, std::memory_order_release,
+                                                      std::memory_order_relaxed));
+}
+
+HcHeapSpan* ArenaMapChunk(std::size_t size) {
+  HcHeapSpan* span = nullptr;
+  if (size <= kHeapSmallMax) {
+    HcHeap* heap = g_heap != nullptr ? g_heap : HeapAttach();
+    span = heap != nullptr ? HeapAcquireSpan(heap, 0) : nullptr;
+  } else {
+    void* block = HeapAllocLarge(size);
+    span = block != nullptr ? HeapSpanOf(block) : nullptr;
+  }
+  if (span != nullptr) {
+    span->owner = nullptr;
+    span->size_class = kHeapArenaClass;
+  }
+  return span;
+}
+
+__attribute__((noinline)) char* ArenaAllocSlow(HcArenaBump* arena, std::size_t size) {
+  HcHeapSpan* span = ArenaMapChunk(size);
+  if (span == nullptr) {
+    return nullptr;
+  }
+  span->next = static_cast<HcHeapSpan*>(arena->chunks);
+  arena->chunks = span;
+  char* out = reinterpret_cast<char*>(span) + kHeapSpanHeader;
+  if (size <= kHeapSmallMax) {
+    arena->bump = out + size;
+    arena->limit = span->limit;
+  }
+  return out;
+}
+
+char* ArenaBumpAlloc(HcArenaBump* arena, std::size_t size) {
+  char* out = arena->bump;
+  if (static_cast<std::size_t>(arena->limit - out) >= size) {
+    arena->bump = out + size;
+    return out;
+  }
+  return ArenaAllocSlow(arena, size);
+}
+
+void* ArenaAlloc(HcArenaScope* scope, std::size_t size) {
+  if (size > SIZE_MAX - kHeapSpanSize) {
+    return nullptr;
+  }
+  size = size == 0 ? 16 : (size + 15) & ~static_cast<std::size_t>(15);
+  if (StatsEnabled()) {
+    StatsAdd(kStatArenaAllocs, 1);
+    StatsAdd(kStatArenaBytes, static_cast<std::int64_t>(size));
+  }
+  if (scope == g_arena_current) {
+    return ArenaBumpAlloc(&scope->local, size);
+  }
+  ArenaLock(scope);
+  char* out = ArenaBumpAlloc(&scope->shared, size);
+  ArenaUnlock(scope);
+  return out;
+}
+
+void ArenaReleaseBump(HcArenaBump* arena) {
+  HcHeapSpan* span = static_cast<HcHeapSpan*>(arena->chunks);
+  arena->chunks = nullptr;
+  arena->bump = nullptr;
+  arena->limit = nullptr;
+  HcHeap* const heap = g_heap;
+  while (span != nullptr) {
+    HcHeapSpan* next = span->next;
+    if (heap != nullptr && span->map_size == kHeapSpanSize) {
+      HeapReleaseSpan(heap, span);
+    } else {
+      (void)::munmap(span, span->map_size);
+    }
+    span = next;
+  }
+}
+
+void ArenaRelease(HcArenaScope* scope) {
+  if (scope->local.chunks != nullptr) {
+    ArenaReleaseBump(&scope->local);
+  }
+  ArenaLock(scope);
+  if (scope->shared.chunks != nullptr) {
+    ArenaReleaseBump(&scope->shared);
+  }
+  ArenaUnlock(scope);
+}
+
+bool ArenaOwnsBlock(void* ptr) {
+  (void)ptr;
+  return false;
+}
+#else
+// Without the span allocator each scoped allocation is its own hc_malloc
+// block, chained through a header so ArenaRelease can free the scope. With
+// HC_RUNTIME_ARENA_FREE_CHECK the registry lets Free() ignore arena blocks
+// as the span allocator does; otherwise freeing one is a caller error.
+struct HcArenaBlock {
+  HcArenaBlock* next;
+  std::uint64_t reserved;
+};
+
+#if HC_RUNTIME_ARENA_FREE_CHECK
+pthread_mutex_t g_arena_blocks_mutex = PTHREAD_MUTEX_INITIALIZER;
+std::unordered_set<void*> g_arena_blocks;
+#endif
+
+void* ArenaAlloc(HcArenaScope* scope, std::size_t size) {
+  if (size > SIZE_MAX - sizeof(HcArenaBlock)) {
+    return nullptr;
+  }
+  HcArenaBlock* block = static_cast<HcArenaBlock*>(hc_malloc(sizeof(HcArenaBlock) + size));
+  if (block == nullptr) {
+    return nullptr;
+  }
+  void* out = block + 1;
+#if HC_RUNTIME_ARENA_FREE_CHECK
+  pthread_mutex_lock(&g_arena_blocks_mutex);
+  g_arena_blocks.insert(out);
+  pthread_mutex_unlock(&g_arena_blocks_mutex);
+#endif
+  if (scope == g_arena_current) {
+    block->next = static_cast<HcArenaBlock*>(scope->local.chunks);
+    scope->local.chunks = block;
+    return out;
+  }
+  ArenaLock(scope);
+  block->next = static_cast<HcArenaBlock*>(scope->shared.chunks);
+  scope->shared.chunks = block;
+  ArenaUnlock(scope);
+  return out;
+}
+
+void ArenaReleaseBlocks(HcArenaBump* arena) {
+  HcArenaBlock* block = static_cast<HcArenaBlock*>(arena->chunks);
+  arena->chunks = nullptr;
+  while (block != nullptr) {
+    HcArenaBlock* next = block->next;
+#if HC_RUNTIME_ARENA_FREE_CHECK
+    pthread_mutex_lock(&g_arena_blocks_mutex);
+    g_arena_blocks.erase(block + 1);
+    pthread_mutex_unlock(&g_arena_blocks_mutex);
+#endif
+    hc_free(block);
+    block = next;
+  }
+}
+
+void ArenaRelease(HcArenaScope* scope) {
+  ArenaReleaseBlocks(&scope->local);
+  ArenaLock(scope);
+  ArenaReleaseBlocks(&scope->shared);
+  ArenaUnlock(scope);
+}
+
+bool ArenaOwnsBlock(void* ptr) {
+#if HC_RUNTIME_ARENA_FREE_CHECK
+  pthread_mutex_lock(&g_arena_blocks_mutex);
+  const bool owned = g_arena_blocks.count(ptr) != 0;
+  pthread_mutex_unlock(&g_arena_blocks_mutex);
+  return owned;
+#else
+  (void)ptr;
+  return false;
+#endif
+}
+#endif
+
+std::int64_t StatsBlockSize(void* ptr) {
+#if HC_RUNTIME_ALLOCATOR
+  const HcHeapSpan* span = HeapSpanOf(ptr);
+  return span->size_class == kHeapArenaClass ? -1 : static_cast<std::int64_t>(span->block_size);
+#elif defined(__linux__)
+  return static_cast<std::int64_t>(malloc_usable_size(ptr));
+#elif defined(__APPLE__)
+  return static_cast<std::int64_t>(malloc_size(ptr));
+#else
+  (void)ptr;
+  return 0;
+#endif
+}
+
+__attribute__((noinline)) void StatsRecordAlloc(void* ptr, std::size_t size) {
+  const std::int64_t bytes = StatsBlockSize(ptr);
+  StatsAdd(kStatAllocs, 1);
+  StatsAdd(kStatBytesAllocated, bytes);
+  StatsAdd(StatsSizeBucket(size), 1);
+  StatsLiveBytes(bytes);
+}
+
+__attribute__((noinline)) void StatsRecordFree(void* ptr) {
+  const std::int64_t bytes = StatsBlockSize(ptr);
+  if (bytes < 0) {
+    return;
+  }
+  StatsAdd(kStatFrees, 1);
+  StatsAdd(kStatBytesFreed, bytes);
+  StatsLiveBytes(-bytes);
+}
+
+void StatsReportAtExit() {
+  hc_runtime_stats_report(0);
+}
+
+void StatsReportJsonAtExit() {
+  hc_runtime_stats_report(1);
+}
+
+struct HcStatsBoot {
+  HcStatsBoot() {
+    const char* text = std::getenv("HOLYC_RUNTIME_STATS");
+    if (text == nullptr || text[0] == '\0' || std::strcmp(text, "0") == 0) {
+      return;
+    }
+    hc_runtime_stats_enable(1);
+    (void)std::atexit(std::strcmp(text, "json") == 0 ? StatsReportJsonAtExit : StatsReportAtExit);
+  }
+};
+
+HcStatsBoot g_stats_boot;
+
+[[noreturn]] void ThrowPayload(std::int64_t payload) {
+  g_exception_payload = payload;
+  if (g_try_stack != nullptr) {
+    hc_try_frame* frame = g_try_stack;
+    g_try_stack = frame->prev;
+    longjmp(frame->env, 1);
+  }
+  RaiseUnwindException();
+  ResumeStackCallAfterThrow();
+
+  OutputFlushThread();
+  std::fflush(stdout);
+  std::fprintf(stderr, "fatal runtime error: uncaught HolyC exception payload=%lld\n",
+               static_cast<long long>(payload));
+  std::abort();
+}
+
+}  // namespace
+
+std::int64_t hc_runtime_abi_version() {
+  return (static_cast<std::int64_t>(HC_RUNTIME_ABI_VERSION_MAJOR) << 32) |
+         static_cast<std::int64_t>(HC_RUNTIME_ABI_VERSION_MINOR);
+}
+
+void hc_print_str(const char* text) {
+  if (text == nullptr) {
+    return;
+  }
+  HcOutputBuffer* out = &g_output;
+  OutputWrite(out, text, std::strlen(text));
+  OutputCommit(out);
+}
+
+void hc_put_char(std::int64_t ch) {
+  HcOutputBuffer* out = &g_output;
+  OutputPut(out, static_cast<char>(ch & 0xff));
+  OutputCommit(out);
+}
+
+void hc_output_flush() {
+  OutputFlush(&g_output);
+}
+
+void hc_fmt_write(const char* text, std::size_t len) {
+  HcOutputBuffer* out = &g_output;
+  OutputWrite(out, text, len);
+  OutputCommit(out);
+}
+
+void hc_fmt_i64_dec(std::int64_t width, std::int64_t flags, std::int64_t value) {
+  HcOutputBuffer* out = &g_output;
+  OutputSigned(out, value, static_cast<int>(flags), width, -1);
+  OutputCommit(out);
+}
+
+void hc_fmt_u64(std::int64_t radix, std::int64_t width, std::int64_t flags, std::int64_t value) {
+  HcOutputBuffer* out = &g_output;
+  const unsigned base =
+      radix == 2 || radix == 8 || radix == 16 ? static_cast<unsigned>(radix) : 10U;
+  OutputInteger(out, static_cast<std::uint64_t>(value), false, base, (flags & kFmtUpper) != 0,
+                static_cast<int>(flags & ~(kFmtPlus | kFmtSpace | kFmtUpper)), width, -1);
+  OutputCommit(out);
+}
+
+void hc_fmt_char(std::int64_t width, std::int64_t flags, std::int64_t ch) {
+  HcOutputBuffer* out = &g_output;
+  const char byte = static_cast<char>(ch & 0xff);
+  OutputText(out, &byte, 1, static_cast<int>(flags), width);
+  OutputCommit(out);
+}
+
+void hc_fmt_str(std::int64_t width, std::int64_t flags, std::int64_t precision, const char* text) {
+  HcOutputBuffer* out = &g_output;
+  if (text == nullptr) {
+    text = "(null)";
+  }
+  const std::size_t len =
+      precision < 0 ? std::strlen(text) : strnlen(text, static_cast<std::size_t>(precision));
+  OutputText(out, text, len, static_cast<int>(flags), width);
+  OutputCommit(out);
+}
+
+void hc_fmt_f64(std::int64_t precision, std::int64_t bits) {
+  HcOutputBuffer* out = &g_output;
+  double value = 0.0;
+  std::memcpy(&value, &bits, sizeof(value));
+  OutputDouble(out, 'f', 0, 0, precision, value);
+  OutputCommit(out);
+}
+
+void hc_print_fmt(const char* format, const std::int64_t* args, std::size_t arg_count) {
+  if (format == nullptr) {
+    return;
+  }
+
+  HcOutputBuffer* out = &g_output;
+  std::size_t arg_index = 0;
+  auto next_arg = [&](std::int64_t fallback = 0) -> std::int64_t {
+    if (args == nullptr || arg_index >= arg_count) {
+      return fallback;
+    }
+    return args[arg_index++];
+  };
+
+  std::size_t i = 0;
+  while (format[i] != '\0') {
+    if (format[i] != '%') {
+      const std::size_t run_begin = i;
+      while (format[i] != '\0' && format[i] != '%') {
+        ++i;
+      }
+      OutputWrite(out, format + run_begin, i - run_begin);
+      continue;
+    }
+
+    const std::size_t spec_begin = i++;
+    if (format[i] == '%') {
+      OutputPut(out, '%');
+      ++i;
+      continue;
+    }
+
+    int flags = 0;
+    for (;; ++i) {
+      if (format[i] == '-') {
+        flags |= kFmtLeft;
+      } else if (format[i] == '+') {
+        flags |= kFmtPlus;
+      } else if (format[i] == ' ') {
+        flags |= kFmtSpace;
+      } else if (format[i] == '#') {
+        flags |= kFmtAlt;
+      } else if (format[i] == '0') {
+        flags |= kFmtZero;
+      } else if (format[i] != '\'') {
+        break;
+      }
+    }
+    bool width_from_arg = false;
+    bool precision_from_arg = false;
+    std::int64_t width = 0;
+    std::int64_t precision = -1;
+    if (format[i] == '*') {
+      width_from_arg = true;
+      ++i;
+    } else {
+      while (format[i] >= '0' && format[i] <= '9') {
+        width = std::min<std::int64_t>(width * 10 + (format[i] - '0'), INT_MAX);
+        ++i;
+      }
+    }
+    if (format[i] == '.') {
+      ++i;
+      precision = 0;
+      if (format[i] == '*') {
+        precision_from_arg = true;
+        ++i;
+      } else {
+        while (format[i] >= '0' && format[i] <= '9') {
+          precision = std::min<std::int64_t>(precision * 10 + (format[i] - '0'), INT_MAX);
+          ++i;
+        }
+      }
+    }
+    int int_bits = 32;
+    while (format[i] == 'h' || format[i] == 'l' || format[i] == 'j' || format[i] == 't' ||
+           format[i] == 'L' || format[i] == 'q') {
+      const char lm = format[i++];
+      if (lm == 'h') {
+        int_bits = format[i] == 'h' ? 8 : 16;
+      } else {
+        int_bits = 64;
+      }
+      if ((lm == 'h' || lm == 'l') && format[i] == lm) {
+        ++i;
+      }
+    }
+
+    const char conv = format[i];
+    if (conv == '\0') {
+      break;
+    }
+    ++i;
+    if (width_from_arg) {
+      width = static_cast<int>(next_arg());
+      if (width < 0) {
+        flags |= kFmtLeft;
+        width = -width;
+      }
+    }
+    if (precision_from_arg) {
+      precision = static_cast<int>(next_arg());
+      if (precision < 0) {
+        precision = -1;
+      }
+    }
+
+    switch (conv) {
+      case 'z': {
+        const std::int64_t idx = next_arg();
+        const char* table =
+            reinterpret_cast<const char*>(static_cast<std::uintptr_t>(next_arg()));
+        const char* text = LookupZString(table, idx);
+        OutputWrite(out, text, std::strlen(text));
+        break;
+      }
+      case 'b': {
+        const std::uint64_t value = static_cast<std::uint64_t>(next_arg());
+        OutputInteger(out, value, false, 2, false, 0, 0, -1);
+        break;
+      }
+      case 'd':
+      case 'i': {
+        std::int64_t value = next_arg();
+        if (int_bits == 32) {
+          value = static_cast<std::int32_t>(value);
+        } else if (int_bits == 16) {
+          value = static_cast<std::int16_t>(value);
+        } else if (int_bits == 8) {
+          value = static_cast<std::int8_t>(value);
+        }
+        OutputSigned(out, value, flags, width, precision);
+        break;
+      }
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o': {
+        std::uint64_t value = static_cast<std::uint64_t>(next_arg());
+        if (int_bits < 64) {
+          value &= (1ULL << int_bits) - 1ULL;
+        }
+        const unsigned base = conv == 'u' ? 10U : conv == 'o' ? 8U : 16U;
+        OutputInteger(out, value, false, base, conv == 'X', flags & ~(kFmtPlus | kFmtSpace),
+                      width, precision);
+        break;
+      }
+      case 'p':
+      case 'P': {
+        const std::uint64_t raw = static_cast<std::uint64_t>(next_arg());
+        if (raw == 0) {
+          if (conv == 'P') {
+            OutputWrite(out, "0x0", 3);
+          } else {
+            OutputText(out, "(nil)", 5, flags, width);
+          }
+          break;
+        }
+        OutputInteger(out, raw, false, 16, false, flags | kFmtAlt, width, precision);
+        break;
+      }
+      case 'c': {
+        const char ch = static_cast<char>(next_arg() & 0xff);
+        OutputText(out, &ch, 1, flags, width);
+        break;
+      }
+      case 's': {
+        const char* text =
             reinterpret_cast<const char*>(static_cast<std::uintptr_t>(next_arg()));
-        print_cstr(spec, text == nullptr ? "(null)" : text);
+        if (text == nullptr) {
+          text = "(null)";
+        }
+        const std::size_t len = precision < 0
+                                    ? std::strlen(text)
+                                    : strnlen(text, static_cast<std::size_t>(precision));
+        OutputText(out, text, len, flags, width);
+        break;
+      }
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G': {
+        const std::uint64_t bits = static_cast<std::uint64_t>(next_arg());
+        double value = 0.0;
+        static_assert(sizeof(value) == sizeof(bits), "double payload size mismatch");
+        std::memcpy(&value, &bits, sizeof(value));
+        OutputDouble(out, conv, flags, width, precision, value);
+        break;
+      }
+      default:
+        OutputWrite(out, format + spec_begin, i - spec_begin);
         break;
+    }
+  }
+  OutputCommit(out);
+}
+
+void hc_try_push(hc_try_frame* frame) {
+  if (frame == nullptr) {
+    return;
+  }
+  frame->prev = g_try_stack;
+  frame->cleanup = 0;
+  g_try_stack = frame;
+}
+
+void hc_try_push_cleanup(hc_try_frame* frame) {
+  if (frame == nullptr) {
+    return;
+  }
+  frame->prev = g_try_stack;
+  frame->cleanup = 1;
+  g_try_stack = frame;
+}
+
+void hc_try_pop(hc_try_frame* frame) {
+  if (frame == nullptr || g_try_stack == nullptr) {
+    return;
+  }
+  if (g_try_stack == frame) {
+    g_try_stack = frame->prev;
+    return;
+  }
+
+  hc_try_frame* prev = g_try_stack;
+  hc_try_frame* cur = g_try_stack->prev;
+  while (cur != nullptr) {
+    if (cur == frame) {
+      prev->prev = cur->prev;
+      return;
+    }
+    prev = cur;
+    cur = cur->prev;
+  }
+}
+
+[[noreturn]] void hc_throw_i64(std::int64_t payload) {
+  StatsCount(kStatExceptionsThrown, 1);
+  ThrowPayload(payload);
+}
+
+_Unwind_Reason_Code hc_personality_v0(int version, _Unwind_Action actions,
+                                      _Unwind_Exception_Class exception_class,
+                                      _Unwind_Exception* exception, _Unwind_Context* context) {
+  if (version != 1 || exception == nullptr || context == nullptr) {
+    return _URC_FATAL_PHASE1_ERROR;
+  }
+  if (exception_class != kHcExceptionClass || (actions & _UA_FORCE_UNWIND) != 0) {
+    return _URC_CONTINUE_UNWIND;
+  }
+  const std::uintptr_t landing_pad = FindLandingPad(context);
+  if (landing_pad == 0) {
+    return _URC_CONTINUE_UNWIND;
+  }
+  if ((actions & _UA_SEARCH_PHASE) != 0) {
+    return StackCallOwnsFrame(context) ? _URC_HANDLER_FOUND : _URC_FATAL_PHASE1_ERROR;
+  }
+  if ((actions & _UA_HANDLER_FRAME) == 0) {
+    return _URC_CONTINUE_UNWIND;
+  }
+  _Unwind_SetGR(context, __builtin_eh_return_data_regno(0),
+                reinterpret_cast<std::uintptr_t>(exception));
+  _Unwind_SetGR(context, __builtin_eh_return_data_regno(1), 1);
+  _Unwind_SetIP(context, landing_pad);
+  return _URC_INSTALL_CONTEXT;
+}
+
+std::int64_t hc_exception_payload() {
+  return g_exception_payload;
+}
+
+std::int64_t hc_exception_active() {
+  return hc_try_depth() > 0 ? 1 : 0;
+}
+
+// setjmp-mode regions are on g_try_stack. Table-mode regions leave no
+// runtime state, so their depth is read back from the landing pads of the
+// frames on the stack; this walk only runs when someone asks.
+std::int64_t hc_try_depth() {
+  std::int64_t depth = 0;
+  for (const hc_try_frame* cur = g_try_stack; cur != nullptr; cur = cur->prev) {
+    depth += cur->cleanup == 0 ? 1 : 0;
+  }
+  (void)_Unwind_Backtrace(CountTryDepth, &depth);
+  return depth;
+}
+
+void hc_register_reflection_table(const hc_reflection_field* fields, std::size_t field_count) {
+  pthread_mutex_lock(&g_reflection_mutex);
+  g_reflection_fields = fields;
+  g_reflection_field_count = field_count;
+  HcReflectionIndex* old = g_reflection_index.exchange(nullptr, std::memory_order_acq_rel);
+  if (old != nullptr) {
+    old->retired = g_reflection_retired;
+    g_reflection_retired = old;
+  }
+  pthread_mutex_unlock(&g_reflection_mutex);
+}
+
+void hc_reflection_reset() {
+  pthread_mutex_lock(&g_reflection_mutex);
+  g_reflection_fields = nullptr;
+  g_reflection_field_count = 0;
+  HcReflectionIndex* index = g_reflection_index.exchange(nullptr, std::memory_order_acq_rel);
+  HcReflectionIndex* retired = g_reflection_retired;
+  g_reflection_retired = nullptr;
+  pthread_mutex_unlock(&g_reflection_mutex);
+  FreeReflectionIndex(index);
+  while (retired != nullptr) {
+    HcReflectionIndex* next = retired->retired;
+    FreeReflectionIndex(retired);
+    retired = next;
+  }
+}
+
+std::size_t hc_reflection_field_count() {
+  pthread_mutex_lock(&g_reflection_mutex);
+  const std::size_t count = g_reflection_field_count;
+  pthread_mutex_unlock(&g_reflection_mutex);
+  return count;
+}
+
+const hc_reflection_field* hc_reflection_fields() {
+  pthread_mutex_lock(&g_reflection_mutex);
+  const hc_reflection_field* fields = g_reflection_fields;
+  pthread_mutex_unlock(&g_reflection_mutex);
+  return fields;
+}
+
+void* hc_malloc(std::size_t size) {
+#if HC_RUNTIME_ALLOCATOR
+  void* out = HeapAlloc(size);
+#else
+  void* out = std::malloc(size);
+#endif
+  if (StatsEnabled() && out != nullptr) {
+    StatsRecordAlloc(out, size);
+  }
+  return out;
+}
+
+void hc_free(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  if (StatsEnabled()) {
+    StatsRecordFree(ptr);
+  }
+#if HC_RUNTIME_ALLOCATOR
+  HeapFree(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+void* hc_memcpy(void* dst, const void* src, std::size_t size) {
+  return std::memcpy(dst, src, size);
+}
+
+void* hc_memset(void* dst, int value, std::size_t size) {
+  return std::memset(dst, value, size);
+}
+
+std::int64_t CallStkGrow(std::int64_t stack_min, std::int64_t stack_max, const char* fn,
+                         std::int64_t a0, std::int64_t a1, std::int64_t a2) {
+  if (fn == nullptr) {
+    return 0;
+  }
+#if HC_RUNTIME_FIBERS
+  const std::size_t threshold = stack_min > 0 ? static_cast<std::size_t>(stack_min) : 0;
+  if (!StackHasRoom(threshold + kStackSegmentReserve)) {
+    std::size_t size = stack_max > 0 ? static_cast<std::size_t>(stack_max) : 0;
+    size = std::max(std::max(size, threshold), kStackSegmentMin) + kStackSegmentReserve;
+    return CallOnStackSegment(size, fn, a0, a1, a2);
+  }
+#else
+  (void)stack_min;
+  (void)stack_max;
+#endif
+  using StkGrowFn = std::int64_t (*)(std::int64_t, std::int64_t, std::int64_t);
+  StkGrowFn callee = reinterpret_cast<StkGrowFn>(reinterpret_cast<std::uintptr_t>(fn));
+  return callee(a0, a1, a2);
+}
+
+CTask* Spawn(const char* fn, const char* data, const char* task_name, std::int64_t target_cpu,
+             CTask* parent, std::int64_t stk_size, std::int64_t flags) {
+  (void)parent;
+  (void)flags;
+  if (fn == nullptr) {
+    return nullptr;
+  }
+#if HC_RUNTIME_FIBERS
+  const std::int64_t task_id = SpawnFiber(fn, data, task_name, target_cpu, stk_size);
+  if (task_id == 0) {
+    return nullptr;
+  }
+  return reinterpret_cast<CTask*>((static_cast<std::uintptr_t>(task_id) << 1) | kSpawnHandleTag);
+#else
+  (void)task_name;
+
+  HcSpawnRequest* req = static_cast<HcSpawnRequest*>(std::calloc(1, sizeof(HcSpawnRequest)));
+  if (req == nullptr) {
+    return nullptr;
+  }
+  req->fn = fn;
+  req->data = data;
+
+  pthread_attr_t attr;
+  pthread_attr_t* attr_ptr = nullptr;
+  bool attr_initialized = false;
+  if (pthread_attr_init(&attr) == 0) {
+    attr_initialized = true;
+    const std::size_t normalized_stack_size = NormalizeStackSize(stk_size);
+    if (normalized_stack_size > 0 &&
+        pthread_attr_setstacksize(&attr, normalized_stack_size) != 0) {
+      pthread_attr_destroy(&attr);
+      std::free(req);
+      return nullptr;
+    }
+#if defined(__linux__)
+    if (target_cpu >= 0 && target_cpu < CPU_SETSIZE) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(static_cast<std::size_t>(target_cpu), &set);
+      (void)pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    }
+#endif
+    attr_ptr = &attr;
+  }
+
+  req->group = g_spawn_scope;
+  req->id = g_next_task_id.fetch_add(1, std::memory_order_relaxed);
+  const std::int64_t task_id = req->id;
+  SpawnArenaRegister(task_id, &req->arena);
+  MarkSpawnStart(req->group);
+  OutputFlushThread();
+  pthread_t thread{};
+  const int rc = pthread_create(&thread, attr_ptr, SpawnThreadMain, req);
+  if (attr_initialized) {
+    pthread_attr_destroy(&attr);
+  }
+  if (rc != 0) {
+    SpawnArenaUnregister(task_id);
+    MarkSpawnDone(req->group);
+    std::free(req);
+    return nullptr;
+  }
+  pthread_detach(thread);
+  StatsCount(kStatTasksSpawned, 1);
+  return reinterpret_cast<CTask*>((static_cast<std::uintptr_t>(task_id) << 1) | kSpawnHandleTag);
+#endif
+}
+
+void Yield() {
+#if HC_RUNTIME_FIBERS
+  CTask* self = g_fiber_current;
+  if (self != nullptr) {
+    self->state = kTaskYielded;
+    SwitchToScheduler(self);
+    return;
+  }
+#endif
+  sched_yield();
+}
+
+void Sleep(std::int64_t ms) {
+#if HC_RUNTIME_FIBERS
+  CTask* self = g_fiber_current;
+  if (self != nullptr) {
+    if (ms <= 0) {
+      self->state = kTaskYielded;
+    } else {
+      self->wake_ns = MonotonicNowNs() + ms * 1000000LL;
+      self->state = kTaskSleeping;
+    }
+    SwitchToScheduler(self);
+    return;
+  }
+#endif
+  if (ms <= 0) {
+    sched_yield();
+    return;
+  }
+  timespec remaining{};
+  remaining.tv_sec = static_cast<time_t>(ms / 1000);
+  remaining.tv_nsec = static_cast<long>((ms % 1000) * 1000000LL);
+  while (nanosleep(&remaining, &remaining) == -1 && errno == EINTR) {
+  }
+}
+
+CJob* JobQue(const char* fn, const char* arg, std::int64_t cpu, std::int64_t flags) {
+  (void)flags;
+  pthread_once(&g_job_pool_once, StartJobPool);
+  CJob* job = AllocJob();
+  if (job == nullptr) {
+    return nullptr;
+  }
+  job->fn = fn;
+  job->arg = static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(arg));
+  DispatchJob(job, cpu < 0 ? -1 : cpu);
+  return job;
+}
+
+std::int64_t JobResGet(CJob* job) {
+  if (job == nullptr) {
+    return 0;
+  }
+  HelpJobsUntil(JobIsDone, job);
+  const std::int64_t result = job->result;
+  ReleaseJob(job);
+  return result;
+}
+
+bool JobResScan(CJob* job, std::int64_t* res) {
+  if (job == nullptr || job->done.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  if (res != nullptr) {
+    *res = job->result;
+  }
+  ReleaseJob(job);
+  return true;
+}
+
+std::int64_t JobResAny(CJob** jobs, std::int64_t count, std::int64_t* res) {
+  if (jobs == nullptr || count <= 0) {
+    return -1;
+  }
+  HcJobAnyWait wait{jobs, static_cast<std::size_t>(count)};
+  for (;;) {
+    bool pending = false;
+    for (std::size_t i = 0; i < wait.count; ++i) {
+      CJob* job = jobs[i];
+      if (job == nullptr) {
+        continue;
+      }
+      pending = true;
+      if (JobResScan(job, res)) {
+        jobs[i] = nullptr;
+        return static_cast<std::int64_t>(i);
+      }
+    }
+    if (!pending) {
+      return -1;
+    }
+    HelpJobsUntil(AnyJobDone, &wait);
+  }
+}
+
+// Takes ownership of job: it is released once its result has been handed
+// to the continuation, so the caller must not pass it to JobResGet,
+// JobResScan or JobThen again. Only the returned handle stays valid.
+CJob* JobThen(CJob* job, const char* fn) {
+  if (job == nullptr) {
+    return nullptr;
+  }
+  CJob* continuation = AllocJob();
+  if (continuation == nullptr) {
+    return nullptr;
+  }
+  continuation->fn = fn;
+
+  CJob* expected = nullptr;
+  if (job->then.compare_exchange_strong(expected, continuation, std::memory_order_acq_rel)) {
+    return continuation;
+  }
+  if (expected != kJobThenSealed) {
+    ReleaseJob(continuation);
+    return nullptr;
+  }
+  // The job has finished running and is about to publish done; help with
+  // queued work rather than spin, since this may be a job worker or fiber.
+  HelpJobsUntil(JobIsDone, job);
+  continuation->arg = job->result;
+  ReleaseJob(job);
+  DispatchJob(continuation, -1);
+  return continuation;
+}
+
+void JobParFor(std::int64_t lo, std::int64_t hi, std::int64_t grain, const char* fn,
+               const char* ctx) {
+  if (fn == nullptr || hi <= lo) {
+    return;
+  }
+  HcParState state;
+  state.body = fn;
+  state.ctx = ctx;
+  state.combine = nullptr;
+  state.reduce = false;
+  RunParallel(&state, lo, hi, grain);
+}
+
+std::int64_t JobParReduce(std::int64_t lo, std::int64_t hi, std::int64_t grain, const char* fn,
+                          const char* ctx, const char* combine, std::int64_t identity) {
+  if (fn == nullptr || hi <= lo) {
+    return identity;
+  }
+  HcParState state;
+  state.body = fn;
+  state.ctx = ctx;
+  state.combine = combine;
+  state.reduce = true;
+  RunParallel(&state, lo, hi, grain);
+
+  std::int64_t result = identity;
+  for (const HcParSlot& slot : state.slots) {
+    if (slot.used != 0) {
+      result = CombinePartial(&state, result, slot.value);
+    }
+  }
+  return result;
+}
+
+std::size_t hc_job_cpu_stats_snapshot(hc_job_cpu_stats* out, std::size_t capacity) {
+  const std::size_t count = g_job_worker_count.load(std::memory_order_acquire);
+  for (std::size_t i = 0; out != nullptr && i < count && i < capacity; ++i) {
+    const HcJobWorker& worker = g_job_workers[i];
+    out[i].cpu = worker.cpu;
+    out[i].queue_depth = worker.deque.depth.load(std::memory_order_relaxed) +
+                         worker.pinned.depth.load(std::memory_order_relaxed);
+    out[i].executed = worker.executed.load(std::memory_order_relaxed);
+    out[i].migrations = worker.migrations.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+void hc_runtime_stats_enable(std::int64_t enabled) {
+  if (enabled != 0) {
+    for (HcStatsThread* stats = g_stats_threads.load(std::memory_order_acquire); stats != nullptr;
+         stats = stats->next) {
+      for (std::size_t i = 0; i < kStatFieldCount; ++i) {
+        stats->baseline[i].store(stats->values[i].load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
       }
-      case 'f':
-      case 'F':
-      case 'e':
-      case 'E':
-      case 'g':
-      case 'G':
-        print_double(spec, unpack_double(next_arg()));
-        break;
-      default:
-        std::fwrite(format + spec_begin, 1, i - spec_begin, stdout);
-        break;
     }
+    g_stats_live_bytes.store(0, std::memory_order_relaxed);
+    g_stats_peak_bytes.store(0, std::memory_order_relaxed);
   }
+  g_stats_enabled.store(enabled != 0, std::memory_order_release);
 }
 
-void hc_try_push(hc_try_frame* frame) {
-  if (frame == nullptr) {
+void hc_runtime_stats(hc_runtime_counters* out) {
+  if (out == nullptr) {
     return;
   }
-  frame->prev = g_try_stack;
-  g_try_stack = frame;
+  std::int64_t totals[kStatFieldCount] = {};
+  std::int64_t threads = 0;
+  for (HcStatsThread* stats = g_stats_threads.load(std::memory_order_acquire); stats != nullptr;
+       stats = stats->next) {
+    for (std::size_t i = 0; i < kStatFieldCount; ++i) {
+      totals[i] += StatsValue(stats, i);
+    }
+    ++threads;
+  }
+  out->allocs = totals[kStatAllocs];
+  out->frees = totals[kStatFrees];
+  out->bytes_allocated = totals[kStatBytesAllocated];
+  out->bytes_freed = totals[kStatBytesFreed];
+  out->live_bytes = g_stats_live_bytes.load(std::memory_order_relaxed);
+  out->peak_bytes = g_stats_peak_bytes.load(std::memory_order_relaxed);
+  out->arena_allocs = totals[kStatArenaAllocs];
+  out->arena_bytes = totals[kStatArenaBytes];
+  for (std::size_t i = 0; i < HC_RUNTIME_STATS_SIZE_BUCKETS; ++i) {
+    out->size_buckets[i] = totals[kStatSizeBuckets + i];
+  }
+  out->jobs_run = totals[kStatJobsRun];
+  out->tasks_spawned = totals[kStatTasksSpawned];
+  out->exceptions_thrown = totals[kStatExceptionsThrown];
+  out->bytes_printed = totals[kStatBytesPrinted];
+  out->threads = threads;
 }
 
-void hc_try_pop(hc_try_frame* frame) {
-  if (frame == nullptr || g_try_stack == nullptr) {
-    return;
+std::size_t hc_runtime_thread_stats(hc_runtime_thread_counters* out, std::size_t capacity) {
+  std::size_t count = 0;
+  for (HcStatsThread* stats = g_stats_threads.load(std::memory_order_acquire); stats != nullptr;
+       stats = stats->next) {
+    if (out != nullptr && count < capacity) {
+      hc_runtime_thread_counters& row = out[count];
+      row.thread = stats->index;
+      row.allocs = StatsValue(stats, kStatAllocs);
+      row.frees = StatsValue(stats, kStatFrees);
+      row.bytes_allocated = StatsValue(stats, kStatBytesAllocated);
+      row.bytes_freed = StatsValue(stats, kStatBytesFreed);
+      row.arena_bytes = StatsValue(stats, kStatArenaBytes);
+      row.jobs_run = StatsValue(stats, kStatJobsRun);
+      row.tasks_spawned = StatsValue(stats, kStatTasksSpawned);
+      row.exceptions_thrown = StatsValue(stats, kStatExceptionsThrown);
+      row.bytes_printed = StatsValue(stats, kStatBytesPrinted);
+    }
+    ++count;
   }
-  if (g_try_stack == frame) {
-    g_try_stack = frame->prev;
+  return count;
+}
+
+void hc_runtime_stats_report(std::int64_t json) {
+  hc_runtime_counters totals{};
+  hc_runtime_stats(&totals);
+  std::vector<hc_runtime_thread_counters> threads(hc_runtime_thread_stats(nullptr, 0));
+  threads.resize(std::min(threads.size(), hc_runtime_thread_stats(threads.data(), threads.size())));
+  threads.erase(std::remove_if(threads.begin(), threads.end(),
+                               [](const hc_runtime_thread_counters& row) {
+                                 return row.allocs == 0 && row.frees == 0 &&
+                                        row.arena_bytes == 0 && row.jobs_run == 0 &&
+                                        row.tasks_spawned == 0 && row.exceptions_thrown == 0 &&
+                                        row.bytes_printed == 0;
+                               }),
+                threads.end());
+  std::sort(threads.begin(), threads.end(),
+            [](const hc_runtime_thread_counters& lhs, const hc_runtime_thread_counters& rhs) {
+              return lhs.thread < rhs.thread;
+            });
+  const std::pair<const char*, std::int64_t> fields[] = {
+      {"memory.allocs", totals.allocs},
+      {"memory.frees", totals.frees},
+      {"memory.bytes_allocated", totals.bytes_allocated},
+      {"memory.bytes_freed", totals.bytes_freed},
+      {"memory.live_bytes", totals.live_bytes},
+      {"memory.peak_bytes", totals.peak_bytes},
+      {"memory.leaked_blocks", totals.allocs - totals.frees},
+      {"memory.arena_allocs", totals.arena_allocs},
+      {"memory.arena_bytes", totals.arena_bytes},
+      {"jobs.run", totals.jobs_run},
+      {"tasks.spawned", totals.tasks_spawned},
+      {"exceptions.thrown", totals.exceptions_thrown},
+      {"output.bytes_printed", totals.bytes_printed},
+  };
+  char bucket[32];
+  if (json == 0) {
+    std::fprintf(stderr, "runtime stats\n");
+    for (const auto& field : fields) {
+      std::fprintf(stderr, "  %-24s %lld\n", field.first, static_cast<long long>(field.second));
+    }
+    for (std::size_t i = 0; i < HC_RUNTIME_STATS_SIZE_BUCKETS; ++i) {
+      if (totals.size_buckets[i] != 0) {
+        std::snprintf(bucket, sizeof(bucket), "memory.size.%s_%zu",
+                      i + 1 < HC_RUNTIME_STATS_SIZE_BUCKETS ? "le" : "gt",
+                      i + 1 < HC_RUNTIME_STATS_SIZE_BUCKETS ? std::size_t{16} << i
+                                                            : std::size_t{16} << (i - 1));
+        std::fprintf(stderr, "  %-24s %lld\n", bucket,
+                     static_cast<long long>(totals.size_buckets[i]));
+      }
+    }
+    for (const hc_runtime_thread_counters& row : threads) {
+      std::fprintf(stderr,
+                   "  thread %-17lld allocs=%lld frees=%lld bytes_allocated=%lld arena_bytes=%lld "
+                   "jobs=%lld tasks=%lld exceptions=%lld printed=%lld\n",
+                   static_cast<long long>(row.thread), static_cast<long long>(row.allocs),
+                   static_cast<long long>(row.frees), static_cast<long long>(row.bytes_allocated),
+                   static_cast<long long>(row.arena_bytes), static_cast<long long>(row.jobs_run),
+                   static_cast<long long>(row.tasks_spawned),
+                   static_cast<long long>(row.exceptions_thrown),
+                   static_cast<long long>(row.bytes_printed));
+    }
     return;
   }
+  std::fprintf(stderr, "{");
+  for (const auto& field : fields) {
+    std::fprintf(stderr, "\"%s\":%lld,", field.first, static_cast<long long>(field.second));
+  }
+  std::fprintf(stderr, "\"memory.size_classes\":{");
+  for (std::size_t i = 0; i < HC_RUNTIME_STATS_SIZE_BUCKETS; ++i) {
+    std::snprintf(bucket, sizeof(bucket), "%s_%zu",
+                  i + 1 < HC_RUNTIME_STATS_SIZE_BUCKETS ? "le" : "gt",
+                  i + 1 < HC_RUNTIME_STATS_SIZE_BUCKETS ? std::size_t{16} << i
+                                                        : std::size_t{16} << (i - 1));
+    std::fprintf(stderr, "%s\"%s\":%lld", i == 0 ? "" : ",", bucket,
+                 static_cast<long long>(totals.size_buckets[i]));
+  }
+  std::fprintf(stderr, "},\"threads\":[");
+  for (std::size_t i = 0; i < threads.size(); ++i) {
+    const hc_runtime_thread_counters& row = threads[i];
+    std::fprintf(stderr,
+                 "%s{\"thread\":%lld,\"allocs\":%lld,\"frees\":%lld,\"bytes_allocated\":%lld,"
+                 "\"bytes_freed\":%lld,\"arena_bytes\":%lld,\"jobs_run\":%lld,"
+                 "\"tasks_spawned\":%lld,\"exceptions_thrown\":%lld,\"bytes_printed\":%lld}",
+                 i == 0 ? "" : ",", static_cast<long long>(row.thread),
+                 static_cast<long long>(row.allocs), static_cast<long long>(row.frees),
+                 static_cast<long long>(row.bytes_allocated),
+                 static_cast<long long>(row.bytes_freed), static_cast<long long>(row.arena_bytes),
+                 static_cast<long long>(row.jobs_run), static_cast<long long>(row.tasks_spawned),
+                 static_cast<long long>(row.exceptions_thrown),
+                 static_cast<long long>(row.bytes_printed));
+  }
+  std::fprintf(stderr, "]}\n");
+}
 
-  hc_try_frame* prev = g_try_stack;
-  hc_try_frame* cur = g_try_stack->prev;
-  while (cur != nullptr) {
-    if (cur == frame) {
-      prev->prev = cur->prev;
-      return;
+CHashClass* HashFind(const char* name, const char* table, std::int64_t kind) {
+  (void)table;
+  (void)kind;
+  return FindClass(EnsureReflectionIndex(), name);
+}
+
+CMemberLst* MemberFind(const char* name, const CHashClass* klass) {
+  if (name == nullptr || klass == nullptr || klass->member_slots == nullptr) {
+    return nullptr;
+  }
+  const std::uint64_t hash = ReflectionHash(name);
+  for (std::uint64_t slot = hash & klass->member_mask;; slot = (slot + 1) & klass->member_mask) {
+    CMemberLst* member = klass->member_slots[slot];
+    if (member == nullptr) {
+      return nullptr;
+    }
+    if (member->hash == hash && std::strcmp(member->str, name) == 0) {
+      return member;
     }
-    prev = cur;
-    cur = cur->prev;
   }
 }
 
-[[noreturn]] void hc_throw_i64(std::int64_t payload) {
-  g_exception_payload = payload;
-  if (g_try_stack != nullptr) {
-    hc_try_frame* frame = g_try_stack;
-    g_try_stack = frame->prev;
-    longjmp(frame->env, 1);
-  }
+std::int64_t MemberMetaData(const char* key, const CMemberLst* member) {
+  const HcMemberMeta* meta = FindMemberMeta(key, member);
+  return meta != nullptr ? meta->value : 0;
+}
 
-  std::fprintf(stderr, "fatal runtime error: uncaught HolyC exception payload=%lld\n",
-               static_cast<long long>(payload));
-  std::abort();
+std::int64_t MemberMetaFind(const char* key, const CMemberLst* member) {
+  return static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(FindMemberMeta(key, member)));
 }
 
-std::int64_t hc_exception_payload() {
-  return g_exception_payload;
+std::int64_t ProcSpawn(const char* command, std::int64_t flags) {
+  if (command == nullptr || command[0] == '\0') {
+    return -1;
+  }
+  OutputFlushThread();
+  std::fflush(stdout);
+  HcProc* proc = AllocProc();
+  if (proc == nullptr) {
+    return -1;
+  }
+  proc->command = CopyCString(command);
+  if (proc->command == nullptr) {
+    ProcDel(static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(proc)));
+    return -1;
+  }
+  proc->flags = flags;
+  proc->status = -1;
+  proc->group = g_spawn_scope;
+  proc->done.count.store(1, std::memory_order_relaxed);
+  MarkSpawnStart(proc->group);
+  SubmitProc(proc);
+  return static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(proc));
 }
 
-std::int64_t hc_exception_active() {
-  return g_try_stack != nullptr ? 1 : 0;
+std::int64_t ProcWait(std::int64_t handle) {
+  HcProc* proc = ProcFromHandle(handle);
+  if (proc == nullptr) {
+    return -1;
+  }
+  JoinWaitGroup(&proc->done);
+  return proc->status;
 }
 
-std::int64_t hc_try_depth() {
-  std::int64_t depth = 0;
-  for (const hc_try_frame* cur = g_try_stack; cur != nullptr; cur = cur->prev) {
-    ++depth;
+bool ProcScan(std::int64_t handle, std::int64_t* status) {
+  HcProc* proc = ProcFromHandle(handle);
+  if (proc == nullptr || !WaitGroupDrained(&proc->done)) {
+    return false;
   }
-  return depth;
+  if (status != nullptr) {
+    *status = proc->status;
+  }
+  return true;
 }
 
-void hc_register_reflection_table(const hc_reflection_field* fields, std::size_t field_count) {
-  g_reflection_fields = fields;
-  g_reflection_field_count = field_count;
-  ClearReflectionCache();
+const char* ProcOut(std::int64_t handle, std::int64_t* len) {
+  HcProc* proc = ProcFromHandle(handle);
+  if (proc == nullptr) {
+    return nullptr;
+  }
+  (void)ProcWait(handle);
+  if (len != nullptr) {
+    *len = static_cast<std::int64_t>(proc->out.len);
+  }
+  return proc->out.data;
 }
 
-std::size_t hc_reflection_field_count() {
-  return g_reflection_field_count;
+const char* ProcErr(std::int64_t handle, std::int64_t* len) {
+  HcProc* proc = ProcFromHandle(handle);
+  if (proc == nullptr) {
+    return nullptr;
+  }
+  (void)ProcWait(handle);
+  if (len != nullptr) {
+    *len = static_cast<std::int64_t>(proc->err.len);
+  }
+  return proc->err.data;
 }
 
-const hc_reflection_field* hc_reflection_fields() {
-  return g_reflection_fields;
+void ProcDel(std::int64_t handle) {
+  HcProc* proc = ProcFromHandle(handle);
+  if (proc == nullptr) {
+    return;
+  }
+  if (proc->command != nullptr) {
+    (void)ProcWait(handle);
+  }
+  std::free(proc->command);
+  proc->command = nullptr;
+  ReleaseProcBuffer(&proc->out);
+  ReleaseProcBuffer(&proc->err);
+  pthread_mutex_lock(&g_proc_mutex);
+  proc->next = g_proc_free;
+  g_proc_free = proc;
+  pthread_mutex_unlock(&g_proc_mutex);
 }
 
-void* hc_malloc(std::size_t size) {
-  return std::malloc(size);
+// The returned handle is a process record owned by the caller, who
+// releases it with ProcDel once done with it.
+std::int64_t hc_task_spawn(const char* task_name) {
+  return ProcSpawn(task_name, 0);
 }
 
-void hc_free(void* ptr) {
-  std::free(ptr);
+void hc_lock_acquire(const void* addr) {
+  LockStripeAcquire(LockStripeFor(addr));
 }
 
-void* hc_memcpy(void* dst, const void* src, std::size_t size) {
-  return std::memcpy(dst, src, size);
+void hc_lock_release(const void* addr) {
+  LockStripeRelease(LockStripeFor(addr));
 }
 
-void* hc_memset(void* dst, int value, std::size_t size) {
-  return std::memset(dst, value, size);
+// Stripes are always taken in index order, so blocks over overlapping
+// variable sets exclude each other without deadlocking.
+void hc_lock_acquire_n(const void* const* addrs, std::int64_t count) {
+  std::uint64_t mask[kLockMaskWords];
+  LockStripeMask(addrs, count, mask);
+  for (std::size_t i = 0; i < kLockStripeCount; ++i) {
+    if ((mask[i / 64] >> (i % 64) & 1) != 0) {
+      LockStripeAcquire(&g_lock_stripes[i]);
+    }
+  }
 }
 
-std::int64_t CallStkGrow(std::int64_t stack_min, std::int64_t stack_max, const char* fn,
-                         std::int64_t a0, std::int64_t a1, std::int64_t a2) {
-  (void)stack_min;
-  (void)stack_max;
-  if (fn == nullptr) {
-    return 0;
+void hc_lock_release_n(const void* const* addrs, std::int64_t count) {
+  std::uint64_t mask[kLockMaskWords];
+  LockStripeMask(addrs, count, mask);
+  for (std::size_t i = kLockStripeCount; i-- > 0;) {
+    if ((mask[i / 64] >> (i % 64) & 1) != 0) {
+      LockStripeRelease(&g_lock_stripes[i]);
+    }
   }
-  using StkGrowFn = std::int64_t (*)(std::int64_t, std::int64_t, std::int64_t);
-  StkGrowFn callee = reinterpret_cast<StkGrowFn>(reinterpret_cast<std::uintptr_t>(fn));
-  return callee(a0, a1, a2);
 }
 
-CTask* Spawn(const char* fn, const char* data, const char* task_name, std::int64_t target_cpu,
-             CTask* parent, std::int64_t stk_size, std::int64_t flags) {
-  (void)task_name;
-  (void)target_cpu;
-  (void)parent;
-  (void)flags;
-  if (fn == nullptr) {
+CFifoI64* FifoI64New(std::int64_t size, CTask* mem_task, std::int64_t flags) {
+  (void)mem_task;
+  std::uint64_t capacity = 2;
+  while (capacity < kFifoCapacityMax && static_cast<std::int64_t>(capacity) < size) {
+    capacity <<= 1;
+  }
+  void* storage = nullptr;
+  if (posix_memalign(&storage, alignof(CFifoI64), sizeof(CFifoI64)) != 0) {
     return nullptr;
   }
-
-  HcSpawnRequest* req = static_cast<HcSpawnRequest*>(std::calloc(1, sizeof(HcSpawnRequest)));
-  if (req == nullptr) {
+  std::memset(storage, 0, sizeof(CFifoI64));
+  CFifoI64* fifo = static_cast<CFifoI64*>(storage);
+  fifo->cells = static_cast<HcFifoCell*>(std::calloc(capacity, sizeof(HcFifoCell)));
+  if (fifo->cells == nullptr) {
+    std::free(fifo);
     return nullptr;
   }
-  req->fn = fn;
-  req->data = data;
-
-  pthread_attr_t attr;
-  pthread_attr_t* attr_ptr = nullptr;
-  bool attr_initialized = false;
-  if (pthread_attr_init(&attr) == 0) {
-    attr_initialized = true;
-    const std::size_t normalized_stack_size = NormalizeStackSize(stk_size);
-    if (normalized_stack_size > 0 &&
-        pthread_attr_setstacksize(&attr, normalized_stack_size) != 0) {
-      pthread_attr_destroy(&attr);
-      std::free(req);
-      return nullptr;
-    }
-    attr_ptr = &attr;
+  for (std::uint64_t i = 0; i < capacity; ++i) {
+    fifo->cells[i].seq.store(i, std::memory_order_relaxed);
   }
+  fifo->mask = capacity - 1;
+  fifo->flags = flags;
+  return fifo;
+}
 
-  MarkSpawnStart();
-  pthread_t thread{};
-  const int rc = pthread_create(&thread, attr_ptr, SpawnThreadMain, req);
-  if (attr_initialized) {
-    pthread_attr_destroy(&attr);
+void FifoI64Del(CFifoI64* fifo) {
+  if (fifo == nullptr) {
+    return;
   }
-  if (rc != 0) {
-    std::free(req);
-    MarkSpawnDone();
-    return nullptr;
+  std::free(fifo->cells);
+  std::free(fifo);
+}
+
+bool FifoI64Ins(CFifoI64* fifo, std::int64_t q) {
+  if (!FifoTryIns(fifo, q)) {
+    return false;
   }
-  pthread_detach(thread);
+  FifoNotify(fifo);
+  return true;
+}
 
-  const std::uintptr_t task_id = static_cast<std::uintptr_t>(
-      g_next_task_id.fetch_add(1, std::memory_order_relaxed));
-  return reinterpret_cast<CTask*>(task_id);
+bool FifoI64Rem(CFifoI64* fifo, std::int64_t* q) {
+  std::int64_t value = 0;
+  if (!FifoTryRem(fifo, &value)) {
+    return false;
+  }
+  FifoNotify(fifo);
+  if (q != nullptr) {
+    *q = value;
+  }
+  return true;
 }
 
-CJob* JobQue(const char* fn, const char* arg, std::int64_t cpu, std::int64_t flags) {
-  (void)cpu;
-  (void)flags;
-  CJob* job = static_cast<CJob*>(std::calloc(1, sizeof(CJob)));
-  if (job == nullptr) {
-    return nullptr;
+bool FifoI64Peek(CFifoI64* fifo, std::int64_t* q) {
+  std::int64_t value = 0;
+  if (!FifoTryPeek(fifo, &value)) {
+    return false;
   }
-  job->fn = fn;
-  job->arg = static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(arg));
-  job->result = 0;
-  job->joined = 0;
+  if (q != nullptr) {
+    *q = value;
+  }
+  return true;
+}
 
-  if (pthread_create(&job->thread, nullptr, JobThreadMain, job) != 0) {
-    std::free(job);
-    return nullptr;
+void FifoI64Flush(CFifoI64* fifo) {
+  std::int64_t value = 0;
+  bool removed = false;
+  while (FifoTryRem(fifo, &value)) {
+    removed = true;
+  }
+  if (removed) {
+    FifoNotify(fifo);
   }
-  return job;
 }
 
-std::int64_t JobResGet(CJob* job) {
-  if (job == nullptr) {
+std::int64_t FifoI64Cnt(CFifoI64* fifo) {
+  const std::uint64_t out = fifo->out.load(std::memory_order_acquire);
+  const std::uint64_t in = fifo->in.load(std::memory_order_acquire);
+  if (in <= out) {
     return 0;
   }
-  if (!job->joined) {
-    pthread_join(job->thread, nullptr);
-    job->joined = 1;
+  const std::uint64_t claimed = std::min(in - out, fifo->mask + 1);
+  if (FifoSpsc(fifo)) {
+    return static_cast<std::int64_t>(claimed);
   }
-  const std::int64_t result = job->result;
-  std::free(job);
-  return result;
+  // MPMC producers claim a slot before they publish it. Only count the
+  // published run a remover could take now, not slots still being written.
+  std::uint64_t published = 0;
+  while (published < claimed &&
+         fifo->cells[(out + published) & fifo->mask].seq.load(std::memory_order_acquire) ==
+             out + published + 1) {
+    ++published;
+  }
+  return static_cast<std::int64_t>(published);
 }
 
-CHashClass* HashFind(const char* name, const char* table, std::int64_t kind) {
-  (void)table;
-  (void)kind;
-  EnsureReflectionCache();
-  return FindClassByName(name);
+void FifoI64InsWait(CFifoI64* fifo, std::int64_t q) {
+  while (!FifoTryIns(fifo, q)) {
+    FifoBlock(fifo, FifoWritable);
+  }
+  FifoNotify(fifo);
 }
 
-std::int64_t MemberMetaData(const char* key, const CMemberLst* member) {
-  if (key == nullptr || member == nullptr) {
-    return 0;
+std::int64_t FifoI64RemWait(CFifoI64* fifo) {
+  std::int64_t value = 0;
+  while (!FifoTryRem(fifo, &value)) {
+    FifoBlock(fifo, FifoReadable);
   }
-  for (const HcMemberMeta* meta = member->meta; meta != nullptr; meta = meta->next) {
-    if (meta->key != nullptr && std::strcmp(meta->key, key) == 0) {
-      return meta->value;
-    }
+  FifoNotify(fifo);
+  return value;
+}
+
+CFifoU8* FifoU8New(std::int64_t size, CTask* mem_task, std::int64_t flags) {
+  return reinterpret_cast<CFifoU8*>(FifoI64New(size, mem_task, flags));
+}
+
+void FifoU8Del(CFifoU8* fifo) {
+  FifoI64Del(reinterpret_cast<CFifoI64*>(fifo));
+}
+
+bool FifoU8Ins(CFifoU8* fifo, std::int64_t b) {
+  return FifoI64Ins(&fifo->ring, b & 0xff);
+}
+
+bool FifoU8Rem(CFifoU8* fifo, std::uint8_t* b) {
+  std::int64_t value = 0;
+  if (!FifoI64Rem(&fifo->ring, &value)) {
+    return false;
   }
-  return 0;
+  if (b != nullptr) {
+    *b = static_cast<std::uint8_t>(value);
+  }
+  return true;
 }
 
-std::int64_t MemberMetaFind(const char* key, const CMemberLst* member) {
-  if (key == nullptr || member == nullptr) {
-    return 0;
+bool FifoU8Peek(CFifoU8* fifo, std::uint8_t* b) {
+  std::int64_t value = 0;
+  if (!FifoI64Peek(&fifo->ring, &value)) {
+    return false;
   }
-  for (const HcMemberMeta* meta = member->meta; meta != nullptr; meta = meta->next) {
-    if (meta->key != nullptr && std::strcmp(meta->key, key) == 0) {
-      return static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(meta));
-    }
+  if (b != nullptr) {
+    *b = static_cast<std::uint8_t>(value);
   }
-  return 0;
+  return true;
 }
 
-std::int64_t hc_task_spawn(const char* task_name) {
-  if (task_name == nullptr || task_name[0] == '\0') {
-    return -1;
+void FifoU8Flush(CFifoU8* fifo) {
+  FifoI64Flush(&fifo->ring);
+}
+
+std::int64_t FifoU8Cnt(CFifoU8* fifo) {
+  return FifoI64Cnt(&fifo->ring);
+}
+
+void FifoU8InsWait(CFifoU8* fifo, std::int64_t b) {
+  FifoI64InsWait(&fifo->ring, b & 0xff);
+}
+
+std::int64_t FifoU8RemWait(CFifoU8* fifo) {
+  return FifoI64RemWait(&fifo->ring);
+}
+
+void* MAlloc(std::int64_t size, CTask* mem_task) {
+  if (size < 0) {
+    return nullptr;
   }
+  const std::uintptr_t handle = reinterpret_cast<std::uintptr_t>(mem_task);
+  if (mem_task == nullptr) {
+    return hc_malloc(static_cast<std::size_t>(size));
+  }
+  if ((handle & kSpawnHandleTag) == 0) {
+    return ArenaAlloc(reinterpret_cast<HcArenaScope*>(mem_task), static_cast<std::size_t>(size));
+  }
+  // A spawn handle allocates from its task's arena while the task runs and
+  // yields NULL once it has finished. The registry lock stays held so the
+  // task cannot release the arena under this allocation.
+  const std::int64_t task_id = static_cast<std::int64_t>(handle >> 1);
+  void* out = nullptr;
+  pthread_mutex_lock(&g_spawn_arenas_mutex);
+  const auto it = g_spawn_arenas.find(task_id);
+  if (it != g_spawn_arenas.end()) {
+    out = ArenaAlloc(it->second, static_cast<std::size_t>(size));
+  }
+  pthread_mutex_unlock(&g_spawn_arenas_mutex);
+  return out;
+}
 
-  char* command_copy = CopyCString(task_name);
-  if (command_copy == nullptr) {
-    return -1;
+void* CAlloc(std::int64_t size, CTask* mem_task) {
+  void* out = MAlloc(size, mem_task);
+  if (out != nullptr) {
+    std::memset(out, 0, static_cast<std::size_t>(size));
   }
+  return out;
+}
 
-  const CTask* task = Spawn(
-      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&TaskSpawnCommandEntry)),
-      command_copy, task_name, -1, nullptr, 0, 0);
-  if (task == nullptr) {
-    std::free(command_copy);
-    return -1;
+void Free(void* addr) {
+  if (addr == nullptr || ArenaOwnsBlock(addr)) {
+    return;
   }
-  return static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(task));
+  hc_free(addr);
+}
+
+CTask* TaskCur() {
+  return reinterpret_cast<CTask*>(g_arena_current);
 }
 
 void hc_spawn_wait_all() {
-  pthread_mutex_lock(&g_spawn_mutex);
-  while (g_spawn_inflight > 0) {
-    pthread_cond_wait(&g_spawn_cond, &g_spawn_mutex);
+  do {
+    HelpJobsUntil(JobsDrained, nullptr);
+    JoinWaitGroup(&g_spawn_all);
+  } while (g_job_inflight.load(std::memory_order_seq_cst) > 0);
+  OutputFlushThread();
+}
+
+CSpawnGrp* SpawnGrpBegin() {
+  pthread_mutex_lock(&g_spawn_grp_mutex);
+  CSpawnGrp* group = g_spawn_grp_free;
+  if (group != nullptr) {
+    g_spawn_grp_free = group->next_free;
+  }
+  pthread_mutex_unlock(&g_spawn_grp_mutex);
+  if (group == nullptr) {
+    group = static_cast<CSpawnGrp*>(std::calloc(1, sizeof(CSpawnGrp)));
+    if (group == nullptr) {
+      return nullptr;
+    }
+  }
+  group->wait.count.store(0, std::memory_order_relaxed);
+  group->next_free = nullptr;
+  group->outer = SwapSpawnScope(group);
+  return group;
+}
+
+void SpawnGrpWait(CSpawnGrp* group) {
+  if (group == nullptr) {
+    return;
   }
-  pthread_mutex_unlock(&g_spawn_mutex);
+  JoinWaitGroup(&group->wait);
+  EndSpawnScope(group);
+  pthread_mutex_lock(&g_spawn_grp_mutex);
+  group->next_free = g_spawn_grp_free;
+  g_spawn_grp_free = group;
+  pthread_mutex_unlock(&g_spawn_grp_mutex);
+}
+
+std::int64_t SpawnGrpCnt(CSpawnGrp* group) {
+  const HcWaitGroup* wait = group != nullptr ? &group->wait : &g_spawn_all;
+  return wait->count.load(std::memory_order_acquire);
 }
 
 }  // extern "C"
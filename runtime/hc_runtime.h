@@ -3,10 +3,20 @@
 #include <cstddef>
 #include <cstdint>
 #include <setjmp.h>
+#include <unwind.h>
 
-#define HC_RUNTIME_ABI_VERSION_MAJOR 1
+#define HC_RUNTIME_ABI_VERSION_MAJOR 3
 #define HC_RUNTIME_ABI_VERSION_MINOR 0
 
+#define HC_FMT_LEFT 1
+#define HC_FMT_PLUS 2
+#define HC_FMT_SPACE 4
+#define HC_FMT_ALT 8
+#define HC_FMT_ZERO 16
+#define HC_FMT_UPPER 32
+
+#define HC_RUNTIME_STATS_SIZE_BUCKETS 16
+
 extern "C" {
 
 std::int64_t hc_runtime_abi_version();
@@ -14,27 +24,60 @@ std::int64_t hc_runtime_abi_version();
 void hc_print_str(const char* text);
 void hc_put_char(std::int64_t ch);
 void hc_print_fmt(const char* format, const std::int64_t* args, std::size_t arg_count);
+void hc_output_flush();
+void hc_fmt_write(const char* text, std::size_t len);
+void hc_fmt_i64_dec(std::int64_t width, std::int64_t flags, std::int64_t value);
+void hc_fmt_u64(std::int64_t radix, std::int64_t width, std::int64_t flags, std::int64_t value);
+void hc_fmt_char(std::int64_t width, std::int64_t flags, std::int64_t ch);
+void hc_fmt_str(std::int64_t width, std::int64_t flags, std::int64_t precision, const char* text);
+void hc_fmt_f64(std::int64_t precision, std::int64_t bits);
 
+// Cleanup frames (lock blocks, CallStkGrow segments) only release state and
+// raise the exception again, so hc_try_depth does not count them.
 typedef struct hc_try_frame {
   jmp_buf env;
   struct hc_try_frame* prev;
+  std::int64_t cleanup;
 } hc_try_frame;
 
+// Table-mode landing pads catch one of these, so hc_try_depth can read how
+// many try regions of that function enclose a call from its unwind tables.
+#define HC_TRY_DEPTH_MAGIC 0x48435452594450ULL
+
+typedef struct hc_try_depth_marker {
+  std::uint64_t magic;
+  std::int64_t depth;
+} hc_try_depth_marker;
+
 void hc_try_push(hc_try_frame* frame);
+void hc_try_push_cleanup(hc_try_frame* frame);
 void hc_try_pop(hc_try_frame* frame);
 [[noreturn]] void hc_throw_i64(std::int64_t payload);
 std::int64_t hc_exception_payload();
 std::int64_t hc_exception_active();
 std::int64_t hc_try_depth();
+_Unwind_Reason_Code hc_personality_v0(int version, _Unwind_Action actions,
+                                      _Unwind_Exception_Class exception_class,
+                                      _Unwind_Exception* exception, _Unwind_Context* context);
+
+typedef struct hc_reflection_meta {
+  const char* key;
+  std::int64_t value;
+} hc_reflection_meta;
 
 typedef struct hc_reflection_field {
   const char* aggregate_name;
   const char* field_name;
   const char* field_type;
   const char* annotations;
+  std::int64_t offset;
+  std::int64_t size;
+  const hc_reflection_meta* meta;
+  std::int64_t meta_count;
 } hc_reflection_field;
 
 void hc_register_reflection_table(const hc_reflection_field* fields, std::size_t field_count);
+void hc_reflection_reset();
 std::size_t hc_reflection_field_count();
 const hc_reflection_field* hc_reflection_fields();
 
@@ -42,9 +85,18 @@ void* hc_malloc(std::size_t size);
 void hc_free(void* ptr);
 void* hc_memcpy(void* dst, const void* src, std::size_t size);
 void* hc_memset(void* dst, int value, std::size_t size);
+void hc_lock_acquire(const void* addr);
+void hc_lock_release(const void* addr);
+// Takes the stripes of every address in addrs; a count of zero takes all
+// stripes.
+void hc_lock_acquire_n(const void* const* addrs, std::int64_t count);
+void hc_lock_release_n(const void* const* addrs, std::int64_t count);
 
 typedef struct CJob CJob;
 typedef struct CTask CTask;
+typedef struct CSpawnGrp CSpawnGrp;
+typedef struct CFifoI64 CFifoI64;
+typedef struct CFifoU8 CFifoU8;
 typedef struct CHashClass CHashClass;
 typedef struct CMemberLst CMemberLst;
 
@@ -52,12 +104,96 @@ std::int64_t CallStkGrow(std::int64_t stack_min, std::int64_t stack_max, const c
                          std::int64_t a0, std::int64_t a1, std::int64_t a2);
 CTask* Spawn(const char* fn, const char* data, const char* task_name, std::int64_t target_cpu,
              CTask* parent, std::int64_t stk_size, std::int64_t flags);
+void Yield();
+void Sleep(std::int64_t ms);
+CSpawnGrp* SpawnGrpBegin();
+void SpawnGrpWait(CSpawnGrp* group);
+std::int64_t SpawnGrpCnt(CSpawnGrp* group);
 CJob* JobQue(const char* fn, const char* arg, std::int64_t cpu, std::int64_t flags);
 std::int64_t JobResGet(CJob* job);
+bool JobResScan(CJob* job, std::int64_t* res);
+std::int64_t JobResAny(CJob** jobs, std::int64_t count, std::int64_t* res);
+CJob* JobThen(CJob* job, const char* fn);
+void JobParFor(std::int64_t lo, std::int64_t hi, std::int64_t grain, const char* fn,
+               const char* ctx);
+std::int64_t JobParReduce(std::int64_t lo, std::int64_t hi, std::int64_t grain, const char* fn,
+                          const char* ctx, const char* combine, std::int64_t identity);
 CHashClass* HashFind(const char* name, const char* table, std::int64_t kind);
+CMemberLst* MemberFind(const char* name, const CHashClass* klass);
 std::int64_t MemberMetaData(const char* key, const CMemberLst* member);
 std::int64_t MemberMetaFind(const char* key, const CMemberLst* member);
+typedef struct hc_job_cpu_stats {
+  std::int64_t cpu;
+  std::int64_t queue_depth;
+  std::int64_t executed;
+  std::int64_t migrations;
+} hc_job_cpu_stats;
+
+std::size_t hc_job_cpu_stats_snapshot(hc_job_cpu_stats* out, std::size_t capacity);
+
+typedef struct hc_runtime_counters {
+  std::int64_t allocs;
+  std::int64_t frees;
+  std::int64_t bytes_allocated;
+  std::int64_t bytes_freed;
+  std::int64_t live_bytes;
+  std::int64_t peak_bytes;
+  std::int64_t arena_allocs;
+  std::int64_t arena_bytes;
+  std::int64_t size_buckets[HC_RUNTIME_STATS_SIZE_BUCKETS];
+  std::int64_t jobs_run;
+  std::int64_t tasks_spawned;
+  std::int64_t exceptions_thrown;
+  std::int64_t bytes_printed;
+  std::int64_t threads;
+} hc_runtime_counters;
+
+typedef struct hc_runtime_thread_counters {
+  std::int64_t thread;
+  std::int64_t allocs;
+  std::int64_t frees;
+  std::int64_t bytes_allocated;
+  std::int64_t bytes_freed;
+  std::int64_t arena_bytes;
+  std::int64_t jobs_run;
+  std::int64_t tasks_spawned;
+  std::int64_t exceptions_thrown;
+  std::int64_t bytes_printed;
+} hc_runtime_thread_counters;
+
+void hc_runtime_stats_enable(std::int64_t enabled);
+void hc_runtime_stats(hc_runtime_counters* out);
+std::size_t hc_runtime_thread_stats(hc_runtime_thread_counters* out, std::size_t capacity);
+void hc_runtime_stats_report(std::int64_t json);
+std::int64_t ProcSpawn(const char* command, std::int64_t flags);
+std::int64_t ProcWait(std::int64_t proc);
+bool ProcScan(std::int64_t proc, std::int64_t* status);
+const char* ProcOut(std::int64_t proc, std::int64_t* len);
+const char* ProcErr(std::int64_t proc, std::int64_t* len);
+void ProcDel(std::int64_t proc);
 std::int64_t hc_task_spawn(const char* task_name);
+CFifoI64* FifoI64New(std::int64_t size, CTask* mem_task, std::int64_t flags);
+void FifoI64Del(CFifoI64* fifo);
+bool FifoI64Ins(CFifoI64* fifo, std::int64_t q);
+bool FifoI64Rem(CFifoI64* fifo, std::int64_t* q);
+bool FifoI64Peek(CFifoI64* fifo, std::int64_t* q);
+void FifoI64Flush(CFifoI64* fifo);
+std::int64_t FifoI64Cnt(CFifoI64* fifo);
+void FifoI64InsWait(CFifoI64* fifo, std::int64_t q);
+std::int64_t FifoI64RemWait(CFifoI64* fifo);
+CFifoU8* FifoU8New(std::int64_t size, CTask* mem_task, std::int64_t flags);
+void FifoU8Del(CFifoU8* fifo);
+bool FifoU8Ins(CFifoU8* fifo, std::int64_t b);
+bool FifoU8Rem(CFifoU8* fifo, std::uint8_t* b);
+bool FifoU8Peek(CFifoU8* fifo, std::uint8_t* b);
+void FifoU8Flush(CFifoU8* fifo);
+std::int64_t FifoU8Cnt(CFifoU8* fifo);
+void FifoU8InsWait(CFifoU8* fifo, std::int64_t b);
+std::int64_t FifoU8RemWait(CFifoU8* fifo);
+void* MAlloc(std::int64_t size, CTask* mem_task);
+void* CAlloc(std::int64_t size, CTask* mem_task);
+void Free(void* addr);
+CTask* TaskCur();
 void hc_spawn_wait_all();
 
 }
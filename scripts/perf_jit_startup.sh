@@ -0,0 +1,240 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+usage() {
+  cat >&2 <<'EOF'
+usage: perf_jit_startup.sh <holyc-bin> [options]
+
+Generates HolyC programs with many functions, of which Main calls only a
+few, and compares `holyc jit` wall time in eager mode and with --jit-lazy.
+
+Options:
+  --functions <list>        Comma-separated function counts (default: 100,1000,5000)
+  --called <count>          Functions actually called from Main (default: 10)
+  --opt-level <level>       --opt-level passed to holyc jit (default: 2)
+  --out-md <path>           Markdown summary path (default: .holyc-artifacts/perf-jit-startup.md)
+  --runs <count>            Timed runs per mode (default: 5)
+  -h, --help                Show this help.
+EOF
+}
+
+HOLYC_BIN=""
+FUNCTIONS="100,1000,5000"
+CALLED="10"
+OPT_LEVEL="2"
+OUT_MD=".holyc-artifacts/perf-jit-startup.md"
+RUNS="5"
+
+while [[ $# -gt 0 ]]; do
+  case "$1" in
+    -h|--help)
+      usage
+      exit 0
+      ;;
+    --functions)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --functions requires a value" >&2
+        exit 2
+      fi
+      FUNCTIONS="$2"
+      shift 2
+      ;;
+    --functions=*)
+      FUNCTIONS="${1#*=}"
+      shift
+      ;;
+    --called)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --called requires a value" >&2
+        exit 2
+      fi
+      CALLED="$2"
+      shift 2
+      ;;
+    --called=*)
+      CALLED="${1#*=}"
+      shift
+      ;;
+    --opt-level)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --opt-level requires a value" >&2
+        exit 2
+      fi
+      OPT_LEVEL="$2"
+      shift 2
+      ;;
+    --opt-level=*)
+      OPT_LEVEL="${1#*=}"
+      shift
+      ;;
+    --out-md)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --out-md requires a value" >&2
+        exit 2
+      fi
+      OUT_MD="$2"
+      shift 2
+      ;;
+    --out-md=*)
+      OUT_MD="${1#*=}"
+      shift
+      ;;
+    --runs)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --runs requires a value" >&2
+        exit 2
+      fi
+      RUNS="$2"
+      shift 2
+      ;;
+    --runs=*)
+      RUNS="${1#*=}"
+      shift
+      ;;
+    -*)
+      echo "error: unknown option: $1" >&2
+      usage
+      exit 2
+      ;;
+    *)
+      if [[ -z "${HOLYC_BIN}" ]]; then
+        HOLYC_BIN="$1"
+      else
+        echo "error: unexpected argument: $1" >&2
+        usage
+        exit 2
+      fi
+      shift
+      ;;
+  esac
+done
+
+if [[ -z "${HOLYC_BIN}" ]]; then
+  usage
+  exit 2
+fi
+if ! [[ "${FUNCTIONS}" =~ ^[1-9][0-9]*(,[1-9][0-9]*)*$ ]]; then
+  echo "error: --functions must be a comma-separated list of positive integers" >&2
+  exit 2
+fi
+if ! [[ "${CALLED}" =~ ^[1-9][0-9]*$ ]]; then
+  echo "error: --called must be a positive integer" >&2
+  exit 2
+fi
+if ! [[ "${OPT_LEVEL}" =~ ^(0|1|2|3|s|z)$ ]]; then
+  echo "error: --opt-level must be one of: 0, 1, 2, 3, s, z" >&2
+  exit 2
+fi
+if ! [[ "${RUNS}" =~ ^[1-9][0-9]*$ ]]; then
+  echo "error: --runs must be a positive integer" >&2
+  exit 2
+fi
+if ! command -v python3 >/dev/null 2>&1; then
+  echo "error: python3 is required" >&2
+  exit 2
+fi
+
+mkdir -p "$(dirname "${OUT_MD}")"
+
+TEMP_DIR="$(mktemp -d)"
+cleanup() {
+  rm -rf "${TEMP_DIR}"
+}
+trap cleanup EXIT
+
+python3 - "${HOLYC_BIN}" "${FUNCTIONS}" "${CALLED}" "${OPT_LEVEL}" "${OUT_MD}" "${RUNS}" "${TEMP_DIR}" <<'PY'
+import datetime
+import pathlib
+import statistics
+import subprocess
+import sys
+import time
+
+holyc_bin, functions, called, opt_level, out_md, runs, temp_dir = sys.argv[1:]
+counts = [int(value) for value in functions.split(",")]
+called = int(called)
+runs = int(runs)
+temp = pathlib.Path(temp_dir)
+modes = [("eager", []), ("lazy", ["--jit-lazy"])]
+
+
+def generate(count):
+    parts = []
+    for i in range(count):
+        parts.append(
+            f"I64 Fn{i}(I64 x)\n"
+            "{\n"
+            f"  I64 acc={i};\n"
+            "  I64 j=0;\n"
+            "  while (j<x) {\n"
+            "    if (j&1)\n"
+            "      acc=acc*31+j;\n"
+            "    else\n"
+            "      acc=acc^(j<<3);\n"
+            "    j++;\n"
+            "  }\n"
+            "  return acc;\n"
+            "}\n"
+        )
+    calls = "".join(f"  total+=Fn{i}({i % 7 + 1});\n" for i in range(min(called, count)))
+    parts.append("I64 Main()\n{\n  I64 total=0;\n" + calls + "  return total&127;\n}\n")
+    path = temp / f"startup_{count}.HC"
+    path.write_text("\n".join(parts), encoding="utf-8")
+    return path
+
+
+def measure(src, extra):
+    cmd = [holyc_bin, "jit", str(src), f"--opt-level={opt_level}"] + extra
+    samples = []
+    output = None
+    for _ in range(runs):
+        start = time.perf_counter()
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+        samples.append(time.perf_counter() - start)
+        if proc.returncode != 0:
+            reason = (proc.stderr.strip().splitlines() or ["jit failed"])[-1]
+            return None, reason
+        output = proc.stdout
+    return (statistics.median(samples) * 1e3, output), ""
+
+
+rows = []
+failures = []
+for count in counts:
+    src = generate(count)
+    row = {"count": count}
+    for label, extra in modes:
+        result, reason = measure(src, extra)
+        row[label] = result
+        if result is None:
+            failures.append(f"- {count} functions ({label}): {reason}")
+    if row["eager"] is not None and row["lazy"] is not None and row["eager"][1] != row["lazy"][1]:
+        failures.append(f"- {count} functions: eager and lazy output differ")
+    rows.append(row)
+
+generated_at = datetime.datetime.now(datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+lines = [
+    "# JIT Startup (eager vs --jit-lazy)",
+    "",
+    f"Generated by scripts/perf_jit_startup.sh on {generated_at}.",
+    "",
+    f"Main calls {called} functions. Opt level: {opt_level}. "
+    f"Times are the median wall time of {runs} `holyc jit` runs.",
+    "",
+    "| Functions | Eager (ms) | Lazy (ms) | Speedup |",
+    "| ---: | ---: | ---: | ---: |",
+]
+for row in rows:
+    eager = row["eager"]
+    lazy = row["lazy"]
+    if eager is None or lazy is None:
+        lines.append(f"| {row['count']} | - | - | - |")
+        continue
+    speedup = eager[0] / lazy[0] if lazy[0] > 0 else 0.0
+    lines.append(f"| {row['count']} | {eager[0]:.3f} | {lazy[0]:.3f} | {speedup:.2f}x |")
+if failures:
+    lines += ["", "Failures:", ""] + failures
+
+pathlib.Path(out_md).write_text("\n".join(lines) + "\n", encoding="utf-8")
+print(f"wrote {out_md}")
+PY
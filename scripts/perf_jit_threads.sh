@@ -0,0 +1,322 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+usage() {
+  cat >&2 <<'EOF'
+usage: perf_jit_threads.sh <holyc-bin> [options]
+
+Generates a HolyC program with many independent functions and compares the
+`holyc jit` compile time for each --jit-threads value. The first thread
+count is the baseline for the speedup column.
+
+A second build of the same program also runs a hot loop over small leaf
+functions. Its extra jit-exec time is the run time, which shows what calls
+between partitions cost once they can no longer be inlined.
+
+Options:
+  --functions <count>       Functions in the generated program (default: 5000)
+  --threads <list>          Comma-separated --jit-threads values (default: 0,2,4,8)
+  --opt-level <level>       --opt-level passed to holyc jit (default: 2)
+  --out-md <path>           Markdown summary path (default: .holyc-artifacts/perf-jit-threads.md)
+  --runs <count>            Timed runs per thread count (default: 3)
+  --rounds <count>          Hot-loop iterations in the run build (default: 200000)
+  -h, --help                Show this help.
+EOF
+}
+
+HOLYC_BIN=""
+FUNCTIONS="5000"
+THREADS="0,2,4,8"
+OPT_LEVEL="2"
+OUT_MD=".holyc-artifacts/perf-jit-threads.md"
+RUNS="3"
+ROUNDS="200000"
+
+while [[ $# -gt 0 ]]; do
+  case "$1" in
+    -h|--help)
+      usage
+      exit 0
+      ;;
+    --functions)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --functions requires a value" >&2
+        exit 2
+      fi
+      FUNCTIONS="$2"
+      shift 2
+      ;;
+    --functions=*)
+      FUNCTIONS="${1#*=}"
+      shift
+      ;;
+    --threads)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --threads requires a value" >&2
+        exit 2
+      fi
+      THREADS="$2"
+      shift 2
+      ;;
+    --threads=*)
+      THREADS="${1#*=}"
+      shift
+      ;;
+    --opt-level)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --opt-level requires a value" >&2
+        exit 2
+      fi
+      OPT_LEVEL="$2"
+      shift 2
+      ;;
+    --opt-level=*)
+      OPT_LEVEL="${1#*=}"
+      shift
+      ;;
+    --out-md)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --out-md requires a value" >&2
+        exit 2
+      fi
+      OUT_MD="$2"
+      shift 2
+      ;;
+    --out-md=*)
+      OUT_MD="${1#*=}"
+      shift
+      ;;
+    --runs)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --runs requires a value" >&2
+        exit 2
+      fi
+      RUNS="$2"
+      shift 2
+      ;;
+    --runs=*)
+      RUNS="${1#*=}"
+      shift
+      ;;
+    --rounds)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --rounds requires a value" >&2
+        exit 2
+      fi
+      ROUNDS="$2"
+      shift 2
+      ;;
+    --rounds=*)
+      ROUNDS="${1#*=}"
+      shift
+      ;;
+    -*)
+      echo "error: unknown option: $1" >&2
+      usage
+      exit 2
+      ;;
+    *)
+      if [[ -z "${HOLYC_BIN}" ]]; then
+        HOLYC_BIN="$1"
+      else
+        echo "error: unexpected argument: $1" >&2
+        usage
+        exit 2
+      fi
+      shift
+      ;;
+  esac
+done
+
+if [[ -z "${HOLYC_BIN}" ]]; then
+  usage
+  exit 2
+fi
+if ! [[ "${FUNCTIONS}" =~ ^[1-9][0-9]*$ ]]; then
+  echo "error: --functions must be a positive integer" >&2
+  exit 2
+fi
+if ! [[ "${THREADS}" =~ ^[0-9]+(,[0-9]+)*$ ]]; then
+  echo "error: --threads must be a comma-separated list of non-negative integers" >&2
+  exit 2
+fi
+if ! [[ "${OPT_LEVEL}" =~ ^(0|1|2|3|s|z)$ ]]; then
+  echo "error: --opt-level must be one of: 0, 1, 2, 3, s, z" >&2
+  exit 2
+fi
+if ! [[ "${RUNS}" =~ ^[1-9][0-9]*$ ]]; then
+  echo "error: --runs must be a positive integer" >&2
+  exit 2
+fi
+if ! [[ "${ROUNDS}" =~ ^[1-9][0-9]*$ ]]; then
+  echo "error: --rounds must be a positive integer" >&2
+  exit 2
+fi
+if ! command -v python3 >/dev/null 2>&1; then
+  echo "error: python3 is required" >&2
+  exit 2
+fi
+
+mkdir -p "$(dirname "${OUT_MD}")"
+
+TEMP_DIR="$(mktemp -d)"
+cleanup() {
+  rm -rf "${TEMP_DIR}"
+}
+trap cleanup EXIT
+
+python3 - "${HOLYC_BIN}" "${FUNCTIONS}" "${THREADS}" "${OPT_LEVEL}" "${OUT_MD}" "${RUNS}" "${ROUNDS}" "${TEMP_DIR}" <<'PY'
+import datetime
+import os
+import pathlib
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+holyc_bin, functions, threads, opt_level, out_md, runs, rounds, temp_dir = sys.argv[1:]
+count = int(functions)
+thread_counts = [int(value) for value in threads.split(",")]
+runs = int(runs)
+rounds = int(rounds)
+leaf_count = 64
+temp = pathlib.Path(temp_dir)
+jit_exec_re = re.compile(r"^\s+jit-exec\s+([0-9.]+) s$", re.MULTILINE)
+
+
+def generate(name, loop_rounds):
+    parts = []
+    for i in range(count):
+        parts.append(
+            f"I64 Fn{i}(I64 x)\n"
+            "{\n"
+            f"  I64 acc={i};\n"
+            "  I64 j=0;\n"
+            "  while (j<x) {\n"
+            "    if (j&1)\n"
+            "      acc=acc*31+j;\n"
+            "    else\n"
+            "      acc=acc^(j<<3);\n"
+            "    j++;\n"
+            "  }\n"
+            "  return acc;\n"
+            "}\n"
+        )
+    for i in range(leaf_count):
+        parts.append(f"I64 Leaf{i}(I64 x)\n{{\n  return x*{i % 13 + 3}+{i};\n}}\n")
+    # A global keeps the loop bound opaque, so both builds compile the same code.
+    parts.append(f"I64 rounds={loop_rounds};\n")
+    calls = "".join(f"  total+=Fn{i}({i % 7 + 1});\n" for i in range(count))
+    leaf_calls = "".join(f"    total+=Leaf{i}(r);\n" for i in range(leaf_count))
+    parts.append(
+        "I64 Main()\n{\n  I64 total=0;\n  I64 r;\n"
+        + calls
+        + "  for (r=0;r<rounds;r++) {\n"
+        + leaf_calls
+        + "  }\n  return total&127;\n}\n"
+    )
+    path = temp / f"{name}_{count}.HC"
+    path.write_text("\n".join(parts), encoding="utf-8")
+    return path
+
+
+def measure(src, thread_count):
+    cmd = [
+        holyc_bin,
+        "jit",
+        str(src),
+        f"--opt-level={opt_level}",
+        f"--jit-threads={thread_count}",
+        "--time-phases",
+    ]
+    wall = []
+    jit_exec = []
+    output = None
+    for _ in range(runs):
+        start = time.perf_counter()
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+        wall.append(time.perf_counter() - start)
+        if proc.returncode != 0:
+            reason = (proc.stderr.strip().splitlines() or ["jit failed"])[-1]
+            return None, reason
+        match = jit_exec_re.search(proc.stderr)
+        if match:
+            jit_exec.append(float(match.group(1)))
+        output = proc.stdout
+    exec_ms = statistics.median(jit_exec) * 1e3 if len(jit_exec) == runs else None
+    return (statistics.median(wall) * 1e3, exec_ms, output), ""
+
+
+compile_src = generate("threads", 0)
+run_src = generate("threads_run", rounds)
+rows = []
+failures = []
+for thread_count in thread_counts:
+    result, reason = measure(compile_src, thread_count)
+    run_result = None
+    if result is not None:
+        run_result, reason = measure(run_src, thread_count)
+    rows.append((thread_count, result, run_result))
+    if result is None or run_result is None:
+        failures.append(f"- --jit-threads={thread_count}: {reason}")
+
+for index in (1, 2):
+    outputs = {row[index][2] for row in rows if row[index] is not None}
+    if len(outputs) > 1:
+        failures.append("- program output differs between thread counts")
+        break
+
+
+def compile_ms(result):
+    return result[1] if result[1] is not None else result[0]
+
+
+def run_ms(result, run_result):
+    if result is None or run_result is None:
+        return None
+    return max(compile_ms(run_result) - compile_ms(result), 0.0)
+
+
+def ratio(base, value):
+    if base is None or value is None or value <= 0:
+        return "-"
+    return f"{base / value:.2f}x"
+
+
+baseline = rows[0][1] if rows else None
+baseline_run = run_ms(rows[0][1], rows[0][2]) if rows else None
+generated_at = datetime.datetime.now(datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+lines = [
+    "# JIT Compile Threads",
+    "",
+    f"Generated by scripts/perf_jit_threads.sh on {generated_at}.",
+    "",
+    f"Program: {count} functions, all called from Main. Opt level: {opt_level}. "
+    f"Host CPUs: {os.cpu_count()}. Times are medians of {runs} `holyc jit` runs; "
+    "jit-exec is the optimize+compile+run phase from --time-phases.",
+    "",
+    f"Run is the extra jit-exec time of the build that also makes {rounds} passes "
+    f"over {leaf_count} leaf calls; Run speed below 1.00x means lost inlining.",
+    "",
+    "| --jit-threads | Wall (ms) | jit-exec (ms) | Speedup | Run (ms) | Run speed |",
+    "| ---: | ---: | ---: | ---: | ---: | ---: |",
+]
+for thread_count, result, run_result in rows:
+    if result is None:
+        lines.append(f"| {thread_count} | - | - | - | - | - |")
+        continue
+    exec_text = f"{result[1]:.3f}" if result[1] is not None else "-"
+    speedup = ratio(compile_ms(baseline) if baseline is not None else None, compile_ms(result))
+    run = run_ms(result, run_result)
+    run_text = f"{run:.3f}" if run is not None else "-"
+    lines.append(
+        f"| {thread_count} | {result[0]:.3f} | {exec_text} | {speedup} | {run_text} | "
+        f"{ratio(baseline_run, run)} |"
+    )
+if failures:
+    lines += ["", "Failures:", ""] + failures
+
+pathlib.Path(out_md).write_text("\n".join(lines) + "\n", encoding="utf-8")
+print(f"wrote {out_md}")
+PY
@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+usage() {
+  cat >&2 <<'EOF'
+usage: perf_job_scaling.sh <runtime-bench-bin> [options]
+
+Runs the runtime_bench parfor benchmark with 1..N job workers and reports
+JobParFor/JobParReduce throughput and speedup over a single worker.
+
+Options:
+  --out-md <path>           Markdown summary path (default: .holyc-artifacts/perf-job-scaling.md)
+  --max-workers <count>     Highest worker count to measure (default: online CPUs)
+  --iterations <count>      runtime_bench --iterations value (default: 20000)
+  -h, --help                Show this help.
+EOF
+}
+
+BENCH_BIN=""
+OUT_MD=".holyc-artifacts/perf-job-scaling.md"
+MAX_WORKERS=""
+ITERATIONS="20000"
+
+while [[ $# -gt 0 ]]; do
+  case "$1" in
+    -h|--help)
+      usage
+      exit 0
+      ;;
+    --out-md)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --out-md requires a value" >&2
+        exit 2
+      fi
+      OUT_MD="$2"
+      shift 2
+      ;;
+    --out-md=*)
+      OUT_MD="${1#*=}"
+      shift
+      ;;
+    --max-workers)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --max-workers requires a value" >&2
+        exit 2
+      fi
+      MAX_WORKERS="$2"
+      shift 2
+      ;;
+    --max-workers=*)
+      MAX_WORKERS="${1#*=}"
+      shift
+      ;;
+    --iterations)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --iterations requires a value" >&2
+        exit 2
+      fi
+      ITERATIONS="$2"
+      shift 2
+      ;;
+    --iterations=*)
+      ITERATIONS="${1#*=}"
+      shift
+      ;;
+    -*)
+      echo "error: unknown option: $1" >&2
+      usage
+      exit 2
+      ;;
+    *)
+      if [[ -z "${BENCH_BIN}" ]]; then
+        BENCH_BIN="$1"
+      else
+        echo "error: unexpected argument: $1" >&2
+        usage
+        exit 2
+      fi
+      shift
+      ;;
+  esac
+done
+
+if [[ -z "${BENCH_BIN}" ]]; then
+  usage
+  exit 2
+fi
+
+if [[ -z "${MAX_WORKERS}" ]]; then
+  MAX_WORKERS="$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)"
+fi
+if ! [[ "${MAX_WORKERS}" =~ ^[1-9][0-9]*$ ]]; then
+  echo "error: --max-workers must be a positive integer" >&2
+  exit 2
+fi
+if ! [[ "${ITERATIONS}" =~ ^[1-9][0-9]*$ ]]; then
+  echo "error: --iterations must be a positive integer" >&2
+  exit 2
+fi
+
+mkdir -p "$(dirname "${OUT_MD}")"
+
+rate_of() {
+  local name="$1"
+  local output="$2"
+  awk -v name="${name}" '$1 == name { for (i = 2; i <= NF; ++i) if ($i ~ /^ops_per_sec=/) { sub(/^ops_per_sec=/, "", $i); print $i } }' <<<"${output}"
+}
+
+{
+  echo "# Job System Scaling"
+  echo
+  echo "Generated by scripts/perf_job_scaling.sh on $(date -u +%Y-%m-%dT%H:%M:%SZ)."
+  echo
+  echo "Elements per run: $((ITERATIONS * 1000)). Worker count set with HOLYC_JOB_WORKERS."
+  echo
+  echo "| Workers | JobParFor (elem/s) | Speedup | JobParReduce (elem/s) | Speedup |"
+  echo "| ---: | ---: | ---: | ---: | ---: |"
+} >"${OUT_MD}"
+
+BASE_FOR=""
+BASE_REDUCE=""
+for ((workers = 1; workers <= MAX_WORKERS; ++workers)); do
+  output="$(HOLYC_JOB_WORKERS="${workers}" "${BENCH_BIN}" --iterations="${ITERATIONS}" parfor)"
+  for_rate="$(rate_of parfor.jobparfor "${output}")"
+  reduce_rate="$(rate_of parreduce.jobparreduce "${output}")"
+  if [[ -z "${BASE_FOR}" ]]; then
+    BASE_FOR="${for_rate}"
+    BASE_REDUCE="${reduce_rate}"
+  fi
+  awk -v w="${workers}" -v f="${for_rate}" -v r="${reduce_rate}" -v bf="${BASE_FOR}" -v br="${BASE_REDUCE}" \
+    'BEGIN { printf("| %d | %.0f | %.2fx | %.0f | %.2fx |\n", w, f, f / bf, r, r / br) }' >>"${OUT_MD}"
+done
+
+cat "${OUT_MD}"
@@ -0,0 +1,208 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+usage() {
+  cat >&2 <<'EOF'
+usage: perf_reflection_size.sh <holyc-bin> [options]
+
+Builds every .HC file in the corpus with `holyc build` and reports binary
+size and process startup time. With --baseline-bin the same corpus is built
+with a second compiler and both columns are compared.
+
+Options:
+  --baseline-bin <path>     Optional holyc binary to compare against.
+  --corpus <dir>            Corpus directory (default: examples/reference/holyc_docs)
+  --out-md <path>           Markdown summary path (default: .holyc-artifacts/perf-reflection-size.md)
+  --runs <count>            Timed startup runs per binary (default: 20)
+  -h, --help                Show this help.
+EOF
+}
+
+HOLYC_BIN=""
+BASELINE_BIN=""
+CORPUS_DIR="examples/reference/holyc_docs"
+OUT_MD=".holyc-artifacts/perf-reflection-size.md"
+RUNS="20"
+
+while [[ $# -gt 0 ]]; do
+  case "$1" in
+    -h|--help)
+      usage
+      exit 0
+      ;;
+    --baseline-bin)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --baseline-bin requires a value" >&2
+        exit 2
+      fi
+      BASELINE_BIN="$2"
+      shift 2
+      ;;
+    --baseline-bin=*)
+      BASELINE_BIN="${1#*=}"
+      shift
+      ;;
+    --corpus)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --corpus requires a value" >&2
+        exit 2
+      fi
+      CORPUS_DIR="$2"
+      shift 2
+      ;;
+    --corpus=*)
+      CORPUS_DIR="${1#*=}"
+      shift
+      ;;
+    --out-md)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --out-md requires a value" >&2
+        exit 2
+      fi
+      OUT_MD="$2"
+      shift 2
+      ;;
+    --out-md=*)
+      OUT_MD="${1#*=}"
+      shift
+      ;;
+    --runs)
+      if [[ $# -lt 2 ]]; then
+        echo "error: --runs requires a value" >&2
+        exit 2
+      fi
+      RUNS="$2"
+      shift 2
+      ;;
+    --runs=*)
+      RUNS="${1#*=}"
+      shift
+      ;;
+    -*)
+      echo "error: unknown option: $1" >&2
+      usage
+      exit 2
+      ;;
+    *)
+      if [[ -z "${HOLYC_BIN}" ]]; then
+        HOLYC_BIN="$1"
+      else
+        echo "error: unexpected argument: $1" >&2
+        usage
+        exit 2
+      fi
+      shift
+      ;;
+  esac
+done
+
+if [[ -z "${HOLYC_BIN}" ]]; then
+  usage
+  exit 2
+fi
+if [[ ! -d "${CORPUS_DIR}" ]]; then
+  echo "error: corpus directory not found: ${CORPUS_DIR}" >&2
+  exit 2
+fi
+if ! [[ "${RUNS}" =~ ^[1-9][0-9]*$ ]]; then
+  echo "error: --runs must be a positive integer" >&2
+  exit 2
+fi
+if ! command -v python3 >/dev/null 2>&1; then
+  echo "error: python3 is required" >&2
+  exit 2
+fi
+
+mkdir -p "$(dirname "${OUT_MD}")"
+
+TEMP_DIR="$(mktemp -d)"
+cleanup() {
+  rm -rf "${TEMP_DIR}"
+}
+trap cleanup EXIT
+
+python3 - "${HOLYC_BIN}" "${BASELINE_BIN}" "${CORPUS_DIR}" "${OUT_MD}" "${RUNS}" "${TEMP_DIR}" <<'PY'
+import datetime
+import pathlib
+import statistics
+import subprocess
+import sys
+import time
+
+holyc_bin, baseline_bin, corpus_dir, out_md, runs, temp_dir = sys.argv[1:]
+runs = int(runs)
+temp = pathlib.Path(temp_dir)
+compilers = [("current", holyc_bin)]
+if baseline_bin:
+    compilers.append(("baseline", baseline_bin))
+
+
+def measure(label, compiler, src):
+    out = temp / f"{src.stem}.{label}"
+    build = subprocess.run(
+        [compiler, "build", str(src), "-o", str(out)],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+    if build.returncode != 0:
+        reason = (build.stderr.strip().splitlines() or ["build failed"])[-1]
+        return None, reason
+    samples = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        subprocess.run([str(out)], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, timeout=30)
+        samples.append(time.perf_counter() - start)
+    return (out.stat().st_size, statistics.median(samples) * 1e3), ""
+
+
+rows = []
+for src in sorted(pathlib.Path(corpus_dir).glob("*.HC")):
+    row = {"name": src.name}
+    for label, compiler in compilers:
+        row[label] = measure(label, compiler, src)
+    rows.append(row)
+
+generated_at = datetime.datetime.now(datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+header = "| File |"
+rule = "| --- |"
+for label, _ in compilers:
+    header += f" {label} size (B) | {label} startup (ms) |"
+    rule += " ---: | ---: |"
+if baseline_bin:
+    header += " Size delta |"
+    rule += " ---: |"
+lines = [
+    "# Reflection Size/Startup",
+    "",
+    f"Generated by scripts/perf_reflection_size.sh on {generated_at}.",
+    "",
+    f"Corpus: {corpus_dir}. Startup is the median wall time of {runs} runs.",
+    "",
+    header,
+    rule,
+]
+failures = []
+for row in rows:
+    line = f"| {row['name']} |"
+    for label, _ in compilers:
+        result, reason = row[label]
+        if result is None:
+            line += " - | - |"
+            failures.append(f"- {row['name']} ({label}): {reason}")
+        else:
+            line += f" {result[0]} | {result[1]:.3f} |"
+    if baseline_bin:
+        current, _ = row["current"]
+        baseline, _ = row["baseline"]
+        if current is not None and baseline is not None and baseline[0] > 0:
+            line += f" {(current[0] - baseline[0]) / baseline[0] * 100:+.1f}% |"
+        else:
+            line += " - |"
+    lines.append(line)
+if failures:
+    lines += ["", "Build failures:", ""] + failures
+
+pathlib.Path(out_md).write_text("\n".join(lines) + "\n", encoding="utf-8")
+print(f"wrote {out_md}")
+PY
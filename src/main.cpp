@@ -2,6 +2,7 @@
 #include <chrono>
 #include <cstdlib>
 #include <cerrno>
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
@@ -11,6 +12,7 @@
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #if defined(__unix__) || defined(__APPLE__)
@@ -24,6 +26,7 @@ extern char** environ;
 #endif
 
 #include "frontend.h"
+#include "hc_runtime.h"
 #include "llvm_backend.h"
 #include "repl.h"
 #include "version.h"
@@ -49,18 +52,25 @@ void print_usage() {
             << "  emit-hir <file> [--mode=jit|aot] [--strict|--permissive]\n"
             << "                       Emit lowered HIR dump\n"
             << "  emit-llvm <file> [--mode=jit|aot] [--strict|--permissive]\n"
+            << "            [--exceptions=table|setjmp]\n"
             << "                       Emit textual LLVM IR\n"
             << "  jit <file> [--strict|--permissive] [--jit-backend=llvm]\n"
             << "            [--jit-session=<name>] [--jit-reset] [--opt-level=0|1|2|3|s|z]\n"
+            << "            [--exceptions=table|setjmp] [--runtime-stats[=json]]\n"
+            << "            [--jit-cache-dir=<dir>] [--jit-cache-max-mb=<n>] [--jit-lazy]\n"
+            << "            [--jit-tiered] [--jit-tier-threshold=<calls>] [--jit-tier-stats]\n"
+            << "            [--jit-threads=<n>]\n"
             << "                       Execute supported subset in-process\n"
             << "  repl [--strict|--permissive] [--jit-session=<name>] [--jit-reset]\n"
-            << "       [--opt-level=0|1|2|3|s|z]\n"
+            << "       [--opt-level=0|1|2|3|s|z] [--exceptions=table|setjmp]\n"
             << "                       Start interactive JIT-backed HolyC REPL\n"
             << "  build <file> [-o out] [--target=<triple>] [--artifact-dir=<dir>]\n"
             << "               [--keep-temps] [--strict|--permissive] [--opt-level=0|1|2|3|s|z]\n"
+            << "               [--exceptions=table|setjmp]\n"
             << "                       Build executable via host toolchain/LLVM\n"
             << "  run <file> [--target=<triple>] [--artifact-dir=<dir>] [--keep-temps]\n"
             << "            [--strict|--permissive] [--opt-level=0|1|2|3|s|z]\n"
+            << "            [--exceptions=table|setjmp] [--runtime-stats[=json]]\n"
             << "                       Build and run executable\n";
 }
 
@@ -247,6 +257,70 @@ bool TryParseJitSessionArg(std::string_view arg, std::string* session_out) {
   return true;
 }
 
+bool TryParseJitOptionsArg(std::string_view arg, holyc::llvm_backend::JitOptions* options_out,
+                           std::string* error) {
+  if (arg == "--jit-lazy") {
+    options_out->lazy = true;
+    return true;
+  }
+  if (arg == "--jit-tiered") {
+    options_out->tiered = true;
+    return true;
+  }
+
+  constexpr std::string_view tier_threshold_prefix = "--jit-tier-threshold=";
+  if (arg.substr(0, tier_threshold_prefix.size()) == tier_threshold_prefix) {
+    const std::string value(arg.substr(tier_threshold_prefix.size()));
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long calls = std::strtoull(value.c_str(), &end, 10);
+    if (value.empty() || errno != 0 || end == nullptr || *end != '\0' || calls == 0) {
+      *error = "error: invalid --jit-tier-threshold value (expected positive call count): " +
+               value;
+      return true;
+    }
+    options_out->tier_threshold = static_cast<std::uint64_t>(calls);
+    return true;
+  }
+
+  constexpr std::string_view threads_prefix = "--jit-threads=";
+  if (arg.substr(0, threads_prefix.size()) == threads_prefix) {
+    const std::string value(arg.substr(threads_prefix.size()));
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long threads = std::strtoul(value.c_str(), &end, 10);
+    if (value.empty() || errno != 0 || end == nullptr || *end != '\0' || threads > 256) {
+      *error = "error: invalid --jit-threads value (expected 0-256): " + value;
+      return true;
+    }
+    options_out->compile_threads = static_cast<unsigned>(threads);
+    return true;
+  }
+
+  constexpr std::string_view cache_dir_prefix = "--jit-cache-dir=";
+  if (arg.substr(0, cache_dir_prefix.size()) == cache_dir_prefix) {
+    options_out->cache_dir = std::string(arg.substr(cache_dir_prefix.size()));
+    return true;
+  }
+
+  constexpr std::string_view cache_size_prefix = "--jit-cache-max-mb=";
+  if (arg.substr(0, cache_size_prefix.size()) == cache_size_prefix) {
+    const std::string value(arg.substr(cache_size_prefix.size()));
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long megabytes = std::strtoull(value.c_str(), &end, 10);
+    if (value.empty() || errno != 0 || end == nullptr || *end != '\0' ||
+        megabytes > (UINT64_MAX >> 20)) {
+      *error = "error: invalid --jit-cache-max-mb value (expected megabytes): " + value;
+      return true;
+    }
+    options_out->cache_max_bytes = static_cast<std::uint64_t>(megabytes) << 20;
+    return true;
+  }
+
+  return false;
+}
+
 bool TryParseJitBackendArg(std::string_view arg, JitBackendKind* backend_out,
                            std::string* error) {
   constexpr std::string_view prefix = "--jit-backend=";
@@ -303,6 +377,29 @@ bool TryParseOptLevelArg(std::string_view arg, holyc::llvm_backend::OptLevel* op
   return true;
 }
 
+bool TryParseExceptionsArg(std::string_view arg,
+                           holyc::frontend::ExceptionModel* exception_model_out,
+                           std::string* error) {
+  constexpr std::string_view prefix = "--exceptions=";
+  if (arg.substr(0, prefix.size()) != prefix) {
+    return false;
+  }
+
+  const std::string_view value = arg.substr(prefix.size());
+  if (value == "table") {
+    *exception_model_out = holyc::frontend::ExceptionModel::kTable;
+    return true;
+  }
+  if (value == "setjmp") {
+    *exception_model_out = holyc::frontend::ExceptionModel::kSetjmp;
+    return true;
+  }
+
+  *error = "error: invalid --exceptions value (expected table or setjmp): " +
+           std::string(value);
+  return true;
+}
+
 bool TryParseTimePhasesArg(std::string_view arg, bool* enabled_out,
                            std::string* json_path_out, std::string* error) {
   if (arg == "--time-phases") {
@@ -323,6 +420,27 @@ bool TryParseTimePhasesArg(std::string_view arg, bool* enabled_out,
   return true;
 }
 
+bool TryParseRuntimeStatsArg(std::string_view arg, bool* enabled_out, bool* json_out,
+                             std::string* error) {
+  if (arg == "--runtime-stats") {
+    *enabled_out = true;
+    *json_out = false;
+    return true;
+  }
+  constexpr std::string_view prefix = "--runtime-stats=";
+  if (arg.substr(0, prefix.size()) != prefix) {
+    return false;
+  }
+  const std::string_view value = arg.substr(prefix.size());
+  if (value != "text" && value != "json") {
+    *error = "error: invalid --runtime-stats value (expected text or json): " + std::string(value);
+    return true;
+  }
+  *enabled_out = true;
+  *json_out = value == "json";
+  return true;
+}
+
 template <typename Fn>
 auto RunTimedPhase(std::vector<holyc::frontend::PhaseTiming>* phase_timings,
                    std::string_view phase_name, Fn&& fn) -> decltype(fn()) {
@@ -333,6 +451,7 @@ auto RunTimedPhase(std::vector<holyc::frontend::PhaseTiming>* phase_timings,
     phase_timings->push_back(holyc::frontend::PhaseTiming{
         std::string(phase_name),
         std::chrono::duration<double>(end - start).count(),
+        {},
     });
   }
   return result;
@@ -375,6 +494,10 @@ void PrintPhaseTimings(std::string_view command,
   for (const holyc::frontend::PhaseTiming& phase : phase_timings) {
     std::cerr << "  " << std::setw(24) << std::left << phase.name << " "
               << std::fixed << std::setprecision(6) << phase.seconds << " s\n";
+    for (const holyc::frontend::PhaseCounter& counter : phase.counters) {
+      std::cerr << "    " << std::setw(22) << std::left << counter.name << " " << counter.value
+                << "\n";
+    }
   }
 }
 
@@ -407,7 +530,17 @@ bool WritePhaseTimingsJson(std::string_view output_path, std::string_view comman
   for (std::size_t i = 0; i < phase_timings.size(); ++i) {
     const holyc::frontend::PhaseTiming& phase = phase_timings[i];
     out << "    {\"name\":\"" << EscapeJson(phase.name) << "\",\"seconds\":"
-        << std::fixed << std::setprecision(9) << phase.seconds << "}";
+        << std::fixed << std::setprecision(9) << phase.seconds;
+    if (!phase.counters.empty()) {
+      out << ",\"counters\":{";
+      for (std::size_t j = 0; j < phase.counters.size(); ++j) {
+        const holyc::frontend::PhaseCounter& counter = phase.counters[j];
+        out << (j == 0 ? "" : ",") << "\"" << EscapeJson(counter.name)
+            << "\":" << counter.value;
+      }
+      out << "}";
+    }
+    out << "}";
     if (i + 1 < phase_timings.size()) {
       out << ",";
     }
@@ -425,6 +558,24 @@ bool WritePhaseTimingsJson(std::string_view output_path, std::string_view comman
   return true;
 }
 
+void PrintJitTierTransitions(const std::vector<holyc::llvm_backend::JitTierTransition>& transitions) {
+  std::cerr << "jit tier transitions\n";
+  if (transitions.empty()) {
+    std::cerr << "  (none)\n";
+    return;
+  }
+  for (const holyc::llvm_backend::JitTierTransition& transition : transitions) {
+    std::cerr << "  " << std::setw(24) << std::left << transition.function << " "
+              << transition.from << " -> " << transition.to << " after " << transition.calls
+              << " calls, " << std::fixed << std::setprecision(3) << transition.compile_ms
+              << " ms";
+    if (!transition.ok) {
+      std::cerr << " failed: " << transition.error;
+    }
+    std::cerr << "\n";
+  }
+}
+
 void MaybeReportPhaseTimings(std::string_view command, bool enabled,
                              std::string_view json_path,
                              const std::vector<holyc::frontend::PhaseTiming>& phase_timings) {
@@ -444,6 +595,7 @@ int BuildExecutable(std::string_view input_path, std::string_view output_path,
                     std::string_view artifact_dir, std::string_view target_triple,
                     bool strict_mode, bool keep_temps,
                     holyc::llvm_backend::OptLevel opt_level,
+                    holyc::frontend::ExceptionModel exception_model,
                     std::vector<holyc::frontend::PhaseTiming>* phase_timings = nullptr) {
   std::string input_text;
   const bool read_ok = RunTimedPhase(phase_timings, "read-source",
@@ -453,9 +605,10 @@ int BuildExecutable(std::string_view input_path, std::string_view output_path,
     return 2;
   }
 
-  const holyc::frontend::ParseResult ir =
-      holyc::frontend::EmitLlvmIr(input_text, input_path, holyc::frontend::ExecutionMode::kAot,
-                                  strict_mode, phase_timings);
+  holyc::llvm_backend::IrModulePtr module;
+  const holyc::frontend::ParseResult ir = holyc::frontend::EmitLlvmModule(
+      input_text, input_path, &module, holyc::frontend::ExecutionMode::kAot, strict_mode,
+      phase_timings, exception_model);
   if (!ir.ok) {
     std::cerr << ir.output << "\n";
     return 1;
@@ -471,18 +624,23 @@ int BuildExecutable(std::string_view input_path, std::string_view output_path,
   const std::string artifact_base =
       (std::filesystem::path(std::string(artifact_dir)) / ArtifactBaseName(output_path)).string();
   const std::string ll_path = artifact_base + ".ll";
-  const bool write_ir_ok =
-      RunTimedPhase(phase_timings, "write-llvm-ir", [&]() { return WriteFile(ll_path, ir.output); });
-  if (!write_ir_ok) {
-    std::cerr << "error: cannot write LLVM IR file: " << ll_path << "\n";
-    return 2;
+  if (keep_temps) {
+    const bool write_ir_ok = RunTimedPhase(phase_timings, "write-llvm-ir", [&]() {
+      const holyc::llvm_backend::Result printed = holyc::llvm_backend::PrintIrModule(*module);
+      return printed.ok && WriteFile(ll_path, printed.output);
+    });
+    if (!write_ir_ok) {
+      std::cerr << "error: cannot write LLVM IR file: " << ll_path << "\n";
+      return 2;
+    }
   }
 
   const holyc::llvm_backend::Result build_result = RunTimedPhase(
       phase_timings, "aot-codegen-link",
       [&]() {
-        return holyc::llvm_backend::BuildExecutableFromIr(ir.output, output_path, artifact_dir,
-                                                          target_triple, opt_level);
+        return holyc::llvm_backend::BuildExecutableFromModule(std::move(module), output_path,
+                                                              artifact_dir, target_triple,
+                                                              opt_level);
       });
   if (!build_result.ok) {
     std::cerr << "error: " << build_result.output << "\n";
@@ -768,6 +926,7 @@ int main(int argc, char** argv) {
 
     holyc::frontend::ExecutionMode mode = holyc::frontend::ExecutionMode::kAot;
     bool strict_mode = kStrictModeDefault;
+    holyc::frontend::ExceptionModel exception_model = holyc::frontend::ExceptionModel::kTable;
     bool time_phases = false;
     std::string time_phases_json;
     for (int i = 3; i < argc; ++i) {
@@ -783,6 +942,14 @@ int main(int argc, char** argv) {
       if (TryParseStrictArg(arg, &strict_mode)) {
         continue;
       }
+      std::string exceptions_error;
+      if (TryParseExceptionsArg(arg, &exception_model, &exceptions_error)) {
+        if (!exceptions_error.empty()) {
+          std::cerr << exceptions_error << "\n";
+          return 2;
+        }
+        continue;
+      }
       std::string phase_err;
       if (TryParseTimePhasesArg(arg, &time_phases, &time_phases_json, &phase_err)) {
         if (!phase_err.empty()) {
@@ -808,7 +975,7 @@ int main(int argc, char** argv) {
     }
 
     const holyc::frontend::ParseResult result = holyc::frontend::EmitLlvmIr(
-        input_text, input_path, mode, strict_mode, phase_out);
+        input_text, input_path, mode, strict_mode, phase_out, exception_model);
     if (!result.ok) {
       MaybeReportPhaseTimings("emit-llvm", time_phases, time_phases_json, phase_timings);
       std::cerr << result.output << "\n";
@@ -839,8 +1006,16 @@ int main(int argc, char** argv) {
     bool reset_after_run = true;
     JitBackendKind jit_backend = JitBackendKind::kLlvm;
     holyc::llvm_backend::OptLevel opt_level = kJitOptDefault;
+    holyc::frontend::ExceptionModel exception_model = holyc::frontend::ExceptionModel::kTable;
     bool time_phases = false;
     std::string time_phases_json;
+    bool runtime_stats = false;
+    bool runtime_stats_json = false;
+    bool jit_tier_stats = false;
+    holyc::llvm_backend::JitOptions jit_options;
+    if (const char* cache_dir = std::getenv("HOLYC_JIT_CACHE_DIR"); cache_dir != nullptr) {
+      jit_options.cache_dir = cache_dir;
+    }
     for (int i = 3; i < argc; ++i) {
       const std::string_view arg = argv[i];
       if (TryParseStrictArg(arg, &strict_mode)) {
@@ -854,6 +1029,22 @@ int main(int argc, char** argv) {
         }
         continue;
       }
+      std::string jit_options_error;
+      if (TryParseJitOptionsArg(arg, &jit_options, &jit_options_error)) {
+        if (!jit_options_error.empty()) {
+          std::cerr << jit_options_error << "\n";
+          return 2;
+        }
+        continue;
+      }
+      std::string exceptions_error;
+      if (TryParseExceptionsArg(arg, &exception_model, &exceptions_error)) {
+        if (!exceptions_error.empty()) {
+          std::cerr << exceptions_error << "\n";
+          return 2;
+        }
+        continue;
+      }
       std::string phase_err;
       if (TryParseTimePhasesArg(arg, &time_phases, &time_phases_json, &phase_err)) {
         if (!phase_err.empty()) {
@@ -862,6 +1053,14 @@ int main(int argc, char** argv) {
         }
         continue;
       }
+      std::string stats_err;
+      if (TryParseRuntimeStatsArg(arg, &runtime_stats, &runtime_stats_json, &stats_err)) {
+        if (!stats_err.empty()) {
+          std::cerr << stats_err << "\n";
+          return 2;
+        }
+        continue;
+      }
       std::string backend_error;
       if (TryParseJitBackendArg(arg, &jit_backend, &backend_error)) {
         if (!backend_error.empty()) {
@@ -878,6 +1077,10 @@ int main(int argc, char** argv) {
         jit_reset = true;
         continue;
       }
+      if (arg == "--jit-tier-stats") {
+        jit_tier_stats = true;
+        continue;
+      }
       std::cerr << "error: unknown jit argument: " << arg << "\n";
       return 2;
     }
@@ -885,6 +1088,10 @@ int main(int argc, char** argv) {
       std::cerr << "error: unsupported jit backend\n";
       return 2;
     }
+    if (jit_options.tiered && jit_options.lazy) {
+      std::cerr << "error: --jit-tiered cannot be combined with --jit-lazy\n";
+      return 2;
+    }
 
     const std::string_view input_path = argv[2];
     std::string input_text;
@@ -909,21 +1116,40 @@ int main(int argc, char** argv) {
       }
     }
 
-    const holyc::frontend::ParseResult ir_result = holyc::frontend::EmitLlvmIr(
-        input_text, input_path, holyc::frontend::ExecutionMode::kJit, strict_mode, phase_out);
+    holyc::llvm_backend::IrModulePtr module;
+    const holyc::frontend::ParseResult ir_result = holyc::frontend::EmitLlvmModule(
+        input_text, input_path, &module, holyc::frontend::ExecutionMode::kJit, strict_mode,
+        phase_out, exception_model);
     if (!ir_result.ok) {
       MaybeReportPhaseTimings("jit", time_phases, time_phases_json, phase_timings);
       std::cerr << ir_result.output << "\n";
       return 1;
     }
 
+    if (runtime_stats) {
+      hc_runtime_stats_enable(1);
+    }
+    holyc::llvm_backend::SetJitOptions(jit_options);
     const holyc::llvm_backend::Result result = RunTimedPhase(
         phase_out, "jit-exec",
         [&]() {
-          return holyc::llvm_backend::ExecuteIrJit(ir_result.output, jit_session, reset_after_run,
-                                                   "main", opt_level);
+          return holyc::llvm_backend::ExecuteModuleJit(std::move(module), jit_session,
+                                                       reset_after_run, "main", opt_level);
         });
+    if (!phase_timings.empty()) {
+      for (const holyc::llvm_backend::JitCounter& counter : holyc::llvm_backend::JitCounters()) {
+        phase_timings.back().counters.push_back(
+            holyc::frontend::PhaseCounter{counter.name, counter.value});
+      }
+    }
+    if (runtime_stats) {
+      hc_runtime_stats_enable(0);
+      hc_runtime_stats_report(runtime_stats_json ? 1 : 0);
+    }
     MaybeReportPhaseTimings("jit", time_phases, time_phases_json, phase_timings);
+    if (jit_tier_stats) {
+      PrintJitTierTransitions(holyc::llvm_backend::JitTierTransitions());
+    }
     if (!result.ok) {
       std::cerr << result.output << "\n";
       return 1;
@@ -937,6 +1163,7 @@ int main(int argc, char** argv) {
     std::string jit_session = "__repl__";
     bool jit_reset = false;
     holyc::llvm_backend::OptLevel opt_level = kReplOptDefault;
+    holyc::frontend::ExceptionModel exception_model = holyc::frontend::ExceptionModel::kTable;
     for (int i = 2; i < argc; ++i) {
       const std::string_view arg = argv[i];
       if (TryParseStrictArg(arg, &strict_mode)) {
@@ -950,6 +1177,14 @@ int main(int argc, char** argv) {
         }
         continue;
       }
+      std::string exceptions_error;
+      if (TryParseExceptionsArg(arg, &exception_model, &exceptions_error)) {
+        if (!exceptions_error.empty()) {
+          std::cerr << exceptions_error << "\n";
+          return 2;
+        }
+        continue;
+      }
       if (TryParseJitSessionArg(arg, &jit_session)) {
         continue;
       }
@@ -960,7 +1195,7 @@ int main(int argc, char** argv) {
       std::cerr << "error: unknown repl argument: " << arg << "\n";
       return 2;
     }
-    return holyc::repl::RunRepl(strict_mode, jit_session, jit_reset, opt_level);
+    return holyc::repl::RunRepl(strict_mode, jit_session, jit_reset, opt_level, exception_model);
   }
 
   if (arg1 == "build") {
@@ -976,6 +1211,7 @@ int main(int argc, char** argv) {
     bool strict_mode = kStrictModeDefault;
     bool keep_temps = false;
     holyc::llvm_backend::OptLevel opt_level = kBuildOptDefault;
+    holyc::frontend::ExceptionModel exception_model = holyc::frontend::ExceptionModel::kTable;
     bool time_phases = false;
     std::string time_phases_json;
 
@@ -1007,6 +1243,14 @@ int main(int argc, char** argv) {
         }
         continue;
       }
+      std::string exceptions_error;
+      if (TryParseExceptionsArg(arg, &exception_model, &exceptions_error)) {
+        if (!exceptions_error.empty()) {
+          std::cerr << exceptions_error << "\n";
+          return 2;
+        }
+        continue;
+      }
       std::string phase_err;
       if (TryParseTimePhasesArg(arg, &time_phases, &time_phases_json, &phase_err)) {
         if (!phase_err.empty()) {
@@ -1026,7 +1270,7 @@ int main(int argc, char** argv) {
 
     std::vector<holyc::frontend::PhaseTiming> phase_timings;
     const int rc = BuildExecutable(input_path, output_path, artifact_dir, target_triple,
-                                   strict_mode, keep_temps, opt_level,
+                                   strict_mode, keep_temps, opt_level, exception_model,
                                    time_phases ? &phase_timings : nullptr);
     MaybeReportPhaseTimings("build", time_phases, time_phases_json, phase_timings);
     if (rc == 0) {
@@ -1047,8 +1291,11 @@ int main(int argc, char** argv) {
     bool strict_mode = kStrictModeDefault;
     bool keep_temps = false;
     holyc::llvm_backend::OptLevel opt_level = kBuildOptDefault;
+    holyc::frontend::ExceptionModel exception_model = holyc::frontend::ExceptionModel::kTable;
     bool time_phases = false;
     std::string time_phases_json;
+    bool runtime_stats = false;
+    bool runtime_stats_json = false;
     std::string output_path =
         (std::filesystem::path(artifact_dir) / (BasenameNoExt(input_path) + ".run")).string();
 
@@ -1082,6 +1329,14 @@ int main(int argc, char** argv) {
         }
         continue;
       }
+      std::string exceptions_error;
+      if (TryParseExceptionsArg(arg, &exception_model, &exceptions_error)) {
+        if (!exceptions_error.empty()) {
+          std::cerr << exceptions_error << "\n";
+          return 2;
+        }
+        continue;
+      }
       std::string phase_err;
       if (TryParseTimePhasesArg(arg, &time_phases, &time_phases_json, &phase_err)) {
         if (!phase_err.empty()) {
@@ -1090,6 +1345,14 @@ int main(int argc, char** argv) {
         }
         continue;
       }
+      std::string stats_err;
+      if (TryParseRuntimeStatsArg(arg, &runtime_stats, &runtime_stats_json, &stats_err)) {
+        if (!stats_err.empty()) {
+          std::cerr << stats_err << "\n";
+          return 2;
+        }
+        continue;
+      }
       if (arg == "--keep-temps") {
         keep_temps = true;
         continue;
@@ -1103,12 +1366,18 @@ int main(int argc, char** argv) {
     std::vector<holyc::frontend::PhaseTiming>* phase_out =
         time_phases ? &phase_timings : nullptr;
     const int rc = BuildExecutable(input_path, output_path, artifact_dir, target_triple,
-                                   strict_mode, keep_temps, opt_level, phase_out);
+                                   strict_mode, keep_temps, opt_level, exception_model,
+                                   phase_out);
     if (rc != 0) {
       MaybeReportPhaseTimings("run", time_phases, time_phases_json, phase_timings);
       return rc;
     }
 
+#if defined(__unix__) || defined(__APPLE__)
+    if (runtime_stats) {
+      (void)::setenv("HOLYC_RUNTIME_STATS", runtime_stats_json ? "json" : "1", 1);
+    }
+#endif
     std::string run_error;
     const int run_rc = RunTimedPhase(
         phase_out, "run-program",
@@ -12,6 +12,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #if defined(__unix__) || defined(__APPLE__)
@@ -898,8 +899,12 @@ struct DeclCatalog {
 
 class ReplEngine {
  public:
-  ReplEngine(bool strict_mode, std::string_view jit_session, llvm_backend::OptLevel opt_level)
-      : strict_mode_(strict_mode), jit_session_(jit_session), opt_level_(opt_level) {}
+  ReplEngine(bool strict_mode, std::string_view jit_session, llvm_backend::OptLevel opt_level,
+             frontend::ExceptionModel exception_model)
+      : strict_mode_(strict_mode),
+        jit_session_(jit_session),
+        opt_level_(opt_level),
+        exception_model_(exception_model) {}
 
   void SetStrictMode(bool strict_mode) { strict_mode_ = strict_mode; }
 
@@ -970,15 +975,17 @@ class ReplEngine {
       unit << cell_text << "\n";
 
       const std::string filename = "<repl-decl-" + std::to_string(cell_id_ + 1) + ">";
+      llvm_backend::IrModulePtr module;
       const frontend::ParseResult ir_result =
-          frontend::EmitLlvmIr(unit.str(), filename, frontend::ExecutionMode::kJit, strict_mode_);
+          frontend::EmitLlvmModule(unit.str(), filename, &module, frontend::ExecutionMode::kJit,
+                                   strict_mode_, nullptr, exception_model_);
       if (!ir_result.ok) {
         std::cerr << ir_result.output << "\n";
         return false;
       }
 
       const llvm_backend::Result load_result =
-          llvm_backend::LoadIrJit(ir_result.output, jit_session_, opt_level_);
+          llvm_backend::LoadModuleJit(std::move(module), jit_session_, opt_level_);
       if (!load_result.ok) {
         std::cerr << load_result.output << "\n";
         return false;
@@ -1023,15 +1030,17 @@ class ReplEngine {
     }
 
     const std::string filename = "<repl-exec-" + std::to_string(cell_id_ + 1) + ">";
+    llvm_backend::IrModulePtr module;
     const frontend::ParseResult ir_result =
-        frontend::EmitLlvmIr(wrapped_source, filename, frontend::ExecutionMode::kJit, strict_mode_);
+        frontend::EmitLlvmModule(wrapped_source, filename, &module, frontend::ExecutionMode::kJit,
+                                 strict_mode_, nullptr, exception_model_);
     if (!ir_result.ok) {
       std::cerr << ir_result.output << "\n";
       return false;
     }
 
-    const llvm_backend::Result jit_result = llvm_backend::ExecuteIrJit(
-        ir_result.output, jit_session_, false, entry_function_name, opt_level_);
+    const llvm_backend::Result jit_result = llvm_backend::ExecuteModuleJit(
+        std::move(module), jit_session_, false, entry_function_name, opt_level_);
     if (!jit_result.ok) {
       std::cerr << jit_result.output << "\n";
       return false;
@@ -1093,6 +1102,7 @@ class ReplEngine {
   bool strict_mode_ = true;
   std::string jit_session_;
   llvm_backend::OptLevel opt_level_ = llvm_backend::OptLevel::kO1;
+  frontend::ExceptionModel exception_model_ = frontend::ExceptionModel::kTable;
   std::uint64_t cell_id_ = 0;
   DeclCatalog catalog_;
 };
@@ -1100,8 +1110,9 @@ class ReplEngine {
 }  // namespace
 
 int RunRepl(bool strict_mode, std::string_view jit_session, bool jit_reset,
-            llvm_backend::OptLevel opt_level) {
-  ReplEngine engine(strict_mode, jit_session.empty() ? "__repl__" : jit_session, opt_level);
+            llvm_backend::OptLevel opt_level, frontend::ExceptionModel exception_model) {
+  ReplEngine engine(strict_mode, jit_session.empty() ? "__repl__" : jit_session, opt_level,
+                    exception_model);
   if (jit_reset && !engine.Reset()) {
     return 1;
   }
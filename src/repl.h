@@ -2,11 +2,13 @@
 
 #include <string_view>
 
+#include "frontend.h"
 #include "llvm_backend.h"
 
 namespace holyc::repl {
 
 int RunRepl(bool strict_mode, std::string_view jit_session, bool jit_reset,
-            llvm_backend::OptLevel opt_level);
+            llvm_backend::OptLevel opt_level,
+            frontend::ExceptionModel exception_model = frontend::ExceptionModel::kTable);
 
 }  // namespace holyc::repl
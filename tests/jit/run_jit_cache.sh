@@ -0,0 +1,68 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+if [[ $# -ne 2 ]]; then
+  echo "usage: $0 <holyc-bin> <source-file>" >&2
+  exit 2
+fi
+
+HOLYC_BIN="$1"
+SRC_FILE="$2"
+TMP_DIR="$(mktemp -d)"
+trap 'rm -rf "${TMP_DIR}"' EXIT
+
+CACHE_DIR="${TMP_DIR}/cache"
+
+run_jit() {
+  local label="$1"
+  shift
+  "${HOLYC_BIN}" jit "${SRC_FILE}" --jit-cache-dir="${CACHE_DIR}" --time-phases "$@" \
+    >"${TMP_DIR}/${label}.out" 2>"${TMP_DIR}/${label}.err"
+}
+
+expect_counter() {
+  local label="$1"
+  local name="$2"
+  local value="$3"
+  if ! grep -Eq "^ +${name} +${value}\$" "${TMP_DIR}/${label}.err"; then
+    echo "jit cache failure: expected ${name}=${value} on ${label} run" >&2
+    cat "${TMP_DIR}/${label}.err" >&2
+    exit 1
+  fi
+}
+
+run_jit cold
+expect_counter cold cache-misses 1
+expect_counter cold cache-stores 1
+
+CACHED_OBJECTS="$(find "${CACHE_DIR}" -name '*.o' | wc -l | tr -d ' ')"
+if [[ "${CACHED_OBJECTS}" != "1" ]]; then
+  echo "jit cache failure: expected 1 cached object, found ${CACHED_OBJECTS}" >&2
+  exit 1
+fi
+
+run_jit warm
+expect_counter warm cache-hits 1
+expect_counter warm cache-stores 0
+if ! cmp -s "${TMP_DIR}/cold.out" "${TMP_DIR}/warm.out"; then
+  echo "jit cache failure: warm run output differs from cold run" >&2
+  diff "${TMP_DIR}/cold.out" "${TMP_DIR}/warm.out" >&2 || true
+  exit 1
+fi
+
+run_jit other-opt --opt-level=0
+expect_counter other-opt cache-misses 1
+expect_counter other-opt cache-stores 1
+
+rm -rf "${CACHE_DIR}"
+mkdir -p "${CACHE_DIR}"
+head -c 2097152 /dev/zero >"${CACHE_DIR}/stale.o"
+touch -t 200001010000 "${CACHE_DIR}/stale.o"
+run_jit capped --jit-cache-max-mb=1
+expect_counter capped cache-stores 1
+expect_counter capped cache-evictions 1
+CACHED_OBJECTS="$(find "${CACHE_DIR}" -name '*.o' | wc -l | tr -d ' ')"
+if [[ -e "${CACHE_DIR}/stale.o" || "${CACHED_OBJECTS}" != "1" ]]; then
+  echo "jit cache failure: expected only the new object to survive eviction" >&2
+  exit 1
+fi
@@ -6,11 +6,26 @@
 #include <cstdint>
 #include <cstring>
 #include <thread>
+#include <vector>
+
+#include <unistd.h>
 
 namespace {
 
+// Free() skips task-arena blocks under the span allocator. Without it only
+// the HC_RUNTIME_ARENA_FREE_CHECK registry, on in ASan builds, can tell.
+#if !defined(HC_RUNTIME_ALLOCATOR) || HC_RUNTIME_ALLOCATOR || defined(HC_RUNTIME_ARENA_FREE_CHECK) || \
+    defined(__SANITIZE_ADDRESS__)
+constexpr bool kFreeSkipsArenaBlocks = true;
+#else
+constexpr bool kFreeSkipsArenaBlocks = false;
+#endif
+
 volatile std::int64_t g_job_seen = 0;
 std::atomic<std::int64_t> g_spawn_seen{0};
+std::atomic<std::int64_t> g_spawn_arena{0};
+std::atomic<bool> g_spawn_hold{true};
+std::atomic<std::int64_t> g_group_seen{0};
 
 extern "C" std::int64_t AbiConformanceFn(std::int64_t a0, std::int64_t a1, std::int64_t a2) {
   return a0 + a1 + a2;
@@ -20,15 +35,139 @@ extern "C" void AbiConformanceJob(std::int64_t arg) {
   g_job_seen = arg;
 }
 
+extern "C" std::int64_t AbiConformanceSquare(std::int64_t arg) {
+  return arg * arg;
+}
+
+extern "C" std::int64_t AbiConformanceIncrement(std::int64_t arg) {
+  return arg + 1;
+}
+
+extern "C" std::int64_t AbiConformanceReflect(std::int64_t) {
+  return static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(HashFind("Demo", nullptr, 0)));
+}
+
+extern "C" std::int64_t AbiConformanceArena(std::int64_t arg) {
+  CTask* scope = TaskCur();
+  if (scope == nullptr) {
+    return 0;
+  }
+  std::vector<unsigned char*> blocks;
+  for (std::int64_t i = 0; i < arg; ++i) {
+    const std::int64_t size = i % 7 == 0 ? 200000 : 1 + (i * 37) % 900;
+    unsigned char* block = static_cast<unsigned char*>(MAlloc(size, scope));
+    if (block == nullptr || reinterpret_cast<std::uintptr_t>(block) % 16 != 0) {
+      return 0;
+    }
+    std::memset(block, static_cast<int>(i & 0xff), static_cast<std::size_t>(size));
+    blocks.push_back(block);
+  }
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    const std::size_t last = i % 7 == 0 ? 199999 : (i * 37) % 900;
+    if (blocks[i][0] != (i & 0xff) || blocks[i][last] != (i & 0xff)) {
+      return 0;
+    }
+    if (kFreeSkipsArenaBlocks) {
+      Free(blocks[i]);
+    }
+  }
+  return 1;
+}
+
+extern "C" void AbiConformanceSpawnHold(const char*) {
+  while (g_spawn_hold.load(std::memory_order_acquire)) {
+    Sleep(1);
+  }
+}
+
+extern "C" void AbiConformanceSpawnArena(const char*) {
+  g_spawn_arena.store(AbiConformanceArena(300) + 1, std::memory_order_release);
+}
+
+extern "C" void AbiConformanceFill(std::int64_t lo, std::int64_t hi, const char* ctx) {
+  std::int64_t* out = reinterpret_cast<std::int64_t*>(const_cast<char*>(ctx));
+  for (std::int64_t i = lo; i < hi; ++i) {
+    out[i] = i * 2;
+  }
+}
+
+extern "C" std::int64_t AbiConformanceRangeSum(std::int64_t lo, std::int64_t hi, const char*) {
+  std::int64_t sum = 0;
+  for (std::int64_t i = lo; i < hi; ++i) {
+    sum += i;
+  }
+  return sum;
+}
+
+extern "C" std::int64_t AbiConformanceMax(std::int64_t a, std::int64_t b) {
+  return a > b ? a : b;
+}
+
 extern "C" void AbiConformanceSpawn(const char* arg) {
   g_spawn_seen.store(static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(arg)),
                      std::memory_order_release);
 }
 
+extern "C" std::int64_t AbiConformanceDeep(std::int64_t n, std::int64_t throw_at, std::int64_t) {
+  if (n == throw_at) {
+    hc_throw_i64(n);
+  }
+  if (n == 0) {
+    return 0;
+  }
+  const char* self = reinterpret_cast<const char*>(
+      reinterpret_cast<std::uintptr_t>(&AbiConformanceDeep));
+  return 1 + CallStkGrow(0x800, 0x100000, self, n - 1, throw_at, 0);
+}
+
+extern "C" void AbiConformanceGroupChild(const char*) {
+  Sleep(1);
+  g_group_seen.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" void AbiConformanceGroupParent(const char*) {
+  for (int i = 0; i < 3; ++i) {
+    (void)Spawn(
+        reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceGroupChild)),
+        nullptr, "abi-child", -1, nullptr, 0, 0);
+  }
+  g_group_seen.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" std::int64_t AbiConformanceOpenGroup(std::int64_t) {
+  return static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(SpawnGrpBegin()));
+}
+
+extern "C" std::int64_t AbiConformanceSpawnSleep(std::int64_t) {
+  return ProcSpawn("sleep 1", 0);
+}
+
+extern "C" void AbiConformanceFifoProduce(const char* arg) {
+  CFifoI64* fifo = reinterpret_cast<CFifoI64*>(const_cast<char*>(arg));
+  for (std::int64_t i = 1; i <= 1000; ++i) {
+    FifoI64InsWait(fifo, i);
+  }
+}
+
+extern "C" void AbiConformanceFifoConsume(const char* arg) {
+  CFifoI64* fifo = reinterpret_cast<CFifoI64*>(const_cast<char*>(arg));
+  std::int64_t sum = 0;
+  for (std::int64_t i = 1; i <= 1000; ++i) {
+    const std::int64_t value = FifoI64RemWait(fifo);
+    sum += value == i ? value : 0;
+  }
+  g_group_seen.store(sum, std::memory_order_release);
+}
+
 struct CHashClassView {
   CMemberLst* member_lst_and_root;
 };
 
+struct CMemberLstView {
+  const char* str;
+  std::int64_t offset;
+};
+
 }  // namespace
 
 int main() {
@@ -46,12 +185,14 @@ int main() {
     return 2;
   }
 
+  const hc_reflection_meta demo_meta[] = {{"dft_val", 9}, {"print_str", 0}};
   const hc_reflection_field fields[] = {
-      {"Pair", "a", "I64", "visible"},
-      {"Demo", "age", "I64", "dft_val 9 print_str \"%d\""},
+      {"Pair", "a", "I64", "visible", 0, 0, nullptr, 0},
+      {"Pair", "b", "I32", "dft_val 2", 0, 0, nullptr, 0},
+      {"Demo", "age", "I64", "dft_val 9 print_str \"%d\"", 24, 8, demo_meta, 2},
   };
-  hc_register_reflection_table(fields, 2);
-  if (hc_reflection_field_count() != 2) {
+  hc_register_reflection_table(fields, 3);
+  if (hc_reflection_field_count() != 3) {
     return 3;
   }
   const hc_reflection_field* reflected = hc_reflection_fields();
@@ -65,6 +206,13 @@ int main() {
     if (hc_exception_active() == 0 || hc_try_depth() != 1) {
       return 5;
     }
+    hc_try_frame cleanup{};
+    hc_try_push_cleanup(&cleanup);
+    const std::int64_t depth_with_cleanup = hc_try_depth();
+    hc_try_pop(&cleanup);
+    if (depth_with_cleanup != 1) {
+      return 5;
+    }
     hc_throw_i64(42);
     return 6;
   }
@@ -82,12 +230,84 @@ int main() {
   }
   hc_free(ptr);
 
+  const std::size_t alloc_sizes[] = {0, 1, 16, 17, 129, 4096, 131072, 131073, 3 << 20};
+  for (const std::size_t size : alloc_sizes) {
+    unsigned char* block = static_cast<unsigned char*>(hc_malloc(size));
+    if (block == nullptr || (reinterpret_cast<std::uintptr_t>(block) & 15) != 0) {
+      return 39;
+    }
+    std::memset(block, 0xA5, size);
+    hc_free(block);
+  }
+  void* cross_blocks[4096];
+  for (std::size_t i = 0; i < 4096; ++i) {
+    cross_blocks[i] = hc_malloc(16 + (i % 64) * 16);
+  }
+  std::thread cross_free([&cross_blocks] {
+    for (void* block : cross_blocks) {
+      hc_free(block);
+    }
+    for (std::size_t i = 0; i < 1024; ++i) {
+      cross_blocks[i] = hc_malloc(48);
+    }
+  });
+  cross_free.join();
+  for (std::size_t i = 0; i < 1024; ++i) {
+    hc_free(cross_blocks[i]);
+  }
+  std::int64_t* zeroed = static_cast<std::int64_t*>(CAlloc(64 * 8, nullptr));
+  if (zeroed == nullptr || zeroed[0] != 0 || zeroed[63] != 0) {
+    return 39;
+  }
+  Free(zeroed);
+  Free(nullptr);
+  if (TaskCur() != nullptr) {
+    return 40;
+  }
+  CJob* arena_job =
+      JobQue(reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceArena)),
+             reinterpret_cast<const char*>(static_cast<std::uintptr_t>(2000)), -1, 0);
+  std::int64_t* parent_block =
+      static_cast<std::int64_t*>(CAlloc(64, reinterpret_cast<CTask*>(arena_job)));
+  if (parent_block == nullptr || parent_block[7] != 0) {
+    return 40;
+  }
+  if (kFreeSkipsArenaBlocks) {
+    Free(parent_block);
+  }
+  if (JobResGet(arena_job) != 1) {
+    return 40;
+  }
+
   const std::int64_t stkgrow = CallStkGrow(
       0x100, 0x1000, reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceFn)),
       1, 2, 3);
   if (stkgrow != 6) {
     return 10;
   }
+  if (AbiConformanceDeep(200000, -1, 0) != 200000) {
+    return 28;
+  }
+  hc_try_frame deep_frame{};
+  if (hc_try_begin(&deep_frame) == 0) {
+    (void)AbiConformanceDeep(200000, 7, 0);
+    hc_try_end(&deep_frame);
+    return 29;
+  }
+  hc_try_end(&deep_frame);
+  if (hc_exception_payload() != 7 || hc_try_depth() != 0) {
+    return 29;
+  }
+
+  bool unwound = false;
+  try {
+    (void)AbiConformanceDeep(64, 60, 0);
+  } catch (...) {
+    unwound = true;
+  }
+  if (!unwound || hc_exception_payload() != 60 || hc_try_depth() != 0) {
+    return 38;
+  }
 
   CJob* job = JobQue(reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceJob)),
                      reinterpret_cast<const char*>(static_cast<std::uintptr_t>(17)), 0, 0);
@@ -98,6 +318,67 @@ int main() {
   if (g_job_seen != 17) {
     return 12;
   }
+  const char* square_fn =
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceSquare));
+  const char* increment_fn =
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceIncrement));
+  CJob* square = JobQue(square_fn, reinterpret_cast<const char*>(static_cast<std::uintptr_t>(6)),
+                        -1, 0);
+  if (JobResGet(square) != 36) {
+    return 21;
+  }
+  CJob* any_jobs[2] = {
+      JobQue(square_fn, reinterpret_cast<const char*>(static_cast<std::uintptr_t>(2)), -1, 0),
+      JobThen(JobQue(square_fn, reinterpret_cast<const char*>(static_cast<std::uintptr_t>(3)), -1,
+                     0),
+              increment_fn),
+  };
+  std::int64_t any_sum = 0;
+  for (int i = 0; i < 2; ++i) {
+    std::int64_t any_res = 0;
+    if (JobResAny(any_jobs, 2, &any_res) < 0) {
+      return 22;
+    }
+    any_sum += any_res;
+  }
+  if (any_sum != 14 || JobResAny(any_jobs, 2, nullptr) != -1) {
+    return 23;
+  }
+  CJob* scanned = JobQue(square_fn, reinterpret_cast<const char*>(static_cast<std::uintptr_t>(4)),
+                         -1, 0);
+  std::int64_t scan_res = 0;
+  while (!JobResScan(scanned, &scan_res)) {
+    std::this_thread::yield();
+  }
+  if (scan_res != 16) {
+    return 24;
+  }
+
+  std::int64_t filled[1000] = {};
+  JobParFor(0, 1000, 7,
+            reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceFill)),
+            reinterpret_cast<const char*>(filled));
+  for (std::int64_t i = 0; i < 1000; ++i) {
+    if (filled[i] != i * 2) {
+      return 25;
+    }
+  }
+  const char* range_sum_fn =
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceRangeSum));
+  if (JobParReduce(0, 100000, 0, range_sum_fn, nullptr, nullptr, 0) != 4999950000LL) {
+    return 26;
+  }
+  const std::int64_t widest = JobParReduce(
+      0, 1000, 10, range_sum_fn, nullptr,
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceMax)), -1);
+  if (widest <= 0 || JobParReduce(5, 5, 1, range_sum_fn, nullptr, nullptr, 42) != 42) {
+    return 27;
+  }
+
+  hc_job_cpu_stats cpu_stats[64] = {};
+  if (hc_job_cpu_stats_snapshot(cpu_stats, 64) == 0 || cpu_stats[0].executed < 1) {
+    return 20;
+  }
 
   CTask* task = Spawn(
       reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceSpawn)),
@@ -116,6 +397,56 @@ int main() {
     return 14;
   }
 
+  (void)Spawn(
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceSpawnArena)),
+      nullptr, "abi-arena", -1, nullptr, 0, 0);
+  for (int i = 0; i < 2000 && g_spawn_arena.load(std::memory_order_acquire) == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (g_spawn_arena.load(std::memory_order_acquire) != 2) {
+    return 40;
+  }
+
+  // A spawn handle allocates from its task's arena only while the task runs.
+  CSpawnGrp* hold_group = SpawnGrpBegin();
+  CTask* holder = Spawn(
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceSpawnHold)),
+      nullptr, "abi-hold", -1, nullptr, 0, 0);
+  std::int64_t* held_block = static_cast<std::int64_t*>(CAlloc(64, holder));
+  const bool held_ok = holder != nullptr && held_block != nullptr && held_block[7] == 0;
+  g_spawn_hold.store(false, std::memory_order_release);
+  SpawnGrpWait(hold_group);
+  if (!held_ok || MAlloc(16, holder) != nullptr) {
+    return 47;
+  }
+
+  CSpawnGrp* group = SpawnGrpBegin();
+  for (int i = 0; i < 4; ++i) {
+    (void)Spawn(
+        reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceGroupParent)),
+        nullptr, "abi-parent", -1, nullptr, 0, 0);
+  }
+  SpawnGrpWait(group);
+  if (g_group_seen.load(std::memory_order_acquire) != 16) {
+    return 30;
+  }
+
+  // Both jobs are pinned to one worker; the group the first leaves open
+  // must not pick up the command the second one starts.
+  const char* open_group_fn =
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceOpenGroup));
+  const char* spawn_sleep_fn =
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceSpawnSleep));
+  CSpawnGrp* leaked = reinterpret_cast<CSpawnGrp*>(
+      static_cast<std::uintptr_t>(JobResGet(JobQue(open_group_fn, nullptr, 0, 0))));
+  const std::int64_t sleeper = JobResGet(JobQue(spawn_sleep_fn, nullptr, 0, 0));
+  const std::int64_t leaked_count = SpawnGrpCnt(leaked);
+  ProcDel(sleeper);
+  SpawnGrpWait(leaked);
+  if (leaked_count != 0) {
+    return 45;
+  }
+
   CHashClass* demo = HashFind("Demo", nullptr, 0);
   if (demo == nullptr) {
     return 15;
@@ -130,10 +461,271 @@ int main() {
   if (MemberMetaData("dft_val", member) != 9) {
     return 18;
   }
+  if (MemberFind("age", demo) != member || MemberFind("missing", demo) != nullptr ||
+      HashFind("Missing", nullptr, 0) != nullptr) {
+    return 42;
+  }
+  CMemberLst* pair_b = MemberFind("b", HashFind("Pair", nullptr, 0));
+  if (reinterpret_cast<CMemberLstView*>(member)->offset != 24 || pair_b == nullptr ||
+      reinterpret_cast<CMemberLstView*>(pair_b)->offset != 8 ||
+      MemberMetaData("dft_val", pair_b) != 2 || MemberMetaFind("print_str", member) == 0) {
+    return 43;
+  }
+  CJob* reflect = JobQue(
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&AbiConformanceReflect)),
+      nullptr, -1, 0);
+  if (JobResGet(reflect) != static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(demo))) {
+    return 42;
+  }
+  hc_register_reflection_table(fields, 3);
+  if (MemberFind("age", HashFind("Demo", nullptr, 0)) == nullptr) {
+    return 42;
+  }
+  hc_reflection_reset();
+  if (hc_reflection_field_count() != 0 || HashFind("Demo", nullptr, 0) != nullptr) {
+    return 42;
+  }
 
-  if (hc_task_spawn(":") <= 0) {
+  const std::int64_t shell_task = hc_task_spawn(":");
+  if (shell_task <= 0 || ProcWait(shell_task) != 0) {
     return 19;
   }
+  ProcDel(shell_task);
+
+  const std::int64_t echo_task = ProcSpawn("echo abi-out", 1);
+  std::int64_t echo_len = 0;
+  const char* echo_out = ProcOut(echo_task, &echo_len);
+  if (echo_out == nullptr || echo_len != 8 || std::strcmp(echo_out, "abi-out\n") != 0) {
+    return 31;
+  }
+  ProcDel(echo_task);
+
+  const std::int64_t status_task = ProcSpawn("echo abi-err 1>&2; exit 3", 2);
+  std::int64_t status = -1;
+  while (!ProcScan(status_task, &status)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  const char* err_out = ProcErr(status_task, nullptr);
+  if (status != 3 || err_out == nullptr || std::strcmp(err_out, "abi-err\n") != 0) {
+    return 32;
+  }
+  ProcDel(status_task);
+
+  const std::int64_t missing_task = ProcSpawn("holyc-abi-missing-command", 0);
+  if (ProcWait(missing_task) != 127) {
+    return 44;
+  }
+  ProcDel(missing_task);
+
+  // '=' in an argument keeps the direct launch; a leading assignment does not.
+  const std::int64_t option_task = ProcSpawn("holyc-abi-missing-command --opt=1", 2);
+  const std::int64_t option_status = ProcWait(option_task);
+  const char* option_err = ProcErr(option_task, nullptr);
+  if (option_status != 127 || (option_err != nullptr && option_err[0] != '\0')) {
+    return 44;
+  }
+  ProcDel(option_task);
+  const std::int64_t assign_task = ProcSpawn("HOLYC_ABI_ASSIGN=1 true", 0);
+  if (ProcWait(assign_task) != 0) {
+    return 44;
+  }
+  ProcDel(assign_task);
+
+  CFifoU8* bytes = FifoU8New(3, nullptr, 0);
+  std::uint8_t byte = 0;
+  if (bytes == nullptr || FifoU8Rem(bytes, &byte) || !FifoU8Ins(bytes, 0x141) ||
+      !FifoU8Ins(bytes, 2) || !FifoU8Ins(bytes, 3) || !FifoU8Ins(bytes, 4) ||
+      FifoU8Ins(bytes, 5) || FifoU8Cnt(bytes) != 4 || !FifoU8Peek(bytes, &byte) || byte != 0x41 ||
+      !FifoU8Rem(bytes, &byte) || byte != 0x41 || FifoU8RemWait(bytes) != 2) {
+    return 33;
+  }
+  FifoU8Flush(bytes);
+  if (FifoU8Cnt(bytes) != 0 || FifoU8Peek(bytes, &byte)) {
+    return 33;
+  }
+  FifoU8Del(bytes);
+
+  for (std::int64_t flags = 0; flags <= 1; ++flags) {
+    CFifoI64* ring = FifoI64New(4, nullptr, flags);
+    g_group_seen.store(0, std::memory_order_relaxed);
+    CSpawnGrp* fifo_group = SpawnGrpBegin();
+    (void)Spawn(reinterpret_cast<const char*>(
+                    reinterpret_cast<std::uintptr_t>(&AbiConformanceFifoConsume)),
+                reinterpret_cast<const char*>(ring), "abi-fifo-rem", -1, nullptr, 0, 0);
+    (void)Spawn(reinterpret_cast<const char*>(
+                    reinterpret_cast<std::uintptr_t>(&AbiConformanceFifoProduce)),
+                reinterpret_cast<const char*>(ring), "abi-fifo-ins", -1, nullptr, 0, 0);
+    SpawnGrpWait(fifo_group);
+    if (g_group_seen.load(std::memory_order_acquire) != 500500 || FifoI64Cnt(ring) != 0) {
+      return 34;
+    }
+    FifoI64Del(ring);
+  }
+
+  CFifoI64* shared = FifoI64New(64, nullptr, 0);
+  std::thread producers[4];
+  for (std::int64_t t = 0; t < 4; ++t) {
+    producers[t] = std::thread([shared, t] {
+      for (std::int64_t i = 0; i < 10000; ++i) {
+        FifoI64InsWait(shared, t * 10000 + i + 1);
+      }
+    });
+  }
+  std::int64_t fifo_sum = 0;
+  for (std::int64_t i = 0; i < 40000; ++i) {
+    fifo_sum += FifoI64RemWait(shared);
+  }
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+  std::int64_t leftover = 0;
+  if (fifo_sum != 40000LL * 40001LL / 2 || FifoI64Rem(shared, &leftover)) {
+    return 35;
+  }
+  FifoI64Del(shared);
+
+  std::int64_t locked_a = 0;
+  std::int64_t locked_b = 0;
+  std::thread lockers[4];
+  for (std::thread& locker : lockers) {
+    locker = std::thread([&locked_a, &locked_b] {
+      for (int i = 0; i < 20000; ++i) {
+        hc_lock_acquire(&locked_a);
+        hc_lock_acquire(&locked_b);
+        ++locked_a;
+        locked_b -= 2;
+        hc_lock_release(&locked_b);
+        hc_lock_release(&locked_a);
+      }
+    });
+  }
+  for (std::thread& locker : lockers) {
+    locker.join();
+  }
+  if (locked_a != 80000 || locked_b != -160000) {
+    return 36;
+  }
+
+  // Key sets in either order, and the every-stripe form, must exclude one
+  // another without deadlocking.
+  std::thread set_lockers[3];
+  for (std::size_t t = 0; t < 3; ++t) {
+    set_lockers[t] = std::thread([t, &locked_a, &locked_b] {
+      const void* forward[] = {&locked_a, &locked_b};
+      const void* backward[] = {&locked_b, &locked_a};
+      const void* const* keys = t == 0 ? forward : backward;
+      const std::int64_t count = t == 2 ? 0 : 2;
+      for (int i = 0; i < 20000; ++i) {
+        hc_lock_acquire_n(keys, count);
+        ++locked_a;
+        locked_b -= 2;
+        hc_lock_release_n(keys, count);
+      }
+    });
+  }
+  for (std::thread& locker : set_lockers) {
+    locker.join();
+  }
+  if (locked_a != 140000 || locked_b != -280000) {
+    return 46;
+  }
+
+  const double print_real = 3.25;
+  std::int64_t print_real_bits = 0;
+  std::memcpy(&print_real_bits, &print_real, sizeof(print_real_bits));
+  const std::int64_t print_args[] = {
+      -42, 42, 42, -42, 7, 7, 5, 0, 255, 255, 255, 8, -1, -5, 70000, 65, 65,
+      5, 3, 4, 9, 6, 4,
+      static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>("holy")),
+      static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>("holy")),
+      static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>("holy")), 0x1234, 0,
+      print_real_bits, 5, 1,
+      static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>("a\0b\0c\0")), 0};
+  char expected[512];
+  std::snprintf(expected, sizeof(expected),
+                "n=%d|%5d|%-5d|%05d|%+d|% d|%.3d|%.0d|%x|%#X|%#o|%#o|%u|%ld|%hd|%c|%3c|"
+                "%*d|%-*d|%.*d|%s|%.2s|%-6s|%p|%s|%6.2f|%s|%s|%s|%%|%s\n",
+                -42, 42, 42, -42, 7, 7, 5, 0, 255U, 255U, 255U, 8U, 0xffffffffU, -5L,
+                static_cast<short>(70000), 'A', 'A', 5, 3, 4, 9, 6, 4, "holy", "holy", "holy",
+                reinterpret_cast<void*>(static_cast<std::uintptr_t>(0x1234)), "0x0", 3.25, "101",
+                "b", "0x0", "%q");
+  std::strcat(expected, "fmt:[  -42][ff  ][0X2A][+7][00101][ Z][ho    ][2.50]");
+  void* stats_untracked = hc_malloc(20000);
+  hc_runtime_stats_enable(1);
+  hc_free(stats_untracked);
+  void* stats_freed = hc_malloc(100);
+  void* stats_kept = hc_malloc(5000);
+  hc_free(stats_freed);
+  if (JobResGet(JobQue(square_fn, reinterpret_cast<const char*>(static_cast<std::uintptr_t>(3)),
+                       -1, 0)) != 9) {
+    return 41;
+  }
+  hc_try_frame stats_frame{};
+  if (hc_try_begin(&stats_frame) == 0) {
+    hc_throw_i64(1);
+  }
+  hc_try_end(&stats_frame);
+  int print_pipe[2];
+  std::fflush(stdout);
+  const int saved_stdout = dup(STDOUT_FILENO);
+  if (saved_stdout < 0 || pipe(print_pipe) != 0) {
+    return 37;
+  }
+  dup2(print_pipe[1], STDOUT_FILENO);
+  hc_print_fmt("n=%d|%5d|%-5d|%05d|%+d|% d|%.3d|%.0d|%x|%#X|%#o|%#o|%u|%ld|%hd|%c|%3c|"
+               "%*d|%-*d|%.*d|%s|%.2s|%-6s|%p|%P|%6.2f|%b|%z|%P|%%|%q\n",
+               print_args, sizeof(print_args) / sizeof(print_args[0]));
+  hc_fmt_write("fmt:[", 5);
+  hc_fmt_i64_dec(5, 0, -42);
+  hc_fmt_write("][", 2);
+  hc_fmt_u64(16, 4, HC_FMT_LEFT, 255);
+  hc_fmt_write("][", 2);
+  hc_fmt_u64(16, 0, HC_FMT_ALT | HC_FMT_UPPER, 42);
+  hc_fmt_write("][", 2);
+  hc_fmt_i64_dec(0, HC_FMT_PLUS, 7);
+  hc_fmt_write("][", 2);
+  hc_fmt_u64(2, 5, HC_FMT_ZERO, 5);
+  hc_fmt_write("][", 2);
+  hc_fmt_char(2, 0, 'Z');
+  hc_fmt_write("][", 2);
+  hc_fmt_str(6, HC_FMT_LEFT, 2, "holy");
+  hc_fmt_write("][", 2);
+  const double fmt_real = 2.5;
+  std::int64_t fmt_real_bits = 0;
+  std::memcpy(&fmt_real_bits, &fmt_real, sizeof(fmt_real_bits));
+  hc_fmt_f64(2, fmt_real_bits);
+  hc_fmt_write("]", 1);
+  hc_output_flush();
+  std::fflush(stdout);
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  close(print_pipe[1]);
+  char printed[512] = {};
+  std::size_t printed_len = 0;
+  for (;;) {
+    const ssize_t got =
+        read(print_pipe[0], printed + printed_len, sizeof(printed) - 1 - printed_len);
+    if (got <= 0) {
+      break;
+    }
+    printed_len += static_cast<std::size_t>(got);
+  }
+  close(print_pipe[0]);
+  if (std::strcmp(printed, expected) != 0) {
+    return 37;
+  }
+  hc_runtime_counters counters{};
+  hc_runtime_stats(&counters);
+  hc_runtime_stats_enable(0);
+  if (counters.allocs != 2 || counters.frees != 2 || counters.live_bytes < 5000 ||
+      counters.peak_bytes < counters.live_bytes || counters.size_buckets[3] != 1 ||
+      counters.size_buckets[9] != 1 || counters.jobs_run != 1 ||
+      counters.exceptions_thrown != 1 ||
+      counters.bytes_printed != static_cast<std::int64_t>(std::strlen(expected)) ||
+      hc_runtime_thread_stats(nullptr, 0) < 1) {
+    return 41;
+  }
+  hc_free(stats_kept);
 
   return 0;
 }
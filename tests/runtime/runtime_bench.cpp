@@ -0,0 +1,1279 @@
+#include "hc_runtime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+  std::int64_t iterations = 20000;
+};
+
+struct LatencyProbe {
+  Clock::time_point submitted;
+  std::atomic<std::int64_t> started_ns{0};
+};
+
+std::atomic<std::int64_t> g_bench_sink{0};
+
+std::int64_t ElapsedNs(Clock::time_point start, Clock::time_point end) {
+  return static_cast<std::int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+double PerSecond(std::int64_t count, std::int64_t elapsed_ns) {
+  if (elapsed_ns <= 0) {
+    return 0.0;
+  }
+  return static_cast<double>(count) * 1e9 / static_cast<double>(elapsed_ns);
+}
+
+const char* AsFnPtr(void (*fn)(std::int64_t)) {
+  return reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(fn));
+}
+
+const char* AsArg(const void* ptr) {
+  return static_cast<const char*>(ptr);
+}
+
+extern "C" void BenchNopJob(std::int64_t arg) {
+  g_bench_sink.fetch_add(arg, std::memory_order_relaxed);
+}
+
+extern "C" void BenchLatencyJob(std::int64_t arg) {
+  LatencyProbe* probe = reinterpret_cast<LatencyProbe*>(static_cast<std::uintptr_t>(arg));
+  probe->started_ns.store(ElapsedNs(probe->submitted, Clock::now()), std::memory_order_release);
+}
+
+void* BenchThreadPerJobMain(void* opaque) {
+  const std::int64_t arg = static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(opaque));
+  BenchLatencyJob(arg);
+  return nullptr;
+}
+
+void* BenchThreadPerJobNop(void* opaque) {
+  BenchNopJob(static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(opaque)));
+  return nullptr;
+}
+
+void ReportRate(const char* name, std::int64_t count, std::int64_t elapsed_ns) {
+  std::printf("%-32s ops=%lld elapsed_ms=%.3f ops_per_sec=%.0f\n", name,
+              static_cast<long long>(count), static_cast<double>(elapsed_ns) / 1e6,
+              PerSecond(count, elapsed_ns));
+}
+
+void ReportLatency(const char* name, std::vector<std::int64_t>& samples) {
+  if (samples.empty()) {
+    return;
+  }
+  std::int64_t total = 0;
+  for (const std::int64_t sample : samples) {
+    total += sample;
+  }
+  std::vector<std::int64_t> sorted = samples;
+  std::size_t mid = sorted.size() / 2;
+  std::size_t p99 = (sorted.size() * 99) / 100;
+  if (p99 >= sorted.size()) {
+    p99 = sorted.size() - 1;
+  }
+  std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(mid), sorted.end());
+  const std::int64_t median = sorted[mid];
+  std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(p99), sorted.end());
+  std::printf("%-32s samples=%zu mean_ns=%lld median_ns=%lld p99_ns=%lld\n", name, samples.size(),
+              static_cast<long long>(total / static_cast<std::int64_t>(samples.size())),
+              static_cast<long long>(median), static_cast<long long>(sorted[p99]));
+}
+
+void BenchJobs(const BenchConfig& config) {
+  const std::int64_t n = config.iterations;
+
+  std::vector<CJob*> jobs(static_cast<std::size_t>(n));
+  const Clock::time_point pool_start = Clock::now();
+  for (std::int64_t i = 0; i < n; ++i) {
+    jobs[static_cast<std::size_t>(i)] = JobQue(AsFnPtr(&BenchNopJob), AsArg(nullptr), -1, 0);
+  }
+  for (CJob* job : jobs) {
+    (void)JobResGet(job);
+  }
+  ReportRate("jobs.pool.throughput", n, ElapsedNs(pool_start, Clock::now()));
+
+  std::vector<pthread_t> threads(static_cast<std::size_t>(n));
+  const Clock::time_point tpj_start = Clock::now();
+  for (std::int64_t i = 0; i < n; ++i) {
+    pthread_create(&threads[static_cast<std::size_t>(i)], nullptr, BenchThreadPerJobNop, nullptr);
+  }
+  for (pthread_t thread : threads) {
+    pthread_join(thread, nullptr);
+  }
+  ReportRate("jobs.thread_per_job.throughput", n, ElapsedNs(tpj_start, Clock::now()));
+
+  const std::int64_t latency_runs = n < 2000 ? n : 2000;
+  std::vector<std::int64_t> pool_latency;
+  std::vector<std::int64_t> tpj_latency;
+  pool_latency.reserve(static_cast<std::size_t>(latency_runs));
+  tpj_latency.reserve(static_cast<std::size_t>(latency_runs));
+  for (std::int64_t i = 0; i < latency_runs; ++i) {
+    LatencyProbe probe;
+    probe.submitted = Clock::now();
+    CJob* job = JobQue(AsFnPtr(&BenchLatencyJob), AsArg(&probe), -1, 0);
+    (void)JobResGet(job);
+    pool_latency.push_back(probe.started_ns.load(std::memory_order_acquire));
+
+    LatencyProbe tpj_probe;
+    tpj_probe.submitted = Clock::now();
+    pthread_t thread{};
+    pthread_create(&thread, nullptr, BenchThreadPerJobMain, &tpj_probe);
+    pthread_join(thread, nullptr);
+    tpj_latency.push_back(tpj_probe.started_ns.load(std::memory_order_acquire));
+  }
+  ReportLatency("jobs.pool.submit_to_run", pool_latency);
+  ReportLatency("jobs.thread_per_job.submit_to_run", tpj_latency);
+  hc_spawn_wait_all();
+}
+
+void BenchJobsPinned(const BenchConfig& config) {
+  const std::int64_t n = config.iterations;
+  hc_job_cpu_stats before[64] = {};
+  const std::size_t cores = hc_job_cpu_stats_snapshot(before, 64);
+  const std::int64_t spread = cores > 0 ? static_cast<std::int64_t>(cores) : 1;
+
+  std::vector<CJob*> jobs(static_cast<std::size_t>(n));
+  const Clock::time_point pinned_start = Clock::now();
+  for (std::int64_t i = 0; i < n; ++i) {
+    const std::int64_t cpu = before[static_cast<std::size_t>(i % spread)].cpu;
+    jobs[static_cast<std::size_t>(i)] =
+        JobQue(AsFnPtr(&BenchNopJob), AsArg(nullptr), cpu < 0 ? i % spread : cpu, 0);
+  }
+  for (CJob* job : jobs) {
+    (void)JobResGet(job);
+  }
+  ReportRate("jobs.pinned.throughput", n, ElapsedNs(pinned_start, Clock::now()));
+
+  const Clock::time_point any_start = Clock::now();
+  for (std::int64_t i = 0; i < n; ++i) {
+    jobs[static_cast<std::size_t>(i)] = JobQue(AsFnPtr(&BenchNopJob), AsArg(nullptr), -1, 0);
+  }
+  for (CJob* job : jobs) {
+    (void)JobResGet(job);
+  }
+  ReportRate("jobs.any_core.throughput", n, ElapsedNs(any_start, Clock::now()));
+
+  hc_job_cpu_stats after[64] = {};
+  const std::size_t count = hc_job_cpu_stats_snapshot(after, 64);
+  for (std::size_t i = 0; i < count && i < 64; ++i) {
+    std::printf("jobs.core cpu=%lld queue_depth=%lld executed=%lld migrations=%lld\n",
+                static_cast<long long>(after[i].cpu), static_cast<long long>(after[i].queue_depth),
+                static_cast<long long>(after[i].executed),
+                static_cast<long long>(after[i].migrations));
+  }
+}
+
+std::uint64_t MixIndex(std::int64_t i) {
+  std::uint64_t x = static_cast<std::uint64_t>(i) * 0x9E3779B97F4A7C15ULL;
+  x ^= x >> 29;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  return x ^ (x >> 32);
+}
+
+extern "C" void BenchParForBody(std::int64_t lo, std::int64_t hi, const char* ctx) {
+  std::uint64_t* out = reinterpret_cast<std::uint64_t*>(const_cast<char*>(ctx));
+  for (std::int64_t i = lo; i < hi; ++i) {
+    out[i] = MixIndex(i);
+  }
+}
+
+extern "C" std::int64_t BenchParReduceBody(std::int64_t lo, std::int64_t hi, const char*) {
+  std::uint64_t acc = 0;
+  for (std::int64_t i = lo; i < hi; ++i) {
+    acc += MixIndex(i) & 0xFFFFU;
+  }
+  return static_cast<std::int64_t>(acc);
+}
+
+void BenchParFor(const BenchConfig& config) {
+  const std::int64_t n = config.iterations * 1000;
+  hc_job_cpu_stats stats[64] = {};
+  (void)JobResGet(JobQue(AsFnPtr(&BenchNopJob), AsArg(nullptr), -1, 0));
+  const std::size_t cores = hc_job_cpu_stats_snapshot(stats, 64);
+  std::printf("parfor cores=%zu elements=%lld\n", cores, static_cast<long long>(n));
+
+  std::vector<std::uint64_t> out(static_cast<std::size_t>(n));
+  const Clock::time_point serial_start = Clock::now();
+  BenchParForBody(0, n, reinterpret_cast<const char*>(out.data()));
+  ReportRate("parfor.serial", n, ElapsedNs(serial_start, Clock::now()));
+
+  const Clock::time_point par_start = Clock::now();
+  JobParFor(0, n, 0, reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&BenchParForBody)),
+            reinterpret_cast<const char*>(out.data()));
+  ReportRate("parfor.jobparfor", n, ElapsedNs(par_start, Clock::now()));
+
+  const Clock::time_point serial_reduce_start = Clock::now();
+  const std::int64_t serial_sum = BenchParReduceBody(0, n, nullptr);
+  ReportRate("parreduce.serial", n, ElapsedNs(serial_reduce_start, Clock::now()));
+
+  const Clock::time_point reduce_start = Clock::now();
+  const std::int64_t par_sum = JobParReduce(
+      0, n, 0, reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&BenchParReduceBody)),
+      nullptr, nullptr, 0);
+  ReportRate("parreduce.jobparreduce", n, ElapsedNs(reduce_start, Clock::now()));
+  if (par_sum != serial_sum) {
+    std::printf("parreduce mismatch serial=%lld parallel=%lld\n",
+                static_cast<long long>(serial_sum), static_cast<long long>(par_sum));
+  }
+}
+
+extern "C" void BenchFiberNop(const char* data) {
+  (void)data;
+  g_bench_sink.fetch_add(1, std::memory_order_relaxed);
+}
+
+struct PingPong {
+  std::atomic<std::int64_t> turn{0};
+  std::int64_t rounds = 0;
+};
+
+void RunFiberPingPong(PingPong* pp, std::int64_t self, std::int64_t peer) {
+  for (std::int64_t i = 0; i < pp->rounds; ++i) {
+    while (pp->turn.load(std::memory_order_acquire) != self) {
+      Yield();
+    }
+    pp->turn.store(peer, std::memory_order_release);
+  }
+}
+
+extern "C" void BenchFiberPing(const char* data) {
+  RunFiberPingPong(reinterpret_cast<PingPong*>(const_cast<char*>(data)), 0, 1);
+}
+
+extern "C" void BenchFiberPong(const char* data) {
+  RunFiberPingPong(reinterpret_cast<PingPong*>(const_cast<char*>(data)), 1, 0);
+}
+
+struct ThreadPingPong {
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+  std::int64_t turn = 0;
+  std::int64_t rounds = 0;
+};
+
+void* BenchThreadPingPong(void* opaque) {
+  ThreadPingPong* pp = static_cast<ThreadPingPong*>(opaque);
+  pthread_mutex_lock(&pp->mutex);
+  for (std::int64_t i = 0; i < pp->rounds; ++i) {
+    while (pp->turn != 1) {
+      pthread_cond_wait(&pp->cond, &pp->mutex);
+    }
+    pp->turn = 0;
+    pthread_cond_broadcast(&pp->cond);
+  }
+  pthread_mutex_unlock(&pp->mutex);
+  return nullptr;
+}
+
+long MaxRssKb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+const char* AsTaskFn(void (*fn)(const char*)) {
+  return reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(fn));
+}
+
+void BenchFibers(const BenchConfig& config) {
+  const std::int64_t n = config.iterations * 5;
+  const long rss_before = MaxRssKb();
+  const Clock::time_point spawn_start = Clock::now();
+  for (std::int64_t i = 0; i < n; ++i) {
+    (void)Spawn(AsTaskFn(&BenchFiberNop), nullptr, nullptr, -1, nullptr, 0, 0);
+  }
+  hc_spawn_wait_all();
+  ReportRate("fibers.spawn_complete", n, ElapsedNs(spawn_start, Clock::now()));
+  std::printf("%-32s tasks=%lld max_rss_kb=%ld delta_kb=%ld\n", "fibers.memory",
+              static_cast<long long>(n), MaxRssKb(), MaxRssKb() - rss_before);
+
+  const std::int64_t thread_runs = n < 2000 ? n : 2000;
+  std::vector<pthread_t> threads(static_cast<std::size_t>(thread_runs));
+  const Clock::time_point thread_start = Clock::now();
+  for (pthread_t& thread : threads) {
+    pthread_create(&thread, nullptr, BenchThreadPerJobNop, nullptr);
+  }
+  for (pthread_t thread : threads) {
+    pthread_join(thread, nullptr);
+  }
+  ReportRate("fibers.pthread_baseline", thread_runs, ElapsedNs(thread_start, Clock::now()));
+
+  const std::int64_t rounds = config.iterations;
+  PingPong pp;
+  pp.rounds = rounds;
+  const Clock::time_point yield_start = Clock::now();
+  (void)Spawn(AsTaskFn(&BenchFiberPing), reinterpret_cast<const char*>(&pp), nullptr, 0, nullptr,
+              0, 0);
+  (void)Spawn(AsTaskFn(&BenchFiberPong), reinterpret_cast<const char*>(&pp), nullptr, 0, nullptr,
+              0, 0);
+  hc_spawn_wait_all();
+  ReportRate("fibers.yield_pingpong", rounds * 2, ElapsedNs(yield_start, Clock::now()));
+
+  ThreadPingPong tpp;
+  tpp.rounds = rounds;
+  pthread_t peer{};
+  pthread_create(&peer, nullptr, BenchThreadPingPong, &tpp);
+  const Clock::time_point cond_start = Clock::now();
+  pthread_mutex_lock(&tpp.mutex);
+  for (std::int64_t i = 0; i < rounds; ++i) {
+    tpp.turn = 1;
+    pthread_cond_broadcast(&tpp.cond);
+    while (tpp.turn != 0) {
+      pthread_cond_wait(&tpp.cond, &tpp.mutex);
+    }
+  }
+  pthread_mutex_unlock(&tpp.mutex);
+  pthread_join(peer, nullptr);
+  ReportRate("fibers.condvar_pingpong", rounds * 2, ElapsedNs(cond_start, Clock::now()));
+}
+
+extern "C" std::int64_t BenchStkGrowRecurse(std::int64_t n, std::int64_t, std::int64_t) {
+  if (n == 0) {
+    return 0;
+  }
+  const char* self =
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&BenchStkGrowRecurse));
+  return 1 + CallStkGrow(0x800, 0x1000000, self, n - 1, 0, 0);
+}
+
+extern "C" std::int64_t BenchPlainRecurse(std::int64_t n, std::int64_t, std::int64_t) {
+  if (n == 0) {
+    return 0;
+  }
+  return 1 + BenchPlainRecurse(n - 1, 0, 0) + g_bench_sink.load(std::memory_order_relaxed);
+}
+
+void BenchStkGrow(const BenchConfig& config) {
+  const std::int64_t depths[] = {1000, 10000, 100000, 1000000, 2 * 1024 * 1024};
+  const std::int64_t max_depth = config.iterations * 128;
+  for (const std::int64_t depth : depths) {
+    if (depth > max_depth && depth != depths[0]) {
+      break;
+    }
+    char name[64];
+    const Clock::time_point grow_start = Clock::now();
+    const std::int64_t grow = BenchStkGrowRecurse(depth, 0, 0);
+    std::snprintf(name, sizeof(name), "stkgrow.per_frame.%lld", static_cast<long long>(depth));
+    ReportRate(name, grow, ElapsedNs(grow_start, Clock::now()));
+
+    const Clock::time_point once_start = Clock::now();
+    const std::int64_t once = CallStkGrow(
+        depth * 256 + 0x800, depth * 256 + 0x800,
+        reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&BenchPlainRecurse)), depth,
+        0, 0);
+    std::snprintf(name, sizeof(name), "stkgrow.up_front.%lld", static_cast<long long>(depth));
+    ReportRate(name, once, ElapsedNs(once_start, Clock::now()));
+  }
+
+  const std::int64_t calls = config.iterations;
+  const char* plain =
+      reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(&BenchPlainRecurse));
+  const Clock::time_point reuse_start = Clock::now();
+  for (std::int64_t i = 0; i < calls; ++i) {
+    (void)CallStkGrow(0x1000000, 0x1000000, plain, 8, 0, 0);
+  }
+  ReportRate("stkgrow.segment_reuse", calls, ElapsedNs(reuse_start, Clock::now()));
+
+  const Clock::time_point direct_start = Clock::now();
+  for (std::int64_t i = 0; i < calls; ++i) {
+    (void)CallStkGrow(0, 0, plain, 8, 0, 0);
+  }
+  ReportRate("stkgrow.direct_call", calls, ElapsedNs(direct_start, Clock::now()));
+}
+
+struct SpawnChurnArgs {
+  std::int64_t tasks = 0;
+  bool grouped = false;
+};
+
+void* BenchSpawnChurnMain(void* opaque) {
+  const SpawnChurnArgs* args = static_cast<const SpawnChurnArgs*>(opaque);
+  const std::int64_t batch = 64;
+  for (std::int64_t done = 0; done < args->tasks; done += batch) {
+    CSpawnGrp* group = args->grouped ? SpawnGrpBegin() : nullptr;
+    for (std::int64_t i = 0; i < batch; ++i) {
+      (void)Spawn(AsTaskFn(&BenchFiberNop), nullptr, nullptr, -1, nullptr, 0, 0);
+    }
+    if (group != nullptr) {
+      SpawnGrpWait(group);
+    }
+  }
+  return nullptr;
+}
+
+struct MutexAccounting {
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+  std::int64_t inflight = 0;
+  std::int64_t pairs = 0;
+};
+
+void* BenchMutexAccountingMain(void* opaque) {
+  MutexAccounting* acct = static_cast<MutexAccounting*>(opaque);
+  for (std::int64_t i = 0; i < acct->pairs; ++i) {
+    pthread_mutex_lock(&acct->mutex);
+    ++acct->inflight;
+    pthread_mutex_unlock(&acct->mutex);
+    pthread_mutex_lock(&acct->mutex);
+    if (--acct->inflight == 0) {
+      pthread_cond_broadcast(&acct->cond);
+    }
+    pthread_mutex_unlock(&acct->mutex);
+  }
+  return nullptr;
+}
+
+struct AtomicAccounting {
+  std::atomic<std::int64_t> inflight{0};
+  std::atomic<std::int32_t> waiters{0};
+  std::int64_t pairs = 0;
+};
+
+void* BenchAtomicAccountingMain(void* opaque) {
+  AtomicAccounting* acct = static_cast<AtomicAccounting*>(opaque);
+  for (std::int64_t i = 0; i < acct->pairs; ++i) {
+    acct->inflight.fetch_add(1, std::memory_order_relaxed);
+    if (acct->inflight.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+        acct->waiters.load(std::memory_order_seq_cst) > 0) {
+      g_bench_sink.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  return nullptr;
+}
+
+template <typename Accounting>
+void RunAccountingBench(const char* name, int threads, std::int64_t pairs,
+                        void* (*body)(void*)) {
+  Accounting acct;
+  acct.pairs = pairs;
+  std::vector<pthread_t> workers(static_cast<std::size_t>(threads));
+  const Clock::time_point start = Clock::now();
+  for (pthread_t& worker : workers) {
+    pthread_create(&worker, nullptr, body, &acct);
+  }
+  for (pthread_t worker : workers) {
+    pthread_join(worker, nullptr);
+  }
+  ReportRate(name, pairs * threads, ElapsedNs(start, Clock::now()));
+}
+
+void BenchSpawnContention(const BenchConfig& config) {
+  const int thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+  const std::int64_t total = config.iterations * 5;
+  for (const int threads : thread_counts) {
+    const std::int64_t per_thread = std::max<std::int64_t>(total / threads, 64);
+    char name[64];
+    for (const bool grouped : {false, true}) {
+      SpawnChurnArgs args;
+      args.tasks = per_thread;
+      args.grouped = grouped;
+      std::vector<pthread_t> workers(static_cast<std::size_t>(threads));
+      const Clock::time_point start = Clock::now();
+      for (pthread_t& worker : workers) {
+        pthread_create(&worker, nullptr, BenchSpawnChurnMain, &args);
+      }
+      for (pthread_t worker : workers) {
+        pthread_join(worker, nullptr);
+      }
+      hc_spawn_wait_all();
+      std::snprintf(name, sizeof(name), "spawn.%s.threads_%d", grouped ? "grouped" : "wait_all",
+                    threads);
+      ReportRate(name, per_thread * threads, ElapsedNs(start, Clock::now()));
+    }
+
+    const std::int64_t pairs = per_thread * 10;
+    std::snprintf(name, sizeof(name), "accounting.mutex.threads_%d", threads);
+    RunAccountingBench<MutexAccounting>(name, threads, pairs, BenchMutexAccountingMain);
+    std::snprintf(name, sizeof(name), "accounting.atomic.threads_%d", threads);
+    RunAccountingBench<AtomicAccounting>(name, threads, pairs, BenchAtomicAccountingMain);
+  }
+}
+
+void* BenchSystemThreadMain(void* opaque) {
+  const char* command = static_cast<const char*>(opaque);
+  g_bench_sink.fetch_add(std::system(command), std::memory_order_relaxed);
+  return nullptr;
+}
+
+void BenchProcs(const BenchConfig& config) {
+  const std::int64_t n = std::max<std::int64_t>(config.iterations / 20, 8);
+  const char* commands[] = {"true", "true; true"};
+  for (const char* command : commands) {
+    char name[64];
+    std::vector<pthread_t> threads(static_cast<std::size_t>(n));
+    const Clock::time_point system_start = Clock::now();
+    for (pthread_t& thread : threads) {
+      pthread_create(&thread, nullptr, BenchSystemThreadMain, const_cast<char*>(command));
+    }
+    for (pthread_t thread : threads) {
+      pthread_join(thread, nullptr);
+    }
+    std::snprintf(name, sizeof(name), "procs.thread_system.%s",
+                  std::strchr(command, ';') != nullptr ? "shell" : "direct");
+    ReportRate(name, n, ElapsedNs(system_start, Clock::now()));
+
+    std::vector<std::int64_t> procs(static_cast<std::size_t>(n));
+    const Clock::time_point pool_start = Clock::now();
+    for (std::int64_t& proc : procs) {
+      proc = ProcSpawn(command, 0);
+    }
+    for (const std::int64_t proc : procs) {
+      g_bench_sink.fetch_add(ProcWait(proc), std::memory_order_relaxed);
+      ProcDel(proc);
+    }
+    std::snprintf(name, sizeof(name), "procs.pool.%s",
+                  std::strchr(command, ';') != nullptr ? "shell" : "direct");
+    ReportRate(name, n, ElapsedNs(pool_start, Clock::now()));
+  }
+
+  const std::int64_t captures = std::max<std::int64_t>(n / 4, 4);
+  std::int64_t captured = 0;
+  const Clock::time_point capture_start = Clock::now();
+  for (std::int64_t i = 0; i < captures; ++i) {
+    const std::int64_t proc = ProcSpawn("echo captured", 1);
+    std::int64_t len = 0;
+    (void)ProcOut(proc, &len);
+    captured += len;
+    ProcDel(proc);
+  }
+  ReportRate("procs.capture_stdout", captures, ElapsedNs(capture_start, Clock::now()));
+  g_bench_sink.fetch_add(captured, std::memory_order_relaxed);
+}
+
+struct FifoBenchArgs {
+  CFifoI64* fifo;
+  std::int64_t messages;
+  bool blocking;
+};
+
+void* BenchFifoProducerMain(void* opaque) {
+  FifoBenchArgs* args = static_cast<FifoBenchArgs*>(opaque);
+  for (std::int64_t i = 1; i <= args->messages; ++i) {
+    if (args->blocking) {
+      FifoI64InsWait(args->fifo, i);
+      continue;
+    }
+    while (!FifoI64Ins(args->fifo, i)) {
+      sched_yield();
+    }
+  }
+  return nullptr;
+}
+
+void* BenchFifoConsumerMain(void* opaque) {
+  FifoBenchArgs* args = static_cast<FifoBenchArgs*>(opaque);
+  std::int64_t sum = 0;
+  for (std::int64_t i = 0; i < args->messages; ++i) {
+    if (args->blocking) {
+      sum += FifoI64RemWait(args->fifo);
+      continue;
+    }
+    std::int64_t value = 0;
+    while (!FifoI64Rem(args->fifo, &value)) {
+      sched_yield();
+    }
+    sum += value;
+  }
+  g_bench_sink.fetch_add(sum, std::memory_order_relaxed);
+  return nullptr;
+}
+
+struct LockedQueue {
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+  std::vector<std::int64_t> ring;
+  std::size_t head = 0;
+  std::size_t count = 0;
+  std::int64_t messages = 0;
+};
+
+void* BenchLockedProducerMain(void* opaque) {
+  LockedQueue* queue = static_cast<LockedQueue*>(opaque);
+  for (std::int64_t i = 1; i <= queue->messages; ++i) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == queue->ring.size()) {
+      pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    queue->ring[(queue->head + queue->count) % queue->ring.size()] = i;
+    ++queue->count;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+  }
+  return nullptr;
+}
+
+void* BenchLockedConsumerMain(void* opaque) {
+  LockedQueue* queue = static_cast<LockedQueue*>(opaque);
+  std::int64_t sum = 0;
+  for (std::int64_t i = 0; i < queue->messages; ++i) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0) {
+      pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    sum += queue->ring[queue->head];
+    queue->head = (queue->head + 1) % queue->ring.size();
+    --queue->count;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+  }
+  g_bench_sink.fetch_add(sum, std::memory_order_relaxed);
+  return nullptr;
+}
+
+void RunFifoBench(const char* name, std::int64_t flags, int pairs, std::int64_t messages,
+                  bool blocking) {
+  FifoBenchArgs args;
+  args.fifo = FifoI64New(1024, nullptr, flags);
+  args.messages = messages / pairs;
+  args.blocking = blocking;
+  std::vector<pthread_t> threads(static_cast<std::size_t>(pairs) * 2);
+  const Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < threads.size(); ++i) {
+    pthread_create(&threads[i], nullptr, i % 2 == 0 ? BenchFifoProducerMain : BenchFifoConsumerMain,
+                   &args);
+  }
+  for (pthread_t thread : threads) {
+    pthread_join(thread, nullptr);
+  }
+  ReportRate(name, args.messages * pairs, ElapsedNs(start, Clock::now()));
+  FifoI64Del(args.fifo);
+}
+
+void BenchFifo(const BenchConfig& config) {
+  const std::int64_t messages = config.iterations * 50;
+  for (const std::int64_t flags : {std::int64_t{1}, std::int64_t{0}}) {
+    CFifoI64* fifo = FifoI64New(1024, nullptr, flags);
+    std::int64_t sum = 0;
+    const Clock::time_point start = Clock::now();
+    for (std::int64_t i = 0; i < messages; i += 64) {
+      for (std::int64_t j = 0; j < 64; ++j) {
+        (void)FifoI64Ins(fifo, i + j);
+      }
+      std::int64_t value = 0;
+      while (FifoI64Rem(fifo, &value)) {
+        sum += value;
+      }
+    }
+    ReportRate(flags != 0 ? "fifo.spsc.local" : "fifo.mpmc.local", messages,
+               ElapsedNs(start, Clock::now()));
+    g_bench_sink.fetch_add(sum, std::memory_order_relaxed);
+    FifoI64Del(fifo);
+  }
+  RunFifoBench("fifo.spsc.spin", 1, 1, messages, false);
+  RunFifoBench("fifo.spsc.wait", 1, 1, messages, true);
+  const int pair_counts[] = {1, 2, 4, 8};
+  for (const int pairs : pair_counts) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "fifo.mpmc.spin.pairs_%d", pairs);
+    RunFifoBench(name, 0, pairs, messages, false);
+    std::snprintf(name, sizeof(name), "fifo.mpmc.wait.pairs_%d", pairs);
+    RunFifoBench(name, 0, pairs, messages, true);
+
+    LockedQueue queue;
+    queue.ring.resize(1024);
+    queue.messages = messages / pairs;
+    std::vector<pthread_t> threads(static_cast<std::size_t>(pairs) * 2);
+    const Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+      pthread_create(&threads[i], nullptr,
+                     i % 2 == 0 ? BenchLockedProducerMain : BenchLockedConsumerMain, &queue);
+    }
+    for (pthread_t thread : threads) {
+      pthread_join(thread, nullptr);
+    }
+    std::snprintf(name, sizeof(name), "fifo.mutex_condvar.pairs_%d", pairs);
+    ReportRate(name, queue.messages * pairs, ElapsedNs(start, Clock::now()));
+  }
+}
+
+struct LockBenchArgs {
+  std::int64_t rounds;
+  std::int64_t* shared_a;
+  std::int64_t* shared_b;
+  pthread_mutex_t* mutex;
+  std::atomic<std::int64_t>* counter;
+  int mode;
+};
+
+void* BenchLockMain(void* opaque) {
+  LockBenchArgs* args = static_cast<LockBenchArgs*>(opaque);
+  for (std::int64_t i = 0; i < args->rounds; ++i) {
+    if (args->mode == 0) {
+      hc_lock_acquire(args->shared_a);
+      *args->shared_a += 1;
+      *args->shared_b -= 1;
+      hc_lock_release(args->shared_a);
+    } else if (args->mode == 1) {
+      pthread_mutex_lock(args->mutex);
+      *args->shared_a += 1;
+      *args->shared_b -= 1;
+      pthread_mutex_unlock(args->mutex);
+    } else if (args->mode == 2) {
+      args->counter->fetch_add(1, std::memory_order_seq_cst);
+    } else {
+      std::int64_t current = args->counter->load(std::memory_order_relaxed);
+      while (!args->counter->compare_exchange_weak(current, current * 3 + 1,
+                                                   std::memory_order_seq_cst)) {
+      }
+    }
+  }
+  return nullptr;
+}
+
+void BenchLock(const BenchConfig& config) {
+  const char* mode_names[] = {"striped", "mutex", "atomicrmw", "cmpxchg"};
+  const int thread_counts[] = {1, 2, 4, 8};
+  const std::int64_t total = config.iterations * 50;
+  for (const int threads : thread_counts) {
+    for (int mode = 0; mode < 4; ++mode) {
+      std::int64_t shared_a = 0;
+      std::int64_t shared_b = 0;
+      pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+      std::atomic<std::int64_t> counter{0};
+      LockBenchArgs args{total / threads, &shared_a, &shared_b, &mutex, &counter, mode};
+      std::vector<pthread_t> workers(static_cast<std::size_t>(threads));
+      const Clock::time_point start = Clock::now();
+      for (pthread_t& worker : workers) {
+        pthread_create(&worker, nullptr, BenchLockMain, &args);
+      }
+      for (pthread_t worker : workers) {
+        pthread_join(worker, nullptr);
+      }
+      char name[64];
+      std::snprintf(name, sizeof(name), "lock.%s.threads_%d", mode_names[mode], threads);
+      ReportRate(name, args.rounds * threads, ElapsedNs(start, Clock::now()));
+      g_bench_sink.fetch_add(shared_a + shared_b + counter.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+    }
+  }
+}
+
+struct PrintBenchArgs {
+  std::int64_t lines;
+  int mode;
+};
+
+void LegacyPrintLine(std::int64_t index, const char* name, std::int64_t value) {
+  const char* format = "item %d: %s = 0x%08x\n";
+  for (const char* cur = format; *cur != '\0'; ++cur) {
+    if (*cur != '%') {
+      std::fputc(*cur, stdout);
+      continue;
+    }
+    if (cur[1] == 'd') {
+      std::fprintf(stdout, "%d", static_cast<int>(index));
+      cur += 1;
+    } else if (cur[1] == 's') {
+      std::fprintf(stdout, "%s", name);
+      cur += 1;
+    } else {
+      std::fprintf(stdout, "%08x", static_cast<unsigned>(value));
+      cur += 4;
+    }
+  }
+}
+
+void* BenchPrintMain(void* opaque) {
+  const PrintBenchArgs* args = static_cast<const PrintBenchArgs*>(opaque);
+  const char* name = "holyc";
+  for (std::int64_t i = 0; i < args->lines; ++i) {
+    if (args->mode == 0) {
+      LegacyPrintLine(i, name, i * 2654435761LL);
+    } else if (args->mode == 1) {
+      const std::int64_t line_args[] = {
+          i, static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(name)), i * 2654435761LL};
+      hc_print_fmt("item %d: %s = 0x%08x\n", line_args, 3);
+    } else {
+      hc_fmt_write("item ", 5);
+      hc_fmt_i64_dec(0, 0, static_cast<std::int32_t>(i));
+      hc_fmt_write(": ", 2);
+      hc_fmt_str(0, 0, -1, name);
+      hc_fmt_write(" = 0x", 5);
+      hc_fmt_u64(16, 8, HC_FMT_ZERO, (i * 2654435761LL) & 0xffffffffLL);
+      hc_fmt_write("\n", 1);
+    }
+  }
+  hc_output_flush();
+  return nullptr;
+}
+
+void BenchPrint(const BenchConfig& config) {
+  const std::int64_t total = config.iterations * 25;
+  const int thread_counts[] = {1, 4};
+  const char* mode_names[] = {"legacy", "buffered", "specialized"};
+  char reports[6][128];
+  int report_count = 0;
+  std::fflush(stdout);
+  const int saved_stdout = dup(STDOUT_FILENO);
+  const int null_fd = open("/dev/null", O_WRONLY);
+  if (saved_stdout < 0 || null_fd < 0) {
+    return;
+  }
+  dup2(null_fd, STDOUT_FILENO);
+  for (const int threads : thread_counts) {
+    for (int mode = 0; mode < 3; ++mode) {
+      PrintBenchArgs args{total / threads, mode};
+      std::vector<pthread_t> workers(static_cast<std::size_t>(threads));
+      const Clock::time_point start = Clock::now();
+      for (pthread_t& worker : workers) {
+        pthread_create(&worker, nullptr, BenchPrintMain, &args);
+      }
+      for (pthread_t worker : workers) {
+        pthread_join(worker, nullptr);
+      }
+      std::fflush(stdout);
+      const std::int64_t elapsed_ns = ElapsedNs(start, Clock::now());
+      char name[64];
+      std::snprintf(name, sizeof(name), "print.%s.threads_%d", mode_names[mode], threads);
+      std::snprintf(reports[report_count++], sizeof(reports[0]),
+                    "%-32s ops=%lld elapsed_ms=%.3f ops_per_sec=%.0f", name,
+                    static_cast<long long>(args.lines * threads),
+                    static_cast<double>(elapsed_ns) / 1e6,
+                    PerSecond(args.lines * threads, elapsed_ns));
+    }
+  }
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  close(null_fd);
+  for (int i = 0; i < report_count; ++i) {
+    std::printf("%s\n", reports[i]);
+  }
+}
+
+extern "C" __attribute__((noinline)) std::int64_t BenchThrowChain(std::int64_t depth,
+                                                                  std::int64_t throw_at) {
+  if (depth == throw_at) {
+    hc_throw_i64(depth);
+  }
+  if (depth == 0) {
+    return g_bench_sink.load(std::memory_order_relaxed);
+  }
+  return 1 + BenchThrowChain(depth - 1, throw_at);
+}
+
+// Keeps the setjmp region out of the benchmark loops so their locals are not
+// live across the setjmp and cannot be clobbered by the longjmp.
+extern "C" __attribute__((noinline)) std::int64_t BenchSetjmpTry(std::int64_t depth,
+                                                                 std::int64_t throw_at) {
+  hc_try_frame frame;
+  if (hc_try_begin(&frame) == 0) {
+    const std::int64_t value = BenchThrowChain(depth, throw_at);
+    hc_try_end(&frame);
+    return value;
+  }
+  return hc_exception_payload();
+}
+
+void BenchExceptions(const BenchConfig& config) {
+  const std::int64_t n = config.iterations * 50;
+  std::int64_t sum = 0;
+
+  const Clock::time_point none_start = Clock::now();
+  for (std::int64_t i = 0; i < n; ++i) {
+    sum += BenchThrowChain(0, -1);
+  }
+  ReportRate("exceptions.try_entry.none", n, ElapsedNs(none_start, Clock::now()));
+
+  const Clock::time_point setjmp_start = Clock::now();
+  for (std::int64_t i = 0; i < n; ++i) {
+    sum += BenchSetjmpTry(0, -1);
+  }
+  ReportRate("exceptions.try_entry.setjmp", n, ElapsedNs(setjmp_start, Clock::now()));
+
+  const Clock::time_point table_start = Clock::now();
+  for (std::int64_t i = 0; i < n; ++i) {
+    try {
+      sum += BenchThrowChain(0, -1);
+    } catch (...) {
+      sum -= 1;
+    }
+  }
+  ReportRate("exceptions.try_entry.table", n, ElapsedNs(table_start, Clock::now()));
+
+  const std::int64_t throws = config.iterations;
+  const std::int64_t depths[] = {1, 16};
+  for (const std::int64_t depth : depths) {
+    char name[64];
+    const Clock::time_point setjmp_throw_start = Clock::now();
+    for (std::int64_t i = 0; i < throws; ++i) {
+      sum += BenchSetjmpTry(depth, 0);
+    }
+    std::snprintf(name, sizeof(name), "exceptions.throw.setjmp.depth_%lld",
+                  static_cast<long long>(depth));
+    ReportRate(name, throws, ElapsedNs(setjmp_throw_start, Clock::now()));
+
+    const Clock::time_point table_throw_start = Clock::now();
+    for (std::int64_t i = 0; i < throws; ++i) {
+      try {
+        sum += BenchThrowChain(depth, 0);
+      } catch (...) {
+        sum += hc_exception_payload();
+      }
+    }
+    std::snprintf(name, sizeof(name), "exceptions.throw.table.depth_%lld",
+                  static_cast<long long>(depth));
+    ReportRate(name, throws, ElapsedNs(table_throw_start, Clock::now()));
+  }
+  g_bench_sink.fetch_add(sum & 1, std::memory_order_relaxed);
+}
+
+struct MallocBenchArgs {
+  std::int64_t rounds;
+  int mode;
+  std::uint64_t seed;
+  std::atomic<void*>* pipe;
+};
+
+constexpr std::size_t kMallocBenchSlots = 256;
+constexpr std::size_t kMallocBenchPipe = 1024;
+
+void* BenchAllocate(int mode, std::size_t size) {
+  return mode == 0 ? hc_malloc(size) : std::malloc(size);
+}
+
+void BenchRelease(int mode, void* ptr) {
+  if (mode == 0) {
+    hc_free(ptr);
+  } else {
+    std::free(ptr);
+  }
+}
+
+void* BenchMallocChurnMain(void* opaque) {
+  const MallocBenchArgs* args = static_cast<const MallocBenchArgs*>(opaque);
+  void* slots[kMallocBenchSlots] = {};
+  std::uint64_t seed = args->seed;
+  for (std::int64_t i = 0; i < args->rounds; ++i) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const std::size_t slot = static_cast<std::size_t>(seed >> 33) % kMallocBenchSlots;
+    const std::size_t size = 16 + static_cast<std::size_t>(seed >> 40) % 496;
+    if (slots[slot] != nullptr) {
+      BenchRelease(args->mode, slots[slot]);
+    }
+    char* block = static_cast<char*>(BenchAllocate(args->mode, size));
+    block[0] = static_cast<char>(i);
+    slots[slot] = block;
+  }
+  for (void* block : slots) {
+    if (block != nullptr) {
+      BenchRelease(args->mode, block);
+    }
+  }
+  return nullptr;
+}
+
+void* BenchMallocProducerMain(void* opaque) {
+  const MallocBenchArgs* args = static_cast<const MallocBenchArgs*>(opaque);
+  for (std::int64_t i = 0; i < args->rounds; ++i) {
+    std::atomic<void*>& cell = args->pipe[static_cast<std::size_t>(i) % kMallocBenchPipe];
+    char* block = static_cast<char*>(BenchAllocate(args->mode, 16 + static_cast<std::size_t>(i % 31) * 16));
+    block[0] = static_cast<char>(i);
+    while (cell.load(std::memory_order_acquire) != nullptr) {
+      sched_yield();
+    }
+    cell.store(block, std::memory_order_release);
+  }
+  return nullptr;
+}
+
+void* BenchMallocConsumerMain(void* opaque) {
+  const MallocBenchArgs* args = static_cast<const MallocBenchArgs*>(opaque);
+  for (std::int64_t i = 0; i < args->rounds; ++i) {
+    std::atomic<void*>& cell = args->pipe[static_cast<std::size_t>(i) % kMallocBenchPipe];
+    void* block = cell.load(std::memory_order_acquire);
+    while (block == nullptr) {
+      sched_yield();
+      block = cell.load(std::memory_order_acquire);
+    }
+    cell.store(nullptr, std::memory_order_release);
+    BenchRelease(args->mode, block);
+  }
+  return nullptr;
+}
+
+void BenchMalloc(const BenchConfig& config) {
+  const char* mode_names[] = {"hc_malloc", "libc"};
+  const int thread_counts[] = {1, 4, 8};
+  const std::int64_t rounds = config.iterations * 50;
+  for (const int threads : thread_counts) {
+    for (int mode = 0; mode < 2; ++mode) {
+      std::vector<MallocBenchArgs> args(static_cast<std::size_t>(threads));
+      std::vector<pthread_t> workers(static_cast<std::size_t>(threads));
+      const Clock::time_point start = Clock::now();
+      for (std::size_t i = 0; i < workers.size(); ++i) {
+        args[i] = MallocBenchArgs{rounds, mode, 0x9E3779B97F4A7C15ULL * (i + 1), nullptr};
+        pthread_create(&workers[i], nullptr, BenchMallocChurnMain, &args[i]);
+      }
+      for (pthread_t worker : workers) {
+        pthread_join(worker, nullptr);
+      }
+      char name[64];
+      std::snprintf(name, sizeof(name), "malloc.churn.%s.threads_%d", mode_names[mode], threads);
+      ReportRate(name, rounds * threads, ElapsedNs(start, Clock::now()));
+    }
+  }
+  for (int mode = 0; mode < 2; ++mode) {
+    std::vector<std::atomic<void*>> pipe(kMallocBenchPipe);
+    for (std::atomic<void*>& cell : pipe) {
+      cell.store(nullptr, std::memory_order_relaxed);
+    }
+    MallocBenchArgs args{rounds, mode, 0, pipe.data()};
+    pthread_t producer;
+    pthread_t consumer;
+    const Clock::time_point start = Clock::now();
+    pthread_create(&producer, nullptr, BenchMallocProducerMain, &args);
+    pthread_create(&consumer, nullptr, BenchMallocConsumerMain, &args);
+    pthread_join(producer, nullptr);
+    pthread_join(consumer, nullptr);
+    char name[64];
+    std::snprintf(name, sizeof(name), "malloc.xthread.%s", mode_names[mode]);
+    ReportRate(name, rounds, ElapsedNs(start, Clock::now()));
+  }
+}
+
+extern "C" void BenchArenaJob(std::int64_t arg) {
+  const int mode = static_cast<int>(arg & 3);
+  const std::size_t temps = static_cast<std::size_t>(arg >> 2);
+  CTask* scope = mode == 2 ? TaskCur() : nullptr;
+  std::vector<void*> blocks(mode == 2 ? 0 : temps);
+  std::uint64_t seed = 0x2545F4914F6CDD1DULL ^ temps;
+  std::int64_t sum = 0;
+  for (std::size_t i = 0; i < temps; ++i) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const std::size_t size = 16 + static_cast<std::size_t>(seed >> 40) % 496;
+    char* block = static_cast<char*>(mode == 2 ? MAlloc(static_cast<std::int64_t>(size), scope)
+                                               : BenchAllocate(mode, size));
+    block[0] = static_cast<char>(i);
+    sum += block[0];
+    if (mode != 2) {
+      blocks[i] = block;
+    }
+  }
+  for (void* block : blocks) {
+    BenchRelease(mode, block);
+  }
+  g_bench_sink.fetch_add(sum, std::memory_order_relaxed);
+}
+
+const char* ArenaJobArg(int mode, std::int64_t temps) {
+  return reinterpret_cast<const char*>(static_cast<std::uintptr_t>((temps << 2) | mode));
+}
+
+void BenchArena(const BenchConfig& config) {
+  const char* mode_names[] = {"hc_malloc", "libc", "arena"};
+  const std::int64_t requests = config.iterations * 8;
+  const std::int64_t request_temps = 64;
+  const std::int64_t bulk_temps = config.iterations * 50;
+  std::vector<CJob*> jobs(static_cast<std::size_t>(requests));
+  for (int mode = 0; mode < 3; ++mode) {
+    const Clock::time_point start = Clock::now();
+    for (CJob*& job : jobs) {
+      job = JobQue(AsFnPtr(&BenchArenaJob), ArenaJobArg(mode, request_temps), -1, 0);
+    }
+    for (CJob* job : jobs) {
+      (void)JobResGet(job);
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "arena.request.%s", mode_names[mode]);
+    ReportRate(name, requests * request_temps, ElapsedNs(start, Clock::now()));
+  }
+  for (int mode = 0; mode < 3; ++mode) {
+    const Clock::time_point start = Clock::now();
+    (void)JobResGet(JobQue(AsFnPtr(&BenchArenaJob), ArenaJobArg(mode, bulk_temps), -1, 0));
+    char name[64];
+    std::snprintf(name, sizeof(name), "arena.bulk.%s", mode_names[mode]);
+    ReportRate(name, bulk_temps, ElapsedNs(start, Clock::now()));
+  }
+}
+
+struct ReflectionBenchArgs {
+  const std::vector<std::string>* names;
+  std::int64_t lookups;
+  std::int64_t seed;
+};
+
+void* BenchReflectionMain(void* opaque) {
+  const ReflectionBenchArgs* args = static_cast<const ReflectionBenchArgs*>(opaque);
+  const std::vector<std::string>& names = *args->names;
+  std::uint64_t seed = 0x9E3779B97F4A7C15ULL ^ static_cast<std::uint64_t>(args->seed);
+  std::int64_t found = 0;
+  for (std::int64_t i = 0; i < args->lookups; ++i) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const std::string& name = names[static_cast<std::size_t>(seed >> 33) % names.size()];
+    CHashClass* klass = HashFind(name.c_str(), nullptr, 0);
+    CMemberLst* member = MemberFind("f5", klass);
+    found += MemberMetaData("dft_val", member);
+  }
+  g_bench_sink.fetch_add(found, std::memory_order_relaxed);
+  return nullptr;
+}
+
+void BenchReflection(const BenchConfig& config) {
+  const std::size_t class_count = 1000;
+  const std::size_t fields_per_class = 8;
+  std::vector<std::string> class_names;
+  std::vector<std::string> field_names;
+  std::vector<std::string> annotations;
+  class_names.reserve(class_count);
+  for (std::size_t c = 0; c < class_count; ++c) {
+    class_names.push_back("CBenchClass" + std::to_string(c));
+  }
+  for (std::size_t f = 0; f < fields_per_class; ++f) {
+    char field[16];
+    char annotation[64];
+    std::snprintf(field, sizeof(field), "f%zu", f);
+    std::snprintf(annotation, sizeof(annotation), "dft_val %zu format \"%%d\"", f);
+    field_names.emplace_back(field);
+    annotations.emplace_back(annotation);
+  }
+  std::vector<hc_reflection_meta> metas;
+  for (std::size_t f = 0; f < fields_per_class; ++f) {
+    metas.push_back({"dft_val", static_cast<std::int64_t>(f)});
+    metas.push_back({"format", static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>("%d"))});
+  }
+  std::vector<hc_reflection_field> parsed;
+  std::vector<hc_reflection_field> resolved;
+  parsed.reserve(class_count * fields_per_class);
+  resolved.reserve(class_count * fields_per_class);
+  for (const std::string& klass : class_names) {
+    for (std::size_t f = 0; f < fields_per_class; ++f) {
+      parsed.push_back({klass.c_str(), field_names[f].c_str(), "I64", annotations[f].c_str(), 0, 0,
+                        nullptr, 0});
+      resolved.push_back({klass.c_str(), field_names[f].c_str(), "I64", annotations[f].c_str(),
+                          static_cast<std::int64_t>(f * 8), 8, &metas[f * 2], 2});
+    }
+  }
+
+  hc_register_reflection_table(parsed.data(), parsed.size());
+  const Clock::time_point parsed_start = Clock::now();
+  (void)HashFind(class_names.back().c_str(), nullptr, 0);
+  ReportRate("reflection.first_lookup.parsed", 1, ElapsedNs(parsed_start, Clock::now()));
+
+  hc_register_reflection_table(resolved.data(), resolved.size());
+  const Clock::time_point resolved_start = Clock::now();
+  (void)HashFind(class_names.back().c_str(), nullptr, 0);
+  ReportRate("reflection.first_lookup.resolved", 1, ElapsedNs(resolved_start, Clock::now()));
+
+  const std::int64_t lookups = config.iterations * 10;
+  for (const int threads : {1, 16}) {
+    std::vector<pthread_t> workers(static_cast<std::size_t>(threads));
+    std::vector<ReflectionBenchArgs> args(static_cast<std::size_t>(threads));
+    const Clock::time_point start = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+      args[static_cast<std::size_t>(t)] = ReflectionBenchArgs{&class_names, lookups, t};
+      pthread_create(&workers[static_cast<std::size_t>(t)], nullptr, BenchReflectionMain,
+                     &args[static_cast<std::size_t>(t)]);
+    }
+    for (pthread_t worker : workers) {
+      pthread_join(worker, nullptr);
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "reflection.hashfind.%dt", threads);
+    ReportRate(name, lookups * threads, ElapsedNs(start, Clock::now()));
+  }
+  hc_register_reflection_table(nullptr, 0);
+}
+
+struct BenchEntry {
+  const char* name;
+  void (*run)(const BenchConfig&);
+};
+
+const BenchEntry kBenches[] = {
+    {"jobs", BenchJobs},
+    {"jobs-pinned", BenchJobsPinned},
+    {"parfor", BenchParFor},
+    {"fibers", BenchFibers},
+    {"stkgrow", BenchStkGrow},
+    {"spawn-contention", BenchSpawnContention},
+    {"procs", BenchProcs},
+    {"fifo", BenchFifo},
+    {"lock", BenchLock},
+    {"print", BenchPrint},
+    {"exceptions", BenchExceptions},
+    {"malloc", BenchMalloc},
+    {"arena", BenchArena},
+    {"reflection", BenchReflection},
+};
+
+void PrintUsage() {
+  std::fprintf(stderr, "usage: runtime_bench [--iterations=N] [bench...]\nbenches:");
+  for (const BenchEntry& entry : kBenches) {
+    std::fprintf(stderr, " %s", entry.name);
+  }
+  std::fprintf(stderr, "\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchConfig config;
+  std::vector<std::string> selected;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--iterations=", 0) == 0) {
+      config.iterations = std::strtoll(arg.c_str() + 13, nullptr, 10);
+      if (config.iterations <= 0) {
+        PrintUsage();
+        return 2;
+      }
+      continue;
+    }
+    if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    }
+    if (!arg.empty() && arg[0] == '-') {
+      PrintUsage();
+      return 2;
+    }
+    selected.push_back(arg);
+  }
+
+  for (const std::string& name : selected) {
+    bool known = false;
+    for (const BenchEntry& entry : kBenches) {
+      known = known || name == entry.name;
+    }
+    if (!known) {
+      std::fprintf(stderr, "error: unknown benchmark: %s\n", name.c_str());
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  for (const BenchEntry& entry : kBenches) {
+    bool enabled = selected.empty();
+    for (const std::string& name : selected) {
+      enabled = enabled || name == entry.name;
+    }
+    if (enabled) {
+      entry.run(config);
+    }
+  }
+  return 0;
+}